@@ -68,25 +68,33 @@
 
 /**
  * @brief 将数据放在boot与app共享的ram，
- * boot与app之间的切换不会影响这些数据。
+ * boot与app之间的切换不会影响这些数据，该区域不缓存。
  */
 #define SHARE SECTION(".share")
 
 /**
  * @brief 将有值数据放在外设可访问的ram，
- * boot与app之间的切换会覆盖这些数据。
+ * boot与app之间的切换会覆盖这些数据，
+ * 该区域不缓存，dma缓冲区无需维护dcache。
  */
 #define SHARE_INIT SECTION(".share_init")
 
 /**
  * @brief 将无值数据放在外设可访问的ram，
- * boot与app之间的切换可能会覆盖这些数据。
+ * boot与app之间的切换可能会覆盖这些数据，
+ * 该区域不缓存，dma缓冲区无需维护dcache。
  */
 #define SHARE_UNINIT SECTION(".share_uninit")
 
+/**
+ * @brief 将无值数据放在axiram，适合放置大块的缓冲区，
+ * 复位时会被清零，该区域按写回缓存，不要用作dma缓冲区。
+ */
+#define AXI_UNINIT SECTION(".axi_uninit")
+
 /**
  * @brief 将数据放在备份ram，电池供电时始终保持数据存在，
- * 除非程序的显示修改。
+ * 除非程序的显示修改，该区域不缓存，写入立即生效。
  */
 #define BACKUP SECTION(".backup")
 
@@ -0,0 +1,28 @@
+/**
+ * @file crc.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-06
+ * @copyright Copyright (c) 2026
+ * @brief 提供硬件crc外设接口，
+ * 上层按CRC-16/XMODEM参数计算校验值，不直接依赖具体mcu的crc外设。
+ */
+
+#ifndef _CRC_H_
+#define _CRC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief 使用硬件外设继续计算CRC-16/XMODEM(多项式0x1021，不反转)。
+ * @param crc 输入为当前的crc值，成功时输出更新后的crc值。
+ * @param data 数据指针，无对齐要求。
+ * @param len 数据长度。
+ * @return true 计算完成。
+ * @return false 外设正被其他上下文使用，调用者应改用软件计算。
+ */
+extern bool bsp_crc16_update(uint16_t *crc, const uint8_t *data, size_t len);
+
+#endif
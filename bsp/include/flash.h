@@ -0,0 +1,91 @@
+/**
+ * @file flash.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-02
+ * @copyright Copyright (c) 2026
+ * @brief 提供片内flash的擦除与编程接口，
+ * 上层只按地址操作flash，不直接依赖具体mcu的flash控制器。
+ * 在线程中调用时由flash中断完成操作，调用线程阻塞等待，其他线程照常运行；
+ * 两个bank各自排队，一个bank擦除时另一个bank可以同时编程；
+ * 调度器启动前或在中断中调用时退回到关中断轮询。
+ */
+
+#ifndef _FLASH_H_
+#define _FLASH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief 定义flash操作的返回值。
+ */
+typedef enum bsp_flash_error_t {
+    BSP_FLASH_OK            = 0,  //!< 操作成功
+    BSP_FLASH_ERROR_PARAM   = -1, //!< 地址越界或未对齐
+    BSP_FLASH_ERROR_UNLOCK  = -2, //!< 解锁控制寄存器失败
+    BSP_FLASH_ERROR_ERASE   = -3, //!< 擦除失败
+    BSP_FLASH_ERROR_PROGRAM = -4, //!< 编程失败
+    BSP_FLASH_ERROR_TIMEOUT = -5, //!< 等待操作完成超时
+} bsp_flash_error_t;
+
+/**
+ * @brief 判断地址是否位于片内flash。
+ * @param addr 待判断的地址。
+ * @return true 位于片内flash。
+ * @return false 不在片内flash。
+ */
+extern bool bsp_flash_contains(uint32_t addr);
+
+/**
+ * @brief 擦除地址所在的扇区。
+ * @param addr 扇区内任意地址。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+extern int bsp_flash_erase_sector_by_addr(uint32_t addr);
+
+/**
+ * @brief 擦除覆盖[addr, addr + size)的所有扇区。
+ * @param addr 起始地址，必须按扇区对齐。
+ * @param size 需要擦除的字节数，向上取整到扇区。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+extern int bsp_flash_erase(uint32_t addr, uint32_t size);
+
+/**
+ * @brief 在后台擦除覆盖[addr, addr + size)的所有扇区，启动后立即返回。
+ * 同一bank上的后续操作会先等待擦除完成，另一个bank不受影响。
+ * @param addr 起始地址，必须按扇区对齐。
+ * @param size 需要擦除的字节数，向上取整到扇区。
+ * @return int 成功启动返回BSP_FLASH_OK，失败返回负数错误码。
+ * @note 调度器启动前或在中断中调用时同步擦除。
+ */
+extern int bsp_flash_erase_start(uint32_t addr, uint32_t size);
+
+/**
+ * @brief 等待地址所在bank上的后台操作全部完成。
+ * @param addr bank内任意地址。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+extern int bsp_flash_wait(uint32_t addr);
+
+/**
+ * @brief 判断一段flash是否全部处于擦除状态。
+ * @param addr 起始地址，必须按4字节对齐。
+ * @param size 字节数。
+ * @return true 全部为0xFF，无需擦除。
+ * @return false 存在已编程的数据，或地址越界。
+ */
+extern bool bsp_flash_is_blank(uint32_t addr, uint32_t size);
+
+/**
+ * @brief 向已擦除的flash写入数据。
+ * @param addr 写入地址，必须按flash word对齐。
+ * @param data 数据指针，无对齐要求。
+ * @param size 数据长度，不足一个flash word的部分以0xFF填充。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ * @note 同一个flash word在擦除前只能编程一次。
+ */
+extern int bsp_flash_write(uint32_t addr, const uint8_t *data, uint32_t size);
+
+#endif
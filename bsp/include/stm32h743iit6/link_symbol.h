@@ -20,6 +20,12 @@ extern const char _stack_min_size[]; //!< 栈最小大小
 extern const char _heap_start[];     //!< 紧跟在数据段之后
 extern const char _heap_end[];       //!< 堆结束地址(紧靠栈且不覆盖最小栈空间)
 
+/**
+ * @brief 导入普通代码段符号定义。
+ */
+extern const char _code_start[]; //!< flash中普通代码段的起始地址
+extern const char _code_end[];   //!< flash中普通代码段的结束地址
+
 /**
  * @brief 导入itcm初始化符号定义。
  */
@@ -27,6 +33,13 @@ extern const char _itcm_section_addr[]; //!< flash中快速代码段的起始地
 extern const char _itcm_ram_start[];    //!< itcm中快速代码段的起始地址
 extern const char _itcm_ram_end[];      //!< itcm中快速代码段的结束地址
 
+/**
+ * @brief 导入dtcm热点常量符号定义。
+ */
+extern const char _dtcm_const_section_addr[]; //!< flash中dtcm热点常量的起始地址
+extern const char _dtcm_const_start[];        //!< dtcm中热点常量的起始地址
+extern const char _dtcm_const_end[];          //!< dtcm中热点常量的结束地址
+
 /**
  * @brief 导入dtcm初始化符号定义。
  */
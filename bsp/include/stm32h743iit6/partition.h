@@ -12,13 +12,28 @@
 
 #include "specification.h" //!< 导入内存划分与段分配
 
+/**
+ * @brief 原地升级布局，差分补丁直接改写user分区，不再保留oem分区，
+ * user分区同时容纳旧固件、新固件与还原时的移位空间。
+ */
+#ifndef PARTITION_IN_PLACE
+#define PARTITION_IN_PLACE 0
+#endif
+
 /**
  * @brief 各分区占用扇区数量。
  */
+#if PARTITION_IN_PLACE
+#define LOADER_SECTOR_COUNT 2  //!< 引导程序占用扇区数量
+#define USER_SECTOR_COUNT   12 //!< 用户程序占用扇区数量
+#define PATCH_SECTOR_COUNT  2  //!< 差分补丁占用扇区数量
+#define OEM_SECTOR_COUNT    0  //!< 厂商程序占用扇区数量
+#else
 #define LOADER_SECTOR_COUNT 2 //!< 引导程序占用扇区数量
 #define USER_SECTOR_COUNT   6 //!< 用户程序占用扇区数量
 #define PATCH_SECTOR_COUNT  2 //!< 差分补丁占用扇区数量
 #define OEM_SECTOR_COUNT    6 //!< 厂商程序占用扇区数量
+#endif
 
 /**
  * @brief 内存各分区占用大小。
@@ -17,6 +17,8 @@
 #define MCU_FLASH_SECTOR_SIZE  0x00020000 //!< 扇区大小
 #define MCU_FLASH_START        0x08000000 //!< 起始地址
 #define MCU_FLASH_SECTOR_COUNT 16         //!< 扇区数量
+#define MCU_FLASH_BANK_SECTORS 8          //!< 单个bank的扇区数量
+#define MCU_FLASH_WORD_SIZE    32         //!< 最小编程单位(flash word)大小
 
 /**
  * @brief ITCM规格参数。
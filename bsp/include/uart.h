@@ -0,0 +1,57 @@
+/**
+ * @file uart.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-22
+ * @copyright Copyright (c) 2026
+ * @brief 提供串口发送接口，数据先拷贝进发送环形缓冲区，由dma在后台发出，
+ * 调用者不再逐字节等待发送寄存器为空。
+ * 缓冲区满时线程阻塞等待dma完成，中断中轮询dma完成标志；
+ * 调度器启动前、关中断或在系统异常中调用时退回到轮询，并等待数据全部发出。
+ */
+
+#ifndef _UART_H_
+#define _UART_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief usart1(控制台)发送缓冲区大小，必须为2的幂。
+ */
+#ifndef BSP_UART1_TX_BUF_SIZE
+#define BSP_UART1_TX_BUF_SIZE (1024 * 2)
+#endif
+
+/**
+ * @brief uart4(ymodem)发送缓冲区大小，必须为2的幂。
+ */
+#ifndef BSP_UART4_TX_BUF_SIZE
+#define BSP_UART4_TX_BUF_SIZE (64)
+#endif
+
+/**
+ * @brief 定义支持dma发送的串口。
+ */
+typedef enum bsp_uart_t {
+    BSP_UART_USART1 = 0, //!< 控制台
+    BSP_UART_UART4,      //!< ymodem
+    BSP_UART_COUNT,
+} bsp_uart_t;
+
+/**
+ * @brief 发送一段数据。
+ * @param port 串口。
+ * @param buf 数据。
+ * @param size 字节数。
+ * @return size_t 已放入发送缓冲区的字节数，总是等于size。
+ */
+extern size_t bsp_uart_write(bsp_uart_t port, const void *buf, size_t size);
+
+/**
+ * @brief 等待发送缓冲区中的数据全部发出。
+ * @param port 串口。
+ */
+extern void bsp_uart_flush(bsp_uart_t port);
+
+#endif
@@ -0,0 +1,94 @@
+#include <crc.h>
+#include <main.h>
+#include <mcu.h>
+
+/**
+ * @brief 外设是否已完成时钟与多项式配置。
+ */
+static volatile bool bsp_crc_ready = false;
+
+/**
+ * @brief 外设是否正被占用，被占用时调用者回退到软件计算。
+ */
+static volatile bool bsp_crc_busy = false;
+
+/**
+ * @brief 尝试占用crc外设。
+ * @return true 占用成功。
+ * @return false 外设正被其他上下文使用。
+ */
+ITCM static bool bsp_crc_acquire(void)
+{
+    bool result = false;
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!bsp_crc_busy)
+    {
+        bsp_crc_busy = true;
+        result = true;
+    }
+    __set_PRIMASK(primask);
+    return result;
+}
+
+/**
+ * @brief 释放crc外设。
+ */
+ITCM static void bsp_crc_release(void)
+{
+    bsp_crc_busy = false;
+}
+
+/**
+ * @brief 开启外设时钟并配置为16位多项式0x1021，输入输出均不反转。
+ */
+ITCM static void bsp_crc_setup(void)
+{
+    __HAL_RCC_CRC_CLK_ENABLE();
+    CRC->POL = 0x1021;
+    CRC->CR = CRC_CR_POLYSIZE_0;
+    bsp_crc_ready = true;
+}
+
+ITCM bool bsp_crc16_update(uint16_t *crc, const uint8_t *data, size_t len)
+{
+    if (!bsp_crc_acquire())
+    {
+        return false;
+    }
+
+    if (!bsp_crc_ready)
+    {
+        bsp_crc_setup();
+    }
+
+    // 复位时从INIT装载初值，从而支持分段计算
+    CRC->INIT = *crc;
+    CRC->CR |= CRC_CR_RESET;
+
+    // 先按字节写到4字节对齐
+    while ((len > 0) && (((uint32_t)data & 3) != 0))
+    {
+        *(volatile uint8_t *)&CRC->DR = *data++;
+        --len;
+    }
+
+    // 外设先处理字的高字节，小端数据需要翻转字节序
+    while (len >= 4)
+    {
+        CRC->DR = __REV(*(const uint32_t *)data);
+        data += 4;
+        len -= 4;
+    }
+
+    while (len > 0)
+    {
+        *(volatile uint8_t *)&CRC->DR = *data++;
+        --len;
+    }
+
+    *crc = (uint16_t)CRC->DR;
+
+    bsp_crc_release();
+    return true;
+}
@@ -0,0 +1,770 @@
+#include <flash.h>
+#include <main.h>
+#include <mcu.h>
+#include <rthw.h>
+#include <rtthread.h>
+#include <string.h>
+
+/**
+ * @brief 单个bank的字节大小。
+ */
+#define BSP_FLASH_BANK_SIZE (MCU_FLASH_BANK_SECTORS * MCU_FLASH_SECTOR_SIZE)
+
+/**
+ * @brief 片内flash的结束地址。
+ */
+#define BSP_FLASH_END                                                          \
+    (MCU_FLASH_START + MCU_FLASH_SECTOR_COUNT * MCU_FLASH_SECTOR_SIZE)
+
+/**
+ * @brief 等待单个扇区擦除完成的最长时间。
+ */
+#define BSP_FLASH_TIMEOUT_MS (5000)
+
+/**
+ * @brief 轮询单个flash word编程完成的最长时间，典型值只有几十微秒。
+ */
+#ifndef BSP_FLASH_PROGRAM_TIMEOUT_MS
+#define BSP_FLASH_PROGRAM_TIMEOUT_MS (10)
+#endif
+
+/**
+ * @brief bank数量，两个bank的控制寄存器相互独立，可以同时擦除或编程。
+ */
+#define BSP_FLASH_BANKS (MCU_FLASH_SECTOR_COUNT / MCU_FLASH_BANK_SECTORS)
+
+/**
+ * @brief 擦除与编程操作的错误标志。
+ * 单位与双位ecc错误由读取触发，与正在进行的操作无关，不计入操作结果。
+ */
+#define BSP_FLASH_SR_ERRORS                                                    \
+    (FLASH_SR_WRPERR | FLASH_SR_PGSERR | FLASH_SR_STRBERR | FLASH_SR_INCERR |  \
+     FLASH_SR_OPERR)
+
+/**
+ * @brief 擦除完成与BSP_FLASH_SR_ERRORS对应的中断使能位，
+ * 不打开ecc错误中断，中断处理不清除ecc标志，打开后会反复进入中断。
+ */
+#define BSP_FLASH_CR_IT                                                        \
+    (FLASH_CR_EOPIE | FLASH_CR_WRPERRIE | FLASH_CR_PGSERRIE |                  \
+     FLASH_CR_STRBERRIE | FLASH_CR_INCERRIE | FLASH_CR_OPERRIE)
+
+/**
+ * @brief 单个bank的中断驱动状态，只有扇区擦除由中断完成。
+ */
+typedef struct {
+    struct rt_mutex mutex;        //!< 串行化访问同一bank的线程
+    struct rt_semaphore done;     //!< 每擦除完一个扇区由中断释放
+    volatile bool busy;           //!< 有擦除正等待中断完成
+    volatile uint32_t erase_next; //!< 后台擦除队列中下一个扇区索引
+    volatile uint32_t erase_end;  //!< 后台擦除队列的结束扇区索引(不含)
+    volatile int status;          //!< 最近一次操作的结果
+} bsp_flash_bank_t;
+
+/**
+ * @brief 各bank的状态，下标0对应bank1。
+ */
+static bsp_flash_bank_t bsp_flash_banks[BSP_FLASH_BANKS];
+
+/**
+ * @brief 中断服务是否已经就绪。
+ */
+static volatile bool bsp_flash_async = false;
+
+/**
+ * @brief 返回地址所在的bank。
+ * @param addr flash地址。
+ * @return uint32_t FLASH_BANK_1或FLASH_BANK_2。
+ */
+ITCM static uint32_t bsp_flash_bank(uint32_t addr)
+{
+    return ((addr - MCU_FLASH_START) < BSP_FLASH_BANK_SIZE) ? FLASH_BANK_1
+                                                            : FLASH_BANK_2;
+}
+
+/**
+ * @brief 返回地址在所属bank内的扇区索引。
+ * @param addr flash地址。
+ * @return uint32_t 扇区索引。
+ */
+ITCM static uint32_t bsp_flash_sector(uint32_t addr)
+{
+    return ((addr - MCU_FLASH_START) / MCU_FLASH_SECTOR_SIZE) %
+           MCU_FLASH_BANK_SECTORS;
+}
+
+/**
+ * @brief 清除bank的错误标志，防止历史遗留错误导致操作失败。
+ * @param bank FLASH_BANK_1或FLASH_BANK_2。
+ */
+ITCM static void bsp_flash_clear_error(uint32_t bank)
+{
+    if (bank == FLASH_BANK_1)
+    {
+        __HAL_FLASH_CLEAR_FLAG_BANK1(FLASH_FLAG_ALL_ERRORS_BANK1);
+    }
+    else
+    {
+        __HAL_FLASH_CLEAR_FLAG_BANK2(FLASH_FLAG_ALL_ERRORS_BANK2);
+    }
+}
+
+/**
+ * @brief 丢弃dcache中[addr, addr + size)的旧内容，擦除或编程完成后调用，
+ * 之后的读取才能看到flash中的新数据。
+ * @param addr flash地址。
+ * @param size 字节数。
+ * @note flash按写透配置，缓存行中没有未写回的数据，可以直接无效化。
+ */
+ITCM static void bsp_flash_invalidate(uint32_t addr, uint32_t size)
+{
+    rt_hw_cpu_dcache_ops(RT_HW_CACHE_INVALIDATE, (void *)addr, (int)size);
+}
+
+/**
+ * @brief 返回bank内扇区的起始地址。
+ * @param bank FLASH_BANK_1或FLASH_BANK_2。
+ * @param sector bank内的扇区索引。
+ * @return uint32_t flash地址。
+ */
+ITCM static uint32_t bsp_flash_sector_addr(uint32_t bank, uint32_t sector)
+{
+    return MCU_FLASH_START + ((bank == FLASH_BANK_1) ? 0 : BSP_FLASH_BANK_SIZE) +
+           sector * MCU_FLASH_SECTOR_SIZE;
+}
+
+/**
+ * @brief 控制寄存器的解锁嵌套计数，
+ * 编程期间会开中断，其他线程可能同时操作flash。
+ */
+static volatile uint32_t bsp_flash_unlock_count = 0;
+
+/**
+ * @brief 解锁Flash控制寄存器，只有第一个使用者真正解锁。
+ * @return true 解锁成功。
+ * @return false 解锁失败。
+ */
+ITCM static bool bsp_flash_unlock(void)
+{
+    bool result = true;
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (bsp_flash_unlock_count == 0)
+    {
+        result = (HAL_FLASH_Unlock() == HAL_OK);
+    }
+    if (result)
+    {
+        ++bsp_flash_unlock_count;
+    }
+    __set_PRIMASK(primask);
+    return result;
+}
+
+/**
+ * @brief 上锁Flash控制寄存器，只有最后一个使用者真正上锁。
+ */
+ITCM static void bsp_flash_lock(void)
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if ((bsp_flash_unlock_count > 0) && (--bsp_flash_unlock_count == 0))
+    {
+        HAL_FLASH_Lock();
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 判断当前上下文能否阻塞等待中断完成，
+ * 调度器启动前或在中断中调用时退回到轮询。
+ * @return true 可以阻塞等待。
+ * @return false 只能轮询。
+ */
+ITCM static bool bsp_flash_can_wait(void)
+{
+    return bsp_flash_async && (rt_thread_self() != NULL) &&
+           (rt_interrupt_get_nest() == 0);
+}
+
+/**
+ * @brief 返回bank状态。
+ * @param bank FLASH_BANK_1或FLASH_BANK_2。
+ * @return bsp_flash_bank_t* bank状态。
+ */
+ITCM static bsp_flash_bank_t *bsp_flash_state(uint32_t bank)
+{
+    return &bsp_flash_banks[(bank == FLASH_BANK_1) ? 0 : 1];
+}
+
+/**
+ * @brief 返回bank的控制寄存器。
+ * @param bank FLASH_BANK_1或FLASH_BANK_2。
+ * @return volatile uint32_t* CR1或CR2。
+ */
+ITCM static volatile uint32_t *bsp_flash_cr(uint32_t bank)
+{
+    return (bank == FLASH_BANK_1) ? &FLASH->CR1 : &FLASH->CR2;
+}
+
+/**
+ * @brief 启动单个扇区的擦除，完成时产生中断。
+ * @param bank FLASH_BANK_1或FLASH_BANK_2。
+ * @param sector bank内的扇区索引。
+ */
+ITCM static void bsp_flash_start_erase(uint32_t bank, uint32_t sector)
+{
+    volatile uint32_t *cr = bsp_flash_cr(bank);
+    *cr &= ~(FLASH_CR_PSIZE | FLASH_CR_SNB);
+    *cr |= BSP_FLASH_CR_IT;
+    *cr |= FLASH_CR_SER | FLASH_VOLTAGE_RANGE_3 |
+           (sector << FLASH_CR_SNB_Pos) | FLASH_CR_START;
+}
+
+/**
+ * @brief 启动单个flash word的编程，不产生中断，由bsp_flash_program_poll等待。
+ * @param bank FLASH_BANK_1或FLASH_BANK_2。
+ * @param addr flash word地址。
+ * @param src 4字节对齐的源数据。
+ */
+ITCM static void bsp_flash_start_program(uint32_t bank, uint32_t addr,
+                                         const uint32_t *src)
+{
+    volatile uint32_t *cr = bsp_flash_cr(bank);
+    volatile uint32_t *dest = (volatile uint32_t *)addr;
+
+    // 写缓冲必须连续写满，期间不能被同一bank的其他访问打断
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *cr |= FLASH_CR_PG;
+    __ISB();
+    __DSB();
+    for (uint32_t i = 0; i < (MCU_FLASH_WORD_SIZE / sizeof(uint32_t)); ++i)
+    {
+        dest[i] = src[i];
+    }
+    __ISB();
+    __DSB();
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 轮询等待flash word编程完成并清除标志位。
+ * 单次编程只有几十微秒，比等待完成中断再切换线程的开销小得多，
+ * 轮询期间不关中断，其他中断照常响应。
+ * @param bank FLASH_BANK_1或FLASH_BANK_2。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+ITCM static int bsp_flash_program_poll(uint32_t bank)
+{
+    volatile uint32_t *sr = (bank == FLASH_BANK_1) ? &FLASH->SR1 : &FLASH->SR2;
+    volatile uint32_t *ccr =
+        (bank == FLASH_BANK_1) ? &FLASH->CCR1 : &FLASH->CCR2;
+    const rt_tick_t timeout =
+        rt_tick_from_millisecond(BSP_FLASH_PROGRAM_TIMEOUT_MS) + 1;
+    const rt_tick_t start = rt_tick_get();
+    int result = BSP_FLASH_OK;
+
+    while ((*sr & FLASH_SR_QW) != 0)
+    {
+        // 调度器启动前关中断调用时滴答不增加，由HAL的轮询路径处理
+        if ((rt_tick_get() - start) > timeout)
+        {
+            result = BSP_FLASH_ERROR_TIMEOUT;
+            break;
+        }
+    }
+
+    const uint32_t flags = *sr & (FLASH_SR_EOP | BSP_FLASH_SR_ERRORS);
+    *ccr = flags;
+    *bsp_flash_cr(bank) &= ~FLASH_CR_PG;
+    if ((result == BSP_FLASH_OK) && ((flags & BSP_FLASH_SR_ERRORS) != 0))
+    {
+        result = BSP_FLASH_ERROR_PROGRAM;
+    }
+    return result;
+}
+
+/**
+ * @brief 标记bank开始一次中断驱动的擦除，调用者持有bank互斥锁且bank空闲。
+ * @param state bank状态。
+ */
+ITCM static void bsp_flash_begin(bsp_flash_bank_t *state)
+{
+    rt_sem_control(&state->done, RT_IPC_CMD_RESET, NULL);
+    state->status = BSP_FLASH_OK;
+    state->busy = true;
+}
+
+/**
+ * @brief 等待超时后中止bank上的操作，丢弃擦除队列并释放它持有的解锁，
+ * 否则busy一直为真，之后的每次操作都会再等待一次超时。
+ * @param state bank状态。
+ */
+ITCM static void bsp_flash_abort(bsp_flash_bank_t *state)
+{
+    const uint32_t bank =
+        (state == &bsp_flash_banks[0]) ? FLASH_BANK_1 : FLASH_BANK_2;
+    volatile uint32_t *cr = bsp_flash_cr(bank);
+
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *cr &= ~(FLASH_CR_START | FLASH_CR_PG | FLASH_CR_SER | FLASH_CR_SNB |
+             BSP_FLASH_CR_IT);
+    if (state->erase_end > 0)
+    {
+        // 扇区内容不确定，由后续的空白检查或擦除处理
+        state->erase_end = 0;
+        state->erase_next = 0;
+        bsp_flash_lock();
+    }
+    state->status = BSP_FLASH_ERROR_TIMEOUT;
+    state->busy = false;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 阻塞等待bank上的操作全部完成，等待期间其他线程照常运行。
+ * @param state bank状态。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+ITCM static int bsp_flash_wait_idle(bsp_flash_bank_t *state)
+{
+    while (state->busy)
+    {
+        // 后台擦除队列每完成一个扇区都会唤醒一次
+        if (rt_sem_take(&state->done,
+                        rt_tick_from_millisecond(BSP_FLASH_TIMEOUT_MS)) !=
+            RT_EOK)
+        {
+            bsp_flash_abort(state);
+        }
+    }
+
+    // 每个错误只报告给第一个等待者，例如后台擦除失败时的下一次编程
+    const int result = state->status;
+    state->status = BSP_FLASH_OK;
+    return result;
+}
+
+/**
+ * @brief 处理一个bank的完成与错误标志，擦除队列未空时启动下一个扇区。
+ * @param bank FLASH_BANK_1或FLASH_BANK_2。
+ */
+ITCM static void bsp_flash_bank_irq(uint32_t bank)
+{
+    bsp_flash_bank_t *state = bsp_flash_state(bank);
+    volatile uint32_t *sr = (bank == FLASH_BANK_1) ? &FLASH->SR1 : &FLASH->SR2;
+    volatile uint32_t *ccr =
+        (bank == FLASH_BANK_1) ? &FLASH->CCR1 : &FLASH->CCR2;
+
+    // 编程轮询期间的标志位由bsp_flash_program_poll处理，不能在这里清除
+    const uint32_t flags = *sr & (FLASH_SR_EOP | BSP_FLASH_SR_ERRORS);
+    if ((flags == 0) || !state->busy)
+    {
+        return;
+    }
+
+    // 清除标志位的位置与状态寄存器一致
+    *ccr = flags;
+    volatile uint32_t *cr = bsp_flash_cr(bank);
+    *cr &= ~(FLASH_CR_SER | FLASH_CR_SNB);
+
+    // 刚结束的扇区，失败时内容同样不确定
+    bsp_flash_invalidate(bsp_flash_sector_addr(bank, state->erase_next - 1),
+                         MCU_FLASH_SECTOR_SIZE);
+
+    if ((flags & BSP_FLASH_SR_ERRORS) != 0)
+    {
+        state->status = BSP_FLASH_ERROR_ERASE;
+        state->erase_next = state->erase_end;
+    }
+
+    if (state->erase_next < state->erase_end)
+    {
+        bsp_flash_start_erase(bank, state->erase_next++);
+    }
+    else
+    {
+        // 后台擦除队列结束，释放启动时的解锁
+        *cr &= ~BSP_FLASH_CR_IT;
+        state->erase_end = 0;
+        state->erase_next = 0;
+        bsp_flash_lock();
+        state->busy = false;
+    }
+    rt_sem_release(&state->done);
+}
+
+/**
+ * @brief 在后台擦除同一个bank内连续的扇区，启动后立即返回。
+ * @param bank FLASH_BANK_1或FLASH_BANK_2。
+ * @param sector 起始扇区索引。
+ * @param count 扇区数量。
+ * @return int 成功启动返回BSP_FLASH_OK，失败返回负数错误码。
+ * @note 调用者持有bank互斥锁。
+ */
+ITCM static int bsp_flash_erase_bank_start(uint32_t bank, uint32_t sector,
+                                           uint32_t count)
+{
+    bsp_flash_bank_t *state = bsp_flash_state(bank);
+
+    // 同一bank一次只能进行一个操作，先等待之前的操作结束
+    if (bsp_flash_wait_idle(state) == BSP_FLASH_ERROR_TIMEOUT)
+    {
+        return BSP_FLASH_ERROR_TIMEOUT;
+    }
+
+    if (!bsp_flash_unlock())
+    {
+        return BSP_FLASH_ERROR_UNLOCK;
+    }
+
+    bsp_flash_clear_error(bank);
+    bsp_flash_begin(state);
+
+    // 擦除队列由中断逐个扇区推进，结束时在中断中上锁
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    state->erase_next = sector + 1;
+    state->erase_end = sector + count;
+    bsp_flash_start_erase(bank, sector);
+    __set_PRIMASK(primask);
+
+    return BSP_FLASH_OK;
+}
+
+/**
+ * @brief 擦除同一个bank内连续的扇区。
+ * @param bank FLASH_BANK_1或FLASH_BANK_2。
+ * @param sector 起始扇区索引。
+ * @param count 扇区数量。
+ * @param wait 是否等待擦除完成。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+ITCM static int bsp_flash_erase_bank(uint32_t bank, uint32_t sector,
+                                     uint32_t count, bool wait)
+{
+    int result = BSP_FLASH_OK;
+
+    if (bsp_flash_can_wait())
+    {
+        bsp_flash_bank_t *state = bsp_flash_state(bank);
+        rt_mutex_take(&state->mutex, RT_WAITING_FOREVER);
+        result = bsp_flash_erase_bank_start(bank, sector, count);
+        if ((result == BSP_FLASH_OK) && wait)
+        {
+            result = bsp_flash_wait_idle(state);
+        }
+        rt_mutex_release(&state->mutex);
+        return result;
+    }
+
+    FLASH_EraseInitTypeDef flash_erase_configuration = {
+        .TypeErase = FLASH_TYPEERASE_SECTORS,
+        .Banks = bank,
+        .Sector = sector,
+        .NbSectors = count,
+        .VoltageRange = FLASH_VOLTAGE_RANGE_3,
+    };
+
+    // 在擦除前关闭全局中断
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    // 解锁Flash控制寄存器
+    if (!bsp_flash_unlock())
+    {
+        result = BSP_FLASH_ERROR_UNLOCK;
+    }
+    else
+    {
+        bsp_flash_clear_error(bank);
+
+        uint32_t sector_error;
+        if (HAL_FLASHEx_Erase(&flash_erase_configuration, &sector_error) !=
+            HAL_OK)
+        {
+            result = BSP_FLASH_ERROR_ERASE;
+        }
+        bsp_flash_invalidate(bsp_flash_sector_addr(bank, sector),
+                             count * MCU_FLASH_SECTOR_SIZE);
+
+        // 上锁Flash控制寄存器
+        bsp_flash_lock();
+    }
+
+    // 恢复全局中断
+    __set_PRIMASK(primask);
+
+    return result;
+}
+
+ITCM bool bsp_flash_contains(uint32_t addr)
+{
+    return (addr >= MCU_FLASH_START) && (addr < BSP_FLASH_END);
+}
+
+ITCM int bsp_flash_erase_sector_by_addr(uint32_t addr)
+{
+    if (!bsp_flash_contains(addr))
+    {
+        return BSP_FLASH_ERROR_PARAM;
+    }
+
+    return bsp_flash_erase_bank(bsp_flash_bank(addr), bsp_flash_sector(addr),
+                                1, true);
+}
+
+/**
+ * @brief 擦除覆盖[addr, addr + size)的所有扇区。
+ * @param addr 起始地址，必须按扇区对齐。
+ * @param size 需要擦除的字节数，向上取整到扇区。
+ * @param wait 是否等待擦除完成。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+ITCM static int bsp_flash_erase_range(uint32_t addr, uint32_t size, bool wait)
+{
+    if (!bsp_flash_contains(addr) ||
+        ((addr - MCU_FLASH_START) % MCU_FLASH_SECTOR_SIZE) != 0)
+    {
+        return BSP_FLASH_ERROR_PARAM;
+    }
+
+    uint32_t count = (size + MCU_FLASH_SECTOR_SIZE - 1) / MCU_FLASH_SECTOR_SIZE;
+    if (count > (BSP_FLASH_END - addr) / MCU_FLASH_SECTOR_SIZE)
+    {
+        return BSP_FLASH_ERROR_PARAM;
+    }
+
+    while (count > 0)
+    {
+        // 一次擦除不能跨越bank，按bank拆分
+        const uint32_t sector = bsp_flash_sector(addr);
+        uint32_t number = MCU_FLASH_BANK_SECTORS - sector;
+        if (number > count)
+        {
+            number = count;
+        }
+
+        const int result =
+            bsp_flash_erase_bank(bsp_flash_bank(addr), sector, number, wait);
+        if (result != BSP_FLASH_OK)
+        {
+            return result;
+        }
+
+        addr += number * MCU_FLASH_SECTOR_SIZE;
+        count -= number;
+    }
+
+    return BSP_FLASH_OK;
+}
+
+ITCM int bsp_flash_erase(uint32_t addr, uint32_t size)
+{
+    return bsp_flash_erase_range(addr, size, true);
+}
+
+ITCM int bsp_flash_erase_start(uint32_t addr, uint32_t size)
+{
+    return bsp_flash_erase_range(addr, size, false);
+}
+
+ITCM int bsp_flash_wait(uint32_t addr)
+{
+    if (!bsp_flash_contains(addr))
+    {
+        return BSP_FLASH_ERROR_PARAM;
+    }
+    if (!bsp_flash_can_wait())
+    {
+        return BSP_FLASH_OK;
+    }
+
+    bsp_flash_bank_t *state = bsp_flash_state(bsp_flash_bank(addr));
+    rt_mutex_take(&state->mutex, RT_WAITING_FOREVER);
+    const int result = bsp_flash_wait_idle(state);
+    rt_mutex_release(&state->mutex);
+    return result;
+}
+
+ITCM bool bsp_flash_is_blank(uint32_t addr, uint32_t size)
+{
+    if (!bsp_flash_contains(addr) || ((addr & 3) != 0) ||
+        (size > BSP_FLASH_END - addr))
+    {
+        return false;
+    }
+
+    const uint32_t *word = (const uint32_t *)addr;
+    uint32_t remaining = size / sizeof(uint32_t);
+
+    // 每次合并一个flash word再比较，减少分支
+    while (remaining >= (MCU_FLASH_WORD_SIZE / sizeof(uint32_t)))
+    {
+        const uint32_t merged = word[0] & word[1] & word[2] & word[3] &
+                                word[4] & word[5] & word[6] & word[7];
+        if (merged != 0xFFFFFFFF)
+        {
+            return false;
+        }
+        word += MCU_FLASH_WORD_SIZE / sizeof(uint32_t);
+        remaining -= MCU_FLASH_WORD_SIZE / sizeof(uint32_t);
+    }
+
+    while (remaining-- > 0)
+    {
+        if (*word++ != 0xFFFFFFFF)
+        {
+            return false;
+        }
+    }
+
+    // 不足4字节的零头逐字节比较
+    const uint8_t *byte = (const uint8_t *)word;
+    for (uint32_t i = 0; i < (size & 3); ++i)
+    {
+        if (byte[i] != 0xFF)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+ITCM int bsp_flash_write(uint32_t addr, const uint8_t *data, uint32_t size)
+{
+    if (!bsp_flash_contains(addr) || ((addr & (MCU_FLASH_WORD_SIZE - 1)) != 0) ||
+        (size > BSP_FLASH_END - addr))
+    {
+        return BSP_FLASH_ERROR_PARAM;
+    }
+
+    int result = BSP_FLASH_OK;
+    uint8_t word[MCU_FLASH_WORD_SIZE] ALIGN(MCU_FLASH_WORD_SIZE);
+    const uint32_t bank = bsp_flash_bank(addr);
+    const bool wait = bsp_flash_can_wait();
+    bsp_flash_bank_t *state = bsp_flash_state(bank);
+
+    if (wait)
+    {
+        // 同一bank上可能还有后台擦除，必须等它完成后才能编程
+        rt_mutex_take(&state->mutex, RT_WAITING_FOREVER);
+        result = bsp_flash_wait_idle(state);
+        if (result != BSP_FLASH_OK)
+        {
+            rt_mutex_release(&state->mutex);
+            return result;
+        }
+    }
+
+    // 整段数据只解锁一次，而不是每个flash word都解锁
+    if (!bsp_flash_unlock())
+    {
+        if (wait)
+        {
+            rt_mutex_release(&state->mutex);
+        }
+        return BSP_FLASH_ERROR_UNLOCK;
+    }
+
+    bsp_flash_clear_error(bank);
+
+    uint32_t bytes_processed = 0;
+    while (bytes_processed < size)
+    {
+        const uint32_t remaining = size - bytes_processed;
+        const uint8_t *src = data + bytes_processed;
+
+        // 按32位字读取源数据，未对齐或不足一个flash word时先拷贝
+        if ((remaining < MCU_FLASH_WORD_SIZE) || (((uint32_t)src & 3) != 0))
+        {
+            const uint32_t copy_len = (remaining < MCU_FLASH_WORD_SIZE)
+                                          ? remaining
+                                          : MCU_FLASH_WORD_SIZE;
+            memset(word, 0xFF, sizeof(word));
+            memcpy(word, src, copy_len);
+            src = word;
+        }
+
+        if (wait)
+        {
+            // 只在填写写缓冲期间关闭全局中断，编程期间轮询完成
+            bsp_flash_start_program(bank, addr + bytes_processed,
+                                    (const uint32_t *)src);
+            result = bsp_flash_program_poll(bank);
+            if (result != BSP_FLASH_OK)
+            {
+                break;
+            }
+        }
+        else
+        {
+            // 只在单个flash word编程期间关闭全局中断
+            const uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            const HAL_StatusTypeDef status =
+                HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD,
+                                  addr + bytes_processed, (uint32_t)src);
+            __set_PRIMASK(primask);
+
+            if (status != HAL_OK)
+            {
+                result = BSP_FLASH_ERROR_PROGRAM;
+                break;
+            }
+        }
+
+        bytes_processed += MCU_FLASH_WORD_SIZE;
+    }
+
+    // 包括失败的flash word，其内容同样不确定
+    bsp_flash_invalidate(addr, (bytes_processed < size)
+                                   ? bytes_processed + MCU_FLASH_WORD_SIZE
+                                   : bytes_processed);
+
+    // 上锁Flash控制寄存器
+    bsp_flash_lock();
+
+    if (wait)
+    {
+        rt_mutex_release(&state->mutex);
+    }
+
+    return result;
+}
+
+/**
+ * @brief flash中断处理函数，两个bank共用一个中断。
+ */
+ITCM void FLASH_IRQHandler(void)
+{
+    rt_interrupt_enter();
+    bsp_flash_bank_irq(FLASH_BANK_1);
+    bsp_flash_bank_irq(FLASH_BANK_2);
+    rt_interrupt_leave();
+}
+
+/**
+ * @brief 初始化中断服务，之后线程中的flash操作都由中断完成。
+ * @return int 非0为失败。
+ */
+static int bsp_flash_init(void)
+{
+    static const char *const names[BSP_FLASH_BANKS] = {"flash1", "flash2"};
+    for (uint32_t i = 0; i < BSP_FLASH_BANKS; ++i)
+    {
+        rt_mutex_init(&bsp_flash_banks[i].mutex, names[i], RT_IPC_FLAG_PRIO);
+        rt_sem_init(&bsp_flash_banks[i].done, names[i], 0, RT_IPC_FLAG_FIFO);
+    }
+
+    NVIC_SetPriority(FLASH_IRQn,
+                     NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 6, 0));
+    NVIC_EnableIRQ(FLASH_IRQn);
+
+    bsp_flash_async = true;
+    return 0;
+}
+RUN_DEVICE_EXPORT(bsp_flash_init);
@@ -67,6 +67,9 @@ NONE void ram_init(void)
 
     __HAL_RCC_BKPRAM_CLK_ENABLE();
     PWR->CR1 |= PWR_CR1_DBP;
+
+    // 开启备份域稳压器，主电源掉电后由VBAT保持BKPRAM内容(还原检查点)
+    PWR->CR2 |= PWR_CR2_BREN;
 }
 
 /**
@@ -89,6 +92,11 @@ NAKED void reset_handler(void)
                         (size_t)_itcm_ram_end -
                             (size_t)_itcm_ram_start); //!< 拷贝itcm的数据
 
+    /* 加载dtcm的热点常量，itcm中的代码可能在启动app之前使用 */
+    reset_copy_ram_init((char *)_dtcm_const_start, _dtcm_const_section_addr,
+                        (size_t)_dtcm_const_end -
+                            (size_t)_dtcm_const_start); //!< 拷贝dtcm的常量
+
 #if defined(BUILD_LOADER)
     // 尝试启动app程序
     load_app(); //!< 所有app不满足启动要求则返回并开始启动boot
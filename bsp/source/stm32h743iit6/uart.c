@@ -0,0 +1,309 @@
+#include <main.h>
+#include <mcu.h>
+#include <rthw.h>
+#include <rtthread.h>
+#include <string.h>
+#include <uart.h>
+
+#if (BSP_UART1_TX_BUF_SIZE & (BSP_UART1_TX_BUF_SIZE - 1)) ||                  \
+    (BSP_UART4_TX_BUF_SIZE & (BSP_UART4_TX_BUF_SIZE - 1))
+#error "BSP_UART*_TX_BUF_SIZE must be a power of two"
+#endif
+
+/**
+ * @brief dma1 stream1/stream2的全部中断标志，位于LISR/LIFCR。
+ */
+#define BSP_UART_DMA_FLAGS(n)                                                  \
+    (DMA_LIFCR_CTCIF##n | DMA_LIFCR_CHTIF##n | DMA_LIFCR_CTEIF##n |            \
+     DMA_LIFCR_CDMEIF##n | DMA_LIFCR_CFEIF##n)
+
+/**
+ * @brief 单个串口的dma发送状态。
+ */
+typedef struct {
+    USART_TypeDef *uart;         //!< 串口
+    uint32_t stream;             //!< dma1数据流
+    uint32_t request;            //!< dmamux请求
+    IRQn_Type irq;               //!< dma数据流中断
+    uint32_t tc_flag;            //!< LISR中的传输完成标志
+    uint32_t clear_flags;        //!< LIFCR中的全部标志
+    uint8_t *pool;               //!< 发送缓冲区，dma可访问
+    uint32_t size;               //!< 发送缓冲区大小
+    struct rt_ringbuffer rb;     //!< 待发送的数据
+    volatile uint32_t busy;      //!< dma正在发送的字节数，0为空闲
+    volatile uint32_t waiters;   //!< 等待缓冲区空间的线程数
+    struct rt_semaphore space;   //!< 每完成一次dma传输释放给等待的线程
+} bsp_uart_tx_t;
+
+/*
+ * 发送缓冲区放在dma1可以访问的ram，dtcm对dma1不可见，
+ * 该区域由mpu配置为不缓存，启动dma前无需写回dcache
+ */
+SHARE_UNINIT ALIGN(32) static uint8_t uart1_tx_pool[BSP_UART1_TX_BUF_SIZE];
+SHARE_UNINIT ALIGN(32) static uint8_t uart4_tx_pool[BSP_UART4_TX_BUF_SIZE];
+
+/**
+ * @brief 各串口的发送状态，dma1 stream0已用于uart4接收。
+ */
+static bsp_uart_tx_t bsp_uart_tx[BSP_UART_COUNT] = {
+    [BSP_UART_USART1] =
+        {
+            .uart = USART1,
+            .stream = LL_DMA_STREAM_1,
+            .request = LL_DMAMUX1_REQ_USART1_TX,
+            .irq = DMA1_Stream1_IRQn,
+            .tc_flag = DMA_LISR_TCIF1,
+            .clear_flags = BSP_UART_DMA_FLAGS(1),
+            .pool = uart1_tx_pool,
+            .size = sizeof(uart1_tx_pool),
+        },
+    [BSP_UART_UART4] =
+        {
+            .uart = UART4,
+            .stream = LL_DMA_STREAM_2,
+            .request = LL_DMAMUX1_REQ_UART4_TX,
+            .irq = DMA1_Stream2_IRQn,
+            .tc_flag = DMA_LISR_TCIF2,
+            .clear_flags = BSP_UART_DMA_FLAGS(2),
+            .pool = uart4_tx_pool,
+            .size = sizeof(uart4_tx_pool),
+        },
+};
+
+/**
+ * @brief dma发送是否已经就绪。
+ */
+static volatile bool bsp_uart_async = false;
+
+/**
+ * @brief 当前环境能否阻塞等待dma完成。
+ * @return true 在线程中且dma已就绪。
+ */
+ITCM static bool bsp_uart_can_wait(void)
+{
+    return bsp_uart_async && (rt_thread_self() != NULL) &&
+           (rt_interrupt_get_nest() == 0);
+}
+
+/**
+ * @brief 当前环境下dma完成中断能否得到响应。
+ * @return false 关中断或处于系统异常中，只能轮询完成标志。
+ */
+ITCM static bool bsp_uart_irq_alive(void)
+{
+    const uint32_t ipsr = __get_IPSR();
+    return (__get_PRIMASK() == 0) && ((ipsr == 0) || (ipsr >= 16));
+}
+
+/**
+ * @brief 轮询发送一段数据，dma就绪前使用。
+ * @param tx 发送状态。
+ * @param data 数据。
+ * @param size 字节数。
+ */
+ITCM static void bsp_uart_tx_poll_write(bsp_uart_tx_t *tx, const uint8_t *data,
+                                        size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        // 等待发送数据寄存器为空 (TXE)
+        while (!LL_USART_IsActiveFlag_TXE_TXFNF(tx->uart))
+            ;
+        LL_USART_TransmitData8(tx->uart, data[i]);
+    }
+}
+
+/**
+ * @brief dma空闲时发出缓冲区中连续的一段数据，需在关中断时调用。
+ * @param tx 发送状态。
+ */
+ITCM static void bsp_uart_tx_kick(bsp_uart_tx_t *tx)
+{
+    if (tx->busy != 0)
+        return;
+
+    struct rt_ringbuffer_span span;
+    if (rt_ringbuffer_peek(&tx->rb, 0, tx->size, &span) == 0)
+        return;
+
+    // 跨越缓冲区末尾的第二段在本次完成后再发
+    tx->busy = span.len[0];
+    DMA1->LIFCR = tx->clear_flags;
+    LL_DMA_SetMemoryAddress(DMA1, tx->stream, (uint32_t)span.ptr[0]);
+    LL_DMA_SetDataLength(DMA1, tx->stream, span.len[0]);
+    LL_DMA_EnableStream(DMA1, tx->stream);
+}
+
+/**
+ * @brief 处理dma传输完成，释放已发出的数据并启动下一段，需在关中断时调用。
+ * @param tx 发送状态。
+ */
+ITCM static void bsp_uart_tx_done(bsp_uart_tx_t *tx)
+{
+    if (!(DMA1->LISR & tx->tc_flag))
+        return;
+
+    DMA1->LIFCR = tx->clear_flags;
+    rt_ringbuffer_consume(&tx->rb, tx->busy);
+    tx->busy = 0;
+    bsp_uart_tx_kick(tx);
+
+    while (tx->waiters > 0)
+    {
+        tx->waiters--;
+        rt_sem_release(&tx->space);
+    }
+}
+
+/**
+ * @brief 中断无法响应时轮询dma完成标志。
+ * @param tx 发送状态。
+ */
+ITCM static void bsp_uart_tx_poll(bsp_uart_tx_t *tx)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    bsp_uart_tx_done(tx);
+    rt_hw_interrupt_enable(level);
+}
+
+ITCM void bsp_uart_flush(bsp_uart_t port)
+{
+    bsp_uart_tx_t *tx = &bsp_uart_tx[port];
+
+    if (bsp_uart_async)
+    {
+        // 中断中不能阻塞，同优先级的dma中断也得不到响应，只能轮询
+        const bool can_wait = bsp_uart_can_wait();
+        while ((tx->busy != 0) || (rt_ringbuffer_data_len(&tx->rb) != 0))
+        {
+            if (can_wait)
+                rt_thread_mdelay(1);
+            else
+                bsp_uart_tx_poll(tx);
+        }
+    }
+
+    // 等待最后一个字节移出
+    while (!LL_USART_IsActiveFlag_TC(tx->uart))
+        ;
+}
+
+ITCM size_t bsp_uart_write(bsp_uart_t port, const void *buf, size_t size)
+{
+    bsp_uart_tx_t *tx = &bsp_uart_tx[port];
+    const uint8_t *data = buf;
+
+    if (!bsp_uart_async)
+    {
+        bsp_uart_tx_poll_write(tx, data, size);
+        return size;
+    }
+
+    const bool can_wait = bsp_uart_can_wait();
+    const bool irq_alive = bsp_uart_irq_alive();
+    size_t done = 0;
+    while (done < size)
+    {
+        // 线程、中断都可能写入，关中断使预留、拷贝与发布成为一个整体
+        struct rt_ringbuffer_span span;
+        rt_base_t level = rt_hw_interrupt_disable();
+        const size_t n = rt_ringbuffer_reserve(&tx->rb, size - done, &span);
+        memcpy(span.ptr[0], &data[done], span.len[0]);
+        if (span.len[1] > 0)
+            memcpy(span.ptr[1], &data[done + span.len[0]], span.len[1]);
+        rt_ringbuffer_commit(&tx->rb, n);
+        bsp_uart_tx_kick(tx);
+        if ((n == 0) && can_wait)
+            tx->waiters++;
+        rt_hw_interrupt_enable(level);
+
+        done += n;
+        if (n != 0)
+            continue;
+
+        // 缓冲区已满，等待dma发出一段数据
+        if (can_wait)
+            rt_sem_take(&tx->space, RT_WAITING_FOREVER);
+        else
+            bsp_uart_tx_poll(tx);
+    }
+
+    // 完成中断得不到响应时数据只会发出当前一段，必须在返回前发完
+    if (!irq_alive)
+        bsp_uart_flush(port);
+
+    return size;
+}
+
+/**
+ * @brief 串口dma发送中断。
+ * @param port 串口。
+ */
+ITCM static void bsp_uart_tx_irq(bsp_uart_t port)
+{
+    rt_interrupt_enter();
+    rt_base_t level = rt_hw_interrupt_disable();
+    bsp_uart_tx_done(&bsp_uart_tx[port]);
+    rt_hw_interrupt_enable(level);
+    rt_interrupt_leave();
+}
+
+/**
+ * @brief dma1 stream1中断处理函数，usart1发送。
+ */
+ITCM void DMA1_Stream1_IRQHandler(void)
+{
+    bsp_uart_tx_irq(BSP_UART_USART1);
+}
+
+/**
+ * @brief dma1 stream2中断处理函数，uart4发送。
+ */
+ITCM void DMA1_Stream2_IRQHandler(void)
+{
+    bsp_uart_tx_irq(BSP_UART_UART4);
+}
+
+/**
+ * @brief 配置dma发送通道，之后的串口输出都由dma完成。
+ * @return int 非0为失败。
+ */
+static int bsp_uart_init(void)
+{
+    static const char *const names[BSP_UART_COUNT] = {"uart1_tx", "uart4_tx"};
+
+    for (uint32_t i = 0; i < BSP_UART_COUNT; ++i)
+    {
+        bsp_uart_tx_t *tx = &bsp_uart_tx[i];
+        if (rt_ringbuffer_init(&tx->rb, tx->pool, tx->size) != RT_EOK)
+        {
+            return -1;
+        }
+        rt_sem_init(&tx->space, names[i], 0, RT_IPC_FLAG_FIFO);
+
+        LL_DMA_DisableStream(DMA1, tx->stream);
+        LL_DMA_SetPeriphRequest(DMA1, tx->stream, tx->request);
+        LL_DMA_SetDataTransferDirection(DMA1, tx->stream,
+                                        LL_DMA_DIRECTION_MEMORY_TO_PERIPH);
+        LL_DMA_SetStreamPriorityLevel(DMA1, tx->stream, LL_DMA_PRIORITY_LOW);
+        LL_DMA_SetMode(DMA1, tx->stream, LL_DMA_MODE_NORMAL);
+        LL_DMA_SetPeriphIncMode(DMA1, tx->stream, LL_DMA_PERIPH_NOINCREMENT);
+        LL_DMA_SetMemoryIncMode(DMA1, tx->stream, LL_DMA_MEMORY_INCREMENT);
+        LL_DMA_SetPeriphSize(DMA1, tx->stream, LL_DMA_PDATAALIGN_BYTE);
+        LL_DMA_SetMemorySize(DMA1, tx->stream, LL_DMA_MDATAALIGN_BYTE);
+        LL_DMA_DisableFifoMode(DMA1, tx->stream);
+        LL_DMA_SetPeriphAddress(
+            DMA1, tx->stream,
+            LL_USART_DMA_GetRegAddr(tx->uart, LL_USART_DMA_REG_DATA_TRANSMIT));
+        LL_DMA_EnableIT_TC(DMA1, tx->stream);
+        LL_USART_EnableDMAReq_TX(tx->uart);
+
+        NVIC_SetPriority(tx->irq,
+                         NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 7, 0));
+        NVIC_EnableIRQ(tx->irq);
+    }
+
+    bsp_uart_async = true;
+    return 0;
+}
+RUN_DEVICE_EXPORT(bsp_uart_init);
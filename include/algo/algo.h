@@ -13,6 +13,40 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/**
+ * @brief crc16软件查表每次处理的字节数，可选1、4、8。
+ * 大于1时在首次使用时生成对应数量的表，每张表占用512字节ram。
+ */
+#ifndef ALGO_CRC16_SLICE
+#define ALGO_CRC16_SLICE 4
+#endif
+
+#if (ALGO_CRC16_SLICE != 1) && (ALGO_CRC16_SLICE != 4) &&                      \
+    (ALGO_CRC16_SLICE != 8)
+#error "ALGO_CRC16_SLICE must be 1, 4 or 8"
+#endif
+
+/**
+ * @brief 是否优先使用硬件crc外设，外设被占用时自动回退到软件查表。
+ */
+#ifndef ALGO_CRC16_HW
+#define ALGO_CRC16_HW 1
+#endif
+
+/**
+ * @brief 数据长度达到该值才使用硬件外设，短数据直接查表更快。
+ */
+#ifndef ALGO_CRC16_HW_THRESHOLD
+#define ALGO_CRC16_HW_THRESHOLD 64
+#endif
+
+/**
+ * @brief 启动时与逐字节查表交叉校验，并输出每字节耗时。
+ */
+#ifndef ALGO_CRC16_BENCHMARK
+#define ALGO_CRC16_BENCHMARK 0
+#endif
+
 /**
  * @brief 计算crc16校验值。
  * @param data 指向待校验数据的指针。
@@ -21,4 +55,26 @@
  */
 uint16_t algo_crc16(const uint8_t *data, size_t len);
 
+/**
+ * @brief 开始分段计算crc16。
+ * @return uint16_t crc初值。
+ */
+uint16_t algo_crc16_init(void);
+
+/**
+ * @brief 把一段数据计入crc16。
+ * @param crc 当前crc值。
+ * @param data 指向待校验数据的指针。
+ * @param len 数据长度。
+ * @return uint16_t 更新后的crc值。
+ */
+uint16_t algo_crc16_update(uint16_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief 结束分段计算crc16。
+ * @param crc 当前crc值。
+ * @return uint16_t 最终的crc校验值。
+ */
+uint16_t algo_crc16_final(uint16_t crc);
+
 #endif
\ No newline at end of file
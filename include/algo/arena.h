@@ -0,0 +1,86 @@
+/**
+ * @file arena.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-20
+ * @copyright Copyright (c) 2026
+ * @brief 提供顺序分配的静态内存池，替代升级流程中的rt_malloc，
+ * 内存池放在指定的链接段，会话结束时以O(1)整体回收，并记录用量峰值。
+ */
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <attribute.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 每次分配的起始地址对齐字节数。
+ */
+#define ALGO_ARENA_ALIGN 8
+
+/**
+ * @brief 顺序分配的内存池。
+ * @note 内存池不加锁，同一时刻只能由一个线程使用。
+ */
+typedef struct algo_arena
+{
+    const char *name;        //!< 名称，用于日志
+    uint8_t *base;           //!< 内存池起始地址
+    uint32_t size;           //!< 内存池大小
+    uint32_t used;           //!< 已分配的字节数
+    uint32_t last;           //!< 最后一次分配的起始偏移
+    uint32_t peak;           //!< 本次会话的最大用量
+    uint32_t peak_all;       //!< 上电以来的最大用量
+    uint32_t failed;         //!< 上电以来分配失败的次数
+    bool listed;             //!< 是否已加入链表
+    struct algo_arena *next; //!< 已使用过的内存池链表
+} algo_arena_t;
+
+/**
+ * @brief 定义一个静态内存池。
+ * @param var 内存池变量名。
+ * @param sect 内存池所在的链接段，如AXI_UNINIT，NONE为默认的dtcm。
+ * @param bytes 内存池大小。
+ */
+#define ALGO_ARENA_DEFINE(var, sect, bytes)                                    \
+    sect ALIGN(ALGO_ARENA_ALIGN) static uint8_t var##_pool[bytes];             \
+    static algo_arena_t var = {                                                \
+        .name = #var, .base = var##_pool, .size = (bytes)}
+
+/**
+ * @brief 从内存池分配一段内存。
+ * @param arena 内存池。
+ * @param size 字节数。
+ * @return void* 对齐到ALGO_ARENA_ALIGN的地址，内存池不足时为NULL。
+ */
+void *algo_arena_alloc(algo_arena_t *arena, size_t size);
+
+/**
+ * @brief 归还一段内存，只有最后一次分配会立即回收，其余的等待会话结束。
+ * @param arena 内存池。
+ * @param ptr 由algo_arena_alloc返回的地址。
+ */
+void algo_arena_free(algo_arena_t *arena, void *ptr);
+
+/**
+ * @brief 结束一次会话，整体回收内存池并输出本次会话的用量峰值。
+ * @param arena 内存池。
+ */
+void algo_arena_reset(algo_arena_t *arena);
+
+/**
+ * @brief 获取本次会话的最大用量。
+ * @param arena 内存池。
+ * @return uint32_t 字节数。
+ */
+uint32_t algo_arena_peak(const algo_arena_t *arena);
+
+/**
+ * @brief 输出所有使用过的内存池的大小、当前用量与上电以来的最大用量。
+ */
+void algo_arena_report(void);
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ * @file digest.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-08
+ * @copyright Copyright (c) 2026
+ * @brief 提供整个固件镜像的增量摘要计算，
+ * 在写入flash的同时计算crc32与sha256，无需写完后再回读一遍。
+ */
+
+#ifndef _DIGEST_H_
+#define _DIGEST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief 是否计算sha256，关闭后只校验镜像大小与crc32。
+ */
+#ifndef ALGO_DIGEST_SHA256
+#define ALGO_DIGEST_SHA256 1
+#endif
+
+/**
+ * @brief 是否拒绝没有附带摘要尾部的文件，关闭时仅输出警告以兼容旧文件。
+ */
+#ifndef ALGO_DIGEST_REQUIRED
+#define ALGO_DIGEST_REQUIRED 0
+#endif
+
+/**
+ * @brief 镜像摘要尾部的魔数，小端存储为"DBTL"。
+ */
+#define ALGO_IMAGE_TRAILER_MAGIC 0x4C544244
+
+/**
+ * @brief 附加在固件或补丁文件末尾的摘要信息，描述最终写入app分区的镜像。
+ * @note 所有字段均为小端，crc32为CRC-32/ISO-HDLC。
+ */
+typedef struct algo_image_trailer_t {
+    uint32_t magic;      //!< ALGO_IMAGE_TRAILER_MAGIC
+    uint32_t image_size; //!< 镜像字节数，不含尾部
+    uint32_t crc32;      //!< 镜像的crc32
+    uint8_t sha256[32];  //!< 镜像的sha256
+} algo_image_trailer_t;
+
+/**
+ * @brief sha256增量计算上下文。
+ */
+typedef struct algo_sha256_t {
+    uint32_t state[8];  //!< 中间哈希值
+    uint64_t length;    //!< 已输入的字节数
+    uint8_t block[64];  //!< 未满一个分组的数据
+    uint32_t block_len; //!< block中的字节数
+} algo_sha256_t;
+
+/**
+ * @brief 镜像摘要增量计算上下文。
+ */
+typedef struct algo_digest_t {
+    uint32_t size;  //!< 已输入的字节数
+    uint32_t crc32; //!< crc32中间值
+#if ALGO_DIGEST_SHA256
+    algo_sha256_t sha256; //!< sha256中间状态
+#endif
+} algo_digest_t;
+
+/**
+ * @brief 开始分段计算crc32。
+ * @return uint32_t crc初值。
+ */
+uint32_t algo_crc32_init(void);
+
+/**
+ * @brief 把一段数据计入crc32。
+ * @param crc 当前crc值。
+ * @param data 指向待校验数据的指针。
+ * @param len 数据长度。
+ * @return uint32_t 更新后的crc值。
+ */
+uint32_t algo_crc32_update(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief 结束分段计算crc32。
+ * @param crc 当前crc值。
+ * @return uint32_t 最终的crc校验值。
+ */
+uint32_t algo_crc32_final(uint32_t crc);
+
+/**
+ * @brief 初始化sha256上下文。
+ * @param ctx sha256上下文。
+ */
+void algo_sha256_init(algo_sha256_t *ctx);
+
+/**
+ * @brief 把一段数据计入sha256。
+ * @param ctx sha256上下文。
+ * @param data 数据指针。
+ * @param len 数据长度。
+ */
+void algo_sha256_update(algo_sha256_t *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief 结束sha256计算并输出哈希值，之后上下文需要重新初始化。
+ * @param ctx sha256上下文。
+ * @param out 输出32字节哈希值。
+ */
+void algo_sha256_final(algo_sha256_t *ctx, uint8_t out[32]);
+
+/**
+ * @brief 初始化镜像摘要。
+ * @param digest 镜像摘要上下文。
+ */
+void algo_digest_init(algo_digest_t *digest);
+
+/**
+ * @brief 把一段镜像数据计入摘要，按写入顺序调用。
+ * @param digest 镜像摘要上下文。
+ * @param data 数据指针。
+ * @param len 数据长度。
+ */
+void algo_digest_update(algo_digest_t *digest, const uint8_t *data,
+                        size_t len);
+
+/**
+ * @brief 判断尾部数据是否是有效的摘要尾部。
+ * @param trailer 尾部数据。
+ * @return true 魔数匹配。
+ * @return false 文件没有附带摘要尾部。
+ */
+bool algo_image_trailer_valid(const algo_image_trailer_t *trailer);
+
+/**
+ * @brief 结束摘要计算并与尾部记录的期望值比较。
+ * @param digest 镜像摘要上下文，调用后需要重新初始化。
+ * @param trailer 有效的摘要尾部。
+ * @return true 镜像大小与摘要均一致。
+ * @return false 镜像损坏。
+ */
+bool algo_digest_check(algo_digest_t *digest,
+                       const algo_image_trailer_t *trailer);
+
+#endif
@@ -1,4 +1,77 @@
+/**
+ * @file monitor.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-25
+ * @copyright Copyright (c) 2026
+ * @brief 提供调度统计，调度钩子中用DWT CYCCNT累计各线程的运行周期，
+ * 记录线程从就绪到切入的延迟与中断到处理线程的延迟，
+ * 监视器线程每个周期经usart1发出一条二进制记录，
+ * 由tools/monitor_dump.py解码。
+ */
+
 #ifndef _MONITOR_H_
 #define _MONITOR_H_
 
-#endif
\ No newline at end of file
+#include <stdint.h>
+
+/**
+ * @brief 是否编译调度统计，关闭后监视器只输出cpu占用率日志。
+ * 需要rtconfig.h中定义RT_HOOK_USING_FUNC_PTR。
+ */
+#ifndef MONITOR_TRACE_ENABLE
+#define MONITOR_TRACE_ENABLE 1
+#endif
+
+/**
+ * @brief 输出记录的周期，需小于CYCCNT回绕时间(480MHz下约8.9s)。
+ */
+#ifndef MONITOR_PERIOD_MS
+#define MONITOR_PERIOD_MS 1000
+#endif
+
+/**
+ * @brief 统计的线程数量上限，超出的线程计入最后一个槽位。
+ */
+#ifndef MONITOR_THREAD_SLOTS
+#define MONITOR_THREAD_SLOTS 12
+#endif
+
+/**
+ * @brief 延迟直方图的区间数量，区间0为小于1 << MONITOR_LAT_SHIFT个周期，
+ * 区间i为[1 << (MONITOR_LAT_SHIFT + i - 1), 1 << (MONITOR_LAT_SHIFT + i))，
+ * 最后一个区间收纳更长的延迟。
+ */
+#define MONITOR_LAT_BUCKETS 16
+#define MONITOR_LAT_SHIFT   8
+
+/**
+ * @brief 统计延迟的中断来源。
+ */
+typedef enum {
+    MONITOR_ISR_UART4 = 0, //!< uart4接收，释放ymodem的信号量
+    MONITOR_ISR_COUNT,
+} monitor_isr_t;
+
+#if MONITOR_TRACE_ENABLE
+
+/**
+ * @brief 在中断入口记录时间，已有未被处理的记录时保留较早的一次。
+ * @param src 中断来源。
+ */
+void monitor_isr_enter(monitor_isr_t src);
+
+/**
+ * @brief 处理线程取得中断的通知后调用，统计自中断入口以来的延迟。
+ * @param src 中断来源。
+ */
+void monitor_isr_served(monitor_isr_t src);
+
+#else
+
+#define monitor_isr_enter(src)  ((void)(src))
+#define monitor_isr_served(src) ((void)(src))
+
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * @file profile.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-24
+ * @copyright Copyright (c) 2026
+ * @brief 提供统计采样分析器，tim7中断记录被打断处的pc，
+ * 按地址累加到axiram中的直方图，经usart1发出后由tools/profile_dump.py
+ * 对照elf还原为函数热度。
+ * 采样在关中断区间内被推迟，计入开中断处的指令。
+ */
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief 是否编译采样分析器。
+ */
+#ifndef PROFILE_ENABLE
+#define PROFILE_ENABLE 1
+#endif
+
+/**
+ * @brief 每秒采样次数，取与1kHz系统节拍互质的值，避免与周期性任务同步。
+ * 单次采样约60个周期，默认频率下开销约为cpu的0.01%。
+ */
+#ifndef PROFILE_RATE_HZ
+#define PROFILE_RATE_HZ 997
+#endif
+
+/**
+ * @brief 直方图字节大小，每个地址区间占4字节，
+ * 区间宽度在启动时按代码大小取最小的2的幂。
+ */
+#ifndef PROFILE_HIST_SIZE
+#define PROFILE_HIST_SIZE (64 * 1024)
+#endif
+
+/**
+ * @brief 自动输出直方图的周期，0为只在收到命令时输出。
+ */
+#ifndef PROFILE_DUMP_PERIOD_MS
+#define PROFILE_DUMP_PERIOD_MS 0
+#endif
+
+/**
+ * @brief 每帧最多携带的非零区间数量，帧需远小于usart1发送缓冲区。
+ */
+#define PROFILE_FRAME_ENTRIES 48
+
+/**
+ * @brief usart1收到的单字节命令。
+ */
+#define PROFILE_CMD_DUMP  'p' //!< 输出直方图
+#define PROFILE_CMD_CLEAR 'c' //!< 清空直方图
+#define PROFILE_CMD_PAUSE 's' //!< 暂停或恢复采样
+
+/**
+ * @brief 采样统计。
+ */
+typedef struct profile_stat
+{
+    uint32_t samples; //!< 落在直方图中的采样数
+    uint32_t other;   //!< 落在代码区以外的采样数
+    uint64_t cycles;  //!< 采样中断自身消耗的周期数
+    uint64_t elapsed; //!< 自清空以来经过的周期数
+} profile_stat_t;
+
+/**
+ * @brief 开始或暂停采样。
+ * @param on true为开始。
+ */
+void profile_enable(bool on);
+
+/**
+ * @brief 清空直方图与统计。
+ */
+void profile_clear(void);
+
+/**
+ * @brief 获取采样统计。
+ * @param stat 输出统计。
+ */
+void profile_get_stat(profile_stat_t *stat);
+
+/**
+ * @brief 经usart1输出直方图中的非零区间，
+ * 使用静态缓冲区，只在分析器线程中调用。
+ */
+void profile_dump(void);
+
+#endif
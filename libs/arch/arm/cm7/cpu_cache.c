@@ -9,6 +9,7 @@
  * 2019-04-27     misonyo      update to cortex-m7 series
  */
 
+#include <attribute.h>
 #include <board.h>
 #include <rtdebug.h>
 #include <rthw.h>
@@ -28,10 +29,10 @@ void rt_hw_cpu_icache_disable(void)
 
 rt_base_t rt_hw_cpu_icache_status(void)
 {
-    return 0;
+    return (SCB->CCR & SCB_CCR_IC_Msk) ? 1 : 0;
 }
 
-void rt_hw_cpu_icache_ops(int ops, void *addr, int size)
+ITCM void rt_hw_cpu_icache_ops(int ops, void *addr, int size)
 {
     uint32_t address = (uint32_t)addr & (uint32_t)~(L1CACHE_LINESIZE_BYTE - 1);
     int32_t size_byte = size + address - (uint32_t)addr;
@@ -62,10 +63,10 @@ void rt_hw_cpu_dcache_disable(void)
 
 rt_base_t rt_hw_cpu_dcache_status(void)
 {
-    return 0;
+    return (SCB->CCR & SCB_CCR_DC_Msk) ? 1 : 0;
 }
 
-void rt_hw_cpu_dcache_ops(int ops, void *addr, int size)
+ITCM void rt_hw_cpu_dcache_ops(int ops, void *addr, int size)
 {
     uint32_t startAddr =
         (uint32_t)addr & (uint32_t)~(L1CACHE_LINESIZE_BYTE - 1);
@@ -2,7 +2,135 @@
 #define _DETOOLS_PORT_H_
 
 #include <stdint.h>
+#include <algo/digest.h>
 #include <detools.h>
+#include <mcu.h>
+
+/*
+ * 新固件写入缓存大小，必须是 flash word 的整数倍且不超过一个扇区
+ * 缓存写满后一次解锁连续编程，再统一上锁
+ */
+#ifndef DETOOLS_PORT_WRITE_BUF_SIZE
+#define DETOOLS_PORT_WRITE_BUF_SIZE (1024)
+#endif
+
+#if (DETOOLS_PORT_WRITE_BUF_SIZE % MCU_FLASH_WORD_SIZE) != 0 ||                \
+    (DETOOLS_PORT_WRITE_BUF_SIZE > MCU_FLASH_SECTOR_SIZE)
+#error "DETOOLS_PORT_WRITE_BUF_SIZE must be a multiple of flash word and <= sector"
+#endif
+
+/*
+ * 差分还原每次生成的数据块大小，建议 1~4KB
+ * 旧固件直接从 flash 映射读取，块越大加法循环一次覆盖的跨度越长
+ */
+#ifndef DETOOLS_PORT_CHUNK_SIZE
+#define DETOOLS_PORT_CHUNK_SIZE (1024)
+#endif
+
+#if (DETOOLS_PORT_CHUNK_SIZE % MCU_FLASH_WORD_SIZE) != 0
+#error "DETOOLS_PORT_CHUNK_SIZE must be a multiple of flash word"
+#endif
+
+/*
+ * 解压器工作内存大小，从 AXI SRAM 中划出，不占用系统堆
+ * heatshrink 需要 2^窗口位数 + 256 字节输入缓冲，窗口位数最大为 15
+ */
+#ifndef DETOOLS_PORT_CODEC_ARENA_SIZE
+#define DETOOLS_PORT_CODEC_ARENA_SIZE (32 * 1024 + 512)
+#endif
+
+/*
+ * 启动时测量差分加法内核的每字节周期数，并与逐字节实现比对结果
+ */
+#ifndef DETOOLS_PORT_ADD_BENCHMARK
+#define DETOOLS_PORT_ADD_BENCHMARK (0)
+#endif
+
+/*
+ * 新固件分区在后台擦除，同时读取补丁并解压，写入时才等待擦除完成
+ * 新固件与补丁位于不同 bank 时两者真正并行，置 0 时先同步擦除再还原
+ */
+#ifndef DETOOLS_PORT_BANK_OVERLAP
+#define DETOOLS_PORT_BANK_OVERLAP (1)
+#endif
+
+/*
+ * 还原前先预扫描一遍补丁，只擦除与新固件不同的扇区，擦除与第二遍解压重叠，
+ * 写入时跳过未变化的扇区和全 0xFF 的 flash word，
+ * 以多解压一遍为代价减少擦写次数，已是新固件的扇区不擦不写
+ * 置 0 时只解压一遍，新固件每进入一个扇区先同步擦除，已为空时跳过
+ */
+#ifndef DETOOLS_PORT_SKIP_WRITE
+#define DETOOLS_PORT_SKIP_WRITE (1)
+#endif
+
+/*
+ * 还原过程中在每个新固件扇区边界把 detools 状态记录到 BKPRAM，
+ * 掉电或复位后从最近的检查点继续，而不是从头重新还原
+ */
+#ifndef DETOOLS_PORT_JOURNAL
+#define DETOOLS_PORT_JOURNAL (1)
+#endif
+
+/*
+ * 检查点中 detools 序列化状态的最大字节数
+ */
+#ifndef DETOOLS_PORT_JOURNAL_STATE_SIZE
+#define DETOOLS_PORT_JOURNAL_STATE_SIZE (512)
+#endif
+
+/* 两个检查点交替写入，单个检查点还要保存写回缓存和摘要 */
+#if DETOOLS_PORT_JOURNAL &&                                                    \
+    (2 * (DETOOLS_PORT_JOURNAL_STATE_SIZE + DETOOLS_PORT_WRITE_BUF_SIZE +      \
+          256) >                                                               \
+     MCU_BKPRAM_SIZE)
+#error "DETOOLS_PORT_JOURNAL does not fit into BKPRAM"
+#endif
+
+/*
+ * 原地还原，与 PARTITION_IN_PLACE 分区布局配套，旧固件就地变为新固件，
+ * 补丁须以 in-place 类型生成，内存大小为 user 分区大小，段大小为扇区的整数倍
+ */
+#ifndef DETOOLS_PORT_IN_PLACE
+#define DETOOLS_PORT_IN_PLACE PARTITION_IN_PLACE
+#endif
+
+/*
+ * 启动还原时擦除是否真正与解压重叠：只有预扫描后擦除差异扇区时在后台擦除，
+ * 只解压一遍与原地还原都在写入前同步擦除
+ */
+#define DETOOLS_PORT_APPLY_OVERLAP                                             \
+    (DETOOLS_PORT_BANK_OVERLAP && DETOOLS_PORT_SKIP_WRITE &&                   \
+     !DETOOLS_PORT_IN_PLACE)
+
+/*
+ * 流式还原配置：单个数据块大小、队列深度与还原线程参数
+ */
+#ifndef DETOOLS_PORT_STREAM_BLOCK_SIZE
+#define DETOOLS_PORT_STREAM_BLOCK_SIZE (1024)
+#endif
+
+#ifndef DETOOLS_PORT_STREAM_QUEUE_DEPTH
+#define DETOOLS_PORT_STREAM_QUEUE_DEPTH (4)
+#endif
+
+#ifndef DETOOLS_PORT_STREAM_THREAD_STK
+#define DETOOLS_PORT_STREAM_THREAD_STK (1024 * 2)
+#endif
+
+#ifndef DETOOLS_PORT_STREAM_THREAD_PRIO
+#define DETOOLS_PORT_STREAM_THREAD_PRIO (3)
+#endif
+
+/*
+ * 新固件写入方式
+ */
+typedef enum {
+    DETOOLS_PORT_WRITE_ALL = 0, // 目标已擦除，全部编程
+    DETOOLS_PORT_WRITE_SCAN,    // 只与目标比较，记录不同的扇区
+    DETOOLS_PORT_WRITE_DIRTY,   // 只编程不同扇区中内容不同的 flash word
+    DETOOLS_PORT_WRITE_ERASE,   // 首次写入扇区时擦除，编程内容不同的 flash word
+} detools_port_write_t;
 
 /*
  * 移植层上下文结构体
@@ -18,21 +146,91 @@ typedef struct {
     uint32_t new_app_base;   // 新固件在 Flash 中的首地址
     uint32_t new_app_offset; // 新固件当前写入偏移量
 
-    /* 新增：32 字节对齐的缓存区，用于凑齐 Flash Word */
-    __attribute__((aligned(32))) uint8_t write_buf[32];
+    /* 写回缓存区，凑齐若干 Flash Word 后批量编程 */
+    uint8_t *write_buf;     // 指向 32 字节对齐的静态缓存
     uint32_t write_buf_len; // 缓存区当前已有字节数
+
+    /* 新固件摘要，边写入边计算，为 NULL 时不计算 */
+    algo_digest_t *digest;
+
+    /* 写入方式与差异扇区位图，bit n 对应新固件第 n 个扇区，
+       WRITE_ERASE 时记录本次还原已经擦除的扇区 */
+    detools_port_write_t write_mode;
+    uint32_t dirty;
 } detools_ctx_t;
 
 /**
- * @brief 执行差分还原
+ * @brief 执行差分还原，开启 DETOOLS_PORT_JOURNAL 时从上次中断处继续
  *
  * @param old_app_addr  旧固件首地址 (例如 0x08010000)
  * @param patch_addr    差分包首地址 (例如 0x08040000)
  * @param patch_size    差分包总大小
- * @param new_app_addr  新固件写入首地址 (例如 0x08080000)
- * @return int          成功返回生成的新固件大小，失败返回负数错误码
+ * @param new_app_addr  新固件写入首地址 (例如 0x08080000)，
+ *                      无需预先擦除，只擦除内容与新固件不同的扇区
+ * @param digest        已初始化的新固件摘要，为 NULL 时不计算
+ * @return int          成功返回 DETOOLS_OK，失败返回负数错误码
  */
 int detools_apply_patch(uint32_t old_app_addr, uint32_t patch_addr,
-                        uint32_t patch_size, uint32_t new_app_addr);
+                        uint32_t patch_size, uint32_t new_app_addr,
+                        algo_digest_t *digest);
+
+/**
+ * @brief 原地执行差分还原，按扇区在 AXI SRAM 中暂存新内容后整体编程
+ *
+ * @param app_addr      固件分区首地址，旧固件所在位置，也是新固件写入位置
+ * @param app_size      固件分区大小，必须与生成补丁时的内存大小一致
+ * @param patch_addr    差分包首地址
+ * @param patch_size    差分包总大小
+ * @param digest        已初始化的新固件摘要，为 NULL 时不计算
+ * @return int          成功返回 DETOOLS_OK，失败返回负数错误码
+ */
+int detools_apply_patch_in_place(uint32_t app_addr, uint32_t app_size,
+                                 uint32_t patch_addr, uint32_t patch_size,
+                                 algo_digest_t *digest);
+
+/**
+ * @brief 丢弃还原检查点，分区内容改变时调用，避免从过期的进度继续
+ */
+void detools_port_journal_clear(void);
+
+/**
+ * @brief 检查补丁能否按当前配置还原：补丁类型与 DETOOLS_PORT_IN_PLACE 一致，
+ * 且压缩算法已编译进 detools，不满足的补丁在接收和还原前拒绝
+ * heatshrink 补丁照常还原，但其状态放不进检查点，中断后从头还原
+ *
+ * @param header        补丁首字节
+ * @return true         支持
+ * @return false        不支持
+ */
+bool detools_port_patch_supported(uint8_t header);
+
+/**
+ * @brief 开始流式还原，补丁数据由 detools_stream_write 边接收边送入
+ *
+ * @param old_app_addr  旧固件首地址
+ * @param patch_size    差分包总大小
+ * @param new_app_addr  新固件写入首地址，调用前必须已经擦除或正在后台擦除
+ * @param digest        已初始化的新固件摘要，为 NULL 时不计算，
+ *                      须在 detools_stream_end 返回前保持有效
+ * @return int          成功返回 0，失败返回负数错误码
+ */
+int detools_stream_begin(uint32_t old_app_addr, uint32_t patch_size,
+                         uint32_t new_app_addr, algo_digest_t *digest);
+
+/**
+ * @brief 把一段补丁数据放入还原队列，队列满时阻塞等待
+ *
+ * @param data  补丁数据，返回后即可复用
+ * @param len   数据长度
+ * @return int  还原过程尚未出错返回非负数，否则返回负数错误码
+ */
+int detools_stream_write(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief 结束流式还原，等待队列处理完毕并冲刷写回缓存
+ *
+ * @return int  成功返回 DETOOLS_OK，失败返回负数错误码
+ */
+int detools_stream_end(void);
 
 #endif
\ No newline at end of file
@@ -1,17 +1,98 @@
 /* START OF FILE detools_port.c */
+#include <algo/algo.h>
+#include <algo/arena.h>
 #include <detools_port.h>
+#include <flash.h>
 #include <main.h>
 #include <rtthread.h>
+#include <stddef.h>
 
 // 配置调试日志
 #define DBG_TAG __FILE_NAME__
 #define DBG_LVL DBG_DEBUG
 #include <rtdebug.h>
 
-// 假设已经实现了 Flash 擦除和写入的底层封装函数
-// 注意：Flash 写入前必须确保对应的 Sector/Page 已经被擦除！
-extern int bsp_flash_write(uint32_t addr, const uint8_t *data, uint32_t size);
-extern int bsp_flash_erase_sector_by_addr(uint32_t addr);
+/*
+ * 新固件写回缓存，放在静态区避免占用 boot 线程栈
+ * 同一时刻只会有一次差分还原，因此不需要加锁
+ */
+ALIGN(MCU_FLASH_WORD_SIZE) static uint8_t
+    write_buf[DETOOLS_PORT_WRITE_BUF_SIZE];
+
+/*
+ * detools 生成新固件数据块的缓冲区，与写回缓存同理放在静态区
+ */
+ALIGN(MCU_FLASH_WORD_SIZE) static uint8_t to_buf[DETOOLS_PORT_CHUNK_SIZE];
+
+/*
+ * 解压器工作内存，按顺序分配，每次还原开始时整体回收
+ */
+ALGO_ARENA_DEFINE(codec_arena, AXI_UNINIT, DETOOLS_PORT_CODEC_ARENA_SIZE);
+
+ITCM void *detools_port_codec_alloc(size_t size)
+{
+    return algo_arena_alloc(&codec_arena, size);
+}
+
+ITCM void detools_port_codec_free(void *ptr)
+{
+    // 只回收最后一次分配，其余的在下次还原开始时回收
+    algo_arena_free(&codec_arena, ptr);
+}
+
+/**
+ * @brief 回收全部解压器内存，每次还原开始与结束时调用。
+ */
+ITCM static void detools_port_codec_reset(void)
+{
+    algo_arena_reset(&codec_arena);
+}
+
+/**
+ * @brief 获取补丁使用的压缩算法名称，编号与 detools.c 中的 COMPRESSION_* 一致。
+ * @param compression 压缩算法编号。
+ * @return const char* 名称。
+ */
+ITCM static const char *detools_port_codec_name(int compression)
+{
+    switch (compression)
+    {
+    case 0:
+        return "none";
+    case 1:
+        return "lzma";
+    case 2:
+        return "crle";
+    case 4:
+        return "heatshrink";
+    default:
+        return "unknown";
+    }
+}
+
+ITCM bool detools_port_patch_supported(uint8_t header)
+{
+    // 第 4~6 位为补丁类型，0 为顺序补丁，1 为原地补丁
+    if (((header >> 4) & 0x7) != (DETOOLS_PORT_IN_PLACE ? 1 : 0))
+    {
+        return false;
+    }
+
+    // 低 4 位为压缩算法，只接受编译进 detools 的解压器
+    switch (header & 0xf)
+    {
+    case 0:
+        return DETOOLS_CONFIG_COMPRESSION_NONE == 1;
+    case 1:
+        return DETOOLS_CONFIG_COMPRESSION_LZMA == 1;
+    case 2:
+        return DETOOLS_CONFIG_COMPRESSION_CRLE == 1;
+    case 4:
+        return DETOOLS_CONFIG_COMPRESSION_HEATSHRINK == 1;
+    default:
+        return false;
+    }
+}
 
 /* ====================================================================
  * 1. 回调函数：读取旧固件 (From Read)
@@ -41,32 +122,215 @@ ITCM static int cb_from_seek(void *arg_p, int offset)
 }
 
 /* ====================================================================
- * 3. 回调函数：读取差分包 (Patch Read)
+ * 3. 回调函数：映射旧固件 (From Map) - 零拷贝读取
  * ==================================================================== */
-ITCM static int cb_patch_read(void *arg_p, uint8_t *buf_p, size_t size)
+ITCM static int cb_from_map(void *arg_p, const uint8_t **buf_pp, size_t size)
 {
     detools_ctx_t *ctx = (detools_ctx_t *)arg_p;
 
-    uint8_t *src = (uint8_t *)(ctx->patch_base + ctx->patch_offset);
-    memcpy(buf_p, src, size);
+    // 旧固件可直接寻址，返回指针让 detools 直接在 flash 上做加法
+    *buf_pp = (const uint8_t *)(ctx->old_app_base + ctx->old_app_offset);
 
-    ctx->patch_offset += size;
+    ctx->old_app_offset += size;
     return 0;
 }
 
 /* ====================================================================
- * 写入生成的新固件 (To Write) - 带 32 字节缓存的 Flash 写入
+ * 按写入方式编程新固件 (Program) - 预扫描与跳过未变化的数据
+ * ==================================================================== */
+
+/**
+ * @brief 返回新固件偏移所在扇区在差异位图中的位。
+ * @param offset 新固件内偏移。
+ * @return uint32_t 位掩码。
+ */
+ITCM static uint32_t detools_port_sector_bit(uint32_t offset)
+{
+    return 1UL << (offset / MCU_FLASH_SECTOR_SIZE);
+}
+
+/**
+ * @brief 判断 flash 中是否已经是要写入的数据，
+ * 包括擦除后全 0xFF 的 flash word 与掉电前已经写入的 flash word。
+ * @param addr flash word 地址。
+ * @param data 要写入的数据。
+ * @param len 有效长度，不足一个 flash word 的部分由 0xFF 填充。
+ * @return true 无需编程。
+ * @return false 需要编程。
+ */
+ITCM static bool detools_port_word_done(uint32_t addr, const uint8_t *data,
+                                        uint32_t len)
+{
+    const uint8_t *flash = (const uint8_t *)addr;
+    for (uint32_t i = 0; i < MCU_FLASH_WORD_SIZE; ++i)
+    {
+        if (flash[i] != ((i < len) ? data[i] : 0xFF))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 擦除 [offset, offset + size) 覆盖的、本次还原尚未擦除的扇区，
+ * 已经为空的扇区跳过，擦除后在位图中记录，继续还原时不会再擦除。
+ * @param ctx 移植层上下文。
+ * @param offset 新固件内偏移。
+ * @param size 数据长度。
+ * @return int 成功返回 BSP_FLASH_OK，失败返回负数错误码。
+ */
+ITCM static int detools_port_erase_touched(detools_ctx_t *ctx, uint32_t offset,
+                                           uint32_t size)
+{
+    const uint32_t first = offset / MCU_FLASH_SECTOR_SIZE;
+    const uint32_t last = (offset + size - 1) / MCU_FLASH_SECTOR_SIZE;
+
+    for (uint32_t i = first; i <= last; ++i)
+    {
+        if ((ctx->dirty & (1UL << i)) != 0)
+        {
+            continue;
+        }
+
+        const uint32_t addr = ctx->new_app_base + i * MCU_FLASH_SECTOR_SIZE;
+        if (!bsp_flash_is_blank(addr, MCU_FLASH_SECTOR_SIZE))
+        {
+            const int result = bsp_flash_erase_sector_by_addr(addr);
+            if (result != BSP_FLASH_OK)
+            {
+                LOG_E("flash erase fail at 0x%08X with %d", addr, result);
+                return result;
+            }
+        }
+        ctx->dirty |= 1UL << i;
+    }
+    return BSP_FLASH_OK;
+}
+
+/**
+ * @brief 按上下文的写入方式处理一段新固件数据。
+ * @param ctx 移植层上下文。
+ * @param offset 新固件内偏移，按 flash word 对齐。
+ * @param data 数据指针。
+ * @param size 数据长度。
+ * @return int 成功返回 BSP_FLASH_OK，失败返回负数错误码。
+ */
+ITCM static int detools_port_program(detools_ctx_t *ctx, uint32_t offset,
+                                     const uint8_t *data, uint32_t size)
+{
+    const uint32_t base = ctx->new_app_base;
+
+    if (ctx->write_mode == DETOOLS_PORT_WRITE_ALL)
+    {
+        return bsp_flash_write(base + offset, data, size);
+    }
+
+    uint32_t done = 0;
+    if (ctx->write_mode == DETOOLS_PORT_WRITE_SCAN)
+    {
+        // 按扇区分段比较，任何一个字节不同都要擦除整个扇区
+        while (done < size)
+        {
+            const uint32_t pos = offset + done;
+            uint32_t len = MCU_FLASH_SECTOR_SIZE - (pos % MCU_FLASH_SECTOR_SIZE);
+            if (len > size - done)
+            {
+                len = size - done;
+            }
+            if (((ctx->dirty & detools_port_sector_bit(pos)) == 0) &&
+                (memcmp((const void *)(base + pos), &data[done], len) != 0))
+            {
+                ctx->dirty |= detools_port_sector_bit(pos);
+            }
+            done += len;
+        }
+        return BSP_FLASH_OK;
+    }
+
+    if (ctx->write_mode == DETOOLS_PORT_WRITE_ERASE)
+    {
+        // 擦除后扇区在位图中标记为不同，按差异扇区处理
+        const int result = detools_port_erase_touched(ctx, offset, size);
+        if (result != BSP_FLASH_OK)
+        {
+            return result;
+        }
+    }
+
+    // 只编程差异扇区中内容不同的 flash word，连续的部分合并为一次写入
+    uint32_t run_start = 0;
+    uint32_t run_len = 0;
+    while (done < size)
+    {
+        const uint32_t pos = offset + done;
+        const uint32_t len = ((size - done) < MCU_FLASH_WORD_SIZE)
+                                 ? (size - done)
+                                 : MCU_FLASH_WORD_SIZE;
+        const bool skip = ((ctx->dirty & detools_port_sector_bit(pos)) == 0) ||
+                          detools_port_word_done(base + pos, &data[done], len);
+
+        if (!skip)
+        {
+            if (run_len == 0)
+            {
+                run_start = done;
+            }
+            run_len += len;
+        }
+
+        if ((skip || (done + len == size)) && (run_len > 0))
+        {
+            const int result = bsp_flash_write(base + offset + run_start,
+                                               &data[run_start], run_len);
+            if (result != BSP_FLASH_OK)
+            {
+                return result;
+            }
+            run_len = 0;
+        }
+        done += len;
+    }
+
+    return BSP_FLASH_OK;
+}
+
+/* ====================================================================
+ * 写入生成的新固件 (To Write) - 带写回缓存的批量 Flash 写入
  * ==================================================================== */
 ITCM static int cb_to_write(void *arg_p, const uint8_t *buf_p, size_t size)
 {
     detools_ctx_t *ctx = (detools_ctx_t *)arg_p;
     uint32_t bytes_processed = 0;
-    int result = HAL_OK;
+    int result = BSP_FLASH_OK;
+
+    // 数据还在缓存中时顺带计算摘要，省去写完后回读整个分区
+    if (ctx->digest != NULL)
+    {
+        algo_digest_update(ctx->digest, buf_p, size);
+    }
 
     while (bytes_processed < size)
     {
+        // 缓存为空且剩余数据足够一整块时，跳过缓存直接编程
+        if ((ctx->write_buf_len == 0) &&
+            ((size - bytes_processed) >= DETOOLS_PORT_WRITE_BUF_SIZE))
+        {
+            result = detools_port_program(ctx, ctx->new_app_offset,
+                                          &buf_p[bytes_processed],
+                                          DETOOLS_PORT_WRITE_BUF_SIZE);
+            if (result != BSP_FLASH_OK)
+            {
+                return -1;
+            }
+
+            ctx->new_app_offset += DETOOLS_PORT_WRITE_BUF_SIZE;
+            bytes_processed += DETOOLS_PORT_WRITE_BUF_SIZE;
+            continue;
+        }
+
         // 计算当前还能往缓存里塞多少字节
-        uint32_t copy_len = 32 - ctx->write_buf_len;
+        uint32_t copy_len = DETOOLS_PORT_WRITE_BUF_SIZE - ctx->write_buf_len;
         if (copy_len > (size - bytes_processed))
         {
             copy_len = size - bytes_processed;
@@ -78,40 +342,21 @@ ITCM static int cb_to_write(void *arg_p, const uint8_t *buf_p, size_t size)
         ctx->write_buf_len += copy_len;
         bytes_processed += copy_len;
 
-        // 如果缓存满 32 字节，则执行一次真实的 Flash 写入
-        if (ctx->write_buf_len == 32)
+        // 缓存写满后一次解锁，连续编程整块数据
+        if (ctx->write_buf_len == DETOOLS_PORT_WRITE_BUF_SIZE)
         {
-            uint32_t write_addr = ctx->new_app_base + ctx->new_app_offset;
-
-            __disable_irq(); // 关闭全局中断
-            result = HAL_FLASH_Unlock();
-
-            if (result == HAL_OK)
-            {
-                // 清除 Bank1 和 Bank2
-                // 的所有错误标志，防止历史遗留错误导致编程失败
-                // (此处为了通用性直接把两个 Bank
-                // 的标志都清了，你也可以按需修改)
-                __HAL_FLASH_CLEAR_FLAG_BANK1(FLASH_FLAG_ALL_ERRORS_BANK1);
-                __HAL_FLASH_CLEAR_FLAG_BANK2(
-                    FLASH_FLAG_ALL_ERRORS_BANK2); // 若单片机支持双Bank
-
-                result =
-                    HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, write_addr,
-                                      (uint32_t)ctx->write_buf);
-
-                HAL_FLASH_Lock();
-            }
-            __enable_irq(); // 恢复中断
-
-            if (result != HAL_OK)
+            // 注意：Flash 写入前必须确保对应的 Sector 已经被擦除！
+            result = detools_port_program(ctx, ctx->new_app_offset,
+                                          ctx->write_buf,
+                                          DETOOLS_PORT_WRITE_BUF_SIZE);
+            if (result != BSP_FLASH_OK)
             {
                 // LOG_E("flash program fail at 0x%08X", write_addr);
                 return -1; // detools 要求的错误返回值为负数
             }
 
-            // 写入成功，偏移量增加 32 字节，清空缓存长度
-            ctx->new_app_offset += 32;
+            // 写入成功，偏移量增加整块缓存大小，清空缓存长度
+            ctx->new_app_offset += DETOOLS_PORT_WRITE_BUF_SIZE;
             ctx->write_buf_len = 0;
         }
     }
@@ -119,80 +364,1183 @@ ITCM static int cb_to_write(void *arg_p, const uint8_t *buf_p, size_t size)
     return 0; // 0 表示成功处理
 }
 
+#if DETOOLS_PORT_JOURNAL
 /* ====================================================================
- * 5. 顶层暴露接口
+ * 4. 还原检查点 (Journal) - 掉电后从最近的扇区边界继续
  * ==================================================================== */
+
+#define DETOOLS_JOURNAL_MAGIC (0x4C4E524A) // "JRNL"
+
+/*
+ * 检查点，所有 flash 写入在记录前都已完成
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence; // 越大越新
+
+    /* 还原对象，防止从其他补丁的进度继续 */
+    uint32_t old_app_base;
+    uint32_t patch_base;
+    uint32_t patch_size;
+    uint32_t new_app_base;
+
+    uint32_t new_app_offset; // 已写入 flash 的新固件字节数
+    uint32_t dirty;          // 差异扇区位图
+    uint32_t write_buf_len;  // 写回缓存中尚未编程的字节数
+    uint32_t state_len;      // detools 序列化状态的字节数
+    algo_digest_t digest;    // 已写入数据的摘要
+    uint8_t state[DETOOLS_PORT_JOURNAL_STATE_SIZE];
+    uint8_t write_buf[DETOOLS_PORT_WRITE_BUF_SIZE];
+    uint16_t crc; // 以上全部字段的校验值，最后写入
+} detools_journal_t;
+
+/* 两个检查点交替写入，写到一半掉电时另一个仍然有效 */
+BACKUP static detools_journal_t journal[2];
+
+/* detools 序列化状态的读写位置 */
+static uint8_t *journal_cursor;
+static uint32_t journal_left;
+
+ITCM static int cb_state_write(void *arg_p, const void *buf_p, size_t size)
+{
+    (void)arg_p;
+    if (size > journal_left)
+    {
+        return -1;
+    }
+    memcpy(journal_cursor, buf_p, size);
+    journal_cursor += size;
+    journal_left -= size;
+    return 0;
+}
+
+ITCM static int cb_state_read(void *arg_p, void *buf_p, size_t size)
+{
+    (void)arg_p;
+    if (size > journal_left)
+    {
+        return -1;
+    }
+    memcpy(buf_p, journal_cursor, size);
+    journal_cursor += size;
+    journal_left -= size;
+    return 0;
+}
+
+/**
+ * @brief 计算检查点的校验值。
+ * @param entry 检查点。
+ * @return uint16_t 校验值。
+ */
+ITCM static uint16_t detools_journal_crc(const detools_journal_t *entry)
+{
+    return algo_crc16((const uint8_t *)entry,
+                      offsetof(detools_journal_t, crc));
+}
+
+/**
+ * @brief 查找与本次还原对象一致的最新检查点。
+ * @param ctx 移植层上下文。
+ * @param patch_size 差分包总大小。
+ * @return const detools_journal_t* 检查点，没有时返回 NULL。
+ */
+ITCM static const detools_journal_t *detools_journal_find(
+    const detools_ctx_t *ctx, uint32_t patch_size)
+{
+    const detools_journal_t *found = NULL;
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        const detools_journal_t *entry = &journal[i];
+        if ((entry->magic != DETOOLS_JOURNAL_MAGIC) ||
+            (entry->old_app_base != ctx->old_app_base) ||
+            (entry->patch_base != ctx->patch_base) ||
+            (entry->patch_size != patch_size) ||
+            (entry->new_app_base != ctx->new_app_base) ||
+            (entry->state_len > sizeof(entry->state)) ||
+            (entry->write_buf_len > sizeof(entry->write_buf)) ||
+            (entry->crc != detools_journal_crc(entry)))
+        {
+            continue;
+        }
+        if ((found == NULL) || (entry->sequence > found->sequence))
+        {
+            found = entry;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief 把当前还原进度写入较旧的检查点。
+ * @param apply 还原对象，须处于两次 process 调用之间。
+ * @param ctx 移植层上下文。
+ * @param patch_size 差分包总大小。
+ * @return int 成功返回 0，失败返回负数错误码。
+ */
+ITCM static int detools_journal_save(struct detools_apply_patch_t *apply,
+                                     const detools_ctx_t *ctx,
+                                     uint32_t patch_size)
+{
+    detools_journal_t *entry = &journal[0];
+    uint32_t sequence = 1;
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        const bool valid = (journal[i].magic == DETOOLS_JOURNAL_MAGIC) &&
+                           (journal[i].crc == detools_journal_crc(&journal[i]));
+        if (valid && (journal[i].sequence >= sequence))
+        {
+            sequence = journal[i].sequence + 1;
+            entry = &journal[1 - i];
+        }
+    }
+
+    // 先作废再改写，写到一半掉电时校验失败
+    entry->magic = 0;
+    entry->sequence = sequence;
+    entry->old_app_base = ctx->old_app_base;
+    entry->patch_base = ctx->patch_base;
+    entry->patch_size = patch_size;
+    entry->new_app_base = ctx->new_app_base;
+    entry->new_app_offset = ctx->new_app_offset;
+    entry->dirty = ctx->dirty;
+    entry->write_buf_len = ctx->write_buf_len;
+    memcpy(entry->write_buf, ctx->write_buf, ctx->write_buf_len);
+    if (ctx->digest != NULL)
+    {
+        entry->digest = *ctx->digest;
+    }
+
+    journal_cursor = entry->state;
+    journal_left = sizeof(entry->state);
+    const int res = detools_apply_patch_dump(apply, cb_state_write);
+    if (res != 0)
+    {
+        return res;
+    }
+    entry->state_len = sizeof(entry->state) - journal_left;
+
+    entry->magic = DETOOLS_JOURNAL_MAGIC;
+    entry->crc = detools_journal_crc(entry);
+    return 0;
+}
+
+/**
+ * @brief 从检查点恢复还原对象与上下文。
+ * @param apply 刚初始化的还原对象。
+ * @param ctx 移植层上下文。
+ * @param entry 检查点。
+ * @return int 成功返回 0，失败返回负数错误码。
+ */
+ITCM static int detools_journal_restore(struct detools_apply_patch_t *apply,
+                                        detools_ctx_t *ctx,
+                                        const detools_journal_t *entry)
+{
+    journal_cursor = (uint8_t *)entry->state;
+    journal_left = entry->state_len;
+    const int res = detools_apply_patch_restore(apply, cb_state_read);
+    if (res != 0)
+    {
+        return res;
+    }
+
+    // 旧固件读取位置已由 restore 通过 seek 回调恢复
+    ctx->patch_offset = detools_apply_patch_get_patch_offset(apply);
+    ctx->new_app_offset = entry->new_app_offset;
+    ctx->dirty = entry->dirty;
+    ctx->write_buf_len = entry->write_buf_len;
+    memcpy(ctx->write_buf, entry->write_buf, entry->write_buf_len);
+    if (ctx->digest != NULL)
+    {
+        *ctx->digest = entry->digest;
+    }
+    return 0;
+}
+
+#endif
+
+/* ====================================================================
+ * 5. 冲刷写回缓存 (Flush) - 还原结束后写入缓存中剩余的数据
+ * ==================================================================== */
+ITCM static int cb_to_flush(detools_ctx_t *ctx)
+{
+    if (ctx->write_buf_len == 0)
+    {
+        return 0;
+    }
+
+    uint32_t write_addr = ctx->new_app_base + ctx->new_app_offset;
+
+    // 不足 32 字节的零头由 bsp_flash_write 填充 0xFF
+    int flash_res = detools_port_program(ctx, ctx->new_app_offset,
+                                         ctx->write_buf, ctx->write_buf_len);
+
+    if (flash_res != BSP_FLASH_OK)
+    {
+        LOG_E("flash flush fail at 0x%08X", write_addr);
+        return -1;
+    }
+
+    // 累加最后的零头数据量
+    ctx->new_app_offset += ctx->write_buf_len;
+    ctx->write_buf_len = 0;
+
+    return 0;
+}
+
+/* ====================================================================
+ * 6. 顶层暴露接口
+ * ==================================================================== */
+
+/**
+ * @brief 初始化还原对象，并启用零拷贝读取与大块数据缓冲区。
+ * @param apply 还原对象。
+ * @param ctx 移植层上下文。
+ * @param patch_size 差分包总大小。
+ * @return int 成功返回0，失败返回负数错误码。
+ */
+ITCM static int detools_port_init(struct detools_apply_patch_t *apply,
+                                  detools_ctx_t *ctx, uint32_t patch_size)
+{
+    int res = detools_apply_patch_init(apply, cb_from_read, cb_from_seek,
+                                       patch_size, cb_to_write, ctx);
+    if (res == 0)
+    {
+        res = detools_apply_patch_set_from_map(apply, cb_from_map);
+    }
+    if (res == 0)
+    {
+        res = detools_apply_patch_set_to_buffer(apply, to_buf, sizeof(to_buf));
+    }
+    return res;
+}
+
+/**
+ * @brief 从 flash 中的补丁执行一遍还原。
+ * @param ctx 移植层上下文，偏移量从 0 开始。
+ * @param patch_size 差分包总大小。
+ * @param resume 继续还原的检查点，为 NULL 时从头开始。
+ * @return int 成功返回新固件大小，失败返回负数错误码。
+ */
+ITCM static int detools_port_run(detools_ctx_t *ctx, uint32_t patch_size,
+                                 const void *resume)
+{
+    struct detools_apply_patch_t apply;
+
+    ctx->old_app_offset = 0;
+    ctx->patch_offset = 0;
+    ctx->new_app_offset = 0;
+    ctx->write_buf_len = 0;
+
+    // 差分包同样位于 flash，直接按地址分块送入 detools，省去读回调的拷贝
+    detools_port_codec_reset();
+    int res = detools_port_init(&apply, ctx, patch_size);
+    uint64_t cycles = 0;
+
+#if DETOOLS_PORT_JOURNAL
+    if ((res >= 0) && (resume != NULL))
+    {
+        res = detools_journal_restore(&apply, ctx, resume);
+        if (res >= 0)
+        {
+            LOG_I("resume apply at patch %u, image %u", ctx->patch_offset,
+                  ctx->new_app_offset + ctx->write_buf_len);
+        }
+    }
+
+    // 扫描不写 flash，无需记录进度
+    bool journal_on = (ctx->write_mode != DETOOLS_PORT_WRITE_SCAN);
+    uint32_t journal_sector = ctx->new_app_offset / MCU_FLASH_SECTOR_SIZE;
+#else
+    (void)resume;
+#endif
+
+    while ((res >= 0) && (ctx->patch_offset < patch_size))
+    {
+        uint32_t len = patch_size - ctx->patch_offset;
+        if (len > DETOOLS_PORT_CHUNK_SIZE)
+        {
+            len = DETOOLS_PORT_CHUNK_SIZE;
+        }
+
+        const uint32_t start_cycles = DWT->CYCCNT;
+        res = detools_apply_patch_process(
+            &apply, (const uint8_t *)(ctx->patch_base + ctx->patch_offset),
+            len);
+        cycles += DWT->CYCCNT - start_cycles;
+        ctx->patch_offset += len;
+
+#if DETOOLS_PORT_JOURNAL
+        // 新固件每写完一个扇区记录一次检查点
+        if (journal_on && (res >= 0) &&
+            (ctx->new_app_offset / MCU_FLASH_SECTOR_SIZE != journal_sector))
+        {
+            journal_sector = ctx->new_app_offset / MCU_FLASH_SECTOR_SIZE;
+            res = detools_journal_save(&apply, ctx, patch_size);
+            if (res == -DETOOLS_NOT_IMPLEMENTED)
+            {
+                // heatshrink 的滑动窗口放不进 BKPRAM，本次还原不再记录进度，
+                // 作废已有检查点，中断后从头还原
+                LOG_W("%s state not resumable, restart from zero if "
+                      "interrupted",
+                      detools_port_codec_name(apply.compression));
+                detools_port_journal_clear();
+                journal_on = false;
+                res = 0;
+            }
+            else if (res != 0)
+            {
+                // 状态超出检查点大小
+                LOG_E("apply checkpoint fail at %u with %d",
+                      ctx->new_app_offset, res);
+            }
+        }
+#endif
+    }
+
+    if (res >= 0)
+    {
+        res = detools_apply_patch_finalize(&apply);
+    }
+    else
+    {
+        (void)detools_apply_patch_finalize(&apply);
+    }
+
+    // 扫描一遍不写 flash，周期数只包含解压与差分加法
+    if (res > 0)
+    {
+        LOG_I("%s pass: codec %s, %u.%02u cycles/byte, arena peak %u bytes",
+              (ctx->write_mode == DETOOLS_PORT_WRITE_SCAN) ? "scan" : "write",
+              detools_port_codec_name(apply.compression),
+              (uint32_t)(cycles / res), (uint32_t)(cycles * 100 / res % 100),
+              algo_arena_peak(&codec_arena));
+    }
+
+    // 3. 核心步骤 (Flush)：如果升级成功，且缓存里还有没写满的数据，
+    // 必须写进去，不足 32 字节的零头补 0xFF
+    if ((res >= 0) && (cb_to_flush(ctx) != 0))
+    {
+        return -DETOOLS_IO_FAILED;
+    }
+
+    return res;
+}
+
+#if DETOOLS_PORT_SKIP_WRITE
+/**
+ * @brief 擦除预扫描发现不同的扇区，已经为空的扇区跳过。
+ * @param ctx 移植层上下文。
+ * @return int 成功返回 0，失败返回负数错误码。
+ */
+ITCM static int detools_port_erase_dirty(detools_ctx_t *ctx)
+{
+    uint32_t erased = 0;
+    for (uint32_t i = 0; i < 32; ++i)
+    {
+        if ((ctx->dirty & (1UL << i)) == 0)
+        {
+            continue;
+        }
+
+        const uint32_t addr = ctx->new_app_base + i * MCU_FLASH_SECTOR_SIZE;
+        if (bsp_flash_is_blank(addr, MCU_FLASH_SECTOR_SIZE))
+        {
+            continue;
+        }
+
+#if DETOOLS_PORT_BANK_OVERLAP
+        // 后台擦除，写入该 bank 时才等待
+        const int result = bsp_flash_erase_start(addr, MCU_FLASH_SECTOR_SIZE);
+#else
+        const int result = bsp_flash_erase_sector_by_addr(addr);
+#endif
+        if (result != BSP_FLASH_OK)
+        {
+            LOG_E("flash erase fail at 0x%08X with %d", addr, result);
+            return -DETOOLS_IO_FAILED;
+        }
+        ++erased;
+    }
+
+    LOG_I("%u sectors differ, %u erased", __builtin_popcount(ctx->dirty),
+          erased);
+    return 0;
+}
+#endif
+
 ITCM int detools_apply_patch(uint32_t old_app_addr, uint32_t patch_addr,
-                        uint32_t patch_size, uint32_t new_app_addr)
+                             uint32_t patch_size, uint32_t new_app_addr,
+                             algo_digest_t *digest)
 {
     detools_ctx_t ctx;
     int res;
 
     // 初始化上下文环境
     ctx.old_app_base = old_app_addr;
-    ctx.old_app_offset = 0;
+    ctx.patch_base = patch_addr;
+    ctx.new_app_base = new_app_addr;
+    ctx.write_buf = write_buf;
+    ctx.dirty = 0;
+
+    // 在擦写任何扇区之前拒绝本配置无法还原的补丁
+    if ((patch_size > 0) &&
+        !detools_port_patch_supported(*(const uint8_t *)patch_addr))
+    {
+        LOG_E("%s patch not supported",
+              detools_port_codec_name(*(const uint8_t *)patch_addr & 0xf));
+        return -DETOOLS_BAD_COMPRESSION;
+    }
+
+    // 记录还原耗时，用于评估写入策略
+    const rt_tick_t start_tick = rt_tick_get();
+
+#if DETOOLS_PORT_JOURNAL
+    // 上次还原被打断时从检查点继续，已写入的 flash word 会被跳过
+    const detools_journal_t *resume = detools_journal_find(&ctx, patch_size);
+    if (resume != NULL)
+    {
+        ctx.write_mode = DETOOLS_PORT_SKIP_WRITE ? DETOOLS_PORT_WRITE_DIRTY
+                                                 : DETOOLS_PORT_WRITE_ERASE;
+        ctx.digest = digest;
+        res = detools_port_run(&ctx, patch_size, resume);
+        if (res >= 0)
+        {
+            goto done;
+        }
+
+        // 检查点之后的内容无法继续写入，从头还原
+        LOG_W("resume apply fail with %d, restart", res);
+        detools_port_journal_clear();
+        if (digest != NULL)
+        {
+            algo_digest_init(digest);
+        }
+    }
+#endif
+
+#if DETOOLS_PORT_SKIP_WRITE
+    // 第一遍只比较，找出与目标内容不同的扇区
+    ctx.write_mode = DETOOLS_PORT_WRITE_SCAN;
+    ctx.digest = NULL;
+    res = detools_port_run(&ctx, patch_size, NULL);
+    if (res >= 0)
+    {
+        res = detools_port_erase_dirty(&ctx);
+    }
+
+    // 第二遍只编程不同的扇区，摘要覆盖完整的新固件
+    if (res >= 0)
+    {
+        ctx.write_mode = DETOOLS_PORT_WRITE_DIRTY;
+        ctx.digest = digest;
+        res = detools_port_run(&ctx, patch_size, NULL);
+    }
+#else
+    // 只解压一遍，写入时按需擦除并跳过与目标相同的 flash word
+    ctx.write_mode = DETOOLS_PORT_WRITE_ERASE;
+    ctx.digest = digest;
+    res = detools_port_run(&ctx, patch_size, NULL);
+#endif
+
+#if DETOOLS_PORT_JOURNAL
+done:
+    // 无论成功与否都不再继续这次还原
+    detools_port_journal_clear();
+#endif
+
+    // 如果 res >= 0，代表成功，且返回值是新固件的总大小 (Bytes)
+    // 如果 res < 0，代表失败，可以通过 detools_error_as_string(res)
+    // 打印错误原因
+
+    if (res > 0)
+    {
+        LOG_I("detools(%d) in %u ms, ram %u bytes", res,
+              (rt_tick_get() - start_tick) * 1000 / RT_TICK_PER_SECOND,
+              sizeof(write_buf) + sizeof(to_buf) +
+                  sizeof(struct detools_apply_patch_t) +
+                  algo_arena_peak(&codec_arena));
+        res = DETOOLS_OK;
+    }
+    else
+    {
+        LOG_E("detools(%d): %s", res, detools_error_as_string(res));
+    }
+
+    // 会话结束，整体回收解压器内存
+    detools_port_codec_reset();
+    return res;
+}
+
+#if DETOOLS_PORT_ADD_BENCHMARK
+
+/**
+ * @brief 测量差分加法内核，以旧固件所在flash作为输入数据。
+ * @return int 结果与逐字节实现一致返回0，否则返回-1。
+ */
+static int detools_add_benchmark(void)
+{
+    const uint32_t size = (sizeof(to_buf) < sizeof(write_buf))
+                              ? sizeof(to_buf)
+                              : sizeof(write_buf);
+    const uint8_t *diff = (const uint8_t *)MCU_FLASH_START;
+    const uint8_t *from = diff + size;
+
+    // 逐字节实现作为参考结果
+    memcpy(write_buf, diff, size);
+    const uint32_t scalar_start = DWT->CYCCNT;
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        write_buf[i] = (uint8_t)(write_buf[i] + from[i]);
+    }
+    const uint32_t scalar_cycles = DWT->CYCCNT - scalar_start;
+
+    memcpy(to_buf, diff, size);
+    const uint32_t kernel_start = DWT->CYCCNT;
+    detools_add_bytes(to_buf, from, size);
+    const uint32_t kernel_cycles = DWT->CYCCNT - kernel_start;
+
+    // 以百分之一周期为单位输出，避免格式化浮点数
+    LOG_I("add %u bytes: scalar %u.%02u, kernel %u.%02u cycles/byte", size,
+          scalar_cycles / size, (scalar_cycles * 100 / size) % 100,
+          kernel_cycles / size, (kernel_cycles * 100 / size) % 100);
+
+    if (memcmp(to_buf, write_buf, size) != 0)
+    {
+        LOG_E("add kernel mismatch");
+        return -1;
+    }
+    return 0;
+}
+RUN_APP_EXPORT(detools_add_benchmark);
+
+#endif
+
+#if DETOOLS_PORT_IN_PLACE
+/* ====================================================================
+ * 7. 原地还原：旧固件与新固件共用一个分区，新内容按扇区暂存后整体编程
+ * ==================================================================== */
+
+#define DETOOLS_IN_PLACE_MAGIC (0x50414C49) // "ILAP"
+#define DETOOLS_IN_PLACE_NONE  (0xFFFFFFFF)
+
+/*
+ * 原地还原上下文，detools 给出的地址都是相对分区起始的偏移
+ */
+typedef struct {
+    uint32_t app_base;     // 固件分区首地址
+    uint32_t app_size;     // 固件分区大小
+    uint32_t patch_base;   // 差分包首地址
+    uint32_t patch_size;   // 差分包总大小
+    uint32_t erased;       // 已要求擦除但尚未落到 flash 的扇区位图
+    uint32_t stage_sector; // 暂存缓冲对应的扇区序号
+    uint32_t programmed;   // 实际擦写的扇区数量
+    algo_digest_t *digest; // 新固件摘要，为 NULL 时不计算
+    uint32_t digest_pos;   // 已计入摘要的新固件长度
+} detools_in_place_t;
+
+/*
+ * 已完成的步骤，两个槽按步骤奇偶交替写入，取有效槽中最大的步骤
+ * 原地还原会覆盖旧固件，中断后必须从记录的步骤继续，不能从头开始
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t app_base;
+    uint32_t patch_base;
+    uint32_t patch_size;
+    int32_t step;
+    uint16_t crc; // 以上全部字段的校验值，最后写入
+} detools_in_place_step_t;
+
+BACKUP static detools_in_place_step_t in_place_step[2];
+
+/* 一个扇区的暂存缓冲，扇区写完或步骤完成时整体编程 */
+AXI_UNINIT ALIGN(MCU_FLASH_WORD_SIZE) static uint8_t
+    stage_buf[MCU_FLASH_SECTOR_SIZE];
+
+/**
+ * @brief 计算步骤记录的校验值。
+ * @param entry 步骤记录。
+ * @return uint16_t 校验值。
+ */
+ITCM static uint16_t detools_in_place_step_crc(
+    const detools_in_place_step_t *entry)
+{
+    return algo_crc16((const uint8_t *)entry,
+                      offsetof(detools_in_place_step_t, crc));
+}
+
+/**
+ * @brief 把暂存的扇区写入 flash，内容未变时不擦写。
+ * @param ctx 原地还原上下文。
+ * @return int 成功返回 0，失败返回负数错误码。
+ */
+ITCM static int detools_in_place_flush_stage(detools_in_place_t *ctx)
+{
+    if (ctx->stage_sector == DETOOLS_IN_PLACE_NONE)
+    {
+        return 0;
+    }
+
+    const uint32_t addr =
+        ctx->app_base + ctx->stage_sector * MCU_FLASH_SECTOR_SIZE;
+    ctx->erased &= ~(1UL << ctx->stage_sector);
+    ctx->stage_sector = DETOOLS_IN_PLACE_NONE;
+
+    if (memcmp((const void *)addr, stage_buf, MCU_FLASH_SECTOR_SIZE) == 0)
+    {
+        return 0;
+    }
+
+    if (!bsp_flash_is_blank(addr, MCU_FLASH_SECTOR_SIZE) &&
+        (bsp_flash_erase(addr, MCU_FLASH_SECTOR_SIZE) != BSP_FLASH_OK))
+    {
+        LOG_E("in-place erase fail at 0x%08X", addr);
+        return -1;
+    }
+
+    // 扇区末尾擦除后即为 0xFF 的部分无需编程
+    uint32_t len = MCU_FLASH_SECTOR_SIZE;
+    while ((len > 0) && (stage_buf[len - 1] == 0xFF))
+    {
+        --len;
+    }
+    len = (len + MCU_FLASH_WORD_SIZE - 1) & ~(MCU_FLASH_WORD_SIZE - 1);
+    if ((len > 0) && (bsp_flash_write(addr, stage_buf, len) != BSP_FLASH_OK))
+    {
+        LOG_E("in-place program fail at 0x%08X", addr);
+        return -1;
+    }
 
+    ++ctx->programmed;
+    return 0;
+}
+
+/**
+ * @brief 擦除已要求擦除但之后没有写入的扇区。
+ * @param ctx 原地还原上下文。
+ * @return int 成功返回 0，失败返回负数错误码。
+ */
+ITCM static int detools_in_place_flush_erased(detools_in_place_t *ctx)
+{
+    while (ctx->erased != 0)
+    {
+        const uint32_t sector = __builtin_ctz(ctx->erased);
+        const uint32_t addr = ctx->app_base + sector * MCU_FLASH_SECTOR_SIZE;
+        ctx->erased &= ~(1UL << sector);
+
+        if (!bsp_flash_is_blank(addr, MCU_FLASH_SECTOR_SIZE))
+        {
+            if (bsp_flash_erase(addr, MCU_FLASH_SECTOR_SIZE) != BSP_FLASH_OK)
+            {
+                LOG_E("in-place erase fail at 0x%08X", addr);
+                return -1;
+            }
+            ++ctx->programmed;
+        }
+    }
+    return 0;
+}
+
+ITCM static int cb_mem_read(void *arg_p, void *dst_p, uintptr_t src,
+                            size_t size)
+{
+    detools_in_place_t *ctx = (detools_in_place_t *)arg_p;
+    uint8_t *dst = (uint8_t *)dst_p;
+
+    if ((src > ctx->app_size) || (size > ctx->app_size - src))
+    {
+        return -1;
+    }
+
+    // 读取可能跨扇区，逐扇区取暂存内容、擦除后的内容或 flash 内容
+    while (size > 0)
+    {
+        const uint32_t sector = src / MCU_FLASH_SECTOR_SIZE;
+        const uint32_t pos = src % MCU_FLASH_SECTOR_SIZE;
+        const uint32_t len = ((MCU_FLASH_SECTOR_SIZE - pos) < size)
+                                 ? (MCU_FLASH_SECTOR_SIZE - pos)
+                                 : size;
+
+        if (sector == ctx->stage_sector)
+        {
+            memcpy(dst, &stage_buf[pos], len);
+        }
+        else if ((ctx->erased & (1UL << sector)) != 0)
+        {
+            memset(dst, 0xFF, len);
+        }
+        else
+        {
+            memcpy(dst, (const void *)(ctx->app_base + src), len);
+        }
+
+        dst += len;
+        src += len;
+        size -= len;
+    }
+    return 0;
+}
+
+ITCM static int cb_mem_write(void *arg_p, uintptr_t dst, void *src_p,
+                             size_t size)
+{
+    detools_in_place_t *ctx = (detools_in_place_t *)arg_p;
+    const uint8_t *src = (const uint8_t *)src_p;
+
+    if ((dst > ctx->app_size) || (size > ctx->app_size - dst))
+    {
+        return -1;
+    }
+
+    // 新固件从头按顺序写入，移位阶段的写入不在摘要位置，不计入
+    if ((ctx->digest != NULL) && (dst == ctx->digest_pos))
+    {
+        algo_digest_update(ctx->digest, src, size);
+        ctx->digest_pos += size;
+    }
+
+    while (size > 0)
+    {
+        const uint32_t sector = dst / MCU_FLASH_SECTOR_SIZE;
+        const uint32_t pos = dst % MCU_FLASH_SECTOR_SIZE;
+        const uint32_t len = ((MCU_FLASH_SECTOR_SIZE - pos) < size)
+                                 ? (MCU_FLASH_SECTOR_SIZE - pos)
+                                 : size;
+
+        // 写到新的扇区时先把上一个扇区落到 flash
+        if (sector != ctx->stage_sector)
+        {
+            if (detools_in_place_flush_stage(ctx) != 0)
+            {
+                return -1;
+            }
+
+            const uint32_t addr =
+                ctx->app_base + sector * MCU_FLASH_SECTOR_SIZE;
+            if ((ctx->erased & (1UL << sector)) != 0)
+            {
+                memset(stage_buf, 0xFF, MCU_FLASH_SECTOR_SIZE);
+            }
+            else
+            {
+                memcpy(stage_buf, (const void *)addr, MCU_FLASH_SECTOR_SIZE);
+            }
+            ctx->stage_sector = sector;
+        }
+
+        memcpy(&stage_buf[pos], src, len);
+        dst += len;
+        src += len;
+        size -= len;
+    }
+    return 0;
+}
+
+ITCM static int cb_mem_erase(void *arg_p, uintptr_t addr, size_t size)
+{
+    detools_in_place_t *ctx = (detools_in_place_t *)arg_p;
+
+    // 段大小必须是扇区的整数倍，擦除总是从扇区边界开始
+    if (((addr % MCU_FLASH_SECTOR_SIZE) != 0) || (addr > ctx->app_size) ||
+        (size > ctx->app_size - addr))
+    {
+        return -1;
+    }
+
+    // 只做记录，扇区内容确定后再一并擦写
+    for (uint32_t pos = addr; pos < addr + size; pos += MCU_FLASH_SECTOR_SIZE)
+    {
+        const uint32_t sector = pos / MCU_FLASH_SECTOR_SIZE;
+        if (sector == ctx->stage_sector)
+        {
+            memset(stage_buf, 0xFF, MCU_FLASH_SECTOR_SIZE);
+        }
+        else
+        {
+            ctx->erased |= 1UL << sector;
+        }
+    }
+    return 0;
+}
+
+ITCM static int cb_step_set(void *arg_p, int step)
+{
+    detools_in_place_t *ctx = (detools_in_place_t *)arg_p;
+
+    // 步骤记录之前，该步骤的内容必须已经写入 flash
+    if ((detools_in_place_flush_stage(ctx) != 0) ||
+        (detools_in_place_flush_erased(ctx) != 0))
+    {
+        return -1;
+    }
+
+    if (step == 0)
+    {
+        // 全部步骤完成
+        in_place_step[0].magic = 0;
+        in_place_step[1].magic = 0;
+        return 0;
+    }
+
+    detools_in_place_step_t *entry = &in_place_step[step & 1];
+    entry->magic = 0;
+    entry->app_base = ctx->app_base;
+    entry->patch_base = ctx->patch_base;
+    entry->patch_size = ctx->patch_size;
+    entry->step = step;
+    entry->magic = DETOOLS_IN_PLACE_MAGIC;
+    entry->crc = detools_in_place_step_crc(entry);
+    return 0;
+}
+
+ITCM static int cb_step_get(void *arg_p, int *step_p)
+{
+    const detools_in_place_t *ctx = (const detools_in_place_t *)arg_p;
+
+    *step_p = 0;
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        const detools_in_place_step_t *entry = &in_place_step[i];
+        if ((entry->magic == DETOOLS_IN_PLACE_MAGIC) &&
+            (entry->app_base == ctx->app_base) &&
+            (entry->patch_base == ctx->patch_base) &&
+            (entry->patch_size == ctx->patch_size) &&
+            (entry->crc == detools_in_place_step_crc(entry)) &&
+            (entry->step > *step_p))
+        {
+            *step_p = entry->step;
+        }
+    }
+    return 0;
+}
+
+ITCM int detools_apply_patch_in_place(uint32_t app_addr, uint32_t app_size,
+                                      uint32_t patch_addr, uint32_t patch_size,
+                                      algo_digest_t *digest)
+{
+    struct detools_apply_patch_in_place_t apply;
+    detools_in_place_t ctx;
+
+    ctx.app_base = app_addr;
+    ctx.app_size = app_size;
     ctx.patch_base = patch_addr;
-    ctx.patch_offset = 0;
+    ctx.patch_size = patch_size;
+    ctx.erased = 0;
+    ctx.stage_sector = DETOOLS_IN_PLACE_NONE;
+    ctx.programmed = 0;
+    ctx.digest = digest;
+    ctx.digest_pos = 0;
 
-    ctx.new_app_base = new_app_addr;
-    ctx.new_app_offset = 0;
+    const rt_tick_t start_tick = rt_tick_get();
 
-    // TODO: 在这里执行新固件存放区的 Flash 擦除操作 (推荐做法)
-    // erase_app_partition(new_app_addr, EXPECTED_NEW_APP_SIZE);
+    int step = 0;
+    (void)cb_step_get(&ctx, &step);
+    if (step > 0)
+    {
+        LOG_I("resume in-place apply after step %d", step);
+    }
 
-    // 调用 detools 核心 API
-    res = detools_apply_patch_callbacks(cb_from_read, cb_from_seek,
-                                        cb_patch_read, patch_size, cb_to_write,
-                                        &ctx // arg_p 会透传给所有的 cb_xxx 函数
-    );
+    detools_port_codec_reset();
+    int res = detools_apply_patch_in_place_init(
+        &apply, cb_mem_read, cb_mem_write, cb_mem_erase, cb_step_set,
+        cb_step_get, patch_size, &ctx);
 
-    // 3. 核心步骤 (Flush)：如果升级成功，且缓存里还有没写满 32
-    // 字节的零头数据，必须补 0xFF 写进去
-    if ((res >= 0) && (ctx.write_buf_len > 0))
+    // 差分包位于 flash，直接按地址分块送入 detools
+    uint32_t offset = 0;
+    while ((res >= 0) && (offset < patch_size))
     {
-        uint32_t write_addr = ctx.new_app_base + ctx.new_app_offset;
+        uint32_t len = patch_size - offset;
+        if (len > DETOOLS_PORT_CHUNK_SIZE)
+        {
+            len = DETOOLS_PORT_CHUNK_SIZE;
+        }
+        res = detools_apply_patch_in_place_process(
+            &apply, (const uint8_t *)(patch_addr + offset), len);
+        offset += len;
+    }
+
+    const int fin = detools_apply_patch_in_place_finalize(&apply);
+    if (res >= 0)
+    {
+        res = fin;
+    }
 
-        // 剩余部分填充 0xFF
-        memset(&ctx.write_buf[ctx.write_buf_len], 0xFF, 32 - ctx.write_buf_len);
+    // 最后一步完成时 detools 已通过 cb_step_set 把暂存内容落到 flash
+    if (res > 0)
+    {
+        // 摘要在写入时计算，从中断处继续时已完成步骤的写入被跳过，
+        // 这部分新固件已在 flash 中，从 flash 读回补齐
+        if ((digest != NULL) && (ctx.digest_pos < (uint32_t)res))
+        {
+            algo_digest_update(digest,
+                               (const uint8_t *)(app_addr + ctx.digest_pos),
+                               res - ctx.digest_pos);
+        }
+        LOG_I("in-place detools(%d) in %u ms, %u sectors programmed, "
+              "codec %s, ram %u bytes",
+              res, (rt_tick_get() - start_tick) * 1000 / RT_TICK_PER_SECOND,
+              ctx.programmed, detools_port_codec_name(apply.compression),
+              sizeof(stage_buf) + sizeof(apply) +
+                  algo_arena_peak(&codec_arena));
+        res = DETOOLS_OK;
+    }
+    else
+    {
+        // 步骤记录保留，下次启动从中断处继续
+        LOG_E("in-place detools(%d): %s", res, detools_error_as_string(res));
+    }
 
-        __disable_irq();
-        int flash_res = HAL_FLASH_Unlock();
+    detools_port_codec_reset();
+    return res;
+}
+#endif
+
+ITCM void detools_port_journal_clear(void)
+{
+#if DETOOLS_PORT_JOURNAL
+    journal[0].magic = 0;
+    journal[1].magic = 0;
+#endif
+#if DETOOLS_PORT_IN_PLACE
+    in_place_step[0].magic = 0;
+    in_place_step[1].magic = 0;
+#endif
+}
+
+/* ====================================================================
+ * 8. 流式还原：ymodem 线程生产补丁数据块，还原线程消费
+ * ==================================================================== */
+
+/*
+ * 流式还原的数据块，len 为 0 表示补丁接收结束
+ */
+typedef struct {
+    uint32_t len;
+    uint8_t data[DETOOLS_PORT_STREAM_BLOCK_SIZE];
+} detools_stream_block_t;
+
+/*
+ * 数据块固定在槽位中，队列只传递槽位指针，ymodem 线程填入槽位时拷贝一次；
+ * 两个线程都按先进先出使用槽位，空闲槽位用信号量计数即可
+ */
+static detools_stream_block_t stream_blocks[DETOOLS_PORT_STREAM_QUEUE_DEPTH];
+static struct rt_semaphore stream_free_sem;
+static uint32_t stream_tx_index;
+
+static struct rt_messagequeue stream_mq;
+static uint8_t stream_mq_pool[(sizeof(detools_stream_block_t *) +
+                               sizeof(void *)) *
+                              DETOOLS_PORT_STREAM_QUEUE_DEPTH];
+static struct rt_semaphore stream_done_sem;
+static struct rt_thread stream_thread;
+static uint8_t stream_stack[DETOOLS_PORT_STREAM_THREAD_STK];
+
+static struct detools_apply_patch_t stream_apply;
+static detools_ctx_t stream_ctx;
+static volatile int stream_result;
+static rt_tick_t stream_start_tick;
+
+/**
+ * @brief 还原线程，把队列中的补丁数据块送入 detools。
+ * @param parameter 未使用。
+ */
+ITCM static void detools_stream_thread_entry(void *parameter)
+{
+    while (1)
+    {
+        detools_stream_block_t *block;
+        if (rt_mq_recv(&stream_mq, &block, sizeof(block),
+                       RT_WAITING_FOREVER) != RT_EOK)
+        {
+            continue;
+        }
 
-        if (flash_res == HAL_OK)
+        const uint32_t len = block->len;
+        if (len == 0)
         {
-            __HAL_FLASH_CLEAR_FLAG_BANK1(FLASH_FLAG_ALL_ERRORS_BANK1);
-            __HAL_FLASH_CLEAR_FLAG_BANK1(FLASH_FLAG_ALL_ERRORS_BANK2);
+            // 补丁接收结束，完成还原并冲刷缓存
+            int res = detools_apply_patch_finalize(&stream_apply);
+            if ((stream_result >= 0) && (res >= 0) &&
+                (cb_to_flush(&stream_ctx) != 0))
+            {
+                res = -DETOOLS_IO_FAILED;
+            }
+            if (stream_result >= 0)
+            {
+                stream_result = res;
+            }
+            rt_sem_release(&stream_free_sem);
+            rt_sem_release(&stream_done_sem);
+            continue;
+        }
 
-            flash_res = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD,
-                                          write_addr, (uint32_t)ctx.write_buf);
-            HAL_FLASH_Lock();
+        // 出错后继续取走数据块，让 ymodem 线程不会被阻塞
+        if (stream_result >= 0)
+        {
+            const int res =
+                detools_apply_patch_process(&stream_apply, block->data, len);
+            if (res < 0)
+            {
+                LOG_E("detools stream(%d): %s", res,
+                      detools_error_as_string(res));
+                stream_result = res;
+            }
         }
-        __enable_irq();
 
-        if (flash_res != HAL_OK)
+        // 数据已送入 detools，归还槽位
+        rt_sem_release(&stream_free_sem);
+    }
+}
+
+/**
+ * @brief 初始化流式还原使用的队列与线程。
+ * @return int 非0为失败。
+ */
+static int detools_stream_init(void)
+{
+    const char *const name = "detools";
+    rt_err_t result =
+        rt_mq_init(&stream_mq, "detools_mq", &stream_mq_pool[0],
+                   sizeof(detools_stream_block_t *), sizeof(stream_mq_pool),
+                   RT_IPC_FLAG_FIFO);
+    if (result != RT_EOK)
+    {
+        LOG_E("<mq:%s> init fail with %d", name, result);
+        return result;
+    }
+
+    rt_sem_init(&stream_free_sem, "detools_free",
+                DETOOLS_PORT_STREAM_QUEUE_DEPTH, RT_IPC_FLAG_FIFO);
+    rt_sem_init(&stream_done_sem, "detools_done", 0, RT_IPC_FLAG_FIFO);
+
+    result = rt_thread_init(&stream_thread, name, detools_stream_thread_entry,
+                            NULL, &stream_stack[0], sizeof(stream_stack),
+                            DETOOLS_PORT_STREAM_THREAD_PRIO, 0);
+    if (result == RT_EOK)
+    {
+        result = rt_thread_startup(&stream_thread);
+    }
+
+    if (result == RT_EOK)
+    {
+        LOG_I("<thread:%s> startup success", name);
+    }
+    else
+    {
+        LOG_E("<thread:%s> startup fail with %d", name, result);
+    }
+    return result;
+}
+RUN_ENV_EXPORT(detools_stream_init);
+
+ITCM int detools_stream_begin(uint32_t old_app_addr, uint32_t patch_size,
+                              uint32_t new_app_addr, algo_digest_t *digest)
+{
+    stream_ctx.old_app_base = old_app_addr;
+    stream_ctx.old_app_offset = 0;
+
+    stream_ctx.patch_base = 0;
+    stream_ctx.patch_offset = 0;
+
+    stream_ctx.new_app_base = new_app_addr;
+    stream_ctx.new_app_offset = 0;
+
+    stream_ctx.write_buf = write_buf;
+    stream_ctx.write_buf_len = 0;
+
+    stream_ctx.digest = digest;
+
+    // 流式数据只有一遍，目标分区已整体擦除
+    stream_ctx.write_mode = DETOOLS_PORT_WRITE_ALL;
+    stream_ctx.dirty = 0;
+
+    stream_result = 0;
+    stream_start_tick = rt_tick_get();
+
+    // 清除上一次残留的完成信号
+    while (rt_sem_trytake(&stream_done_sem) == RT_EOK)
+        ;
+
+    detools_port_codec_reset();
+    return detools_port_init(&stream_apply, &stream_ctx, patch_size);
+}
+
+/**
+ * @brief 取得一个空闲槽位，填入数据后把槽位指针送入队列。
+ * @param data 补丁数据，len 为 0 时忽略。
+ * @param len 数据长度，0 表示补丁接收结束。
+ * @return int 0为成功，负数为失败。
+ */
+ITCM static int detools_stream_send(const uint8_t *data, uint32_t len)
+{
+    // 槽位用完时阻塞，还原速度跟不上串口时对发送端形成背压
+    if (rt_sem_take(&stream_free_sem, RT_WAITING_FOREVER) != RT_EOK)
+    {
+        return -DETOOLS_IO_FAILED;
+    }
+
+    detools_stream_block_t *block =
+        &stream_blocks[stream_tx_index % DETOOLS_PORT_STREAM_QUEUE_DEPTH];
+    block->len = len;
+    if (len > 0)
+    {
+        memcpy(block->data, data, len);
+    }
+
+    // 槽位数与队列深度相同，取得槽位后队列不会满
+    if (rt_mq_send(&stream_mq, &block, sizeof(block)) != RT_EOK)
+    {
+        rt_sem_release(&stream_free_sem);
+        return -DETOOLS_IO_FAILED;
+    }
+
+    ++stream_tx_index;
+    return 0;
+}
+
+ITCM int detools_stream_write(const uint8_t *data, uint32_t len)
+{
+    while (len > 0)
+    {
+        const uint32_t block_len = (len < DETOOLS_PORT_STREAM_BLOCK_SIZE)
+                                       ? len
+                                       : DETOOLS_PORT_STREAM_BLOCK_SIZE;
+
+        if (detools_stream_send(data, block_len) != 0)
         {
-            // LOG_E("flash flush fail at 0x%08X", write_addr);
-            return -1;
+            return -DETOOLS_IO_FAILED;
         }
 
-        // 累加最后的零头数据量
-        ctx.new_app_offset += ctx.write_buf_len;
+        data += block_len;
+        len -= block_len;
     }
 
-    // 如果 res >= 0，代表成功，且返回值是新固件的总大小 (Bytes)
-    // 如果 res < 0，代表失败，可以通过 detools_error_as_string(res)
-    // 打印错误原因
+    return stream_result;
+}
 
+ITCM int detools_stream_end(void)
+{
+    if (detools_stream_send(NULL, 0) != 0)
+    {
+        return -DETOOLS_IO_FAILED;
+    }
+
+    // 等待还原线程处理完队列中剩余的数据
+    rt_sem_take(&stream_done_sem, RT_WAITING_FOREVER);
+
+    int res = stream_result;
     if (res > 0)
     {
-        LOG_I("detools(%d)", res);
+        LOG_I("detools stream(%d) in %u ms", res,
+              (rt_tick_get() - stream_start_tick) * 1000 /
+                  RT_TICK_PER_SECOND);
         res = DETOOLS_OK;
     }
     else
     {
-        LOG_E("detools(%d): %s", res, detools_error_as_string(res));
+        LOG_E("detools stream(%d): %s", res, detools_error_as_string(res));
     }
 
+    detools_port_codec_reset();
     return res;
 }
\ No newline at end of file
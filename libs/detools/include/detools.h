@@ -23,7 +23,7 @@
 #endif
 
 #ifndef DETOOLS_CONFIG_COMPRESSION_HEATSHRINK
-#define DETOOLS_CONFIG_COMPRESSION_HEATSHRINK 0
+#define DETOOLS_CONFIG_COMPRESSION_HEATSHRINK 1
 #endif
 
 #include <stdint.h>
@@ -74,6 +74,19 @@
  */
 typedef int (*detools_read_t)(void *arg_p, uint8_t *buf_p, size_t size);
 
+/**
+ * Map callback. Used instead of the read callback when the from-data
+ * is directly addressable, for example memory mapped flash.
+ *
+ * @param[in] arg_p User data passed to detools_apply_patch_init().
+ * @param[out] buf_pp Outputs a pointer to the next size bytes.
+ * @param[in] size Number of bytes to map.
+ *
+ * @return zero(0) or negative error code.
+ */
+typedef int (*detools_map_t)(void *arg_p, const uint8_t **buf_pp,
+                             size_t size);
+
 /**
  * Write callback.
  *
@@ -301,6 +314,7 @@ enum detools_apply_patch_init_state_t {
  */
 struct detools_apply_patch_t {
     detools_read_t from_read;
+    detools_map_t from_map;
     detools_seek_t from_seek;
     size_t patch_size;
     detools_write_t to_write;
@@ -313,6 +327,8 @@ struct detools_apply_patch_t {
     size_t to_size;
     int from_offset;
     size_t chunk_size;
+    uint8_t *to_buf_p;
+    size_t to_buf_size;
     struct detools_apply_patch_patch_reader_t patch_reader;
     struct detools_apply_patch_chunk_t chunk;
     struct detools_apply_patch_size_t size;
@@ -380,6 +396,44 @@ int detools_apply_patch_init(struct detools_apply_patch_t *self_p,
                              size_t patch_size, detools_write_t to_write,
                              void *arg_p);
 
+/**
+ * Read from-data through given map callback instead of the read
+ * callback, so diff data is added straight from the from-data without
+ * a staging copy. Call after detools_apply_patch_init().
+ *
+ * @param[in,out] self_p Initialized apply patch object.
+ * @param[in] from_map Callback to map from-data.
+ *
+ * @return zero(0) or negative error code.
+ */
+int detools_apply_patch_set_from_map(struct detools_apply_patch_t *self_p,
+                                     detools_map_t from_map);
+
+/**
+ * Use given buffer for reconstructed to-data instead of a small stack
+ * buffer, so each to_write call covers a longer span. Call after
+ * detools_apply_patch_init().
+ *
+ * @param[in,out] self_p Initialized apply patch object.
+ * @param[in] buf_p Buffer to use. Must outlive the apply patch object.
+ * @param[in] size Buffer size in bytes.
+ *
+ * @return zero(0) or negative error code.
+ */
+int detools_apply_patch_set_to_buffer(struct detools_apply_patch_t *self_p,
+                                      uint8_t *buf_p, size_t size);
+
+/**
+ * Add given from-data to given to-data byte by byte, modulo 256. This
+ * is the diff reconstruction kernel, a word at a time using SIMD
+ * instructions when the target has them.
+ *
+ * @param[in,out] to_p Diff data in, to-data out.
+ * @param[in] from_p From-data.
+ * @param[in] size Number of bytes.
+ */
+void detools_add_bytes(uint8_t *to_p, const uint8_t *from_p, size_t size);
+
 /**
  * Dump given apply patch object state. Call
  * `detools_apply_patch_restore()` to restore an apply patch object to
@@ -15,10 +15,41 @@
 #define MAX(x, y) (((x) > (y)) ? (x) : (y))
 #define DIV_CEIL(n, d) (((n) + (d) - 1) / (d))
 
+/* Add four bytes lane by lane, modulo 256. */
+#if defined(__ARM_FEATURE_SIMD32) && (__ARM_FEATURE_SIMD32 == 1)
+#include <arm_acle.h>
+#define ADD_U8X4(a, b) ((uint32_t)__uadd8((uint8x4_t)(a), (uint8x4_t)(b)))
+#else
+#define ADD_U8X4(a, b)                                                         \
+    ((((a) & 0x7f7f7f7fu) + ((b) & 0x7f7f7f7fu)) ^ (((a) ^ (b)) & 0x80808080u))
+#endif
+
 /*
  * Utility functions.
  */
 
+void detools_add_bytes(uint8_t *to_p, const uint8_t *from_p, size_t size)
+{
+    size_t i;
+    uint32_t to;
+    uint32_t from;
+
+    /* memcpy() compiles to single unaligned word accesses on targets
+       that support them. */
+    for (i = 0; (i + 4) <= size; i += 4)
+    {
+        memcpy(&to, &to_p[i], 4);
+        memcpy(&from, &from_p[i], 4);
+        to = ADD_U8X4(to, from);
+        memcpy(&to_p[i], &to, 4);
+    }
+
+    for (; i < size; i++)
+    {
+        to_p[i] = (uint8_t)(to_p[i] + from_p[i]);
+    }
+}
+
 static size_t chunk_left(struct detools_apply_patch_chunk_t *self_p)
 {
     return (self_p->size - self_p->offset);
@@ -1239,12 +1270,28 @@ static int process_data(struct detools_apply_patch_t *self_p,
                         enum detools_apply_patch_state_t next_state)
 {
     int res;
-    size_t i;
     uint8_t to[128];
+    uint8_t *to_p;
     size_t to_size;
     uint8_t from[128];
+    const uint8_t *from_p;
 
-    to_size = MIN(sizeof(to), self_p->chunk_size);
+    if (self_p->to_buf_p != NULL)
+    {
+        to_p = self_p->to_buf_p;
+        to_size = MIN(self_p->to_buf_size, self_p->chunk_size);
+    }
+    else
+    {
+        to_p = &to[0];
+        to_size = MIN(sizeof(to), self_p->chunk_size);
+    }
+
+    if ((next_state == detools_apply_patch_state_extra_size_t) &&
+        (self_p->from_map == NULL))
+    {
+        to_size = MIN(sizeof(from), to_size);
+    }
 
     if (to_size == 0)
     {
@@ -1253,7 +1300,7 @@ static int process_data(struct detools_apply_patch_t *self_p,
         return (0);
     }
 
-    res = patch_reader_decompress(&self_p->patch_reader, &to[0], &to_size);
+    res = patch_reader_decompress(&self_p->patch_reader, to_p, &to_size);
 
     if (res != 0)
     {
@@ -1262,7 +1309,15 @@ static int process_data(struct detools_apply_patch_t *self_p,
 
     if (next_state == detools_apply_patch_state_extra_size_t)
     {
-        res = self_p->from_read(self_p->arg_p, &from[0], to_size);
+        if (self_p->from_map != NULL)
+        {
+            res = self_p->from_map(self_p->arg_p, &from_p, to_size);
+        }
+        else
+        {
+            res = self_p->from_read(self_p->arg_p, &from[0], to_size);
+            from_p = &from[0];
+        }
 
         if (res != 0)
         {
@@ -1270,17 +1325,13 @@ static int process_data(struct detools_apply_patch_t *self_p,
         }
 
         self_p->from_offset += to_size;
-
-        for (i = 0; i < to_size; i++)
-        {
-            to[i] = (uint8_t)(to[i] + from[i]);
-        }
+        detools_add_bytes(to_p, from_p, to_size);
     }
 
     self_p->to_offset += to_size;
     self_p->chunk_size -= to_size;
 
-    res = self_p->to_write(self_p->arg_p, &to[0], to_size);
+    res = self_p->to_write(self_p->arg_p, to_p, to_size);
 
     if (res != 0)
     {
@@ -1438,6 +1489,7 @@ int detools_apply_patch_init(struct detools_apply_patch_t *self_p,
                              void *arg_p)
 {
     self_p->from_read = from_read;
+    self_p->from_map = NULL;
     self_p->from_seek = from_seek;
     self_p->patch_size = patch_size;
     self_p->patch_offset = 0;
@@ -1447,11 +1499,35 @@ int detools_apply_patch_init(struct detools_apply_patch_t *self_p,
     self_p->arg_p = arg_p;
     self_p->state = detools_apply_patch_state_init_t;
     self_p->init_state = detools_apply_patch_init_state_fixed_header_t;
+    self_p->to_buf_p = NULL;
+    self_p->to_buf_size = 0;
     self_p->patch_reader.destroy = NULL;
 
     return (0);
 }
 
+int detools_apply_patch_set_from_map(struct detools_apply_patch_t *self_p,
+                                     detools_map_t from_map)
+{
+    self_p->from_map = from_map;
+
+    return (0);
+}
+
+int detools_apply_patch_set_to_buffer(struct detools_apply_patch_t *self_p,
+                                      uint8_t *buf_p, size_t size)
+{
+    if ((buf_p == NULL) || (size == 0))
+    {
+        return (-DETOOLS_INTERNAL_ERROR);
+    }
+
+    self_p->to_buf_p = buf_p;
+    self_p->to_buf_size = size;
+
+    return (0);
+}
+
 int detools_apply_patch_dump(struct detools_apply_patch_t *self_p,
                              detools_state_write_t state_write)
 {
@@ -2033,7 +2109,6 @@ static int in_place_process_data(struct detools_apply_patch_in_place_t *self_p,
                                  enum detools_apply_patch_state_t next_state)
 {
     int res;
-    size_t i;
     uint8_t to[128];
     size_t to_size;
     uint8_t from[128];
@@ -2065,11 +2140,7 @@ static int in_place_process_data(struct detools_apply_patch_in_place_t *self_p,
         }
 
         self_p->segment.from_offset += (int)to_size;
-
-        for (i = 0; i < to_size; i++)
-        {
-            to[i] = (uint8_t)(to[i] + from[i]);
-        }
+        detools_add_bytes(&to[0], &from[0], to_size);
     }
 
     res = in_place_mem_write(self_p,
@@ -0,0 +1,15 @@
+#ifndef _HEATSHRINK_COMMON_H_
+#define _HEATSHRINK_COMMON_H_
+
+/**
+ * @brief 与heatshrink 0.4的流格式一致：
+ * 标记位1后跟8位字面量，标记位0后跟(窗口位数)位偏移与(前瞻位数)位长度，
+ * 偏移与长度都以减1的形式存储，位序从高到低。
+ */
+#define HEATSHRINK_MIN_WINDOW_BITS    4  //!< 最小窗口位数
+#define HEATSHRINK_MAX_WINDOW_BITS    15 //!< 最大窗口位数
+#define HEATSHRINK_MIN_LOOKAHEAD_BITS 3  //!< 最小前瞻位数
+#define HEATSHRINK_LITERAL_MARKER     0x01
+#define HEATSHRINK_BACKREF_MARKER     0x00
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _HEATSHRINK_CONFIG_H_
+#define _HEATSHRINK_CONFIG_H_
+
+#include <stddef.h>
+
+/**
+ * @brief 解码器按补丁头中的窗口参数动态分配，
+ * 置0时解码器内嵌在detools还原对象中，只支持下面的固定参数。
+ */
+#ifndef HEATSHRINK_DYNAMIC_ALLOC
+#define HEATSHRINK_DYNAMIC_ALLOC 1
+#endif
+
+#if HEATSHRINK_DYNAMIC_ALLOC
+/**
+ * @brief 解码器内存由detools移植层的解压器内存区提供，不使用系统堆。
+ */
+extern void *detools_port_codec_alloc(size_t size);
+extern void detools_port_codec_free(void *ptr);
+
+#define HEATSHRINK_MALLOC(SZ)  detools_port_codec_alloc(SZ)
+#define HEATSHRINK_FREE(P, SZ) detools_port_codec_free(P)
+#else
+#define HEATSHRINK_STATIC_INPUT_BUFFER_SIZE 32 //!< 输入缓冲大小
+#define HEATSHRINK_STATIC_WINDOW_BITS       8  //!< 窗口位数
+#define HEATSHRINK_STATIC_LOOKAHEAD_BITS    4  //!< 前瞻位数
+#endif
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef _HEATSHRINK_DECODER_H_
+#define _HEATSHRINK_DECODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "heatshrink_common.h"
+#include "heatshrink_config.h"
+
+/**
+ * @brief 写入输入数据的结果。
+ */
+typedef enum {
+    HSDR_SINK_OK,             //!< 数据已写入输入缓冲
+    HSDR_SINK_FULL,           //!< 输入缓冲已满，需要先取出输出
+    HSDR_SINK_ERROR_NULL = -1 //!< 参数为空
+} HSD_sink_res;
+
+/**
+ * @brief 取出输出数据的结果。
+ */
+typedef enum {
+    HSDR_POLL_EMPTY,             //!< 输入已耗尽
+    HSDR_POLL_MORE,              //!< 输出缓冲已满，还有数据可取
+    HSDR_POLL_ERROR_NULL = -1,   //!< 参数为空
+    HSDR_POLL_ERROR_UNKNOWN = -2 //!< 状态机异常
+} HSD_poll_res;
+
+/**
+ * @brief 结束解码的结果。
+ */
+typedef enum {
+    HSDR_FINISH_DONE,           //!< 全部数据已解码
+    HSDR_FINISH_MORE,           //!< 仍有数据未取出
+    HSDR_FINISH_ERROR_NULL = -1 //!< 参数为空
+} HSD_finish_res;
+
+/**
+ * @brief 解码器状态，输入缓冲与滑动窗口紧跟在结构体之后。
+ */
+typedef struct {
+    uint16_t input_size;   //!< 输入缓冲中的字节数
+    uint16_t input_index;  //!< 下一个未处理的输入字节
+    uint16_t output_count; //!< 反向引用剩余的输出字节数
+    uint16_t output_index; //!< 反向引用的偏移
+    uint16_t head_index;   //!< 滑动窗口写位置
+    uint8_t state;         //!< 状态机当前状态
+    uint8_t current_byte;  //!< 正在拆分的输入字节
+    uint8_t bit_index;     //!< 当前字节中下一位的掩码，0表示需要新字节
+#if HEATSHRINK_DYNAMIC_ALLOC
+    uint16_t input_buffer_size; //!< 输入缓冲大小
+    uint8_t window_sz2;         //!< 窗口位数
+    uint8_t lookahead_sz2;      //!< 前瞻位数
+    uint8_t buffers[];          //!< 输入缓冲 + 滑动窗口
+#else
+    uint8_t buffers[(1 << HEATSHRINK_STATIC_WINDOW_BITS) +
+                    HEATSHRINK_STATIC_INPUT_BUFFER_SIZE];
+#endif
+} heatshrink_decoder;
+
+#if HEATSHRINK_DYNAMIC_ALLOC
+/**
+ * @brief 分配并复位解码器。
+ * @param input_buffer_size 输入缓冲大小。
+ * @param window_sz2 窗口位数。
+ * @param lookahead_sz2 前瞻位数。
+ * @return heatshrink_decoder* 解码器，参数无效或内存不足时返回NULL。
+ */
+heatshrink_decoder *heatshrink_decoder_alloc(uint16_t input_buffer_size,
+                                             uint8_t window_sz2,
+                                             uint8_t lookahead_sz2);
+
+/**
+ * @brief 释放解码器。
+ * @param hsd 解码器。
+ */
+void heatshrink_decoder_free(heatshrink_decoder *hsd);
+#endif
+
+/**
+ * @brief 复位解码器，清空输入缓冲与滑动窗口。
+ * @param hsd 解码器。
+ */
+void heatshrink_decoder_reset(heatshrink_decoder *hsd);
+
+/**
+ * @brief 写入压缩数据。
+ * @param hsd 解码器。
+ * @param in_buf 压缩数据。
+ * @param size 数据长度。
+ * @param input_size 实际写入的长度。
+ * @return HSD_sink_res 写入结果。
+ */
+HSD_sink_res heatshrink_decoder_sink(heatshrink_decoder *hsd,
+                                     const uint8_t *in_buf, size_t size,
+                                     size_t *input_size);
+
+/**
+ * @brief 取出解码后的数据。
+ * @param hsd 解码器。
+ * @param out_buf 输出缓冲。
+ * @param out_buf_size 输出缓冲大小。
+ * @param output_size 实际输出的长度。
+ * @return HSD_poll_res 取出结果。
+ */
+HSD_poll_res heatshrink_decoder_poll(heatshrink_decoder *hsd, uint8_t *out_buf,
+                                     size_t out_buf_size, size_t *output_size);
+
+/**
+ * @brief 检查输入是否已全部解码。
+ * @param hsd 解码器。
+ * @return HSD_finish_res 检查结果。
+ */
+HSD_finish_res heatshrink_decoder_finish(heatshrink_decoder *hsd);
+
+#endif
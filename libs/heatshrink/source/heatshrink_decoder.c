@@ -0,0 +1,357 @@
+#include <heatshrink_decoder.h>
+#include <string.h>
+
+/**
+ * @brief 解码状态机的状态。
+ */
+typedef enum {
+    HSDS_TAG_BIT,           //!< 读取标记位
+    HSDS_YIELD_LITERAL,     //!< 输出字面量
+    HSDS_BACKREF_INDEX_MSB, //!< 读取偏移高位
+    HSDS_BACKREF_INDEX_LSB, //!< 读取偏移低8位
+    HSDS_BACKREF_COUNT_MSB, //!< 读取长度高位
+    HSDS_BACKREF_COUNT_LSB, //!< 读取长度低8位
+    HSDS_YIELD_BACKREF,     //!< 输出反向引用
+} HSD_state;
+
+/**
+ * @brief 输入位数不足时的返回值。
+ */
+#define NO_BITS ((uint16_t)-1)
+
+#if HEATSHRINK_DYNAMIC_ALLOC
+#define INPUT_BUFFER_SIZE(hsd) ((hsd)->input_buffer_size)
+#define WINDOW_BITS(hsd)       ((hsd)->window_sz2)
+#define LOOKAHEAD_BITS(hsd)    ((hsd)->lookahead_sz2)
+#else
+#define INPUT_BUFFER_SIZE(hsd) (HEATSHRINK_STATIC_INPUT_BUFFER_SIZE)
+#define WINDOW_BITS(hsd)       (HEATSHRINK_STATIC_WINDOW_BITS)
+#define LOOKAHEAD_BITS(hsd)    (HEATSHRINK_STATIC_LOOKAHEAD_BITS)
+#endif
+
+/**
+ * @brief 一次poll调用的输出位置。
+ */
+typedef struct {
+    uint8_t *buf;        //!< 输出缓冲
+    size_t buf_size;     //!< 输出缓冲大小
+    size_t *output_size; //!< 已输出的字节数
+} output_info;
+
+#if HEATSHRINK_DYNAMIC_ALLOC
+heatshrink_decoder *heatshrink_decoder_alloc(uint16_t input_buffer_size,
+                                             uint8_t window_sz2,
+                                             uint8_t lookahead_sz2)
+{
+    if ((window_sz2 < HEATSHRINK_MIN_WINDOW_BITS) ||
+        (window_sz2 > HEATSHRINK_MAX_WINDOW_BITS) ||
+        (lookahead_sz2 < HEATSHRINK_MIN_LOOKAHEAD_BITS) ||
+        (lookahead_sz2 >= window_sz2) || (input_buffer_size == 0))
+    {
+        return NULL;
+    }
+
+    const size_t buffers_size = ((size_t)1 << window_sz2) + input_buffer_size;
+    heatshrink_decoder *hsd =
+        HEATSHRINK_MALLOC(sizeof(heatshrink_decoder) + buffers_size);
+    if (hsd == NULL)
+    {
+        return NULL;
+    }
+
+    hsd->input_buffer_size = input_buffer_size;
+    hsd->window_sz2 = window_sz2;
+    hsd->lookahead_sz2 = lookahead_sz2;
+    heatshrink_decoder_reset(hsd);
+    return hsd;
+}
+
+void heatshrink_decoder_free(heatshrink_decoder *hsd)
+{
+    HEATSHRINK_FREE(hsd, sizeof(heatshrink_decoder) +
+                             ((size_t)1 << hsd->window_sz2) +
+                             hsd->input_buffer_size);
+}
+#endif
+
+void heatshrink_decoder_reset(heatshrink_decoder *hsd)
+{
+    // 编码器假定窗口初始全为0
+    memset(hsd->buffers, 0,
+           ((size_t)1 << WINDOW_BITS(hsd)) + INPUT_BUFFER_SIZE(hsd));
+    hsd->state = HSDS_TAG_BIT;
+    hsd->input_size = 0;
+    hsd->input_index = 0;
+    hsd->bit_index = 0x00;
+    hsd->current_byte = 0x00;
+    hsd->output_count = 0;
+    hsd->output_index = 0;
+    hsd->head_index = 0;
+}
+
+HSD_sink_res heatshrink_decoder_sink(heatshrink_decoder *hsd,
+                                     const uint8_t *in_buf, size_t size,
+                                     size_t *input_size)
+{
+    if ((hsd == NULL) || (in_buf == NULL) || (input_size == NULL))
+    {
+        return HSDR_SINK_ERROR_NULL;
+    }
+
+    const size_t rem = INPUT_BUFFER_SIZE(hsd) - hsd->input_size;
+    if (rem == 0)
+    {
+        *input_size = 0;
+        return HSDR_SINK_FULL;
+    }
+
+    size = (rem < size) ? rem : size;
+    memcpy(&hsd->buffers[hsd->input_size], in_buf, size);
+    hsd->input_size += (uint16_t)size;
+    *input_size = size;
+    return HSDR_SINK_OK;
+}
+
+/**
+ * @brief 从输入中按高位在前取出若干位。
+ * @param hsd 解码器。
+ * @param count 位数，不超过15。
+ * @return uint16_t 取出的值，输入不足时返回NO_BITS且不消耗输入。
+ */
+static uint16_t get_bits(heatshrink_decoder *hsd, uint8_t count)
+{
+    if (count > 15)
+    {
+        return NO_BITS;
+    }
+
+    // 中途挂起无法记录已取出的位，不够时一位也不取
+    if ((hsd->input_size == 0) && (hsd->bit_index < (1 << (count - 1))))
+    {
+        return NO_BITS;
+    }
+
+    uint16_t accumulator = 0;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        if (hsd->bit_index == 0x00)
+        {
+            if (hsd->input_size == 0)
+            {
+                return NO_BITS;
+            }
+            hsd->current_byte = hsd->buffers[hsd->input_index++];
+            if (hsd->input_index == hsd->input_size)
+            {
+                // 输入缓冲已读完
+                hsd->input_index = 0;
+                hsd->input_size = 0;
+            }
+            hsd->bit_index = 0x80;
+        }
+        accumulator <<= 1;
+        if (hsd->current_byte & hsd->bit_index)
+        {
+            accumulator |= 0x01;
+        }
+        hsd->bit_index >>= 1;
+    }
+    return accumulator;
+}
+
+/**
+ * @brief 输出一个字节。
+ */
+static void push_byte(output_info *oi, uint8_t byte)
+{
+    oi->buf[(*oi->output_size)++] = byte;
+}
+
+static HSD_state st_tag_bit(heatshrink_decoder *hsd)
+{
+    const uint16_t bits = get_bits(hsd, 1);
+    if (bits == NO_BITS)
+    {
+        return HSDS_TAG_BIT;
+    }
+    if (bits == HEATSHRINK_LITERAL_MARKER)
+    {
+        return HSDS_YIELD_LITERAL;
+    }
+    if (WINDOW_BITS(hsd) > 8)
+    {
+        return HSDS_BACKREF_INDEX_MSB;
+    }
+    hsd->output_index = 0;
+    return HSDS_BACKREF_INDEX_LSB;
+}
+
+static HSD_state st_yield_literal(heatshrink_decoder *hsd, output_info *oi)
+{
+    if (*oi->output_size >= oi->buf_size)
+    {
+        return HSDS_YIELD_LITERAL;
+    }
+
+    const uint16_t byte = get_bits(hsd, 8);
+    if (byte == NO_BITS)
+    {
+        return HSDS_YIELD_LITERAL;
+    }
+
+    uint8_t *window = &hsd->buffers[INPUT_BUFFER_SIZE(hsd)];
+    const uint16_t mask = (uint16_t)((1 << WINDOW_BITS(hsd)) - 1);
+    const uint8_t c = (uint8_t)(byte & 0xFF);
+    window[hsd->head_index++ & mask] = c;
+    push_byte(oi, c);
+    return HSDS_TAG_BIT;
+}
+
+static HSD_state st_backref_index_msb(heatshrink_decoder *hsd)
+{
+    const uint16_t bits = get_bits(hsd, WINDOW_BITS(hsd) - 8);
+    if (bits == NO_BITS)
+    {
+        return HSDS_BACKREF_INDEX_MSB;
+    }
+    hsd->output_index = (uint16_t)(bits << 8);
+    return HSDS_BACKREF_INDEX_LSB;
+}
+
+static HSD_state st_backref_index_lsb(heatshrink_decoder *hsd)
+{
+    const uint8_t bit_ct = WINDOW_BITS(hsd);
+    const uint16_t bits = get_bits(hsd, (bit_ct < 8) ? bit_ct : 8);
+    if (bits == NO_BITS)
+    {
+        return HSDS_BACKREF_INDEX_LSB;
+    }
+    hsd->output_index |= bits;
+    hsd->output_index++;
+    hsd->output_count = 0;
+    return (LOOKAHEAD_BITS(hsd) > 8) ? HSDS_BACKREF_COUNT_MSB
+                                     : HSDS_BACKREF_COUNT_LSB;
+}
+
+static HSD_state st_backref_count_msb(heatshrink_decoder *hsd)
+{
+    const uint16_t bits = get_bits(hsd, LOOKAHEAD_BITS(hsd) - 8);
+    if (bits == NO_BITS)
+    {
+        return HSDS_BACKREF_COUNT_MSB;
+    }
+    hsd->output_count = (uint16_t)(bits << 8);
+    return HSDS_BACKREF_COUNT_LSB;
+}
+
+static HSD_state st_backref_count_lsb(heatshrink_decoder *hsd)
+{
+    const uint8_t bit_ct = LOOKAHEAD_BITS(hsd);
+    const uint16_t bits = get_bits(hsd, (bit_ct < 8) ? bit_ct : 8);
+    if (bits == NO_BITS)
+    {
+        return HSDS_BACKREF_COUNT_LSB;
+    }
+    hsd->output_count |= bits;
+    hsd->output_count++;
+    return HSDS_YIELD_BACKREF;
+}
+
+static HSD_state st_yield_backref(heatshrink_decoder *hsd, output_info *oi)
+{
+    size_t count = oi->buf_size - *oi->output_size;
+    if (count == 0)
+    {
+        return HSDS_YIELD_BACKREF;
+    }
+    if (hsd->output_count < count)
+    {
+        count = hsd->output_count;
+    }
+
+    uint8_t *window = &hsd->buffers[INPUT_BUFFER_SIZE(hsd)];
+    const uint16_t mask = (uint16_t)((1 << WINDOW_BITS(hsd)) - 1);
+    const uint16_t neg_offset = hsd->output_index;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint8_t c = window[(uint16_t)(hsd->head_index - neg_offset) & mask];
+        push_byte(oi, c);
+        window[hsd->head_index & mask] = c;
+        hsd->head_index++;
+    }
+
+    hsd->output_count -= (uint16_t)count;
+    return (hsd->output_count == 0) ? HSDS_TAG_BIT : HSDS_YIELD_BACKREF;
+}
+
+HSD_poll_res heatshrink_decoder_poll(heatshrink_decoder *hsd, uint8_t *out_buf,
+                                     size_t out_buf_size, size_t *output_size)
+{
+    if ((hsd == NULL) || (out_buf == NULL) || (output_size == NULL))
+    {
+        return HSDR_POLL_ERROR_NULL;
+    }
+
+    *output_size = 0;
+    output_info oi = {out_buf, out_buf_size, output_size};
+
+    while (1)
+    {
+        const uint8_t in_state = hsd->state;
+        switch (in_state)
+        {
+        case HSDS_TAG_BIT:
+            hsd->state = st_tag_bit(hsd);
+            break;
+        case HSDS_YIELD_LITERAL:
+            hsd->state = st_yield_literal(hsd, &oi);
+            break;
+        case HSDS_BACKREF_INDEX_MSB:
+            hsd->state = st_backref_index_msb(hsd);
+            break;
+        case HSDS_BACKREF_INDEX_LSB:
+            hsd->state = st_backref_index_lsb(hsd);
+            break;
+        case HSDS_BACKREF_COUNT_MSB:
+            hsd->state = st_backref_count_msb(hsd);
+            break;
+        case HSDS_BACKREF_COUNT_LSB:
+            hsd->state = st_backref_count_lsb(hsd);
+            break;
+        case HSDS_YIELD_BACKREF:
+            hsd->state = st_yield_backref(hsd, &oi);
+            break;
+        default:
+            return HSDR_POLL_ERROR_UNKNOWN;
+        }
+
+        // 状态没有前进时，输入耗尽或输出已满
+        if (hsd->state == in_state)
+        {
+            return (*output_size == out_buf_size) ? HSDR_POLL_MORE
+                                                  : HSDR_POLL_EMPTY;
+        }
+    }
+}
+
+HSD_finish_res heatshrink_decoder_finish(heatshrink_decoder *hsd)
+{
+    if (hsd == NULL)
+    {
+        return HSDR_FINISH_ERROR_NULL;
+    }
+
+    switch (hsd->state)
+    {
+    case HSDS_TAG_BIT:
+    case HSDS_YIELD_LITERAL:
+    case HSDS_BACKREF_INDEX_MSB:
+    case HSDS_BACKREF_INDEX_LSB:
+    case HSDS_BACKREF_COUNT_MSB:
+    case HSDS_BACKREF_COUNT_LSB:
+        // 剩余的只是末尾补齐的位
+        return (hsd->input_size == 0) ? HSDR_FINISH_DONE : HSDR_FINISH_MORE;
+    default:
+        return HSDR_FINISH_MORE;
+    }
+}
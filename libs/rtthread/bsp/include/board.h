@@ -12,6 +12,22 @@
 
 #include <main.h>
 
+/**
+ * @brief 启动时是否打开I-Cache与D-Cache，置0可用于比较关闭缓存时的还原耗时。
+ * @note 各内存区域的缓存策略由MPU_Config配置，dma缓冲区所在的ahb sram不缓存。
+ */
+#ifndef BOARD_CPU_CACHE
+#define BOARD_CPU_CACHE 1
+#endif
+
+/**
+ * @brief 空闲时是否停止systick，由lptim1在下一个定时器到期时唤醒并补偿节拍。
+ * @note tim7采样分析器运行时仍会每毫秒唤醒一次，测量空闲功耗前先暂停采样。
+ */
+#ifndef BOARD_TICKLESS
+#define BOARD_TICKLESS 1
+#endif
+
 /**
  * @brief 启动阶段执行mcu相关的配置以支持rtthread特性与功能。
  */
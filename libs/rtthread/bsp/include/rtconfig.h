@@ -21,6 +21,7 @@
 #define RT_USING_COMPONENTS_INIT       //!< 使用组件形式自动初始化
 #define RT_USING_SIGNALS               //!< 使用异步信号
 #define RT_USING_HOOK                  //!< 使用钩子
+#define RT_HOOK_USING_FUNC_PTR         //!< 钩子通过sethook设置的函数指针调用
 #define RT_USING_IDLE_HOOK             //!< 使用空闲下线程钩子
 #define RT_IDLE_HOOK_LIST_SIZE     1   //!< 空闲线程的钩子数量
 #define IDLE_THREAD_STACK_SIZE     512 //!< 定义空闲钩子栈大小
@@ -74,8 +75,10 @@
 //!< #define FINSH_HISTORY_LINES 8
 
 #define ASYNC_LOG_BUF_SIZE    RT_CONSOLEBUF_SIZE           //!< 单条日志大小
-#define ASYNC_LOG_MSG_COUNT   16                           //!< 队列深度
-#define ASYNC_LOG_THREAD_STK  512                          //!< 消费线程栈
+#define ASYNC_LOG_RING_SIZE   (1024 * 4)                   //!< 环形缓冲区大小，2的幂
+#define ASYNC_LOG_RECORD_SIZE 128                          //!< 单条记录上限，含参数
+#define ASYNC_LOG_BINARY      0                            //!< 输出原始记录，由主机解码
+#define ASYNC_LOG_THREAD_STK  1024                         //!< 消费线程栈
 #define ASYNC_LOG_THREAD_PRIO (RT_THREAD_PRIORITY_MAX - 2) //!< 极低优先级
 
 /**
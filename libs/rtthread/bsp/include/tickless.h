@@ -0,0 +1,80 @@
+/**
+ * @file tickless.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-26
+ * @copyright Copyright (c) 2026
+ * @brief 提供无节拍空闲的节拍补偿模型，只做整数运算，不依赖外设，
+ * 在主机上定义TICKLESS_TICK_US后即可直接编译验证。
+ * 时间以微秒为单位，空闲钩子在睡眠前后分别调用tickless_budget与
+ * tickless_compensate。
+ */
+
+#ifndef _TICKLESS_H_
+#define _TICKLESS_H_
+
+#include <stdint.h>
+
+/**
+ * @brief 每个系统节拍的微秒数。
+ */
+#ifndef TICKLESS_TICK_US
+#define TICKLESS_TICK_US (1000000 / RT_TICK_PER_SECOND)
+#endif
+
+/**
+ * @brief 距下一个定时器到期少于该节拍数时只执行wfi，
+ * 保证lptim比较值写入生效前计数器不会越过它。
+ */
+#ifndef TICKLESS_MIN_TICKS
+#define TICKLESS_MIN_TICKS 2
+#endif
+
+/**
+ * @brief 单次睡眠的上限，lptim1为1MHz的16位计数器，
+ * 需留出余量使比较值不会在写入前被越过。
+ */
+#ifndef TICKLESS_MAX_US
+#define TICKLESS_MAX_US 60000
+#endif
+
+/**
+ * @brief 计算本次睡眠的时长。
+ * @param ticks 距下一个定时器到期的节拍数，没有定时器时传入RT_TICK_MAX。
+ * @param remain_us 当前节拍距下一个节拍边界的微秒数，范围(0, TICKLESS_TICK_US]。
+ * @return uint32_t 睡眠微秒数，0为不进入无节拍睡眠。
+ * @note 按时长醒来时恰好位于定时器到期的节拍边界上。
+ */
+static inline uint32_t tickless_budget(uint32_t ticks, uint32_t remain_us)
+{
+    if (ticks < TICKLESS_MIN_TICKS)
+        return 0;
+
+    const uint64_t us = (uint64_t)(ticks - 1) * TICKLESS_TICK_US + remain_us;
+    return (us > TICKLESS_MAX_US) ? TICKLESS_MAX_US : (uint32_t)us;
+}
+
+/**
+ * @brief 根据实际睡眠时长计算越过的节拍数。
+ * @param remain_us 睡眠前当前节拍距下一个节拍边界的微秒数。
+ * @param slept_us 实际睡眠的微秒数，可能因其他中断提前醒来。
+ * @param next_us 输出醒来后距下一个节拍边界的微秒数，
+ * 范围(0, TICKLESS_TICK_US]，用于恢复systick的相位。
+ * @return uint32_t 睡眠期间越过的节拍边界数，即需要补偿的节拍数。
+ */
+static inline uint32_t tickless_compensate(uint32_t remain_us,
+                                           uint32_t slept_us,
+                                           uint32_t *next_us)
+{
+    if (slept_us < remain_us)
+    {
+        *next_us = remain_us - slept_us;
+        return 0;
+    }
+
+    const uint32_t over = slept_us - remain_us;
+    *next_us = TICKLESS_TICK_US - over % TICKLESS_TICK_US;
+    return 1 + over / TICKLESS_TICK_US;
+}
+
+#endif
@@ -2,6 +2,9 @@
 #include <lptim.h>
 #include <rthw.h>
 #include <rtthread.h>
+#include <string.h>
+#include <tickless.h>
+#include <uart.h>
 
 // 配置调试日志
 #define DBG_TAG __FILE_NAME__
@@ -13,6 +16,126 @@ static uint32_t ticks_per_us;
 // 累加睡眠的Tick数(虽然LPTIM是16位，但累加变量我们要用64位防止总数溢出)
 static volatile uint64_t total_sleep_ticks = 0;
 
+/**
+ * @brief 累加一次睡眠的lptim计数，需在关中断时调用。
+ * @param start 睡眠前的计数。
+ * @param end 醒来后的计数。
+ */
+ITCM static void idle_sleep_add(uint16_t start, uint16_t end)
+{
+    /* 计算差值并累加 (处理16位回环，逻辑很简单) */
+    if (end >= start)
+    {
+        total_sleep_ticks += (end - start);
+    }
+    else
+    {
+        // 发生了回环 (例如 65535 -> 1)
+        total_sleep_ticks += (0xFFFF - start + end + 1);
+    }
+}
+
+#if BOARD_TICKLESS
+
+/**
+ * @brief 读取lptim1计数，计数器与总线异步，连续两次读数相同才可信。
+ * @return uint16_t 计数值。
+ */
+ITCM static uint16_t lptim_count(void)
+{
+    uint16_t a, b;
+    do
+    {
+        a = (uint16_t)LPTIM1->CNT;
+        b = (uint16_t)LPTIM1->CNT;
+    } while (a != b);
+    return a;
+}
+
+/**
+ * @brief 以指定相位重新启动systick。
+ * @param next_us 距下一次systick中断的微秒数。
+ */
+ITCM static void systick_restart(uint32_t next_us)
+{
+    const uint32_t period = ticks_per_us * TICKLESS_TICK_US;
+
+    // 写VAL清零后计数器在下一个时钟装入LOAD，装入后再恢复完整周期
+    SysTick->LOAD = next_us * ticks_per_us - 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    while (SysTick->VAL == 0)
+        ;
+    SysTick->LOAD = period - 1;
+}
+
+/**
+ * @brief 停止systick，由lptim1比较匹配在下一个定时器到期时唤醒，
+ * 醒来后补偿睡眠期间的节拍，需在关中断时调用。
+ * @return true 已完成无节拍睡眠。
+ * @return false 不值得停止systick，需按原方式睡眠。
+ */
+ITCM static bool idle_tickless(void)
+{
+    // 已有待处理的节拍或线程切换时不进入
+    if (SCB->ICSR & (SCB_ICSR_PENDSTSET_Msk | SCB_ICSR_PENDSVSET_Msk))
+        return false;
+
+    const rt_tick_t now = rt_tick_get();
+    const rt_tick_t next = rt_timer_next_timeout_tick();
+    const uint32_t ticks = (next == RT_TICK_MAX) ? RT_TICK_MAX : next - now;
+    if ((next != RT_TICK_MAX) && (ticks > (RT_TICK_MAX / 2)))
+        return false;
+
+    // 停止systick后取当前节拍的剩余时间，val为0时节拍中断已挂起
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    const uint32_t val = SysTick->VAL;
+    const uint32_t remain_us =
+        (val == 0) ? 0 : (val + ticks_per_us - 1) / ticks_per_us;
+    const uint32_t budget = tickless_budget(ticks, remain_us);
+    if ((remain_us == 0) || (budget == 0) ||
+        (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk))
+    {
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        return false;
+    }
+
+    const uint16_t start = lptim_count();
+    LPTIM1->ICR = LPTIM_ICR_CMPOKCF;
+    LPTIM1->CMP = (uint16_t)(start + budget);
+    while (!(LPTIM1->ISR & LPTIM_ISR_CMPOK))
+        ;
+    LPTIM1->ICR = LPTIM_ICR_CMPMCF;
+    NVIC_ClearPendingIRQ(LPTIM1_IRQn);
+    NVIC_EnableIRQ(LPTIM1_IRQn);
+
+    // 关中断时挂起的中断同样可以唤醒，醒来后由调用者开中断处理
+    __DSB();
+    __WFI();
+
+    const uint16_t end = lptim_count();
+    NVIC_DisableIRQ(LPTIM1_IRQn);
+    LPTIM1->ICR = LPTIM_ICR_CMPMCF;
+    NVIC_ClearPendingIRQ(LPTIM1_IRQn);
+    idle_sleep_add(start, end);
+
+    uint32_t next_us;
+    const uint32_t passed =
+        tickless_compensate(remain_us, (uint16_t)(end - start), &next_us);
+    systick_restart(next_us);
+
+    // 最后一个节拍交给systick中断，由rt_tick_increase检查到期的定时器
+    if (passed > 0)
+    {
+        rt_tick_set(now + passed - 1);
+        uwTick += passed - 1;
+        SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+    }
+    return true;
+}
+
+#endif
+
 /**
  * @brief 空闲任务运行时的钩子函数。
  */
@@ -24,6 +147,14 @@ ITCM static void idle_hook_wfi(void)
     // 关中断
     level = rt_hw_interrupt_disable();
 
+#if BOARD_TICKLESS
+    if (idle_tickless())
+    {
+        rt_hw_interrupt_enable(level);
+        return;
+    }
+#endif
+
     // 读开始时间
     start = (uint16_t)LPTIM1->CNT;
 
@@ -32,19 +163,10 @@ ITCM static void idle_hook_wfi(void)
     // 读结束时间
     end = (uint16_t)LPTIM1->CNT;
 
+    idle_sleep_add(start, end);
+
     // 开中断
     rt_hw_interrupt_enable(level);
-
-    /* 计算差值并累加 (处理16位回环，逻辑很简单) */
-    if (end >= start)
-    {
-        total_sleep_ticks += (end - start);
-    }
-    else
-    {
-        // 发生了回环 (例如 65535 -> 1)
-        total_sleep_ticks += (0xFFFF - start + end + 1);
-    }
 }
 
 /**
@@ -133,16 +255,17 @@ ITCM void rt_hw_us_delay(uint32_t us)
  */
 ITCM void rt_hw_console_output(const char *str)
 {
-    while (*str != '\0')
-    {
-        /* 等待发送数据寄存器为空 (TXE) */
-        while (!LL_USART_IsActiveFlag_TXE_TXFNF(USART1))
-            ;
+    bsp_uart_write(BSP_UART_USART1, str, strlen(str));
+}
 
-        /* 写入字符到发送数据寄存器 */
-        LL_USART_TransmitData8(USART1, *str);
-        ++str;
-    }
+/**
+ * @brief 控制台二进制输出。
+ * @param buf 输出数据指针。
+ * @param size 数据长度。
+ */
+ITCM void rt_hw_console_write(const void *buf, size_t size)
+{
+    bsp_uart_write(BSP_UART_USART1, buf, size);
 }
 
 /**
@@ -171,7 +294,18 @@ void rt_hw_mcu_init(void)
         LOG_I("dwt init success");
     }
 
-    // 配置微秒级延时
+#if BOARD_CPU_CACHE
+    // 打开缓存，flash与axi sram的访问由缓存加速
+    rt_hw_cpu_icache_enable();
+    rt_hw_cpu_dcache_enable();
+#endif
+    LOG_I("icache %s, dcache %s", rt_hw_cpu_icache_status() ? "on" : "off",
+          rt_hw_cpu_dcache_status() ? "on" : "off");
+
+    // 配置微秒级延时，比较匹配中断只能在lptim关闭时打开，用于无节拍空闲唤醒
+#if BOARD_TICKLESS
+    LL_LPTIM_EnableIT_CMPM(LPTIM1);
+#endif
     LL_LPTIM_Enable(LPTIM1);
     LL_LPTIM_SetAutoReload(LPTIM1, 0xFFFF); // 设置最大计数值
     LL_LPTIM_StartCounter(LPTIM1, LL_LPTIM_OPERATING_MODE_CONTINUOUS);
@@ -189,5 +323,6 @@ void rt_hw_mcu_init(void)
 
     // 设置空闲钩子
     rt_thread_idle_sethook(idle_hook_wfi);
-    LOG_I("add idle hook: idle_hook_wfi");
+    LOG_I("add idle hook: idle_hook_wfi, tickless %s",
+          BOARD_TICKLESS ? "on" : "off");
 }
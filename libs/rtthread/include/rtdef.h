@@ -136,14 +136,18 @@ typedef enum rt_err_t {
  */
 #define RT_ALIGN_DOWN(size, align) ((size) & ~((align) - 1))
 
-/* 环形缓冲区结构体 */
+/* 环形缓冲区结构体，单生产者单消费者无锁访问，大小必须为2的幂 */
 struct rt_ringbuffer {
     uint8_t *buffer_ptr;
-    uint16_t read_mirror : 1;
-    uint16_t read_index : 15;
-    uint16_t write_mirror : 1;
-    uint16_t write_index : 15;
-    uint16_t buffer_size;
+    uint32_t buffer_mask;          /* 缓冲区大小减1 */
+    volatile uint32_t write_index; /* 累计写入字节数，只由生产者修改 */
+    volatile uint32_t read_index;  /* 累计读出字节数，只由消费者修改 */
+};
+
+/* 环形缓冲区中的一段数据，跨越缓冲区末尾时分为两段 */
+struct rt_ringbuffer_span {
+    uint8_t *ptr[2];  /* 每段的起始地址 */
+    uint32_t len[2];  /* 每段的长度，第二段不存在时为0 */
 };
 
 /**
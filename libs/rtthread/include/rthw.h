@@ -329,4 +329,11 @@ void rt_hw_secondary_cpu_idle_exec(void);
  */
 void rt_hw_console_output(const char *str);
 
+/**
+ * @brief 底层控制台二进制输出函数，用于输出原始日志记录。
+ * @param buf 需要输出的数据。
+ * @param size 数据长度。
+ */
+void rt_hw_console_write(const void *buf, size_t size);
+
 #endif
\ No newline at end of file
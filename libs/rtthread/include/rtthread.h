@@ -7,31 +7,70 @@
 
 /**
  * @brief 初始化环形缓冲区。
+ * @note 同一时刻只允许一个生产者与一个消费者，两端之间无需加锁，
+ * 多个生产者或消费者需要自行互斥。
  * @param rb   环形缓冲区对象指针。
  * @param pool 用于存储数据的缓冲区地址。
- * @param size 缓冲区的大小（字节）。
+ * @param size 缓冲区的大小（字节），必须为2的幂。
+ * @return rt_err_t 大小不是2的幂时返回-RT_EINVAL。
  */
-void rt_ringbuffer_init(struct rt_ringbuffer *rb, uint8_t *pool, uint16_t size);
+rt_err_t rt_ringbuffer_init(struct rt_ringbuffer *rb, uint8_t *pool,
+                            uint32_t size);
 
 /**
- * @brief 向环形缓冲区中写入数据。
+ * @brief 向环形缓冲区中写入数据，由生产者调用。
  * @param rb     环形缓冲区对象指针。
  * @param ptr    待写入数据的指针。
  * @param length 待写入数据的长度。
  * @return size_t 返回实际成功写入的字节数。
  */
 size_t rt_ringbuffer_put(struct rt_ringbuffer *rb, const uint8_t *ptr,
-                         uint16_t length);
+                         uint32_t length);
 
 /**
- * @brief 从环形缓冲区中读取数据。
+ * @brief 从环形缓冲区中读取数据，由消费者调用。
  * @param rb     环形缓冲区对象指针。
  * @param ptr    存放读取数据的目标缓冲区指针。
  * @param length 期望读取数据的长度。
  * @return size_t 返回实际读取到的字节数。
  */
 size_t rt_ringbuffer_get(struct rt_ringbuffer *rb, uint8_t *ptr,
-                         uint16_t length);
+                         uint32_t length);
+
+/**
+ * @brief 预留一段可写空间，生产者直接填入数据后调用rt_ringbuffer_commit。
+ * @param rb     环形缓冲区对象指针。
+ * @param length 期望预留的字节数。
+ * @param span   输出的可写空间。
+ * @return size_t 实际预留的字节数，不超过剩余空间。
+ */
+size_t rt_ringbuffer_reserve(struct rt_ringbuffer *rb, uint32_t length,
+                             struct rt_ringbuffer_span *span);
+
+/**
+ * @brief 发布已经填入的数据，消费者随后可见。
+ * @param rb     环形缓冲区对象指针。
+ * @param length 发布的字节数，不大于预留的字节数。
+ */
+void rt_ringbuffer_commit(struct rt_ringbuffer *rb, uint32_t length);
+
+/**
+ * @brief 查看一段可读数据，不移动读位置，消费者处理完后调用rt_ringbuffer_consume。
+ * @param rb     环形缓冲区对象指针。
+ * @param offset 相对读位置的偏移。
+ * @param length 期望查看的字节数。
+ * @param span   输出的可读数据。
+ * @return size_t 实际可查看的字节数。
+ */
+size_t rt_ringbuffer_peek(struct rt_ringbuffer *rb, uint32_t offset,
+                          uint32_t length, struct rt_ringbuffer_span *span);
+
+/**
+ * @brief 丢弃已经处理的数据，释放空间给生产者。
+ * @param rb     环形缓冲区对象指针。
+ * @param length 丢弃的字节数，不大于可读字节数。
+ */
+void rt_ringbuffer_consume(struct rt_ringbuffer *rb, uint32_t length);
 
 /**
  * @brief 获取环形缓冲区内当前存放的数据长度。
@@ -40,9 +79,17 @@ size_t rt_ringbuffer_get(struct rt_ringbuffer *rb, uint8_t *ptr,
  */
 size_t rt_ringbuffer_data_len(struct rt_ringbuffer *rb);
 
+/**
+ * @brief 获取环形缓冲区内当前剩余的空间。
+ * @param rb 环形缓冲区对象指针。
+ * @return size_t 当前缓冲区内的空闲字节数。
+ */
+size_t rt_ringbuffer_space_len(struct rt_ringbuffer *rb);
+
 /**
  * @brief 重置环形缓冲区。
- * @note 此操作会清空缓冲区内已存的数据，重置读写指针。
+ * @note 此操作会清空缓冲区内已存的数据，重置读写指针，
+ * 调用时生产者与消费者都不能访问缓冲区。
  * @param rb 环形缓冲区对象指针。
  */
 void rt_ringbuffer_reset(struct rt_ringbuffer *rb);
@@ -1539,10 +1586,10 @@ void rt_components_init(void);
 #endif
 
 /**
- * @brief 系统内核格式化输出函数。
- * @param fmt 格式化字符串。
+ * @brief 系统内核格式化输出函数，线程中调用时只记录参数，由log线程延迟格式化。
+ * @param fmt 格式化字符串，必须在输出前保持有效，通常为字符串常量。
  * @param ... 可变参数。
- * @return int 实际打印的字符个数。
+ * @return int 实际打印的字符个数，延迟输出时为记录的字节数。
  */
 int rt_kprintf(const char *fmt, ...);
 
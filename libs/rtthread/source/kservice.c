@@ -26,6 +26,7 @@
 #include <rtdebug.h>
 #include <rthw.h>
 #include <rtthread.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef RT_USING_MODULE
@@ -261,32 +262,389 @@ rt_device_t rt_console_set_device(const char *name)
 RTM_EXPORT(rt_console_set_device);
 #endif /* RT_USING_DEVICE */
 
-/* 日志消息结构 */
-typedef struct rt_log_msg
+/*
+ * 延迟格式化日志：业务线程只记录格式字符串地址、系统tick与原始参数，
+ * 由低优先级的log线程格式化并输出。格式字符串必须位于只读区，
+ * %s参数按内容拷贝进记录，因此可以是栈上的临时字符串。
+ */
+
+/* 日志记录头，后面紧跟按4字节对齐的原始参数 */
+typedef struct rt_log_record
 {
-    char data[ASYNC_LOG_BUF_SIZE];
-} rt_log_msg_t;
+    uint8_t sync;    /* 同步字节ASYNC_LOG_SYNC */
+    uint8_t words;   /* 记录总长度，单位4字节 */
+    uint16_t seq;    /* 序号，丢弃的记录同样计数，用于发现丢失 */
+    uint32_t tick;   /* 记录时的系统tick */
+    const char *fmt; /* 格式字符串 */
+} rt_log_record_t;
+
+#define ASYNC_LOG_SYNC 0xA5
 
-static struct rt_messagequeue log_mq;
-static uint8_t
-    mq_pool[(sizeof(rt_log_msg_t) + sizeof(void *)) * ASYNC_LOG_MSG_COUNT];
+#if (ASYNC_LOG_RECORD_SIZE % 4) || (ASYNC_LOG_RECORD_SIZE > 255 * 4)
+#error "ASYNC_LOG_RECORD_SIZE must be a multiple of 4 and at most 1020"
+#endif
+
+/* 参数在记录中的存放方式 */
+enum rt_log_arg
+{
+    LOG_ARG_NONE,   /* 不消耗参数，如%% */
+    LOG_ARG_WORD,   /* 32位整数、字符与指针 */
+    LOG_ARG_DWORD,  /* 64位整数 */
+    LOG_ARG_DOUBLE, /* 浮点数，按double存放 */
+    LOG_ARG_STR,    /* 字符串，32位长度后紧跟内容，补齐到4字节 */
+};
+
+#if (ASYNC_LOG_RING_SIZE & (ASYNC_LOG_RING_SIZE - 1)) != 0
+#error "ASYNC_LOG_RING_SIZE must be a power of two"
+#endif
+
+/* 日志环形缓冲区，存放连续的日志记录，由log线程统一输出 */
+static struct rt_ringbuffer log_rb;
+ALIGN(4) static uint8_t log_pool[ASYNC_LOG_RING_SIZE];
+static uint16_t log_seq;
+static struct rt_semaphore log_sem;
 static struct rt_thread log_thread;
 static uint8_t log_stack[ASYNC_LOG_THREAD_STK];
 static bool is_async_ready = false;
 
+/* 只有log线程取出并格式化记录，缓冲区放在静态区，线程栈只承担格式化的调用链 */
+static uint32_t log_rec[ASYNC_LOG_RECORD_SIZE / 4];
+#if !ASYNC_LOG_BINARY
+static char log_text[ASYNC_LOG_BUF_SIZE];
+#endif
+
+/**
+ * @brief 解析一个转换说明。
+ * @param p 指向'%'之后的字符。
+ * @param stars 输出宽度与精度中'*'的个数，每个'*'消耗一个int参数。
+ * @param kind 输出参数的存放方式。
+ * @return const char* 转换说明之后的字符。
+ */
+ITCM static const char *rt_log_parse_spec(const char *p, uint8_t *stars,
+                                          enum rt_log_arg *kind)
+{
+    bool ll = false;
+
+    *stars = 0;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '0' || *p == '#')
+        p++;
+    if (*p == '*')
+    {
+        (*stars)++;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9')
+        p++;
+    if (*p == '.')
+    {
+        p++;
+        if (*p == '*')
+        {
+            (*stars)++;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9')
+            p++;
+    }
+    if (*p == 'l')
+    {
+        p++;
+        if (*p == 'l')
+        {
+            ll = true;
+            p++;
+        }
+    }
+    else if (*p == 'h')
+    {
+        if (*++p == 'h')
+            p++;
+    }
+    else if (*p == 'z')
+    {
+        p++;
+    }
+
+    switch (*p)
+    {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        *kind = ll ? LOG_ARG_DWORD : LOG_ARG_WORD;
+        break;
+    case 'c':
+    case 'p':
+        *kind = LOG_ARG_WORD;
+        break;
+    case 'f':
+    case 'F':
+        *kind = LOG_ARG_DOUBLE;
+        break;
+    case 's':
+        *kind = LOG_ARG_STR;
+        break;
+    case '\0':
+        *kind = LOG_ARG_NONE;
+        return p;
+    default:
+        *kind = LOG_ARG_NONE;
+        break;
+    }
+    return p + 1;
+}
+
 /**
- * 消费线程：负责把队列里的日志真正打印出来
+ * @brief 按格式字符串把参数打包成日志记录。
+ * @param rec 记录缓冲区，大小为ASYNC_LOG_RECORD_SIZE。
+ * @param fmt 格式字符串。
+ * @param args 参数列表。
+ * @return size_t 记录长度，已补齐到4字节，放不下的参数被丢弃。
+ */
+ITCM static size_t rt_log_pack(uint32_t *rec, const char *fmt, va_list args)
+{
+    uint8_t *pos = (uint8_t *)rec + sizeof(rt_log_record_t);
+    uint8_t *const end = (uint8_t *)rec + ASYNC_LOG_RECORD_SIZE;
+    uint8_t stars;
+    enum rt_log_arg kind;
+
+    for (const char *p = fmt; *p != '\0';)
+    {
+        if (*p++ != '%')
+            continue;
+        p = rt_log_parse_spec(p, &stars, &kind);
+
+        while (stars-- > 0)
+        {
+            const int star = va_arg(args, int);
+            if (end - pos < 4)
+                goto full;
+            memcpy(pos, &star, 4);
+            pos += 4;
+        }
+
+        switch (kind)
+        {
+        case LOG_ARG_WORD: {
+            const uint32_t word = va_arg(args, uint32_t);
+            if (end - pos < 4)
+                goto full;
+            memcpy(pos, &word, 4);
+            pos += 4;
+            break;
+        }
+        case LOG_ARG_DWORD: {
+            const uint64_t dword = va_arg(args, uint64_t);
+            if (end - pos < 8)
+                goto full;
+            memcpy(pos, &dword, 8);
+            pos += 8;
+            break;
+        }
+        case LOG_ARG_DOUBLE: {
+            const double value = va_arg(args, double);
+            if (end - pos < 8)
+                goto full;
+            memcpy(pos, &value, 8);
+            pos += 8;
+            break;
+        }
+        case LOG_ARG_STR: {
+            const char *str = va_arg(args, const char *);
+            if (str == NULL)
+                str = "(null)";
+            if (end - pos < 4)
+                goto full;
+            // 剩余空间不足时截断字符串
+            uint32_t len = 0;
+            const uint32_t max = (uint32_t)(end - pos) - 4;
+            while (len < max && str[len] != '\0')
+                len++;
+            memcpy(pos, &len, 4);
+            memcpy(pos + 4, str, len);
+            pos += 4 + ((len + 3) & ~3UL);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+full:
+    return RT_ALIGN((size_t)(pos - (uint8_t *)rec), 4);
+}
+
+#if !ASYNC_LOG_BINARY
+/**
+ * @brief 用一个参数格式化单个转换说明。
+ */
+static int rt_log_format_one(char *out, size_t size, const char *spec, ...)
+{
+    va_list args;
+    va_start(args, spec);
+    const int len = vsnprintf(out, size, spec, args);
+    va_end(args);
+    return len;
+}
+
+/**
+ * @brief 把日志记录格式化为字符串。
+ * @param rec 日志记录。
+ * @param out 输出缓冲区。
+ * @param size 输出缓冲区大小。
+ * @return size_t 输出的字符数，不含结束符。
+ */
+static size_t rt_log_render(const uint32_t *rec, char *out, size_t size)
+{
+    const rt_log_record_t *hdr = (const rt_log_record_t *)rec;
+    const uint8_t *pos = (const uint8_t *)&hdr[1];
+    const uint8_t *const end = (const uint8_t *)rec + hdr->words * 4;
+    size_t len = 0;
+    uint8_t stars;
+    enum rt_log_arg kind;
+
+    for (const char *p = hdr->fmt; *p != '\0' && len < size - 1;)
+    {
+        if (*p != '%')
+        {
+            out[len++] = *p++;
+            continue;
+        }
+
+        // 取出转换说明，宽度与精度中的'*'替换为记录的数值
+        const char *const start = p;
+        p = rt_log_parse_spec(p + 1, &stars, &kind);
+        char spec[24];
+        size_t n = 0;
+        for (const char *c = start; c < p && n < sizeof(spec) - 12; c++)
+        {
+            if (*c != '*')
+            {
+                spec[n++] = *c;
+                continue;
+            }
+            int star = 0;
+            if (end - pos >= 4)
+            {
+                memcpy(&star, pos, 4);
+                pos += 4;
+            }
+            n += rt_log_format_one(&spec[n], sizeof(spec) - n, "%d", star);
+        }
+        spec[n] = '\0';
+
+        int written;
+        switch (kind)
+        {
+        case LOG_ARG_WORD: {
+            uint32_t word;
+            if (end - pos < 4)
+                goto truncated;
+            memcpy(&word, pos, 4);
+            pos += 4;
+            written = rt_log_format_one(&out[len], size - len, spec, word);
+            break;
+        }
+        case LOG_ARG_DWORD: {
+            uint64_t dword;
+            if (end - pos < 8)
+                goto truncated;
+            memcpy(&dword, pos, 8);
+            pos += 8;
+            written = rt_log_format_one(&out[len], size - len, spec, dword);
+            break;
+        }
+        case LOG_ARG_DOUBLE: {
+            double value;
+            if (end - pos < 8)
+                goto truncated;
+            memcpy(&value, pos, 8);
+            pos += 8;
+            written = rt_log_format_one(&out[len], size - len, spec, value);
+            break;
+        }
+        case LOG_ARG_STR: {
+            // 按记录的长度作为精度，字符串在记录中没有结束符
+            uint32_t str_len;
+            if (end - pos < 4)
+                goto truncated;
+            memcpy(&str_len, pos, 4);
+            const char *str = (const char *)pos + 4;
+            pos += 4 + ((str_len + 3) & ~3UL);
+            char *cut = strchr(spec, '.');
+            if (cut != NULL)
+            {
+                const int precision = atoi(cut + 1);
+                if (precision >= 0 && (uint32_t)precision < str_len)
+                    str_len = precision;
+            }
+            else
+            {
+                cut = &spec[strlen(spec) - 1];
+            }
+            memcpy(cut, ".*s", sizeof(".*s"));
+            written =
+                rt_log_format_one(&out[len], size - len, spec, str_len, str);
+            break;
+        }
+        default:
+            written = rt_log_format_one(&out[len], size - len, spec);
+            break;
+        }
+
+        if (written > 0)
+            len += ((size_t)written < size - len) ? (size_t)written
+                                                  : size - len - 1;
+        continue;
+
+    truncated:
+        // 参数在记录时被丢弃
+        out[len++] = '?';
+    }
+
+    out[len] = '\0';
+    return len;
+}
+
+#endif
+
+/**
+ * @brief 从缓冲区取出一条完整的日志记录。
+ * @param rec 记录缓冲区，大小为ASYNC_LOG_RECORD_SIZE。
+ * @return bool 是否取到记录。
+ */
+static bool rt_log_pop(uint32_t *rec)
+{
+    struct rt_ringbuffer_span span;
+    if (rt_ringbuffer_peek(&log_rb, 0, 4, &span) < 4)
+        return false;
+
+    // 记录总是整条提交，且以4字节为单位，头部不会跨越缓冲区末尾
+    const rt_log_record_t *hdr = (const rt_log_record_t *)span.ptr[0];
+    return rt_ringbuffer_get(&log_rb, (uint8_t *)rec, hdr->words * 4) > 0;
+}
+
+/**
+ * 消费线程：负责把缓冲区里的日志格式化并打印出来
  */
 static void log_thread_entry(void *parameter)
 {
-    rt_log_msg_t msg;
     while (1)
     {
-        if (rt_mq_recv(&log_mq, &msg, sizeof(rt_log_msg_t),
-                       RT_WAITING_FOREVER) == RT_EOK)
+        // 生产者只在缓冲区由空变为非空时唤醒，因此每次都要取空
+        while (rt_log_pop(log_rec))
         {
-            rt_hw_console_output(msg.data);
+#if ASYNC_LOG_BINARY
+            const rt_log_record_t *hdr = (const rt_log_record_t *)log_rec;
+            rt_hw_console_write(log_rec, hdr->words * 4);
+#else
+            rt_log_render(log_rec, log_text, sizeof(log_text));
+            rt_hw_console_output(log_text);
+#endif
         }
+        rt_sem_take(&log_sem, RT_WAITING_FOREVER);
     }
 }
 
@@ -298,8 +656,9 @@ int log_thread_init(void)
     if (is_async_ready)
         return 0;
 
-    rt_mq_init(&log_mq, "log_mq", &mq_pool[0], sizeof(rt_log_msg_t),
-               sizeof(mq_pool), RT_IPC_FLAG_FIFO);
+    if (rt_ringbuffer_init(&log_rb, &log_pool[0], sizeof(log_pool)) != RT_EOK)
+        return -1;
+    rt_sem_init(&log_sem, "log_sem", 0, RT_IPC_FLAG_FIFO);
 
     rt_thread_init(&log_thread, "log", log_thread_entry, NULL, &log_stack[0],
                    sizeof(log_stack), ASYNC_LOG_THREAD_PRIO, 0);
@@ -313,40 +672,64 @@ RUN_APP_EXPORT(log_thread_init); // 自动初始化
 /**
  * This function will print a formatted string on system console.
  * @param fmt is the format parameters.
- * @return The number of characters actually written to buffer.
+ * @return The number of characters actually written to buffer,
+ * or the size of the deferred record.
  */
-int rt_kprintf(const char *fmt, ...)
+ITCM int rt_kprintf(const char *fmt, ...)
 {
     va_list args;
     size_t length;
 
-    /* 使用局部变量替代static，确保线程安全 */
-    char local_buf[ASYNC_LOG_BUF_SIZE];
-
-    va_start(args, fmt);
-    length = vsnprintf(local_buf, sizeof(local_buf) - 1, fmt, args);
-    if (length > ASYNC_LOG_BUF_SIZE - 1)
-        length = ASYNC_LOG_BUF_SIZE - 1;
-    local_buf[length] = '\0'; // 确保字符串结束
-    va_end(args);
-
     /* 判断当前环境是否支持异步 */
-    /* 如果OS已启动、不在中断中、且队列已初始化 */
+    /* 如果OS已启动、不在中断中、且缓冲区已初始化 */
     if (is_async_ready && rt_thread_self() != NULL &&
         rt_interrupt_get_nest() == 0)
     {
-        rt_log_msg_t msg;
-        memcpy(msg.data, local_buf, length + 1);
-
-        // 发送给异步线程，如果不满则立即发送，满了则丢弃（避免阻塞业务线程）
-        if (rt_mq_send(&log_mq, &msg, sizeof(rt_log_msg_t)) != RT_EOK)
+        uint32_t rec[ASYNC_LOG_RECORD_SIZE / 4];
+        rt_log_record_t *hdr = (rt_log_record_t *)rec;
+
+        va_start(args, fmt);
+        length = rt_log_pack(rec, fmt, args);
+        va_end(args);
+
+        hdr->sync = ASYNC_LOG_SYNC;
+        hdr->words = length / 4;
+        hdr->tick = rt_tick_get();
+        hdr->fmt = fmt;
+
+        /* 多个线程都是生产者，锁住调度器使预留与发布成为一个整体 */
+        struct rt_ringbuffer_span span;
+        bool wake = false;
+        rt_enter_critical();
+        hdr->seq = log_seq++;
+        // 空间不足则整条丢弃（避免阻塞业务线程）
+        if (rt_ringbuffer_reserve(&log_rb, length, &span) == length)
         {
-            // 可选：如果队列满了，为了不丢失重要日志，可以尝试同步输出
+            wake = (rt_ringbuffer_data_len(&log_rb) == 0);
+            memcpy(span.ptr[0], rec, span.len[0]);
+            if (span.len[1] > 0)
+                memcpy(span.ptr[1], (uint8_t *)rec + span.len[0],
+                       span.len[1]);
+            rt_ringbuffer_commit(&log_rb, length);
         }
+        rt_exit_critical();
+
+        if (wake)
+            rt_sem_release(&log_sem);
     }
     else
     {
         /* 同步模式：直接输出 (用于中断、系统启动前、异常状态) */
+        /* 使用局部变量替代static，确保线程安全 */
+        char local_buf[ASYNC_LOG_BUF_SIZE];
+
+        va_start(args, fmt);
+        length = vsnprintf(local_buf, sizeof(local_buf) - 1, fmt, args);
+        if (length > ASYNC_LOG_BUF_SIZE - 1)
+            length = ASYNC_LOG_BUF_SIZE - 1;
+        local_buf[length] = '\0'; // 确保字符串结束
+        va_end(args);
+
         rt_hw_console_output(local_buf);
     }
 
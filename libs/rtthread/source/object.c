@@ -219,84 +219,132 @@ void rt_object_put_sethook(void (*hook)(struct rt_object *object))
 
 /**@{*/
 
-void rt_ringbuffer_init(struct rt_ringbuffer *rb, uint8_t *pool, uint16_t size)
+/*
+ * 读写计数都是自由增长的32位值，差值即为数据长度，与缓冲区掩码相与得到下标。
+ * 生产者以release写入write_index发布数据，消费者以acquire读取后才访问数据；
+ * 消费者以release写入read_index归还空间，生产者以acquire读取后才覆盖数据。
+ */
+
+rt_err_t rt_ringbuffer_init(struct rt_ringbuffer *rb, uint8_t *pool,
+                            uint32_t size)
 {
+    if ((size == 0) || ((size & (size - 1)) != 0))
+        return -RT_EINVAL;
+
     rb->buffer_ptr = pool;
-    rb->buffer_size = size;
+    rb->buffer_mask = size - 1;
     rt_ringbuffer_reset(rb);
+    return RT_EOK;
 }
 
 void rt_ringbuffer_reset(struct rt_ringbuffer *rb)
 {
-    rb->read_mirror = 0;
     rb->read_index = 0;
-    rb->write_mirror = 0;
     rb->write_index = 0;
 }
 
 ITCM size_t rt_ringbuffer_data_len(struct rt_ringbuffer *rb)
 {
-    if (rb->read_index == rb->write_index)
-    {
-        return (rb->read_mirror == rb->write_mirror) ? 0 : rb->buffer_size;
-    }
-    if (rb->write_index > rb->read_index)
-        return rb->write_index - rb->read_index;
-    else
-        return rb->buffer_size - (rb->read_index - rb->write_index);
+    // 先读读计数，保证在第三方线程中查询时长度也不会为负
+    const uint32_t read = __atomic_load_n(&rb->read_index, __ATOMIC_ACQUIRE);
+    const uint32_t write = __atomic_load_n(&rb->write_index, __ATOMIC_ACQUIRE);
+    return write - read;
 }
 
-ITCM size_t rt_ringbuffer_put(struct rt_ringbuffer *rb, const uint8_t *ptr,
-                              uint16_t length)
+ITCM size_t rt_ringbuffer_space_len(struct rt_ringbuffer *rb)
 {
-    uint16_t size;
-    uint16_t free_len = rb->buffer_size - rt_ringbuffer_data_len(rb);
+    return rb->buffer_mask + 1 - rt_ringbuffer_data_len(rb);
+}
 
-    if (free_len == 0)
-        return 0;
-    if (length > free_len)
-        length = free_len;
+/**
+ * @brief 把从下标pos开始的length字节拆分为不跨越缓冲区末尾的两段。
+ */
+ITCM static void _ringbuffer_span(struct rt_ringbuffer *rb, uint32_t pos,
+                                  uint32_t length,
+                                  struct rt_ringbuffer_span *span)
+{
+    const uint32_t index = pos & rb->buffer_mask;
+    const uint32_t first = rb->buffer_mask + 1 - index;
 
-    size = rb->buffer_size - rb->write_index;
-    if (size > length)
+    span->ptr[0] = &rb->buffer_ptr[index];
+    if (length <= first)
     {
-        memcpy(&rb->buffer_ptr[rb->write_index], ptr, length);
-        rb->write_index += length;
+        span->len[0] = length;
+        span->ptr[1] = NULL;
+        span->len[1] = 0;
     }
     else
     {
-        memcpy(&rb->buffer_ptr[rb->write_index], ptr, size);
-        memcpy(&rb->buffer_ptr[0], &ptr[size], length - size);
-        rb->write_index = length - size;
-        rb->write_mirror = ~rb->write_mirror;
+        span->len[0] = first;
+        span->ptr[1] = &rb->buffer_ptr[0];
+        span->len[1] = length - first;
     }
+}
+
+ITCM size_t rt_ringbuffer_reserve(struct rt_ringbuffer *rb, uint32_t length,
+                                  struct rt_ringbuffer_span *span)
+{
+    const uint32_t write = rb->write_index;
+    const uint32_t read = __atomic_load_n(&rb->read_index, __ATOMIC_ACQUIRE);
+    const uint32_t space = rb->buffer_mask + 1 - (write - read);
+
+    if (length > space)
+        length = space;
+    _ringbuffer_span(rb, write, length, span);
     return length;
 }
 
-ITCM size_t rt_ringbuffer_get(struct rt_ringbuffer *rb, uint8_t *ptr,
-                              uint16_t length)
+ITCM void rt_ringbuffer_commit(struct rt_ringbuffer *rb, uint32_t length)
+{
+    __atomic_store_n(&rb->write_index, rb->write_index + length,
+                     __ATOMIC_RELEASE);
+}
+
+ITCM size_t rt_ringbuffer_peek(struct rt_ringbuffer *rb, uint32_t offset,
+                               uint32_t length,
+                               struct rt_ringbuffer_span *span)
 {
-    uint16_t size;
-    uint16_t data_len = rt_ringbuffer_data_len(rb);
+    const uint32_t read = rb->read_index;
+    const uint32_t write = __atomic_load_n(&rb->write_index, __ATOMIC_ACQUIRE);
+    const uint32_t data_len = write - read;
+
+    if (offset > data_len)
+        offset = data_len;
+    if (length > data_len - offset)
+        length = data_len - offset;
+    _ringbuffer_span(rb, read + offset, length, span);
+    return length;
+}
 
-    if (data_len == 0)
-        return 0;
-    if (length > data_len)
-        length = data_len;
+ITCM void rt_ringbuffer_consume(struct rt_ringbuffer *rb, uint32_t length)
+{
+    __atomic_store_n(&rb->read_index, rb->read_index + length,
+                     __ATOMIC_RELEASE);
+}
 
-    size = rb->buffer_size - rb->read_index;
-    if (size > length)
-    {
-        memcpy(ptr, &rb->buffer_ptr[rb->read_index], length);
-        rb->read_index += length;
-    }
-    else
-    {
-        memcpy(ptr, &rb->buffer_ptr[rb->read_index], size);
-        memcpy(&ptr[size], &rb->buffer_ptr[0], length - size);
-        rb->read_index = length - size;
-        rb->read_mirror = ~rb->read_mirror;
-    }
+ITCM size_t rt_ringbuffer_put(struct rt_ringbuffer *rb, const uint8_t *ptr,
+                              uint32_t length)
+{
+    struct rt_ringbuffer_span span;
+
+    length = rt_ringbuffer_reserve(rb, length, &span);
+    memcpy(span.ptr[0], ptr, span.len[0]);
+    if (span.len[1] > 0)
+        memcpy(span.ptr[1], &ptr[span.len[0]], span.len[1]);
+    rt_ringbuffer_commit(rb, length);
+    return length;
+}
+
+ITCM size_t rt_ringbuffer_get(struct rt_ringbuffer *rb, uint8_t *ptr,
+                              uint32_t length)
+{
+    struct rt_ringbuffer_span span;
+
+    length = rt_ringbuffer_peek(rb, 0, length, &span);
+    memcpy(ptr, span.ptr[0], span.len[0]);
+    if (span.len[1] > 0)
+        memcpy(&ptr[span.len[0]], span.ptr[1], span.len[1]);
+    rt_ringbuffer_consume(rb, length);
     return length;
 }
 
@@ -1,4 +1,30 @@
 #ifndef _YMODEM_PORT_H_
 #define _YMODEM_PORT_H_
 
+/**
+ * @brief 接收补丁时边接收边还原，
+ * 不再等待传输结束后由boot线程回读补丁分区。
+ */
+#ifndef YMODEM_PORT_STREAM_APPLY
+#define YMODEM_PORT_STREAM_APPLY 0
+#endif
+
+/**
+ * @brief 流式还原时仍把补丁写入补丁分区，
+ * 还原失败时可由boot线程从补丁分区重试。
+ */
+#ifndef YMODEM_PORT_STREAM_PERSIST
+#define YMODEM_PORT_STREAM_PERSIST 1
+#endif
+
+/**
+ * @brief 按写入进度逐个擦除扇区，收到文件头时不再擦除整个分区。
+ * 一个扇区写满后在后台擦除下一个扇区，擦除与下一个数据包的传输重叠，
+ * 只在写入跨过扇区边界时等待擦除完成。
+ * 与YModem-G同时使用时，接收缓冲区需要容纳擦除一个扇区期间到达的数据。
+ */
+#ifndef YMODEM_PORT_LAZY_ERASE
+#define YMODEM_PORT_LAZY_ERASE 1
+#endif
+
 #endif
\ No newline at end of file
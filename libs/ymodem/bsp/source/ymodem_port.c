@@ -1,3 +1,7 @@
+#include <algo/arena.h>
+#include <algo/digest.h>
+#include <detools_port.h>
+#include <flash.h>
 #include <load/load.h>
 #include <main.h>
 #include <rthw.h>
@@ -11,6 +15,224 @@
 #define DBG_LVL DBG_VERBOSE
 #include <rtdebug.h>
 
+// 流式还原按顺序写入另一个分区，无法原地改写
+#if YMODEM_PORT_STREAM_APPLY && DETOOLS_PORT_IN_PLACE
+#error "YMODEM_PORT_STREAM_APPLY does not support DETOOLS_PORT_IN_PLACE"
+#endif
+
+/**
+ * @brief 地址所在的flash bank序号。
+ */
+#define YMODEM_PORT_BANK(addr)                                                 \
+    (((addr) - MCU_FLASH_START) /                                              \
+     (MCU_FLASH_BANK_SECTORS * MCU_FLASH_SECTOR_SIZE))
+
+/**
+ * @brief 当前文件的大小。
+ */
+static uint32_t file_size = 0;
+
+/**
+ * @brief 文件末尾可能存在的摘要尾部，接收时截取。
+ */
+static algo_image_trailer_t file_trailer;
+
+/**
+ * @brief 写入app分区的镜像摘要，固件文件在接收时计算，补丁在还原时计算。
+ */
+static algo_digest_t file_digest;
+
+/**
+ * @brief 当前文件所在分区的擦除进度。
+ */
+static struct {
+    uint32_t next;   //!< 下一个尚未确认擦除的扇区地址
+    uint32_t end;    //!< 分区结束地址
+    uint32_t limit;  //!< 文件数据结束地址，后台擦除不越过
+    bool background; //!< next所在扇区正在后台擦除
+} file_erase;
+
+#if YMODEM_PORT_LAZY_ERASE
+/**
+ * @brief 在后台擦除下一个尚未擦除的扇区，启动后立即返回。
+ * 同一bank擦除时不能编程，只在当前扇区写满后调用。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+ITCM static int ymodem_erase_start(void)
+{
+    const uint32_t addr = file_erase.next;
+    if (file_erase.background || (addr >= file_erase.limit))
+    {
+        return BSP_FLASH_OK;
+    }
+
+    if (bsp_flash_is_blank(addr, MCU_FLASH_SECTOR_SIZE))
+    {
+        LOG_D("sector 0x%08X already blank", addr);
+        file_erase.next += MCU_FLASH_SECTOR_SIZE;
+        return BSP_FLASH_OK;
+    }
+
+    const int result = bsp_flash_erase_start(addr, MCU_FLASH_SECTOR_SIZE);
+    if (result == BSP_FLASH_OK)
+    {
+        file_erase.background = true;
+    }
+    return result;
+}
+
+/**
+ * @brief 确保写入范围内的扇区都已擦除，已经为空的扇区直接跳过，
+ * 后台擦除中的扇区等待擦除完成。
+ * @param end 即将写入数据的结束地址。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+ITCM static int ymodem_erase_ahead(uint32_t end)
+{
+    if (end > file_erase.end)
+    {
+        return BSP_FLASH_ERROR_PARAM;
+    }
+
+    while (file_erase.next < end)
+    {
+        const uint32_t addr = file_erase.next;
+        if (file_erase.background)
+        {
+            // 擦除在写满上一个扇区时启动，这里只等待剩余的时间
+            const uint32_t start = DWT->CYCCNT;
+            const int result = bsp_flash_wait(addr);
+            const uint32_t us =
+                (DWT->CYCCNT - start) / (SystemCoreClock / 1000000);
+            file_erase.background = false;
+            if (result != BSP_FLASH_OK)
+            {
+                return result;
+            }
+            LOG_D("sector 0x%08X erase waited %u us", addr, us);
+        }
+        else if (bsp_flash_is_blank(addr, MCU_FLASH_SECTOR_SIZE))
+        {
+            LOG_D("sector 0x%08X already blank", addr);
+        }
+        else
+        {
+            // 用周期计数器计时，轮询擦除时系统节拍会停止
+            const uint32_t start = DWT->CYCCNT;
+            const int result = bsp_flash_erase_sector_by_addr(addr);
+            const uint32_t us =
+                (DWT->CYCCNT - start) / (SystemCoreClock / 1000000);
+            if (result != BSP_FLASH_OK)
+            {
+                return result;
+            }
+            LOG_D("sector 0x%08X erased in %u us", addr, us);
+        }
+        file_erase.next += MCU_FLASH_SECTOR_SIZE;
+    }
+
+    return BSP_FLASH_OK;
+}
+#endif
+
+/**
+ * @brief 截取落在文件末尾摘要尾部范围内的数据。
+ * @param data 数据指针。
+ * @param len 数据长度。
+ * @param offset 当前文件偏移量。
+ */
+ITCM static void ymodem_capture_trailer(const uint8_t *data, uint32_t len,
+                                        uint32_t offset)
+{
+    if (file_size < sizeof(file_trailer))
+    {
+        return;
+    }
+
+    const uint32_t start = file_size - sizeof(file_trailer);
+    const uint32_t end = offset + len;
+    if (end <= start)
+    {
+        return;
+    }
+
+    const uint32_t skip = (offset < start) ? (start - offset) : 0;
+    memcpy((uint8_t *)&file_trailer + (offset + skip - start), data + skip,
+           len - skip);
+}
+
+/**
+ * @brief 用文件末尾的摘要尾部校验写入app分区的镜像。
+ * @return true 校验通过，或文件没有摘要尾部且不强制校验。
+ * @return false 镜像损坏。
+ */
+ITCM static bool ymodem_verify_image(void)
+{
+    if (!algo_image_trailer_valid(&file_trailer))
+    {
+        LOG_W("file has no image digest");
+        return !ALGO_DIGEST_REQUIRED;
+    }
+
+    return algo_digest_check(&file_digest, &file_trailer);
+}
+
+#if YMODEM_PORT_STREAM_APPLY
+/**
+ * @brief 当前文件是否正在流式还原。
+ */
+static bool stream_active = false;
+
+/**
+ * @brief 擦除新固件分区并启动流式还原。
+ * @param size 补丁大小。
+ * @return true 启动成功。
+ * @return false 不适合流式还原或启动失败，退回到先落盘再还原的流程。
+ */
+ITCM static bool ymodem_stream_begin(uint32_t size)
+{
+    // user补丁基于user生成oem，oem补丁基于oem生成user
+    const bool to_oem = (load_get_patch() == LOAD_PATCH_USER);
+    const uint32_t old_addr = to_oem ? USER_START : OEM_START;
+    const uint32_t new_addr = to_oem ? OEM_START : USER_START;
+    const uint32_t new_size = to_oem ? OEM_SIZE : USER_SIZE;
+
+#if YMODEM_PORT_STREAM_PERSIST
+    // 新固件与补丁分区在同一bank时，擦除与还原写入都会挡住补丁落盘，
+    // 发送端长时间收不到应答，改为接收完成后由boot线程还原
+    if (YMODEM_PORT_BANK(new_addr) == YMODEM_PORT_BANK(PATCH_START))
+    {
+        LOG_I("0x%08X shares a flash bank with patch, apply after download",
+              new_addr);
+        return false;
+    }
+#endif
+
+    // 补丁头解析前无法得知新固件大小，擦除整个分区
+#if DETOOLS_PORT_BANK_OVERLAP
+    // 新固件分区在后台擦除，文件头立即应答，补丁可同时写入另一个bank
+    int result = bsp_flash_erase_start(new_addr, new_size);
+#else
+    int result = bsp_flash_erase(new_addr, new_size);
+#endif
+    if (result != BSP_FLASH_OK)
+    {
+        LOG_E("flash erase fail with %d", result);
+        return false;
+    }
+
+    result = detools_stream_begin(old_addr, size, new_addr, &file_digest);
+    if (result != 0)
+    {
+        LOG_E("detools stream begin fail with %d", result);
+        return false;
+    }
+
+    LOG_I("stream apply to 0x%08X", new_addr);
+    return true;
+}
+#endif
+
 /**
  * @brief ymodem接收到文件头时执行的回调。
  * @param name 接收到的文件名字符串。
@@ -19,93 +241,95 @@
  */
 ITCM static int ymodem_on_begin(const char *name, uint32_t size)
 {
-    int result = 0;
-    FLASH_EraseInitTypeDef flash_erase_configuration = {
-        .TypeErase = FLASH_TYPEERASE_SECTORS,
-        .NbSectors = (1 + size / MCU_FLASH_SECTOR_SIZE),
-        .VoltageRange = FLASH_VOLTAGE_RANGE_3,
-    };
+    file_size = size;
+    memset(&file_trailer, 0, sizeof(file_trailer));
+    algo_digest_init(&file_digest);
+
+    // 未知文件没有可写入的分区，上一个文件留下的后台擦除照常完成
+    file_erase.next = 0;
+    file_erase.end = 0;
+    file_erase.limit = 0;
+    file_erase.background = false;
+
+    uint32_t addr;
+    uint32_t limit;
     if (strcmp(name, "user.bin") == 0)
     {
-        flash_erase_configuration.Banks = FLASH_BANK_1;
-        flash_erase_configuration.Sector =
-            (USER_START - MCU_FLASH_START) / MCU_FLASH_SECTOR_SIZE;
+        addr = USER_START;
+        limit = USER_SIZE;
         load_write_config_which(LOAD_APP_USER);
     }
+#if !PARTITION_IN_PLACE
     else if (strcmp(name, "oem.bin") == 0)
     {
-        flash_erase_configuration.Banks = FLASH_BANK_2;
-        flash_erase_configuration.Sector =
-            (OEM_START - MCU_FLASH_START) / MCU_FLASH_SECTOR_SIZE - 8;
+        addr = OEM_START;
+        limit = OEM_SIZE;
         load_write_config_which(LOAD_APP_OEM);
     }
+#endif
     else if (strcmp(name, "user.patch") == 0)
     {
-        flash_erase_configuration.Banks = FLASH_BANK_2;
-        flash_erase_configuration.Sector =
-            (PATCH_START - MCU_FLASH_START) / MCU_FLASH_SECTOR_SIZE - 8;
+        addr = PATCH_START;
+        limit = PATCH_SIZE;
         load_set_patch(LOAD_PATCH_USER);
         load_set_patch_size(size);
     }
+#if !PARTITION_IN_PLACE
     else if (strcmp(name, "oem.patch") == 0)
     {
-        flash_erase_configuration.Banks = FLASH_BANK_2;
-        flash_erase_configuration.Sector =
-            (PATCH_START - MCU_FLASH_START) / MCU_FLASH_SECTOR_SIZE - 8;
+        addr = PATCH_START;
+        limit = PATCH_SIZE;
         load_set_patch(LOAD_PATCH_OEM);
         load_set_patch_size(size);
     }
+#endif
     else
     {
         LOG_E("unsupport file: %s (%d bytes)", name, size);
-        goto exit;
+        return -1;
     }
-    LOG_D("flash erase sector index: %u, number: %u",
-          flash_erase_configuration.Sector,
-          flash_erase_configuration.NbSectors);
 
-    // 在擦写前关闭全局中断
-    __disable_irq();
+    // 分区内容即将改变，中断的还原不能再继续
+    detools_port_journal_clear();
 
-    // 解锁Flash控制寄存器
-    result = HAL_FLASH_Unlock();
-    if (0 != result)
-    {
-        LOG_E("flash unlock fail");
-        goto exit;
-    }
+    file_erase.next = addr;
+    file_erase.end = addr + limit;
+    file_erase.limit = addr + ((size < limit) ? size : limit);
 
-    // 清除ECC标志
-    if (flash_erase_configuration.Banks == FLASH_BANK_1)
-    {
-        __HAL_FLASH_CLEAR_FLAG_BANK1(FLASH_FLAG_ALL_ERRORS_BANK1);
-    }
-    else
+#if YMODEM_PORT_STREAM_APPLY
+    stream_active = (addr == PATCH_START) && ymodem_stream_begin(size);
+#if !YMODEM_PORT_STREAM_PERSIST
+    if (stream_active)
     {
-        __HAL_FLASH_CLEAR_FLAG_BANK2(FLASH_FLAG_ALL_ERRORS_BANK2);
+        // 补丁不落盘，无需擦除补丁分区
+        LOG_I("start download: %s (%d bytes)", name, size);
+        return 0;
     }
+#endif
+#endif
 
-    // 执行擦除
-    uint32_t sector_error;
-    result = HAL_FLASHEx_Erase(&flash_erase_configuration, &sector_error);
-    if (0 != result)
+    // 按需擦除时第一个扇区在后台擦除，文件头可以立即应答
+#if YMODEM_PORT_LAZY_ERASE
+    const int result = ymodem_erase_start();
+    if (result != BSP_FLASH_OK)
     {
-        LOG_E("flash erase fail with %u", sector_error);
-        goto exit;
+        LOG_E("flash erase start at 0x%08X fail with %d", addr, result);
+        return -1;
     }
+#else
+    const uint32_t erase_size =
+        (1 + size / MCU_FLASH_SECTOR_SIZE) * MCU_FLASH_SECTOR_SIZE;
+    LOG_D("flash erase from 0x%08X, size: %u", addr, erase_size);
 
-    LOG_I("start download: %s (%d bytes)", name, size);
-
-exit:
-    // 上锁Flash控制寄存器
-    result = HAL_FLASH_Lock();
-    if (0 != result)
+    const int result = bsp_flash_erase(addr, erase_size);
+    if (result != BSP_FLASH_OK)
     {
-        LOG_E("flash lock fail");
+        LOG_E("flash erase fail with %d", result);
+        return -1;
     }
+#endif
 
-    // 使能全局中断
-    __enable_irq();
+    LOG_I("start download: %s (%d bytes)", name, size);
 
     return 0;
 }
@@ -120,14 +344,32 @@ exit:
 ITCM static int ymodem_on_data(const uint8_t *data, uint32_t len,
                                uint32_t offset)
 {
-    int result = 0;
+    ymodem_capture_trailer(data, len, offset);
+
+#if YMODEM_PORT_STREAM_APPLY
+    if (stream_active)
+    {
+        const int result = detools_stream_write(data, len);
+#if YMODEM_PORT_STREAM_PERSIST
+        if (result < 0)
+        {
+            // 补丁照常落盘，传输结束后交给boot线程从补丁分区还原
+            LOG_W("stream apply fail with %d, apply after download", result);
+            stream_active = false;
+            detools_stream_end();
+        }
+#else
+        // 补丁不落盘，还原出错时只能终止传输
+        return (result < 0) ? -1 : 0;
+#endif
+    }
+#endif
 
     load_which_t which;
     if (!load_read_config_which(&which))
     {
-        result = load_get_error();
-        LOG_E("read load which fail with 0x%d", result);
-        goto exit;
+        LOG_E("read load which fail with 0x%d", load_get_error());
+        return -1;
     }
 
     uint32_t addr;
@@ -135,10 +377,16 @@ ITCM static int ymodem_on_data(const uint8_t *data, uint32_t len,
     switch (which)
     {
     case LOAD_APP_USER:
-        addr = USER_START + offset;
-        break;
     case LOAD_APP_OEM:
-        addr = OEM_START + offset;
+        addr = ((which == LOAD_APP_USER) ? USER_START : OEM_START) + offset;
+
+        // 固件文件直接写入app分区，摘要不包含末尾的摘要尾部
+        if ((file_size >= sizeof(file_trailer)) &&
+            (offset < file_size - sizeof(file_trailer)))
+        {
+            const uint32_t limit = file_size - sizeof(file_trailer) - offset;
+            algo_digest_update(&file_digest, data, (len < limit) ? len : limit);
+        }
         break;
     default:
         const load_patch_t patch = load_get_patch();
@@ -147,112 +395,59 @@ ITCM static int ymodem_on_data(const uint8_t *data, uint32_t len,
         case LOAD_PATCH_USER:
         case LOAD_PATCH_OEM:
             addr = PATCH_START + offset;
+
+            // 补丁头到达时就拒绝无法还原的补丁，而不是接收完才失败
+            if ((offset == 0) && !detools_port_patch_supported(data[0]))
+            {
+                LOG_E("patch header 0x%02X not supported", data[0]);
+                return -1;
+            }
             break;
         default:
             LOG_E("load patch error with %d", patch);
-            goto exit;
+            return -1;
         }
         break;
     }
 
     // 检查地址是否32字节对齐
-    if ((addr & 31) != 0)
+    if ((addr & (MCU_FLASH_WORD_SIZE - 1)) != 0)
     {
         LOG_E("flash address 0x%08X not 32-byte aligned", addr);
-        goto exit;
+        return -1;
     }
     LOG_D("flash program from 0x%08X", addr);
 
-    // 在写前关闭全局中断
-    __disable_irq();
-
-    // 解锁Flash控制寄存器
-    result = HAL_FLASH_Unlock();
-    if (0 != result)
+#if YMODEM_PORT_LAZY_ERASE
+    const int erase_result = ymodem_erase_ahead(addr + len);
+    if (erase_result != BSP_FLASH_OK)
     {
-        LOG_E("flash unlock fail");
-        goto exit;
+        LOG_E("flash erase before 0x%08X fail with %d", addr + len,
+              erase_result);
+        return -1;
     }
+#endif
 
-    // 清除ECC标志
-    switch (which)
+    const int result = bsp_flash_write(addr, data, len);
+    if (result != BSP_FLASH_OK)
     {
-    case LOAD_APP_USER:
-        __HAL_FLASH_CLEAR_FLAG_BANK1(FLASH_FLAG_ALL_ERRORS_BANK1);
-        break;
-    case LOAD_APP_OEM:
-        __HAL_FLASH_CLEAR_FLAG_BANK2(FLASH_FLAG_ALL_ERRORS_BANK2);
-        break;
-    default:
-        const load_patch_t patch = load_get_patch();
-        switch (patch)
-        {
-        case LOAD_PATCH_USER:
-        case LOAD_PATCH_OEM:
-            __HAL_FLASH_CLEAR_FLAG_BANK2(FLASH_FLAG_ALL_ERRORS_BANK2);
-            break;
-        default:
-            LOG_E("load patch(%d) with error(%d)", patch, load_get_error());
-            goto exit;
-        }
-        break;
+        LOG_E("flash program fail at 0x%08X with %d", addr, result);
+        return -1;
     }
 
-    uint32_t bytes_processed = 0;
-    static uint8_t buffer[32] __attribute__((aligned(32)));
-
-    while (bytes_processed < len)
+#if YMODEM_PORT_LAZY_ERASE
+    // 当前扇区已写满，下一个扇区的擦除与下一个数据包的传输同时进行
+    if (addr + len == file_erase.next)
     {
-        uint32_t remaining = len - bytes_processed;
-        uint32_t write_addr = addr + bytes_processed;
-        uint8_t *src_ptr = (uint8_t *)(data + bytes_processed);
-
-        if (remaining >= 32)
-        {
-            // 情况1:剩余数据足够写一个完整的32字节块
-            // 注意：如果源数据地址本身就是32位对齐的，可以直接传src_ptr
-            // 否则为了安全，如果src_ptr不对齐，建议先copy到align_buffer
-            if (((uint32_t)src_ptr & 31) == 0)
-            {
-                result = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD,
-                                           write_addr, (uint32_t)src_ptr);
-            }
-            else
-            {
-                memcpy(buffer, src_ptr, 32);
-                result = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD,
-                                           write_addr, (uint32_t)buffer);
-            }
-            bytes_processed += 32;
-        }
-        else
-        {
-            // 情况2: 剩余数据不足32字节，进行填充
-            memset(buffer, 0xFF, 32);           // 先全部填0xFF
-            memcpy(buffer, src_ptr, remaining); // 拷入剩余数据
-
-            result = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, write_addr,
-                                       (uint32_t)buffer);
-            bytes_processed += remaining; // 处理完成
-        }
-
-        if (result != HAL_OK)
+        const int start_result = ymodem_erase_start();
+        if (start_result != BSP_FLASH_OK)
         {
-            LOG_E("flash program fail at 0x%08X with %u", write_addr, result);
-            goto exit;
+            LOG_E("flash erase start at 0x%08X fail with %d", file_erase.next,
+                  start_result);
+            return -1;
         }
     }
-
-exit:
-    // 上锁Flash控制寄存器
-    result = HAL_FLASH_Lock();
-    if (0 != result)
-    {
-        LOG_E("flash lock fail");
-    }
-
-    // 使能全局中断
-    __enable_irq();
+#endif
 
     return 0;
 }
@@ -263,6 +458,32 @@ exit:
  */
 ITCM static void ymodem_on_end(int status)
 {
+    // 输出上电以来各内存池的用量峰值，用于调整内存池大小
+    algo_arena_report();
+
+#if YMODEM_PORT_STREAM_APPLY
+    if (stream_active)
+    {
+        stream_active = false;
+
+        // 无论传输是否成功都要结束还原，释放解压器
+        const int result = detools_stream_end();
+        if ((status == 0) && (result == DETOOLS_OK) && ymodem_verify_image())
+        {
+            const bool to_oem = (load_get_patch() == LOAD_PATCH_USER);
+            load_write_config_which(to_oem ? LOAD_APP_OEM : LOAD_APP_USER);
+            load_set_reset();
+            LOG_I("stream apply success!");
+            return;
+        }
+#if !YMODEM_PORT_STREAM_PERSIST
+        LOG_E("stream apply failed, status: %d, result: %d", status, result);
+        return;
+#endif
+        // 补丁已经落盘，交给boot线程从补丁分区重试
+    }
+#endif
+
     if (status == 0)
     {
         LOG_I("download success!");
@@ -278,6 +499,14 @@ ITCM static void ymodem_on_end(int status)
         {
         case LOAD_APP_USER:
         case LOAD_APP_OEM:
+            if (!ymodem_verify_image())
+            {
+                // 镜像损坏，清除启动参数，不复位
+                LOG_E("image verify fail");
+                load_write_config_which(LOAD_APP_INVALID);
+                return;
+            }
+
             uint8_t buffer[8] = {0};
             const uint32_t addr =
                 ((which == LOAD_APP_USER) ? USER_START : OEM_START);
@@ -301,7 +530,12 @@ ITCM static void ymodem_on_end(int status)
             switch (patch)
             {
             case LOAD_PATCH_USER:
+#if PARTITION_IN_PLACE
+                // 只有user分区，补丁原地改写user
+                load_set_apply(LOAD_APPLY_USER);
+#else
                 load_set_apply(LOAD_APPLY_OEM);
+#endif
                 break;
             case LOAD_PATCH_OEM:
                 load_set_apply(LOAD_APPLY_USER);
@@ -329,7 +563,10 @@ static int ymodem_env_init(void)
         .on_end = ymodem_on_end,
     };
 
-    ymodem_init();
+    if (!ymodem_init())
+    {
+        return -1;
+    }
 
     // 在初始化时注册
     ymodem_set_ops(&ymodem_ops);
@@ -1,6 +1,50 @@
 #ifndef _YMODEM_H_
 #define _YMODEM_H_
 
+/**
+ * @brief 接收串口波特率，初始化时覆盖cubemx中的配置。
+ */
+#ifndef YMODEM_BAUD_RATE
+#define YMODEM_BAUD_RATE (115200)
+#endif
+
+/**
+ * @brief 使用YModem-G流式接收，发送方不再等待每个数据块的ACK，
+ * 任何校验错误都会取消整个传输，只适合可靠的链路。
+ */
+#ifndef YMODEM_STREAM
+#define YMODEM_STREAM (0)
+#endif
+
+/**
+ * @brief dma接收缓冲区大小，流式接收时需要容纳上层处理数据期间到达的数据。
+ */
+#ifndef YMODEM_RX_BUF_SIZE
+#if YMODEM_STREAM
+#define YMODEM_RX_BUF_SIZE (1024 * 16)
+#else
+#define YMODEM_RX_BUF_SIZE (1024 * 4)
+#endif
+#endif
+
+/**
+ * @brief 滑动窗口扩展允许的未应答数据包数上限。
+ * 发送方在文件头中提出窗口大小，接收方在文件头的ACK之后回复'W'与确认的窗口，
+ * 之后发送方可以连续发出窗口内的数据包，不必每包等待ACK；
+ * 不支持扩展的发送方不会提出窗口，仍按停等方式发送。
+ * 窗口内的数据包必须都能放进接收缓冲区，置1关闭扩展，流式接收时不使用。
+ */
+#ifndef YMODEM_WINDOW
+#define YMODEM_WINDOW ((YMODEM_RX_BUF_SIZE - 1) / (1024 + 5))
+#endif
+
+/**
+ * @brief 会话内存池大小，位于dtcm，至少容纳一个1K数据包，会话结束时整体回收。
+ */
+#ifndef YMODEM_ARENA_SIZE
+#define YMODEM_ARENA_SIZE (1024 + 8)
+#endif
+
 /**
  * @brief YModem过程回调接口。
  */
@@ -24,7 +68,7 @@ typedef struct {
 
     /**
      * @brief 传输结束。
-     * @param status 0: 成功; 非0: 异常终止 (超时、校验失败、被取消等)。
+     * @param status 0: 成功; 非0: 异常终止 (超时、校验失败、被取消、接收溢出等)。
      */
     void (*on_end)(int status);
 } ymodem_ops_t;
@@ -34,6 +78,6 @@ void ymodem_set_ops(ymodem_ops_t *const ops);
 
 void ymodem_receive_loop(void);
 
-void ymodem_init(void);
+bool ymodem_init(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef _YMODEM_RING_H_
+#define _YMODEM_RING_H_
+
+#include <rtthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief 返回dma剩余传输计数(NDTR)，主机测试时可用模拟计数代替。
+ */
+typedef uint32_t (*ymodem_ring_counter_t)(void);
+
+/**
+ * @brief 直接建立在dma循环接收缓冲区上的只读环形视图，
+ * 数据帧在原位置解析与校验，不再拷贝到中间缓冲区。
+ * dma是生产者，同步时由接收线程代为发布dma已写入的数据。
+ * 写位置只能反映一圈以内的前进，dma越过半满与全满位置的中断次数
+ * 用于发现两次同步之间dma转过一整圈、覆盖尚未处理数据的情况。
+ */
+typedef struct {
+    struct rt_ringbuffer rb;       //!< 建立在dma接收缓冲区上的环形缓冲区
+    ymodem_ring_counter_t counter; //!< dma剩余传输计数
+    volatile uint32_t halves;      //!< 半满与全满中断的累计次数，由中断更新
+    uint32_t halves_synced;        //!< 按同步时的写位置推算出的累计次数
+    bool overrun;                  //!< 尚未处理的数据已被dma覆盖
+} ymodem_ring_t;
+
+/**
+ * @brief 数据在环中可能跨越缓冲区末尾，最多分为两段。
+ */
+typedef struct rt_ringbuffer_span ymodem_ring_span_t;
+
+/**
+ * @brief 初始化环形视图，读写位置都从当前dma位置开始。
+ * @param ring 环形视图。
+ * @param buf dma接收缓冲区。
+ * @param size 缓冲区大小，与dma传输计数一致，必须为2的幂。
+ * @param counter 读取dma剩余传输计数的函数。
+ * @return true 初始化成功。
+ * @return false 缓冲区大小不是2的幂。
+ */
+bool ymodem_ring_init(ymodem_ring_t *ring, const uint8_t *buf, uint32_t size,
+                      ymodem_ring_counter_t counter);
+
+/**
+ * @brief 从dma计数同步写位置，发现溢出时丢弃全部未读数据并置位溢出标志。
+ * @param ring 环形视图。
+ * @return uint32_t 可读字节数。
+ */
+uint32_t ymodem_ring_sync(ymodem_ring_t *ring);
+
+/**
+ * @brief 在dma半满或全满中断中调用，两个标志同时置位时各调用一次。
+ * @param ring 环形视图。
+ */
+void ymodem_ring_dma_half(ymodem_ring_t *ring);
+
+/**
+ * @brief 查询自上次丢弃全部数据以来是否发生过溢出。
+ * @param ring 环形视图。
+ * @return true dma覆盖了尚未处理的数据。
+ * @return false 数据完整。
+ */
+bool ymodem_ring_overrun(const ymodem_ring_t *ring);
+
+/**
+ * @brief 返回上次同步后的可读字节数。
+ * @param ring 环形视图。
+ * @return uint32_t 可读字节数。
+ */
+uint32_t ymodem_ring_available(const ymodem_ring_t *ring);
+
+/**
+ * @brief 读取读位置之后第offset个字节，不移动读位置。
+ * @param ring 环形视图。
+ * @param offset 相对读位置的偏移，必须小于可读字节数。
+ * @return uint8_t 数据。
+ */
+uint8_t ymodem_ring_peek(const ymodem_ring_t *ring, uint32_t offset);
+
+/**
+ * @brief 返回一段数据在缓冲区中的位置，不移动读位置。
+ * @param ring 环形视图。
+ * @param offset 相对读位置的偏移。
+ * @param len 数据长度，offset + len必须不大于可读字节数。
+ * @param span 输出的数据段。
+ * @return true 数据连续，只有一段。
+ * @return false 数据跨越缓冲区末尾，分为两段。
+ */
+bool ymodem_ring_span(const ymodem_ring_t *ring, uint32_t offset,
+                      uint32_t len, ymodem_ring_span_t *span);
+
+/**
+ * @brief 把一段数据拷贝出来，用于需要连续内存的场合。
+ * @param ring 环形视图。
+ * @param offset 相对读位置的偏移。
+ * @param dest 目标地址。
+ * @param len 数据长度。
+ */
+void ymodem_ring_copy(const ymodem_ring_t *ring, uint32_t offset,
+                      uint8_t *dest, uint32_t len);
+
+/**
+ * @brief 丢弃已经处理的数据。
+ * @param ring 环形视图。
+ * @param len 丢弃的字节数，不大于可读字节数。
+ */
+void ymodem_ring_consume(ymodem_ring_t *ring, uint32_t len);
+
+/**
+ * @brief 丢弃所有未读数据，并清除溢出标志。
+ * @param ring 环形视图。
+ */
+void ymodem_ring_flush(ymodem_ring_t *ring);
+
+#endif
@@ -1,10 +1,14 @@
 #include <algo/algo.h>
+#include <algo/arena.h>
 #include <main.h>
 #include <rthw.h>
 #include <rtthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <thread/monitor.h>
+#include <uart.h>
 #include <ymodem.h>
+#include <ymodem_ring.h>
 
 // 配置调试日志
 #define DBG_TAG __FILE_NAME__
@@ -19,17 +23,47 @@
 #define NAK (0x15)   /* 重传 */
 #define CAN (0x18)   /* 取消 */
 #define CRC_C (0x43) /* 'C' 字符 */
+#define CRC_G (0x47) /* 'G' 字符，请求YModem-G流式传输 */
+#define WND (0x57)   /* 'W' 字符，确认滑动窗口扩展，后跟窗口大小 */
 
-#define UART_RX_BUF_SIZE (1024 * 2)
-#define YMODEM_RB_SIZE (1024 * 4)
+#if YMODEM_STREAM
+#define YMODEM_REQUEST CRC_G
+#else
+#define YMODEM_REQUEST CRC_C
+#endif
+
+// 接收缓冲区至少容纳两个1K数据包，帧直接在其中解析
+#define UART_RX_BUF_SIZE YMODEM_RX_BUF_SIZE
+#define YMODEM_PKT_SIZE (1024 + 5)
+
+#if UART_RX_BUF_SIZE < (YMODEM_PKT_SIZE * 2)
+#error "YMODEM_RX_BUF_SIZE must hold at least two 1K packets"
+#endif
+
+#if (UART_RX_BUF_SIZE & (UART_RX_BUF_SIZE - 1)) != 0
+#error "YMODEM_RX_BUF_SIZE must be a power of two"
+#endif
+
+// dma循环写入，窗口内的数据包超过缓冲区时会覆盖尚未处理的数据
+#if (YMODEM_WINDOW < 1) || (YMODEM_WINDOW * YMODEM_PKT_SIZE >= UART_RX_BUF_SIZE)
+#error "YMODEM_WINDOW packets must fit into YMODEM_RX_BUF_SIZE"
+#endif
+
+// 重传前等待线路空闲的时间，略长于一个1K数据包的线路时间
+#define YMODEM_PURGE_MS (YMODEM_PKT_SIZE * 10 * 1000 / YMODEM_BAUD_RATE + 20)
+
+#if YMODEM_ARENA_SIZE < YMODEM_PKT_SIZE
+#error "YMODEM_ARENA_SIZE must hold at least one 1K packet"
+#endif
 
 SHARE_UNINIT static uint8_t uart_rx_buf[UART_RX_BUF_SIZE];
-static uint32_t last_read_end_pos = 0;
 static struct rt_semaphore uart_rx_sem;
-static struct rt_ringbuffer ymodem_rb;
-static uint8_t rb_mem[YMODEM_RB_SIZE];
+static ymodem_ring_t ymodem_ring;
 static ymodem_ops_t *ymodem_cb = NULL;
 
+// 会话期间的临时内存，代替rt_malloc
+ALGO_ARENA_DEFINE(ymodem_arena, NONE, YMODEM_ARENA_SIZE);
+
 void ymodem_set_ops(ymodem_ops_t *const ops)
 {
     ymodem_cb = ops;
@@ -41,61 +75,150 @@ void ymodem_set_ops(ymodem_ops_t *const ops)
  */
 static void ymodem_putchar(const uint8_t ch)
 {
-    while (!LL_USART_IsActiveFlag_TXE_TXFNF(UART4))
-        ;
-    LL_USART_TransmitData8(UART4, ch);
+    bsp_uart_write(BSP_UART_UART4, &ch, 1);
 }
 
 /**
- * @brief 搬运dma数据到环形缓冲区。
+ * @brief 读取dma剩余传输计数。
+ * @return uint32_t 剩余传输计数。
  */
-static void ymodem_dma_process(void)
+static uint32_t ymodem_dma_counter(void)
 {
-    uint32_t data_len = LL_DMA_GetDataLength(DMA1, LL_DMA_STREAM_0);
-    uint32_t curr_pos = UART_RX_BUF_SIZE - data_len;
-
-    if (curr_pos != last_read_end_pos)
-    {
-        if (curr_pos > last_read_end_pos)
-        {
-            rt_ringbuffer_put(&ymodem_rb, &uart_rx_buf[last_read_end_pos],
-                              curr_pos - last_read_end_pos);
-        }
-        else
-        {
-            rt_ringbuffer_put(&ymodem_rb, &uart_rx_buf[last_read_end_pos],
-                              UART_RX_BUF_SIZE - last_read_end_pos);
-            if (curr_pos > 0)
-                rt_ringbuffer_put(&ymodem_rb, &uart_rx_buf[0], curr_pos);
-        }
-        last_read_end_pos = curr_pos;
-    }
+    return LL_DMA_GetDataLength(DMA1, LL_DMA_STREAM_0);
 }
 
 /**
- * @brief 阻塞式读取。
- * @param dest 数据去向。
- * @param len 读取指定长度数据。
+ * @brief 阻塞等待接收缓冲区中累计到指定长度的数据，数据不被取走。
+ * @param len 等待的数据长度。
  * @param timeout_ms 超时时间。
- * @return size_t
+ * @return true 数据已就绪。
+ * @return false 超时。
  */
-static size_t rb_read_wait(uint8_t *dest, size_t len, uint32_t timeout_ms)
+static bool ymodem_wait(uint32_t len, uint32_t timeout_ms)
 {
     rt_tick_t start = rt_tick_get();
-    size_t total = 0;
-    while (total < len)
+    while (ymodem_ring_sync(&ymodem_ring) < len)
     {
-        total += rt_ringbuffer_get(&ymodem_rb, dest + total, len - total);
-        if (total >= len)
-            break;
-
-        rt_sem_take(&uart_rx_sem, rt_tick_from_millisecond(20));
-        ymodem_dma_process();
+        // 数据已被覆盖，继续等待只会把之后的数据当作完整的帧
+        if (ymodem_ring_overrun(&ymodem_ring))
+            return false;
 
         if ((rt_tick_get() - start) > rt_tick_from_millisecond(timeout_ms))
-            break;
+            return false;
+
+        if (rt_sem_take(&uart_rx_sem, rt_tick_from_millisecond(20)) == RT_EOK)
+            monitor_isr_served(MONITOR_ISR_UART4);
     }
-    return total;
+    return true;
+}
+
+/**
+ * @brief 在接收缓冲区中原位计算crc16，数据可能分为两段。
+ * @param offset 相对读位置的偏移。
+ * @param len 数据长度。
+ * @return uint16_t crc校验值。
+ */
+static uint16_t ymodem_ring_crc16(uint32_t offset, uint32_t len)
+{
+    ymodem_ring_span_t span;
+    if (ymodem_ring_span(&ymodem_ring, offset, len, &span))
+        return algo_crc16(span.ptr[0], span.len[0]);
+
+    uint16_t crc = algo_crc16_init();
+    crc = algo_crc16_update(crc, span.ptr[0], span.len[0]);
+    crc = algo_crc16_update(crc, span.ptr[1], span.len[1]);
+    return algo_crc16_final(crc);
+}
+
+/**
+ * @brief 校验接收缓冲区中的一个完整数据包，包头位于读位置。
+ * @param block_len 数据长度。
+ * @return true 序号与crc均正确。
+ * @return false 数据包损坏。
+ */
+static bool ymodem_check_packet(uint32_t block_len)
+{
+    const uint8_t pkt_seq = ymodem_ring_peek(&ymodem_ring, 1);
+    const uint8_t pkt_inv = ymodem_ring_peek(&ymodem_ring, 2);
+    if ((uint8_t)(pkt_seq + pkt_inv) != 0xFF)
+        return false;
+
+    const uint16_t r_crc =
+        (uint16_t)(ymodem_ring_peek(&ymodem_ring, 3 + block_len) << 8) |
+        ymodem_ring_peek(&ymodem_ring, 3 + block_len + 1);
+    return ymodem_ring_crc16(3, block_len) == r_crc;
+}
+
+/**
+ * @brief 取得数据包中数据的连续地址，跨越缓冲区末尾时拷贝到暂存区。
+ * @param len 数据长度。
+ * @param scratch 暂存区。
+ * @return const uint8_t* 数据地址。
+ */
+static const uint8_t *ymodem_packet_data(uint32_t len, uint8_t *scratch)
+{
+    ymodem_ring_span_t span;
+    if (ymodem_ring_span(&ymodem_ring, 3, len, &span))
+        return span.ptr[0];
+
+    ymodem_ring_copy(&ymodem_ring, 3, scratch, len);
+    return scratch;
+}
+
+/**
+ * @brief 解析文件头中发送方提出的滑动窗口，
+ * 位于文件大小等信息之后，为'W'加十进制的窗口大小。
+ * @param pkt 文件头数据包。
+ * @param d_len 文件头数据长度，pkt[3 + d_len]必须为'\0'。
+ * @return uint32_t 确认的窗口大小，1表示停等。
+ */
+static uint32_t ymodem_parse_window(const uint8_t *pkt, uint32_t d_len)
+{
+#if YMODEM_STREAM || (YMODEM_WINDOW == 1)
+    (void)pkt;
+    (void)d_len;
+    return 1;
+#else
+    const char *name = (const char *)&pkt[3];
+    const char *info = name + strlen(name) + 1;
+    const char *ext = info + strlen(info) + 1;
+    if ((ext >= (const char *)&pkt[3 + d_len]) || (ext[0] != 'W'))
+        return 1;
+
+    const int window = atoi(ext + 1);
+    if (window < 1)
+        return 1;
+    return (window > YMODEM_WINDOW) ? YMODEM_WINDOW : (uint32_t)window;
+#endif
+}
+
+/**
+ * @brief 上层处理数据期间dma写满一圈时，尚未解析的数据已被覆盖，取消传输。
+ * @return true 发生了溢出，已发出取消。
+ * @return false 数据完整。
+ */
+static bool ymodem_cancel_overrun(void)
+{
+    if (!ymodem_ring_overrun(&ymodem_ring))
+        return false;
+
+    LOG_E("rx buffer overrun, data lost while on_data blocked");
+    ymodem_putchar(CAN);
+    ymodem_putchar(CAN);
+    return true;
+}
+
+/**
+ * @brief 丢弃接收缓冲区中的数据，准备重传。
+ * 滑动窗口下发送方可能还有数据包在线路上，等到线路空闲后再回复NAK，
+ * 重传从出错的数据包开始。
+ * @param window 当前文件的窗口大小。
+ */
+static void ymodem_purge(uint32_t window)
+{
+    ymodem_ring_flush(&ymodem_ring);
+    while ((window > 1) && ymodem_wait(1, YMODEM_PURGE_MS))
+        ymodem_ring_flush(&ymodem_ring);
 }
 
 /**
@@ -103,7 +226,8 @@ static size_t rb_read_wait(uint8_t *dest, size_t len, uint32_t timeout_ms)
  */
 void ymodem_receive_loop(void)
 {
-    uint8_t *pkt = rt_malloc(1024 + 12);
+    // 只在数据包跨越缓冲区末尾或解析文件名时使用
+    uint8_t *pkt = algo_arena_alloc(&ymodem_arena, YMODEM_PKT_SIZE);
     if (!pkt)
         return;
 
@@ -114,23 +238,27 @@ void ymodem_receive_loop(void)
     // 会话层循环
     while (1)
     {
-        rt_ringbuffer_reset(&ymodem_rb);
-        last_read_end_pos =
-            UART_RX_BUF_SIZE - LL_DMA_GetDataLength(DMA1, LL_DMA_STREAM_0);
+        ymodem_ring_sync(&ymodem_ring);
+        ymodem_ring_flush(&ymodem_ring);
 
         // 请求起始包(文件名包)
-        ymodem_putchar(CRC_C);
+        ymodem_putchar(YMODEM_REQUEST);
 
-        if (rb_read_wait(&head, 1, 3000) != 1)
+        if (!ymodem_wait(1, 3000))
             continue;
 
+        head = ymodem_ring_peek(&ymodem_ring, 0);
         if (head == SOH || head == STX)
         {
             // 读取文件名包
             uint32_t d_len = (head == SOH) ? 128 : 1024;
-            if (rb_read_wait(&pkt[1], d_len + 4 - 1, 1000) != (d_len + 3))
+            if (!ymodem_wait(d_len + 5, 1000))
                 continue;
 
+            ymodem_ring_copy(&ymodem_ring, 0, pkt, d_len + 5);
+            ymodem_ring_consume(&ymodem_ring, d_len + 5);
+            pkt[3 + d_len] = '\0';
+
             char f_name[64] = {0};
             strncpy(f_name, (char *)&pkt[3], 63);
 
@@ -143,7 +271,9 @@ void ymodem_receive_loop(void)
             }
 
             uint32_t f_size = atoi((char *)&pkt[3] + strlen(f_name) + 1);
-            LOG_I("receiving file: %s, size: %u", f_name, f_size);
+            const uint32_t window = ymodem_parse_window(pkt, d_len);
+            LOG_I("receiving file: %s, size: %u, window: %u", f_name, f_size,
+                  window);
 
             // 开始接收
             if (ymodem_cb && ymodem_cb->on_begin)
@@ -158,31 +288,58 @@ void ymodem_receive_loop(void)
                 }
             }
 
+#if !YMODEM_STREAM
             ymodem_putchar(ACK);
-            ymodem_putchar(CRC_C); // 准备接收正式数据
+            if (window > 1)
+            {
+                // 确认滑动窗口扩展，发送方按确认的窗口连续发送
+                ymodem_putchar(WND);
+                ymodem_putchar((uint8_t)window);
+            }
+#endif
+            ymodem_putchar(YMODEM_REQUEST); // 准备接收正式数据
 
             // 进入数据接收循环
             uint32_t curr = 0;
             uint8_t seq = 1;
+            const rt_tick_t begin = rt_tick_get();
 
             while (1)
             {
-                if (rb_read_wait(&head, 1, 5000) != 1)
+                if (!ymodem_wait(1, 5000))
                 {
+                    if (ymodem_cancel_overrun())
+                    {
+                        error_occurred = -6;
+                        goto exit_session;
+                    }
                     error_occurred = -2;
                     break;
                 }
 
+                head = ymodem_ring_peek(&ymodem_ring, 0);
+
                 // 只有收到EOT才说明数据传完了
                 if (head == EOT)
                 {
                     LOG_D("first EOT received");
+                    ymodem_ring_consume(&ymodem_ring, 1);
                     ymodem_putchar(NAK);
-                    if (rb_read_wait(&head, 1, 2000) == 1 && head == EOT)
+                    if (ymodem_wait(1, 2000) &&
+                        ymodem_ring_peek(&ymodem_ring, 0) == EOT)
                     {
+                        ymodem_ring_consume(&ymodem_ring, 1);
                         LOG_D("second EOT received");
                         ymodem_putchar(ACK);
-                        LOG_I("file %s received", f_name);
+
+                        // 实测的有效吞吐量，用于比较不同波特率和传输模式
+                        const rt_tick_t ticks = rt_tick_get() - begin;
+                        const uint32_t ms = (ticks * 1000) / RT_TICK_PER_SECOND;
+                        const uint32_t rate =
+                            (ms > 0) ? (uint32_t)((uint64_t)curr * 1000 / ms)
+                                     : 0;
+                        LOG_I("file %s received, %u bytes in %u ms (%u B/s)",
+                              f_name, curr, ms, rate);
                     }
                     break; // 跳出数据循环，回到会话循环去发'C'
                 }
@@ -190,51 +347,78 @@ void ymodem_receive_loop(void)
                 if (head == SOH || head == STX)
                 {
                     uint32_t block_len = (head == SOH) ? 128 : 1024;
-                    if (rb_read_wait(&pkt[1], block_len + 4, 1000) ==
-                        (block_len + 4))
+                    if (ymodem_wait(block_len + 5, 1000) &&
+                        ymodem_check_packet(block_len))
                     {
-                        // 校验SEQ
-                        if (pkt[1] + pkt[2] == 0xFF)
+                        const bool expected =
+                            (ymodem_ring_peek(&ymodem_ring, 1) == seq);
+                        if (expected)
                         {
-                            // 校验CRC
-                            uint16_t c_crc = algo_crc16(&pkt[3], block_len);
-                            uint16_t r_crc =
-                                (uint16_t)(pkt[3 + block_len] << 8) |
-                                pkt[3 + block_len + 1];
+                            uint32_t write_sz = (f_size - curr < block_len)
+                                                    ? (f_size - curr)
+                                                    : block_len;
 
-                            if (c_crc == r_crc)
+                            // 校验通过的数据直接从接收缓冲区交给上层
+                            if (ymodem_cb && ymodem_cb->on_data)
                             {
-                                if (pkt[1] == seq)
+                                const uint8_t *data =
+                                    ymodem_packet_data(write_sz, pkt);
+                                if (ymodem_cb->on_data(data, write_sz, curr) !=
+                                    0)
                                 {
-                                    uint32_t write_sz =
-                                        (f_size - curr < block_len)
-                                            ? (f_size - curr)
-                                            : block_len;
-
-                                    // 处理数据块
-                                    if (ymodem_cb && ymodem_cb->on_data)
-                                    {
-                                        if (ymodem_cb->on_data(
-                                                &pkt[3], write_sz, curr) != 0)
-                                        {
-                                            ymodem_putchar(CAN);
-                                            ymodem_putchar(CAN);
-                                            error_occurred = -3;
-                                            goto exit_session;
-                                        }
-                                    }
-
-                                    curr += write_sz;
-                                    seq++;
+                                    ymodem_putchar(CAN);
+                                    ymodem_putchar(CAN);
+                                    error_occurred = -3;
+                                    goto exit_session;
                                 }
-                                ymodem_putchar(ACK);
-                                continue;
                             }
+
+                            curr += write_sz;
+                            seq++;
+                        }
+#if YMODEM_STREAM
+                        else
+                        {
+                            // 流式传输没有重传，序号不连续说明丢了数据
+                            ymodem_putchar(CAN);
+                            ymodem_putchar(CAN);
+                            error_occurred = -5;
+                            goto exit_session;
                         }
+                        ymodem_ring_consume(&ymodem_ring, block_len + 5);
+#else
+                        ymodem_ring_consume(&ymodem_ring, block_len + 5);
+
+                        // 停等时重复的数据包说明ACK丢失，需要再次应答；
+                        // 窗口内每个ACK对应一个新数据包，重复的只丢弃
+                        if (expected || (window == 1))
+                            ymodem_putchar(ACK);
+#endif
+                        continue;
                     }
-                    ymodem_putchar(NAK); // 校验失败
+
+                    if (ymodem_cancel_overrun())
+                    {
+                        error_occurred = -6;
+                        goto exit_session;
+                    }
+
+#if YMODEM_STREAM
+                    // 流式传输无法重传，校验失败只能取消
+                    ymodem_putchar(CAN);
+                    ymodem_putchar(CAN);
+                    error_occurred = -5;
+                    goto exit_session;
+#else
+                    // 校验失败，丢弃残留数据等待重传
+                    ymodem_purge(window);
+                    ymodem_putchar(NAK);
+                    continue;
+#endif
                 }
 
+                ymodem_ring_consume(&ymodem_ring, 1);
+
                 if (head == CAN)
                 {
                     error_occurred = -4;
@@ -251,16 +435,24 @@ exit_session:
     if (ymodem_cb && ymodem_cb->on_end)
         ymodem_cb->on_end(error_occurred);
 
-    rt_free(pkt);
+    algo_arena_reset(&ymodem_arena);
 }
 
 /**
  * @brief 初始化ymodem。
+ * @return true 初始化成功。
+ * @return false 接收缓冲区无法建立环形视图。
  */
-void ymodem_init(void)
+bool ymodem_init(void)
 {
     rt_sem_init(&uart_rx_sem, "uart_rx_sem", 0, RT_IPC_FLAG_FIFO);
-    rt_ringbuffer_init(&ymodem_rb, rb_mem, YMODEM_RB_SIZE);
+
+    // 按配置重新设置波特率，高波特率下停等应答的开销更明显
+    LL_USART_Disable(UART4);
+    LL_USART_SetBaudRate(
+        UART4, LL_RCC_GetUSARTClockFreq(LL_RCC_USART234578_CLKSOURCE),
+        LL_USART_PRESCALER_DIV1, LL_USART_OVERSAMPLING_16, YMODEM_BAUD_RATE);
+    LL_USART_Enable(UART4);
 
     LL_DMA_ConfigAddresses(
         DMA1, LL_DMA_STREAM_0,
@@ -272,6 +464,14 @@ void ymodem_init(void)
     LL_USART_EnableIT_IDLE(UART4);
     LL_DMA_EnableStream(DMA1, LL_DMA_STREAM_0);
     LL_USART_EnableDMAReq_RX(UART4);
+
+    if (!ymodem_ring_init(&ymodem_ring, uart_rx_buf, UART_RX_BUF_SIZE,
+                          ymodem_dma_counter))
+    {
+        LOG_E("ymodem rx ring init failed");
+        return false;
+    }
+    return true;
 }
 
 /**
@@ -279,6 +479,7 @@ void ymodem_init(void)
  */
 void UART4_IRQHandler(void)
 {
+    monitor_isr_enter(MONITOR_ISR_UART4);
     rt_interrupt_enter();
     if (LL_USART_IsActiveFlag_IDLE(UART4))
     {
@@ -293,14 +494,18 @@ void UART4_IRQHandler(void)
  */
 void DMA1_Stream0_IRQHandler(void)
 {
+    monitor_isr_enter(MONITOR_ISR_UART4);
     rt_interrupt_enter();
+    // 记录dma越过的半满与全满位置，接收线程据此发现整圈覆盖
     if (LL_DMA_IsActiveFlag_HT0(DMA1))
     {
         LL_DMA_ClearFlag_HT0(DMA1);
+        ymodem_ring_dma_half(&ymodem_ring);
     }
     if (LL_DMA_IsActiveFlag_TC0(DMA1))
     {
         LL_DMA_ClearFlag_TC0(DMA1);
+        ymodem_ring_dma_half(&ymodem_ring);
     }
     rt_sem_release(&uart_rx_sem);
     rt_interrupt_leave();
@@ -0,0 +1,119 @@
+#include <string.h>
+#include <ymodem_ring.h>
+
+/**
+ * @brief 计算dma当前写位置。
+ * @param ring 环形视图。
+ * @return uint32_t 写位置。
+ */
+static uint32_t ymodem_ring_write_pos(const ymodem_ring_t *ring)
+{
+    const uint32_t size = ring->rb.buffer_mask + 1;
+    const uint32_t remaining = ring->counter();
+
+    // 计数刚好重装或异常时按缓冲区起点处理
+    if ((remaining == 0) || (remaining > size))
+    {
+        return 0;
+    }
+    return size - remaining;
+}
+
+bool ymodem_ring_init(ymodem_ring_t *ring, const uint8_t *buf, uint32_t size,
+                      ymodem_ring_counter_t counter)
+{
+    // dma只写不读，环形缓冲区只由接收线程消费
+    if (rt_ringbuffer_init(&ring->rb, (uint8_t *)buf, size) != RT_EOK)
+    {
+        return false;
+    }
+    ring->counter = counter;
+    ring->overrun = false;
+
+    // 读写位置都从当前dma位置开始，之前的中断不计
+    ring->halves_synced = ring->halves;
+    const uint32_t pos = ymodem_ring_write_pos(ring);
+    rt_ringbuffer_commit(&ring->rb, pos);
+    rt_ringbuffer_consume(&ring->rb, pos);
+    return true;
+}
+
+uint32_t ymodem_ring_sync(ymodem_ring_t *ring)
+{
+    const uint32_t size = ring->rb.buffer_mask + 1;
+    const uint32_t half = size / 2;
+
+    // 先取中断次数再取写位置，中断晚于写位置到达时次数只会偏少
+    const uint32_t halves = ring->halves;
+    const uint32_t head = ring->rb.write_index & ring->rb.buffer_mask;
+    const uint32_t pos = ymodem_ring_write_pos(ring);
+    const uint32_t len = (pos - head) & ring->rb.buffer_mask;
+
+    // 写位置前进len时越过的半满与全满位置数，多出的中断说明dma多转了整圈
+    ring->halves_synced += (head + len) / half - head / half;
+    const bool lapped = (int32_t)(halves - ring->halves_synced) > 0;
+
+    // 发布dma自上次同步以来写入的数据
+    const uint32_t available = ymodem_ring_available(ring);
+    rt_ringbuffer_commit(&ring->rb, len);
+    if (lapped || (available + len > size))
+    {
+        // 覆盖后的数据无法区分新旧，全部丢弃，由上层按溢出处理
+        ring->halves_synced = halves;
+        ring->overrun = true;
+        rt_ringbuffer_consume(&ring->rb, ymodem_ring_available(ring));
+    }
+    return ymodem_ring_available(ring);
+}
+
+void ymodem_ring_dma_half(ymodem_ring_t *ring)
+{
+    ring->halves++;
+}
+
+bool ymodem_ring_overrun(const ymodem_ring_t *ring)
+{
+    return ring->overrun;
+}
+
+uint32_t ymodem_ring_available(const ymodem_ring_t *ring)
+{
+    return rt_ringbuffer_data_len((struct rt_ringbuffer *)&ring->rb);
+}
+
+uint8_t ymodem_ring_peek(const ymodem_ring_t *ring, uint32_t offset)
+{
+    ymodem_ring_span_t span;
+    rt_ringbuffer_peek((struct rt_ringbuffer *)&ring->rb, offset, 1, &span);
+    return *span.ptr[0];
+}
+
+bool ymodem_ring_span(const ymodem_ring_t *ring, uint32_t offset,
+                      uint32_t len, ymodem_ring_span_t *span)
+{
+    rt_ringbuffer_peek((struct rt_ringbuffer *)&ring->rb, offset, len, span);
+    return span->len[1] == 0;
+}
+
+void ymodem_ring_copy(const ymodem_ring_t *ring, uint32_t offset,
+                      uint8_t *dest, uint32_t len)
+{
+    ymodem_ring_span_t span;
+    ymodem_ring_span(ring, offset, len, &span);
+    memcpy(dest, span.ptr[0], span.len[0]);
+    if (span.len[1] > 0)
+    {
+        memcpy(dest + span.len[0], span.ptr[1], span.len[1]);
+    }
+}
+
+void ymodem_ring_consume(ymodem_ring_t *ring, uint32_t len)
+{
+    rt_ringbuffer_consume(&ring->rb, len);
+}
+
+void ymodem_ring_flush(ymodem_ring_t *ring)
+{
+    rt_ringbuffer_consume(&ring->rb, ymodem_ring_available(ring));
+    ring->overrun = false;
+}
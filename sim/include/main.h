@@ -0,0 +1,137 @@
+/**
+ * @file main.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 主机仿真时代替cubemx生成的main.h，
+ * 只提供被仿真的源文件用到的CMSIS、HAL与LL接口，
+ * 外设访问转到sim目录下的模型。
+ */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief 内核时钟，与目标板的系统时钟一致，DWT周期数按它由虚拟时间换算。
+ */
+#define SIM_CORE_CLOCK (480000000UL)
+
+extern uint32_t SystemCoreClock;
+
+/**
+ * @brief 内核外设，只保留被访问的寄存器。
+ */
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+    volatile uint32_t LAR;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t VTOR;
+} SCB_Type;
+
+extern DWT_Type sim_dwt;
+extern SCB_Type sim_scb;
+
+#define DWT (&sim_dwt)
+#define SCB (&sim_scb)
+
+/**
+ * @brief 全局中断开关，与rt_hw_interrupt_disable共用一个状态。
+ */
+extern uint32_t __get_PRIMASK(void);
+extern void __set_PRIMASK(uint32_t primask);
+extern void __disable_irq(void);
+extern void __enable_irq(void);
+
+#define __DSB() __sync_synchronize()
+#define __ISB() __sync_synchronize()
+#define __CLZ(x) ((uint8_t)(((x) == 0) ? 32 : __builtin_clz(x)))
+
+/**
+ * @brief 仿真中没有真正的栈切换与复位，复位交给测试判断结果。
+ */
+#define __set_MSP(msp) ((void)(msp))
+#define NVIC_SystemReset() sim_system_reset()
+
+extern void sim_system_reset(void) __attribute__((noreturn));
+
+/**
+ * @brief 指示灯。
+ */
+typedef struct {
+    volatile uint32_t ODR;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef sim_gpiob;
+
+#define GPIOB               (&sim_gpiob)
+#define LED_GREEN_Pin       (1U << 1)
+#define LED_GREEN_GPIO_Port GPIOB
+
+#define HAL_GPIO_TogglePin(port, pin) ((port)->ODR ^= (pin))
+
+/**
+ * @brief uart4与dma1 stream0，由sim/source/uart.c中的模型实现。
+ */
+typedef struct sim_usart USART_TypeDef;
+typedef struct sim_dma DMA_TypeDef;
+
+extern USART_TypeDef sim_uart4;
+extern DMA_TypeDef sim_dma1;
+
+#define UART4 (&sim_uart4)
+#define DMA1  (&sim_dma1)
+
+#define LL_DMA_STREAM_0                   (0U)
+#define LL_DMA_DIRECTION_PERIPH_TO_MEMORY (0U)
+#define LL_USART_DMA_REG_DATA_RECEIVE     (0U)
+#define LL_USART_PRESCALER_DIV1           (0U)
+#define LL_USART_OVERSAMPLING_16          (0U)
+#define LL_RCC_USART234578_CLKSOURCE      (0U)
+
+extern uint32_t LL_RCC_GetUSARTClockFreq(uint32_t source);
+extern void LL_USART_Enable(USART_TypeDef *usart);
+extern void LL_USART_Disable(USART_TypeDef *usart);
+extern void LL_USART_SetBaudRate(USART_TypeDef *usart, uint32_t clock,
+                                 uint32_t prescaler, uint32_t oversampling,
+                                 uint32_t baud);
+extern void LL_USART_EnableIT_IDLE(USART_TypeDef *usart);
+extern void LL_USART_EnableDMAReq_RX(USART_TypeDef *usart);
+extern uint32_t LL_USART_IsActiveFlag_IDLE(USART_TypeDef *usart);
+extern void LL_USART_ClearFlag_IDLE(USART_TypeDef *usart);
+extern uint32_t LL_USART_DMA_GetRegAddr(USART_TypeDef *usart, uint32_t reg);
+
+extern void LL_DMA_ConfigAddresses(DMA_TypeDef *dma, uint32_t stream,
+                                   uint32_t src, uint32_t dest,
+                                   uint32_t direction);
+extern void LL_DMA_SetDataLength(DMA_TypeDef *dma, uint32_t stream,
+                                 uint32_t length);
+extern uint32_t LL_DMA_GetDataLength(DMA_TypeDef *dma, uint32_t stream);
+extern void LL_DMA_EnableIT_HT(DMA_TypeDef *dma, uint32_t stream);
+extern void LL_DMA_EnableIT_TC(DMA_TypeDef *dma, uint32_t stream);
+extern void LL_DMA_EnableStream(DMA_TypeDef *dma, uint32_t stream);
+extern uint32_t LL_DMA_IsActiveFlag_HT0(DMA_TypeDef *dma);
+extern uint32_t LL_DMA_IsActiveFlag_TC0(DMA_TypeDef *dma);
+extern void LL_DMA_ClearFlag_HT0(DMA_TypeDef *dma);
+extern void LL_DMA_ClearFlag_TC0(DMA_TypeDef *dma);
+
+/**
+ * @brief 中断处理函数，由模型在虚拟时间到达时调用。
+ */
+extern void UART4_IRQHandler(void);
+extern void DMA1_Stream0_IRQHandler(void);
+
+/**
+ * @brief 主机进程入口，映射flash后启动rtthread，由sim/source/board.c实现。
+ */
+extern int main(void);
+
+#endif
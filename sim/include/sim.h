@@ -0,0 +1,164 @@
+/**
+ * @file sim.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 主机仿真的测试接口。
+ * rtthread内核原样编译，所有线程在一个主机线程中按调度器的决定轮流运行；
+ * 只有全部线程阻塞、空闲线程运行时虚拟时间才前进，
+ * 到期的事件在中断上下文中执行，因此结果与主机速度无关且每次相同。
+ * 线程自身的运算不消耗虚拟时间，测得的耗时只来自串口、flash等外设模型。
+ */
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief 在虚拟时间到达时执行的事件，处理函数运行在中断上下文。
+ */
+typedef struct sim_event {
+    uint64_t at_us;                            //!< 到期时间
+    void (*handler)(struct sim_event *event); //!< 处理函数
+    struct sim_event *next;                    //!< 按到期时间排序的链表
+    bool pending;                              //!< 是否在等待到期
+} sim_event_t;
+
+/**
+ * @brief 返回虚拟时间。
+ * @return uint64_t 自仿真开始以来的微秒数。
+ */
+extern uint64_t sim_time_us(void);
+
+/**
+ * @brief 安排事件在指定时间执行，事件已在等待时改到新的时间。
+ * @param event 事件，调用者须先设置handler。
+ * @param at_us 到期的虚拟时间，早于当前时间时在下一次空闲时执行。
+ */
+extern void sim_event_start(sim_event_t *event, uint64_t at_us);
+
+/**
+ * @brief 取消尚未执行的事件。
+ * @param event 事件。
+ */
+extern void sim_event_stop(sim_event_t *event);
+
+/**
+ * @brief 调度器启动前或关中断轮询时直接推进虚拟时间，
+ * 期间到期的事件推迟到下一次空闲时执行。
+ * @param us 推进的微秒数。
+ */
+extern void sim_time_advance(uint32_t us);
+
+/**
+ * @brief 设置虚拟时间上限，到达时认为测试卡死并以失败退出。
+ * @param us 上限微秒数，默认为SIM_TIME_LIMIT_US。
+ */
+extern void sim_time_limit(uint64_t us);
+
+/**
+ * @brief 设置软件复位时的回调，NVIC_SystemReset在仿真中结束进程。
+ * @param hook 返回进程退出码，为NULL时以0退出。
+ */
+extern void sim_reset_hook(int (*hook)(void));
+
+/**
+ * @brief 结束仿真。
+ * @param status 进程退出码。
+ */
+extern void sim_exit(int status) __attribute__((noreturn));
+
+/**
+ * @brief 是否把控制台输出打印到标准输出，默认打开。
+ * @param on 是否打印。
+ */
+extern void sim_console_echo(bool on);
+
+/**
+ * @brief flash故障注入类型，每次注入只生效一次。
+ */
+typedef enum sim_flash_fault_t {
+    SIM_FLASH_FAULT_PROGRAM = 0, //!< 该flash word编程失败，内容不确定
+    SIM_FLASH_FAULT_ERASE,       //!< 该扇区擦除失败，内容不变
+    SIM_FLASH_FAULT_ECC,         //!< 该flash word出现双位错误，读出两位翻转
+} sim_flash_fault_t;
+
+/**
+ * @brief flash模型的统计。
+ */
+typedef struct sim_flash_stats_t {
+    uint32_t erases;     //!< 擦除的扇区数
+    uint32_t words;      //!< 编程的flash word数
+    uint32_t rewrites;   //!< 编程未擦除flash word的次数，属于驱动或上层错误
+    uint32_t ecc_errors; //!< 注入并生效的双位错误数
+    uint64_t busy_us[2]; //!< 各bank忙碌的累计时间
+} sim_flash_stats_t;
+
+/**
+ * @brief 设置擦除与编程耗时，默认值为SIM_FLASH_ERASE_US与SIM_FLASH_PROGRAM_US。
+ * @param erase_us 单个扇区的擦除时间。
+ * @param program_us 单个flash word的编程时间。
+ */
+extern void sim_flash_latency(uint32_t erase_us, uint32_t program_us);
+
+/**
+ * @brief 注入一次故障。
+ * @param addr flash word或扇区内的任意地址。
+ * @param fault 故障类型，SIM_FLASH_FAULT_ECC对已编程的flash word立即生效。
+ */
+extern void sim_flash_inject(uint32_t addr, sim_flash_fault_t fault);
+
+/**
+ * @brief 像烧录器一样直接写入flash内容，不经过模型也不计入统计。
+ * @param addr 起始地址。
+ * @param data 数据。
+ * @param size 字节数。
+ */
+extern void sim_flash_load(uint32_t addr, const void *data, uint32_t size);
+
+/**
+ * @brief 返回flash模型的统计。
+ * @return const sim_flash_stats_t* 统计。
+ */
+extern const sim_flash_stats_t *sim_flash_stats(void);
+
+/**
+ * @brief 对端收到uart4发出的一个字节时的回调，运行在中断上下文。
+ */
+typedef void (*sim_uart_peer_t)(uint8_t ch);
+
+/**
+ * @brief 设置uart4对端，即串口另一头的主机程序。
+ * @param peer 接收回调。
+ * @param turnaround_us 对端收到数据后到开始回应的延迟，如usb串口的轮询间隔。
+ */
+extern void sim_uart_peer(sim_uart_peer_t peer, uint32_t turnaround_us);
+
+/**
+ * @brief 对端发送数据，按当前波特率逐字节写入dma接收缓冲区。
+ * @param data 数据。
+ * @param size 字节数。
+ */
+extern void sim_uart_send(const void *data, uint32_t size);
+
+/**
+ * @brief 对端尚未发出的字节数。
+ * @return uint32_t 字节数。
+ */
+extern uint32_t sim_uart_pending(void);
+
+/**
+ * @brief 丢弃对端尚未发出的数据。
+ */
+extern void sim_uart_cancel(void);
+
+/**
+ * @brief 返回uart4当前的波特率。
+ * @return uint32_t 波特率。
+ */
+extern uint32_t sim_uart_baud(void);
+
+#endif
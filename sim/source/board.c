@@ -0,0 +1,163 @@
+/**
+ * @file board.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 主机仿真的板级支持，代替libs/rtthread/bsp/source/board.c，
+ * systick为虚拟时间上的周期事件，控制台输出到标准输出。
+ */
+
+#include <board.h>
+#include <launch.h>
+#include <load/load.h>
+#include <rthw.h>
+#include <rtthread.h>
+#include <sim.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <uart.h>
+
+// 配置调试日志
+#define DBG_TAG __FILE_NAME__
+#define DBG_LVL DBG_VERBOSE
+#include <rtdebug.h>
+
+/**
+ * @brief rtthread堆大小，与目标板相近即可。
+ */
+#ifndef SIM_HEAP_SIZE
+#define SIM_HEAP_SIZE (256 * 1024)
+#endif
+
+/**
+ * @brief rtthread堆，-no-pie链接时位于低4G。
+ */
+static uint8_t sim_heap[SIM_HEAP_SIZE] ALIGN(8);
+
+/**
+ * @brief systick周期事件。
+ */
+static sim_event_t sim_systick;
+
+/**
+ * @brief 空闲时跳过的虚拟时间，单位与lptim1相同为微秒。
+ */
+static uint64_t total_sleep_ticks = 0;
+
+/**
+ * @brief 控制台输出是否打印到标准输出。
+ */
+static bool sim_console_on = true;
+
+/**
+ * @brief 软件复位时的回调。
+ */
+static int (*sim_reset)(void) = NULL;
+
+extern void sim_idle_dispatch(void);
+extern void sim_flash_map(void);
+
+/**
+ * @brief 空闲钩子，空闲期间的虚拟时间都计为睡眠。
+ */
+static void idle_hook_sim(void)
+{
+    const uint64_t start = sim_time_us();
+    sim_idle_dispatch();
+    total_sleep_ticks += sim_time_us() - start;
+}
+
+/**
+ * @brief 系统滴答定时器中断处理。
+ * @param event systick事件。
+ */
+static void sim_systick_handler(sim_event_t *event)
+{
+    sim_event_start(event, event->at_us + 1000000 / RT_TICK_PER_SECOND);
+    rt_tick_increase();
+}
+
+uint64_t rt_idle_total_sleep_get(void)
+{
+    return total_sleep_ticks;
+}
+
+void rt_idle_total_sleep_clear(void)
+{
+    total_sleep_ticks = 0;
+}
+
+void rt_hw_us_delay(uint32_t us)
+{
+    sim_time_advance(us);
+}
+
+void rt_hw_console_output(const char *str)
+{
+    if (sim_console_on)
+    {
+        fputs(str, stdout);
+    }
+}
+
+void rt_hw_console_write(const void *buf, size_t size)
+{
+    if (sim_console_on)
+    {
+        fwrite(buf, 1, size, stdout);
+    }
+}
+
+void sim_console_echo(bool on)
+{
+    sim_console_on = on;
+}
+
+void sim_reset_hook(int (*hook)(void))
+{
+    sim_reset = hook;
+}
+
+void sim_exit(int status)
+{
+    fflush(stdout);
+    exit(status);
+}
+
+void sim_system_reset(void)
+{
+    sim_exit((sim_reset != NULL) ? sim_reset() : 0);
+}
+
+void rt_hw_mcu_init(void)
+{
+    LOG_F("mcu reset finish");
+    LOG_V("cpu clock per s: %u", SystemCoreClock);
+
+    rt_system_heap_init(sim_heap, sim_heap + sizeof(sim_heap));
+    LOG_V("heap: [0x%p, 0x%p]", sim_heap, sim_heap + sizeof(sim_heap));
+
+    sim_systick.handler = sim_systick_handler;
+    sim_event_start(&sim_systick, 1000000 / RT_TICK_PER_SECOND);
+
+    rt_thread_idle_sethook(idle_hook_sim);
+    LOG_I("add idle hook: idle_hook_sim");
+}
+
+int main(void)
+{
+    // 控制台按行输出，与测试的断言信息保持先后顺序
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    sim_flash_map();
+
+    // 上电时共享区的启动参数无效，测试可在RUN_PREV_EXPORT中重新设置
+    load_clear_error();
+    load_clear_reset();
+    load_write_config_which(LOAD_APP_INVALID);
+    load_clear_apply();
+    load_clear_patch();
+
+    rtthread_launch();
+    return 1;
+}
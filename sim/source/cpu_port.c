@@ -0,0 +1,397 @@
+/**
+ * @file cpu_port.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief rtthread的主机移植，线程上下文由ucontext实现，
+ * 中断由虚拟时间上的事件模拟，只在空闲线程中分发。
+ */
+
+#include <main.h>
+#include <rthw.h>
+#include <rtthread.h>
+#include <sim.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+/**
+ * @brief 每个线程在主机上使用的栈，线程控制块中的栈只保存上下文指针。
+ * 主机上的库函数比目标板用栈多得多，不能直接运行在rtthread分配的栈上。
+ */
+#ifndef SIM_STACK_SIZE
+#define SIM_STACK_SIZE (256 * 1024)
+#endif
+
+/**
+ * @brief 默认的虚拟时间上限。
+ */
+#ifndef SIM_TIME_LIMIT_US
+#define SIM_TIME_LIMIT_US (600ULL * 1000000)
+#endif
+
+/**
+ * @brief 一个线程的主机上下文。
+ */
+typedef struct sim_context {
+    ucontext_t uc;              //!< 寄存器与栈
+    void *stack;                //!< 主机栈
+    void (*entry)(void *);      //!< 线程入口
+    void *parameter;            //!< 入口参数
+    void (*exit)(void);         //!< 入口返回后调用
+    struct sim_context *next;   //!< 空闲链表
+} sim_context_t;
+
+/**
+ * @brief 已经退出的线程留下的上下文，在下一次创建线程时复用。
+ */
+static sim_context_t *sim_context_free = NULL;
+
+/**
+ * @brief 正在运行的上下文，刚退出的上下文在切走之后才能回收。
+ */
+static sim_context_t *sim_context_current = NULL;
+static sim_context_t *sim_context_dead = NULL;
+
+/**
+ * @brief rtthread_launch所在的主机上下文，调度器启动后不再返回。
+ */
+static ucontext_t sim_main_uc;
+
+/**
+ * @brief 全局中断开关，非0为关闭。
+ */
+static volatile rt_base_t sim_irq_masked = 1;
+
+/**
+ * @brief 中断中请求的线程切换，中断处理结束后执行。
+ */
+static bool sim_switch_pending = false;
+static rt_ubase_t sim_switch_from;
+static rt_ubase_t sim_switch_to;
+
+/**
+ * @brief 虚拟时间与按到期时间排序的事件链表。
+ */
+static uint64_t sim_now_us = 0;
+static uint64_t sim_limit_us = SIM_TIME_LIMIT_US;
+static sim_event_t *sim_events = NULL;
+
+uint32_t SystemCoreClock = SIM_CORE_CLOCK;
+DWT_Type sim_dwt;
+SCB_Type sim_scb;
+GPIO_TypeDef sim_gpiob;
+
+/**
+ * @brief 设置虚拟时间，同时更新DWT周期计数。
+ * @param us 新的虚拟时间。
+ */
+static void sim_time_set(uint64_t us)
+{
+    sim_now_us = us;
+    sim_dwt.CYCCNT = (uint32_t)(us * (SIM_CORE_CLOCK / 1000000));
+    if (sim_now_us > sim_limit_us)
+    {
+        fprintf(stderr, "sim: virtual time limit %llu us reached\n",
+                (unsigned long long)sim_limit_us);
+        sim_exit(2);
+    }
+}
+
+uint64_t sim_time_us(void)
+{
+    return sim_now_us;
+}
+
+void sim_time_advance(uint32_t us)
+{
+    sim_time_set(sim_now_us + us);
+}
+
+void sim_time_limit(uint64_t us)
+{
+    sim_limit_us = us;
+}
+
+void sim_event_stop(sim_event_t *event)
+{
+    if (!event->pending)
+    {
+        return;
+    }
+    for (sim_event_t **link = &sim_events; *link != NULL;
+         link = &(*link)->next)
+    {
+        if (*link == event)
+        {
+            *link = event->next;
+            break;
+        }
+    }
+    event->pending = false;
+}
+
+void sim_event_start(sim_event_t *event, uint64_t at_us)
+{
+    sim_event_stop(event);
+
+    // 同一时间的事件按安排的先后执行
+    sim_event_t **link = &sim_events;
+    while ((*link != NULL) && ((*link)->at_us <= at_us))
+    {
+        link = &(*link)->next;
+    }
+    event->at_us = at_us;
+    event->next = *link;
+    event->pending = true;
+    *link = event;
+}
+
+/**
+ * @brief 执行中断中请求的线程切换。
+ */
+static void sim_switch_deferred(void)
+{
+    if (!sim_switch_pending)
+    {
+        return;
+    }
+    sim_switch_pending = false;
+
+    // 被打断的线程恢复后中断仍是打开的
+    const rt_base_t level = rt_hw_interrupt_disable();
+    rt_hw_context_switch(sim_switch_from, sim_switch_to);
+    rt_hw_interrupt_enable(level);
+}
+
+/**
+ * @brief 空闲钩子，推进到最早的事件并在中断上下文中执行。
+ */
+void sim_idle_dispatch(void)
+{
+    if (sim_events == NULL)
+    {
+        fprintf(stderr, "sim: no pending event, system deadlocked\n");
+        sim_exit(2);
+    }
+
+    sim_event_t *event = sim_events;
+    sim_events = event->next;
+    event->pending = false;
+    if (event->at_us > sim_now_us)
+    {
+        sim_time_set(event->at_us);
+    }
+
+    const rt_base_t level = rt_hw_interrupt_disable();
+    rt_interrupt_enter();
+    rt_hw_interrupt_enable(level);
+    event->handler(event);
+    rt_interrupt_leave();
+
+    sim_switch_deferred();
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return (uint32_t)sim_irq_masked;
+}
+
+void __set_PRIMASK(uint32_t primask)
+{
+    sim_irq_masked = primask;
+}
+
+void __disable_irq(void)
+{
+    sim_irq_masked = 1;
+}
+
+void __enable_irq(void)
+{
+    sim_irq_masked = 0;
+}
+
+rt_base_t rt_hw_interrupt_disable(void)
+{
+    const rt_base_t level = sim_irq_masked;
+    sim_irq_masked = 1;
+    return level;
+}
+
+void rt_hw_interrupt_enable(rt_base_t level)
+{
+    sim_irq_masked = level;
+}
+
+/**
+ * @brief 所有线程的主机入口。
+ */
+static void sim_context_entry(void)
+{
+    sim_context_t *context = sim_context_current;
+
+    // 新线程像从异常返回一样以开中断的状态开始
+    sim_irq_masked = 0;
+    context->entry(context->parameter);
+    sim_context_dead = context;
+    context->exit();
+}
+
+uint8_t *rt_hw_stack_init(void *entry, void *parameter, uint8_t *stack_addr,
+                          void *exit)
+{
+    sim_context_t *context = sim_context_free;
+    if (context != NULL)
+    {
+        sim_context_free = context->next;
+    }
+    else
+    {
+        // 栈放在低4G，地址转为uint32_t后不丢失
+        context = malloc(sizeof(*context));
+        void *stack = mmap(NULL, SIM_STACK_SIZE, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+        if ((context == NULL) || (stack == MAP_FAILED))
+        {
+            fprintf(stderr, "sim: out of memory for thread stack\n");
+            abort();
+        }
+        context->stack = stack;
+    }
+
+    context->entry = (void (*)(void *))entry;
+    context->parameter = parameter;
+    context->exit = (void (*)(void))exit;
+    getcontext(&context->uc);
+    context->uc.uc_stack.ss_sp = context->stack;
+    context->uc.uc_stack.ss_size = SIM_STACK_SIZE;
+    context->uc.uc_link = NULL;
+    makecontext(&context->uc, sim_context_entry, 0);
+
+    // 线程栈顶只保存上下文指针，栈溢出检查看到的栈指针仍在线程栈内
+    uint8_t *sp = (uint8_t *)RT_ALIGN_DOWN(
+        (rt_ubase_t)stack_addr - sizeof(sim_context_t *), sizeof(void *));
+    memcpy(sp, &context, sizeof(context));
+    return sp;
+}
+
+/**
+ * @brief 从线程控制块中保存的栈指针取得上下文。
+ * @param sp 指向线程控制块sp成员的地址。
+ * @return sim_context_t* 上下文。
+ */
+static sim_context_t *sim_context_of(rt_ubase_t sp)
+{
+    sim_context_t *context;
+    memcpy(&context, *(uint8_t **)sp, sizeof(context));
+    return context;
+}
+
+/**
+ * @brief 切换到另一个上下文，回来后回收切走前退出的线程。
+ * @param from 当前上下文，为NULL时从主机主线程切出。
+ * @param to 目标上下文。
+ */
+static void sim_context_switch(sim_context_t *from, sim_context_t *to)
+{
+    sim_context_current = to;
+    if (from == NULL)
+    {
+        swapcontext(&sim_main_uc, &to->uc);
+    }
+    else
+    {
+        swapcontext(&from->uc, &to->uc);
+    }
+
+    if ((sim_context_dead != NULL) && (sim_context_dead != sim_context_current))
+    {
+        sim_context_dead->next = sim_context_free;
+        sim_context_free = sim_context_dead;
+        sim_context_dead = NULL;
+    }
+}
+
+void rt_hw_context_switch_to(rt_ubase_t to)
+{
+    sim_context_switch(NULL, sim_context_of(to));
+}
+
+void rt_hw_context_switch(rt_ubase_t from, rt_ubase_t to)
+{
+    sim_context_t *const from_context = sim_context_of(from);
+    sim_context_t *const to_context = sim_context_of(to);
+    if (from_context != to_context)
+    {
+        sim_context_switch(from_context, to_context);
+    }
+}
+
+void rt_hw_context_switch_interrupt(rt_ubase_t from, rt_ubase_t to)
+{
+    // 与PendSV相同，多次请求时保留最早的来源与最新的目标
+    if (!sim_switch_pending)
+    {
+        sim_switch_pending = true;
+        sim_switch_from = from;
+    }
+    sim_switch_to = to;
+}
+
+void rt_hw_cpu_icache_enable(void)
+{
+}
+
+void rt_hw_cpu_icache_disable(void)
+{
+}
+
+rt_base_t rt_hw_cpu_icache_status(void)
+{
+    return 0;
+}
+
+void rt_hw_cpu_icache_ops(int ops, void *addr, int size)
+{
+    (void)ops;
+    (void)addr;
+    (void)size;
+}
+
+void rt_hw_cpu_dcache_enable(void)
+{
+}
+
+void rt_hw_cpu_dcache_disable(void)
+{
+}
+
+rt_base_t rt_hw_cpu_dcache_status(void)
+{
+    return 0;
+}
+
+void rt_hw_cpu_dcache_ops(int ops, void *addr, int size)
+{
+    (void)ops;
+    (void)addr;
+    (void)size;
+}
+
+void rt_hw_cpu_reset(void)
+{
+    sim_system_reset();
+}
+
+void rt_hw_cpu_shutdown(void)
+{
+    sim_exit(1);
+}
+
+int __rt_ffs(int value)
+{
+    return __builtin_ffs(value);
+}
@@ -0,0 +1,612 @@
+/**
+ * @file flash.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 主机仿真的片内flash模型，在flash.h接口层代替寄存器驱动。
+ * flash映射在与目标板相同的地址，128KiB扇区、32字节flash word，
+ * 按bank排队并计入擦除与编程耗时，支持编程、擦除与双位错误的故障注入。
+ * 与目标板一样，线程中的擦除阻塞等待完成事件，编程轮询完成并直接推进虚拟时间，
+ * 调度器启动前或在中断中调用的擦除同样直接推进虚拟时间。
+ */
+
+#include <flash.h>
+#include <main.h>
+#include <mcu.h>
+#include <rthw.h>
+#include <rtthread.h>
+#include <sim.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/**
+ * @brief 单个扇区的擦除时间，数据手册典型值约1s。
+ */
+#ifndef SIM_FLASH_ERASE_US
+#define SIM_FLASH_ERASE_US (1000000)
+#endif
+
+/**
+ * @brief 单个flash word的编程时间，数据手册典型值约16us。
+ */
+#ifndef SIM_FLASH_PROGRAM_US
+#define SIM_FLASH_PROGRAM_US (16)
+#endif
+
+/**
+ * @brief 同时等待生效的注入故障数量上限。
+ */
+#ifndef SIM_FLASH_FAULTS
+#define SIM_FLASH_FAULTS (8)
+#endif
+
+/**
+ * @brief 单个bank的字节大小。
+ */
+#define SIM_FLASH_BANK_SIZE (MCU_FLASH_BANK_SECTORS * MCU_FLASH_SECTOR_SIZE)
+
+/**
+ * @brief 片内flash的大小与结束地址。
+ */
+#define SIM_FLASH_SIZE (MCU_FLASH_SECTOR_COUNT * MCU_FLASH_SECTOR_SIZE)
+#define SIM_FLASH_END  (MCU_FLASH_START + SIM_FLASH_SIZE)
+
+/**
+ * @brief 与寄存器驱动相同的等待超时。
+ */
+#define SIM_FLASH_TIMEOUT_MS (5000)
+
+/**
+ * @brief bank数量。
+ */
+#define SIM_FLASH_BANKS (MCU_FLASH_SECTOR_COUNT / MCU_FLASH_BANK_SECTORS)
+
+/**
+ * @brief 单个bank的状态，与寄存器驱动的bsp_flash_bank_t对应。
+ */
+typedef struct {
+    struct rt_mutex mutex;     //!< 串行化访问同一bank的线程
+    struct rt_semaphore done;  //!< 每擦除完一个扇区释放
+    sim_event_t event;         //!< 当前扇区的擦除完成事件
+    bool busy;                 //!< 有擦除正等待完成
+    uint32_t erase_sector;     //!< 正在擦除的扇区地址
+    uint32_t erase_next;       //!< 擦除队列中下一个扇区地址
+    uint32_t erase_end;        //!< 擦除队列的结束地址(不含)
+    uint64_t start_us;         //!< 当前操作的开始时间
+    int status;                //!< 最近一次操作的结果
+} sim_flash_bank_t;
+
+/**
+ * @brief 尚未生效的注入故障。
+ */
+typedef struct {
+    uint32_t addr;           //!< flash word或扇区地址，0为空槽位
+    sim_flash_fault_t fault; //!< 故障类型
+} sim_flash_fault_slot_t;
+
+static sim_flash_bank_t sim_flash_banks[SIM_FLASH_BANKS];
+static sim_flash_fault_slot_t sim_flash_faults[SIM_FLASH_FAULTS];
+static sim_flash_stats_t sim_flash_stat;
+static uint32_t sim_flash_erase_us = SIM_FLASH_ERASE_US;
+static uint32_t sim_flash_program_us = SIM_FLASH_PROGRAM_US;
+static bool sim_flash_async = false;
+
+/**
+ * @brief 返回地址所在bank的状态。
+ * @param addr flash地址。
+ * @return sim_flash_bank_t* bank状态。
+ */
+static sim_flash_bank_t *sim_flash_bank(uint32_t addr)
+{
+    return &sim_flash_banks[(addr - MCU_FLASH_START) / SIM_FLASH_BANK_SIZE];
+}
+
+/**
+ * @brief 取出一个落在[addr, addr + size)内的故障。
+ * @param addr 起始地址。
+ * @param size 字节数。
+ * @param fault 故障类型。
+ * @return true 存在该故障，已从表中移除。
+ * @return false 没有该故障。
+ */
+static bool sim_flash_fault_take(uint32_t addr, uint32_t size,
+                                 sim_flash_fault_t fault)
+{
+    for (uint32_t i = 0; i < SIM_FLASH_FAULTS; ++i)
+    {
+        sim_flash_fault_slot_t *slot = &sim_flash_faults[i];
+        if ((slot->addr != 0) && (slot->fault == fault) &&
+            (slot->addr - addr < size))
+        {
+            slot->addr = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 在flash word中翻转两位，模拟无法纠正的双位错误。
+ * @param addr flash word地址。
+ */
+static void sim_flash_flip(uint32_t addr)
+{
+    volatile uint8_t *word = (volatile uint8_t *)addr;
+    word[0] ^= 0x01;
+    word[MCU_FLASH_WORD_SIZE / 2] ^= 0x10;
+    ++sim_flash_stat.ecc_errors;
+}
+
+/**
+ * @brief 擦除单个扇区。
+ * @param addr 扇区地址。
+ * @return int 成功返回BSP_FLASH_OK，注入故障时返回BSP_FLASH_ERROR_ERASE。
+ */
+static int sim_flash_erase_apply(uint32_t addr)
+{
+    ++sim_flash_stat.erases;
+    if (sim_flash_fault_take(addr, MCU_FLASH_SECTOR_SIZE,
+                             SIM_FLASH_FAULT_ERASE))
+    {
+        return BSP_FLASH_ERROR_ERASE;
+    }
+    memset((void *)addr, 0xFF, MCU_FLASH_SECTOR_SIZE);
+    return BSP_FLASH_OK;
+}
+
+/**
+ * @brief 按nor flash的规则编程一个flash word。
+ * @param addr flash word地址。
+ * @param src 一个flash word的数据。
+ * @return int 成功返回BSP_FLASH_OK，失败返回BSP_FLASH_ERROR_PROGRAM。
+ */
+static int sim_flash_program_apply(uint32_t addr, const uint8_t *src)
+{
+    uint8_t *dest = (uint8_t *)addr;
+    int result = BSP_FLASH_OK;
+
+    ++sim_flash_stat.words;
+    for (uint32_t i = 0; i < MCU_FLASH_WORD_SIZE; ++i)
+    {
+        if (dest[i] != 0xFF)
+        {
+            // 未擦除的flash word只能把1写成0，控制器报告编程错误
+            ++sim_flash_stat.rewrites;
+            result = BSP_FLASH_ERROR_PROGRAM;
+            break;
+        }
+    }
+
+    if (sim_flash_fault_take(addr, MCU_FLASH_WORD_SIZE,
+                             SIM_FLASH_FAULT_PROGRAM))
+    {
+        // 编程中断，只写入了前一半
+        for (uint32_t i = 0; i < MCU_FLASH_WORD_SIZE / 2; ++i)
+        {
+            dest[i] &= src[i];
+        }
+        return BSP_FLASH_ERROR_PROGRAM;
+    }
+
+    for (uint32_t i = 0; i < MCU_FLASH_WORD_SIZE; ++i)
+    {
+        dest[i] &= src[i];
+    }
+    if (sim_flash_fault_take(addr, MCU_FLASH_WORD_SIZE, SIM_FLASH_FAULT_ECC))
+    {
+        sim_flash_flip(addr);
+    }
+    return result;
+}
+
+/**
+ * @brief 能否阻塞等待完成事件，与寄存器驱动的判断相同。
+ * @return true 可以阻塞等待。
+ * @return false 只能直接推进虚拟时间。
+ */
+static bool sim_flash_can_wait(void)
+{
+    return sim_flash_async && (rt_thread_self() != NULL) &&
+           (rt_interrupt_get_nest() == 0);
+}
+
+/**
+ * @brief 当前操作结束，擦除队列未空时开始下一个扇区。
+ * @param event bank的完成事件。
+ */
+static void sim_flash_complete(sim_event_t *event)
+{
+    sim_flash_bank_t *state = rt_container_of(event, sim_flash_bank_t, event);
+    const uint32_t bank = (uint32_t)(state - sim_flash_banks);
+
+    sim_flash_stat.busy_us[bank] += sim_time_us() - state->start_us;
+    const int result = sim_flash_erase_apply(state->erase_sector);
+    if (result != BSP_FLASH_OK)
+    {
+        state->status = result;
+        state->erase_next = state->erase_end;
+    }
+
+    if (state->erase_next < state->erase_end)
+    {
+        state->erase_sector = state->erase_next;
+        state->erase_next += MCU_FLASH_SECTOR_SIZE;
+        state->start_us = sim_time_us();
+        sim_event_start(&state->event, state->start_us + sim_flash_erase_us);
+    }
+    else
+    {
+        state->erase_sector = 0;
+        state->erase_next = 0;
+        state->erase_end = 0;
+        state->busy = false;
+    }
+    if (sim_flash_async)
+    {
+        rt_sem_release(&state->done);
+    }
+}
+
+/**
+ * @brief 不能阻塞时把bank上排队的操作立即做完。
+ * @param state bank状态。
+ */
+static void sim_flash_drain(sim_flash_bank_t *state)
+{
+    while (state->busy)
+    {
+        const uint64_t at = state->event.at_us;
+        sim_event_stop(&state->event);
+        if (at > sim_time_us())
+        {
+            sim_time_advance((uint32_t)(at - sim_time_us()));
+        }
+        sim_flash_complete(&state->event);
+    }
+}
+
+/**
+ * @brief 阻塞等待bank上的操作全部完成。
+ * @param state bank状态。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+static int sim_flash_wait_idle(sim_flash_bank_t *state)
+{
+    if (!sim_flash_can_wait())
+    {
+        sim_flash_drain(state);
+    }
+    while (state->busy)
+    {
+        if (rt_sem_take(&state->done,
+                        rt_tick_from_millisecond(SIM_FLASH_TIMEOUT_MS)) !=
+            RT_EOK)
+        {
+            // 与寄存器驱动相同，中止当前操作并丢弃擦除队列
+            sim_event_stop(&state->event);
+            state->erase_sector = 0;
+            state->erase_next = 0;
+            state->erase_end = 0;
+            state->status = BSP_FLASH_ERROR_TIMEOUT;
+            state->busy = false;
+        }
+    }
+
+    // 每个错误只报告给第一个等待者
+    const int result = state->status;
+    state->status = BSP_FLASH_OK;
+    return result;
+}
+
+/**
+ * @brief 开始擦除一个扇区，完成事件在duration_us之后到来。
+ * @param state bank状态，调用者已等待它空闲。
+ * @param duration_us 操作耗时。
+ */
+static void sim_flash_begin(sim_flash_bank_t *state, uint32_t duration_us)
+{
+    if (sim_flash_async)
+    {
+        rt_sem_control(&state->done, RT_IPC_CMD_RESET, NULL);
+    }
+    state->busy = true;
+    state->start_us = sim_time_us();
+    sim_event_start(&state->event, state->start_us + duration_us);
+}
+
+/**
+ * @brief 擦除同一个bank内连续的扇区。
+ * @param addr 起始扇区地址。
+ * @param count 扇区数量。
+ * @param wait 是否等待擦除完成。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+static int sim_flash_erase_bank(uint32_t addr, uint32_t count, bool wait)
+{
+    sim_flash_bank_t *state = sim_flash_bank(addr);
+    const bool can_wait = sim_flash_can_wait();
+
+    if (can_wait)
+    {
+        rt_mutex_take(&state->mutex, RT_WAITING_FOREVER);
+    }
+
+    int result = sim_flash_wait_idle(state);
+    if (result != BSP_FLASH_ERROR_TIMEOUT)
+    {
+        result = BSP_FLASH_OK;
+        state->status = BSP_FLASH_OK;
+        state->erase_sector = addr;
+        state->erase_next = addr + MCU_FLASH_SECTOR_SIZE;
+        state->erase_end = addr + count * MCU_FLASH_SECTOR_SIZE;
+        sim_flash_begin(state, sim_flash_erase_us);
+        if (wait || !can_wait)
+        {
+            result = sim_flash_wait_idle(state);
+        }
+    }
+
+    if (can_wait)
+    {
+        rt_mutex_release(&state->mutex);
+    }
+    return result;
+}
+
+bool bsp_flash_contains(uint32_t addr)
+{
+    return (addr >= MCU_FLASH_START) && (addr < SIM_FLASH_END);
+}
+
+int bsp_flash_erase_sector_by_addr(uint32_t addr)
+{
+    if (!bsp_flash_contains(addr))
+    {
+        return BSP_FLASH_ERROR_PARAM;
+    }
+
+    return sim_flash_erase_bank(addr - (addr - MCU_FLASH_START) %
+                                           MCU_FLASH_SECTOR_SIZE,
+                                1, true);
+}
+
+/**
+ * @brief 擦除覆盖[addr, addr + size)的所有扇区，按bank拆分。
+ * @param addr 起始地址，必须按扇区对齐。
+ * @param size 需要擦除的字节数，向上取整到扇区。
+ * @param wait 是否等待擦除完成。
+ * @return int 成功返回BSP_FLASH_OK，失败返回负数错误码。
+ */
+static int sim_flash_erase_range(uint32_t addr, uint32_t size, bool wait)
+{
+    if (!bsp_flash_contains(addr) ||
+        ((addr - MCU_FLASH_START) % MCU_FLASH_SECTOR_SIZE) != 0)
+    {
+        return BSP_FLASH_ERROR_PARAM;
+    }
+
+    uint32_t count = (size + MCU_FLASH_SECTOR_SIZE - 1) / MCU_FLASH_SECTOR_SIZE;
+    if (count > (SIM_FLASH_END - addr) / MCU_FLASH_SECTOR_SIZE)
+    {
+        return BSP_FLASH_ERROR_PARAM;
+    }
+
+    while (count > 0)
+    {
+        const uint32_t sector =
+            ((addr - MCU_FLASH_START) / MCU_FLASH_SECTOR_SIZE) %
+            MCU_FLASH_BANK_SECTORS;
+        uint32_t number = MCU_FLASH_BANK_SECTORS - sector;
+        if (number > count)
+        {
+            number = count;
+        }
+
+        const int result = sim_flash_erase_bank(addr, number, wait);
+        if (result != BSP_FLASH_OK)
+        {
+            return result;
+        }
+
+        addr += number * MCU_FLASH_SECTOR_SIZE;
+        count -= number;
+    }
+
+    return BSP_FLASH_OK;
+}
+
+int bsp_flash_erase(uint32_t addr, uint32_t size)
+{
+    return sim_flash_erase_range(addr, size, true);
+}
+
+int bsp_flash_erase_start(uint32_t addr, uint32_t size)
+{
+    return sim_flash_erase_range(addr, size, false);
+}
+
+int bsp_flash_wait(uint32_t addr)
+{
+    if (!bsp_flash_contains(addr))
+    {
+        return BSP_FLASH_ERROR_PARAM;
+    }
+
+    sim_flash_bank_t *state = sim_flash_bank(addr);
+    if (!sim_flash_can_wait())
+    {
+        sim_flash_drain(state);
+        return BSP_FLASH_OK;
+    }
+
+    rt_mutex_take(&state->mutex, RT_WAITING_FOREVER);
+    const int result = sim_flash_wait_idle(state);
+    rt_mutex_release(&state->mutex);
+    return result;
+}
+
+bool bsp_flash_is_blank(uint32_t addr, uint32_t size)
+{
+    if (!bsp_flash_contains(addr) || ((addr & 3) != 0) ||
+        (size > SIM_FLASH_END - addr))
+    {
+        return false;
+    }
+
+    const uint8_t *byte = (const uint8_t *)addr;
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        if (byte[i] != 0xFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int bsp_flash_write(uint32_t addr, const uint8_t *data, uint32_t size)
+{
+    if (!bsp_flash_contains(addr) || ((addr & (MCU_FLASH_WORD_SIZE - 1)) != 0) ||
+        (size > SIM_FLASH_END - addr))
+    {
+        return BSP_FLASH_ERROR_PARAM;
+    }
+
+    sim_flash_bank_t *state = sim_flash_bank(addr);
+    const bool can_wait = sim_flash_can_wait();
+
+    if (can_wait)
+    {
+        rt_mutex_take(&state->mutex, RT_WAITING_FOREVER);
+    }
+
+    // 同一bank上可能还有后台擦除，必须等它完成后才能编程
+    int result = sim_flash_wait_idle(state);
+    if (result == BSP_FLASH_OK)
+    {
+        uint32_t words = 0;
+        for (uint32_t offset = 0; offset < size;
+             offset += MCU_FLASH_WORD_SIZE)
+        {
+            uint8_t word[MCU_FLASH_WORD_SIZE];
+            const uint32_t remaining = size - offset;
+            memset(word, 0xFF, sizeof(word));
+            memcpy(word, data + offset,
+                   (remaining < MCU_FLASH_WORD_SIZE) ? remaining
+                                                     : MCU_FLASH_WORD_SIZE);
+
+            ++words;
+            result = sim_flash_program_apply(addr + offset, word);
+            if (result != BSP_FLASH_OK)
+            {
+                break;
+            }
+        }
+
+        // 与寄存器驱动一样轮询编程完成，失败的flash word同样计入耗时
+        const uint32_t duration_us = words * sim_flash_program_us;
+        sim_flash_stat.busy_us[state - sim_flash_banks] += duration_us;
+        sim_time_advance(duration_us);
+    }
+
+    if (can_wait)
+    {
+        rt_mutex_release(&state->mutex);
+    }
+    return result;
+}
+
+void sim_flash_latency(uint32_t erase_us, uint32_t program_us)
+{
+    sim_flash_erase_us = erase_us;
+    sim_flash_program_us = program_us;
+}
+
+void sim_flash_inject(uint32_t addr, sim_flash_fault_t fault)
+{
+    if (!bsp_flash_contains(addr))
+    {
+        return;
+    }
+
+    const uint32_t word = addr & ~(uint32_t)(MCU_FLASH_WORD_SIZE - 1);
+    if ((fault == SIM_FLASH_FAULT_ECC) &&
+        !bsp_flash_is_blank(word, MCU_FLASH_WORD_SIZE))
+    {
+        sim_flash_flip(word);
+        return;
+    }
+
+    for (uint32_t i = 0; i < SIM_FLASH_FAULTS; ++i)
+    {
+        if (sim_flash_faults[i].addr == 0)
+        {
+            // 擦除故障按扇区匹配，其余按flash word匹配
+            sim_flash_faults[i].addr =
+                (fault == SIM_FLASH_FAULT_ERASE)
+                    ? addr - (addr - MCU_FLASH_START) % MCU_FLASH_SECTOR_SIZE
+                    : word;
+            sim_flash_faults[i].fault = fault;
+            return;
+        }
+    }
+    fprintf(stderr, "sim: too many pending flash faults\n");
+    abort();
+}
+
+void sim_flash_load(uint32_t addr, const void *data, uint32_t size)
+{
+    if (!bsp_flash_contains(addr) || (size > SIM_FLASH_END - addr))
+    {
+        fprintf(stderr, "sim: flash load out of range\n");
+        abort();
+    }
+    memcpy((void *)addr, data, size);
+}
+
+const sim_flash_stats_t *sim_flash_stats(void)
+{
+    return &sim_flash_stat;
+}
+
+/**
+ * @brief 在目标板的地址映射flash，内容为擦除状态，须在rtthread启动前调用。
+ */
+void sim_flash_map(void)
+{
+    void *flash = mmap((void *)MCU_FLASH_START, SIM_FLASH_SIZE,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (flash != (void *)MCU_FLASH_START)
+    {
+        fprintf(stderr, "sim: cannot map flash at 0x%08X\n", MCU_FLASH_START);
+        exit(2);
+    }
+    memset(flash, 0xFF, SIM_FLASH_SIZE);
+
+    for (uint32_t i = 0; i < SIM_FLASH_BANKS; ++i)
+    {
+        sim_flash_banks[i].event.handler = sim_flash_complete;
+    }
+}
+
+/**
+ * @brief 初始化阻塞等待所需的内核对象，之后线程中的操作都等待完成事件。
+ * @return int 非0为失败。
+ */
+static int sim_flash_init(void)
+{
+    static const char *const names[SIM_FLASH_BANKS] = {"flash1", "flash2"};
+    for (uint32_t i = 0; i < SIM_FLASH_BANKS; ++i)
+    {
+        rt_mutex_init(&sim_flash_banks[i].mutex, names[i], RT_IPC_FLAG_PRIO);
+        rt_sem_init(&sim_flash_banks[i].done, names[i], 0, RT_IPC_FLAG_FIFO);
+    }
+
+    sim_flash_async = true;
+    return 0;
+}
+RUN_DEVICE_EXPORT(sim_flash_init);
@@ -0,0 +1,425 @@
+/**
+ * @file uart.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 主机仿真的串口模型，代替寄存器驱动与LL库。
+ * uart4按波特率逐字节写入dma1 stream0的循环缓冲区，
+ * 递减剩余计数并产生半满、全满与空闲中断；
+ * 发出的字节在线路时间加对端周转时间之后交给对端回调。
+ * usart1为控制台，直接输出到标准输出。
+ */
+
+#include <main.h>
+#include <rthw.h>
+#include <rtthread.h>
+#include <sim.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <uart.h>
+
+/**
+ * @brief 对端待发送与本端待发出数据的缓冲区大小，必须为2的幂。
+ */
+#ifndef SIM_UART_QUEUE_SIZE
+#define SIM_UART_QUEUE_SIZE (1024 * 64)
+#endif
+
+/**
+ * @brief 每个字节的位数，1起始位、8数据位与1停止位。
+ */
+#define SIM_UART_BITS (10)
+
+/**
+ * @brief uart4的模型状态。
+ */
+struct sim_usart {
+    uint32_t baud;         //!< 波特率
+    bool enabled;          //!< 是否使能
+    bool idle_it;          //!< 是否使能空闲中断
+    bool idle_flag;        //!< 空闲标志
+    bool dma_rx;           //!< 是否使能dma接收请求
+    sim_event_t rx_event;  //!< 下一个接收字节到达
+    sim_event_t idle_event; //!< 线路空闲
+    sim_event_t tx_event;  //!< 下一个发出的字节到达对端
+};
+
+/**
+ * @brief dma1 stream0的模型状态。
+ */
+struct sim_dma {
+    uint8_t *dest;   //!< 循环缓冲区
+    uint32_t length; //!< 缓冲区长度
+    uint32_t ndtr;   //!< 剩余传输计数
+    bool enabled;    //!< 是否使能
+    bool ht_it;      //!< 是否使能半满中断
+    bool tc_it;      //!< 是否使能全满中断
+    bool ht_flag;    //!< 半满标志
+    bool tc_flag;    //!< 全满标志
+};
+
+/**
+ * @brief 字节队列，记录每个字节的到达时间。
+ */
+typedef struct {
+    uint8_t data[SIM_UART_QUEUE_SIZE];
+    uint64_t at_ns[SIM_UART_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+} sim_uart_queue_t;
+
+USART_TypeDef sim_uart4 = {.baud = 115200};
+DMA_TypeDef sim_dma1;
+
+/**
+ * @brief 对端发往uart4的数据，与uart4发往对端的数据。
+ */
+static sim_uart_queue_t sim_uart_rx;
+static sim_uart_queue_t sim_uart_tx;
+
+/**
+ * @brief 两个方向上线路空闲的时间，单位纳秒。
+ */
+static uint64_t sim_uart_rx_free_ns = 0;
+static uint64_t sim_uart_tx_free_ns = 0;
+
+static sim_uart_peer_t sim_uart_peer_rx = NULL;
+static uint32_t sim_uart_turnaround_us = 0;
+
+/**
+ * @brief 单个字节的线路时间。
+ * @return uint64_t 纳秒数。
+ */
+static uint64_t sim_uart_byte_ns(void)
+{
+    return (SIM_UART_BITS * 1000000000ULL + sim_uart4.baud - 1) /
+           sim_uart4.baud;
+}
+
+/**
+ * @brief 纳秒时间向上取整为事件的微秒时间。
+ * @param ns 纳秒时间。
+ * @return uint64_t 微秒时间。
+ */
+static uint64_t sim_uart_us(uint64_t ns)
+{
+    return (ns + 999) / 1000;
+}
+
+static uint32_t sim_uart_queue_count(const sim_uart_queue_t *queue)
+{
+    return queue->tail - queue->head;
+}
+
+/**
+ * @brief 把一个字节放入队列，时间接在线路上一个字节之后。
+ * @param queue 队列。
+ * @param ch 字节。
+ * @param free_ns 线路空闲时间，返回时更新。
+ */
+static void sim_uart_queue_push(sim_uart_queue_t *queue, uint8_t ch,
+                                uint64_t *free_ns)
+{
+    if (sim_uart_queue_count(queue) == SIM_UART_QUEUE_SIZE)
+    {
+        fprintf(stderr, "sim: uart queue overflow\n");
+        abort();
+    }
+
+    const uint64_t now_ns = sim_time_us() * 1000;
+    const uint64_t start_ns = (*free_ns > now_ns) ? *free_ns : now_ns;
+    *free_ns = start_ns + sim_uart_byte_ns();
+
+    const uint32_t index = queue->tail++ & (SIM_UART_QUEUE_SIZE - 1);
+    queue->data[index] = ch;
+    queue->at_ns[index] = *free_ns;
+}
+
+/**
+ * @brief 一个字节到达uart4，由dma写入循环缓冲区。
+ * @param event 接收事件。
+ */
+static void sim_uart_rx_handler(sim_event_t *event)
+{
+    const uint32_t index = sim_uart_rx.head++ & (SIM_UART_QUEUE_SIZE - 1);
+    const uint8_t ch = sim_uart_rx.data[index];
+
+    if (sim_uart4.enabled && sim_uart4.dma_rx && sim_dma1.enabled)
+    {
+        sim_dma1.dest[sim_dma1.length - sim_dma1.ndtr] = ch;
+        bool irq = false;
+        if (--sim_dma1.ndtr == sim_dma1.length / 2)
+        {
+            sim_dma1.ht_flag = true;
+            irq = sim_dma1.ht_it;
+        }
+        else if (sim_dma1.ndtr == 0)
+        {
+            // 循环模式自动重装
+            sim_dma1.ndtr = sim_dma1.length;
+            sim_dma1.tc_flag = true;
+            irq = sim_dma1.tc_it;
+        }
+        if (irq)
+        {
+            DMA1_Stream0_IRQHandler();
+        }
+    }
+
+    if (sim_uart_queue_count(&sim_uart_rx) > 0)
+    {
+        const uint32_t next = sim_uart_rx.head & (SIM_UART_QUEUE_SIZE - 1);
+        sim_event_stop(&sim_uart4.idle_event);
+        sim_event_start(event, sim_uart_us(sim_uart_rx.at_ns[next]));
+    }
+    else
+    {
+        // 停止位之后再过一个字节时间没有新数据即为空闲
+        sim_event_start(&sim_uart4.idle_event,
+                        sim_uart_us(sim_uart_rx_free_ns + sim_uart_byte_ns()));
+    }
+}
+
+/**
+ * @brief uart4接收线路空闲。
+ * @param event 空闲事件。
+ */
+static void sim_uart_idle_handler(sim_event_t *event)
+{
+    (void)event;
+    if (!sim_uart4.enabled)
+    {
+        return;
+    }
+    sim_uart4.idle_flag = true;
+    if (sim_uart4.idle_it)
+    {
+        UART4_IRQHandler();
+    }
+}
+
+/**
+ * @brief uart4发出的一个字节到达对端。
+ * @param event 发送事件。
+ */
+static void sim_uart_tx_handler(sim_event_t *event)
+{
+    const uint32_t index = sim_uart_tx.head++ & (SIM_UART_QUEUE_SIZE - 1);
+    const uint8_t ch = sim_uart_tx.data[index];
+
+    if (sim_uart_queue_count(&sim_uart_tx) > 0)
+    {
+        const uint32_t next = sim_uart_tx.head & (SIM_UART_QUEUE_SIZE - 1);
+        sim_event_start(event, sim_uart_us(sim_uart_tx.at_ns[next]) +
+                                   sim_uart_turnaround_us);
+    }
+
+    if (sim_uart_peer_rx != NULL)
+    {
+        sim_uart_peer_rx(ch);
+    }
+}
+
+size_t bsp_uart_write(bsp_uart_t port, const void *buf, size_t size)
+{
+    if (port == BSP_UART_USART1)
+    {
+        rt_hw_console_write(buf, size);
+        return size;
+    }
+
+    const rt_base_t level = rt_hw_interrupt_disable();
+    const uint8_t *data = buf;
+    for (size_t i = 0; i < size; ++i)
+    {
+        sim_uart_queue_push(&sim_uart_tx, data[i], &sim_uart_tx_free_ns);
+    }
+    if (!sim_uart4.tx_event.pending && (sim_uart_queue_count(&sim_uart_tx) > 0))
+    {
+        const uint32_t next = sim_uart_tx.head & (SIM_UART_QUEUE_SIZE - 1);
+        sim_event_start(&sim_uart4.tx_event,
+                        sim_uart_us(sim_uart_tx.at_ns[next]) +
+                            sim_uart_turnaround_us);
+    }
+    rt_hw_interrupt_enable(level);
+    return size;
+}
+
+void bsp_uart_flush(bsp_uart_t port)
+{
+    if (port == BSP_UART_USART1)
+    {
+        fflush(stdout);
+        return;
+    }
+
+    // 线程中等待线路上的数据全部发出
+    while ((rt_thread_self() != NULL) && (rt_interrupt_get_nest() == 0) &&
+           (sim_uart_tx_free_ns > sim_time_us() * 1000))
+    {
+        rt_thread_mdelay(1);
+    }
+}
+
+void sim_uart_peer(sim_uart_peer_t peer, uint32_t turnaround_us)
+{
+    sim_uart_peer_rx = peer;
+    sim_uart_turnaround_us = turnaround_us;
+}
+
+void sim_uart_send(const void *data, uint32_t size)
+{
+    const rt_base_t level = rt_hw_interrupt_disable();
+    const uint8_t *bytes = data;
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        sim_uart_queue_push(&sim_uart_rx, bytes[i], &sim_uart_rx_free_ns);
+    }
+    if (!sim_uart4.rx_event.pending && (sim_uart_queue_count(&sim_uart_rx) > 0))
+    {
+        const uint32_t next = sim_uart_rx.head & (SIM_UART_QUEUE_SIZE - 1);
+        sim_event_stop(&sim_uart4.idle_event);
+        sim_event_start(&sim_uart4.rx_event,
+                        sim_uart_us(sim_uart_rx.at_ns[next]));
+    }
+    rt_hw_interrupt_enable(level);
+}
+
+uint32_t sim_uart_pending(void)
+{
+    return sim_uart_queue_count(&sim_uart_rx);
+}
+
+void sim_uart_cancel(void)
+{
+    const rt_base_t level = rt_hw_interrupt_disable();
+    sim_uart_rx.head = sim_uart_rx.tail;
+    sim_event_stop(&sim_uart4.rx_event);
+    const uint64_t now_ns = sim_time_us() * 1000;
+    if (sim_uart_rx_free_ns > now_ns)
+    {
+        sim_uart_rx_free_ns = now_ns;
+    }
+    rt_hw_interrupt_enable(level);
+}
+
+uint32_t sim_uart_baud(void)
+{
+    return sim_uart4.baud;
+}
+
+uint32_t LL_RCC_GetUSARTClockFreq(uint32_t source)
+{
+    (void)source;
+    return 100000000UL;
+}
+
+void LL_USART_Enable(USART_TypeDef *usart)
+{
+    usart->rx_event.handler = sim_uart_rx_handler;
+    usart->idle_event.handler = sim_uart_idle_handler;
+    usart->tx_event.handler = sim_uart_tx_handler;
+    usart->enabled = true;
+}
+
+void LL_USART_Disable(USART_TypeDef *usart)
+{
+    usart->enabled = false;
+}
+
+void LL_USART_SetBaudRate(USART_TypeDef *usart, uint32_t clock,
+                          uint32_t prescaler, uint32_t oversampling,
+                          uint32_t baud)
+{
+    (void)clock;
+    (void)prescaler;
+    (void)oversampling;
+    usart->baud = baud;
+}
+
+void LL_USART_EnableIT_IDLE(USART_TypeDef *usart)
+{
+    usart->idle_it = true;
+}
+
+void LL_USART_EnableDMAReq_RX(USART_TypeDef *usart)
+{
+    usart->dma_rx = true;
+}
+
+uint32_t LL_USART_IsActiveFlag_IDLE(USART_TypeDef *usart)
+{
+    return usart->idle_flag;
+}
+
+void LL_USART_ClearFlag_IDLE(USART_TypeDef *usart)
+{
+    usart->idle_flag = false;
+}
+
+uint32_t LL_USART_DMA_GetRegAddr(USART_TypeDef *usart, uint32_t reg)
+{
+    (void)reg;
+    return (uint32_t)(uintptr_t)usart;
+}
+
+void LL_DMA_ConfigAddresses(DMA_TypeDef *dma, uint32_t stream, uint32_t src,
+                            uint32_t dest, uint32_t direction)
+{
+    (void)stream;
+    (void)src;
+    (void)direction;
+    dma->dest = (uint8_t *)(uintptr_t)dest;
+}
+
+void LL_DMA_SetDataLength(DMA_TypeDef *dma, uint32_t stream, uint32_t length)
+{
+    (void)stream;
+    dma->length = length;
+    dma->ndtr = length;
+}
+
+uint32_t LL_DMA_GetDataLength(DMA_TypeDef *dma, uint32_t stream)
+{
+    (void)stream;
+    return dma->ndtr;
+}
+
+void LL_DMA_EnableIT_HT(DMA_TypeDef *dma, uint32_t stream)
+{
+    (void)stream;
+    dma->ht_it = true;
+}
+
+void LL_DMA_EnableIT_TC(DMA_TypeDef *dma, uint32_t stream)
+{
+    (void)stream;
+    dma->tc_it = true;
+}
+
+void LL_DMA_EnableStream(DMA_TypeDef *dma, uint32_t stream)
+{
+    (void)stream;
+    dma->enabled = true;
+}
+
+uint32_t LL_DMA_IsActiveFlag_HT0(DMA_TypeDef *dma)
+{
+    return dma->ht_flag;
+}
+
+uint32_t LL_DMA_IsActiveFlag_TC0(DMA_TypeDef *dma)
+{
+    return dma->tc_flag;
+}
+
+void LL_DMA_ClearFlag_HT0(DMA_TypeDef *dma)
+{
+    dma->ht_flag = false;
+}
+
+void LL_DMA_ClearFlag_TC0(DMA_TypeDef *dma)
+{
+    dma->tc_flag = false;
+}
@@ -0,0 +1,358 @@
+/**
+ * @file patch_builder.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 测试用的detools顺序补丁生成器，格式按detools的apply实现编码。
+ */
+
+#include <patch_builder.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief 每一段diff与extra覆盖的新固件字节数。
+ */
+#define PATCH_BUILDER_SEGMENT (8 * 1024)
+
+/**
+ * @brief crle中按重复字节编码的最短游程。
+ */
+#define PATCH_BUILDER_MIN_RUN (4)
+
+/**
+ * @brief heatshrink匹配时沿哈希链查找的最多位置数。
+ */
+#define PATCH_BUILDER_CHAIN_DEPTH (64)
+
+/**
+ * @brief heatshrink匹配哈希表的位数，按开头3字节散列。
+ */
+#define PATCH_BUILDER_HASH_BITS (16)
+
+/**
+ * @brief 顺序补丁类型。
+ */
+#define PATCH_BUILDER_SEQUENTIAL (0)
+
+/**
+ * @brief 带容量检查的输出缓冲区。
+ */
+typedef struct {
+    uint8_t *data;
+    uint32_t size;
+    uint32_t capacity;
+    bool overflow;
+} patch_builder_buf_t;
+
+static void patch_builder_put(patch_builder_buf_t *buf, const uint8_t *data,
+                              uint32_t size)
+{
+    if (size > buf->capacity - buf->size)
+    {
+        buf->overflow = true;
+        return;
+    }
+    memcpy(&buf->data[buf->size], data, size);
+    buf->size += size;
+}
+
+static void patch_builder_byte(patch_builder_buf_t *buf, uint8_t byte)
+{
+    patch_builder_put(buf, &byte, 1);
+}
+
+/**
+ * @brief 补丁头中的新固件大小，首字节6位，之后每字节7位，最高位为延续标志。
+ */
+static void patch_builder_header_size(patch_builder_buf_t *buf, uint32_t value)
+{
+    uint8_t byte = value & 0x3f;
+    value >>= 6;
+    while (value != 0)
+    {
+        patch_builder_byte(buf, byte | 0x80);
+        byte = value & 0x7f;
+        value >>= 7;
+    }
+    patch_builder_byte(buf, byte);
+}
+
+/**
+ * @brief 补丁数据中的有符号大小，首字节第6位为符号位。
+ */
+static void patch_builder_size(patch_builder_buf_t *buf, int32_t value)
+{
+    uint32_t magnitude = (value < 0) ? (uint32_t)-value : (uint32_t)value;
+    uint8_t byte = (magnitude & 0x3f) | ((value < 0) ? 0x40 : 0);
+    magnitude >>= 6;
+    while (magnitude != 0)
+    {
+        patch_builder_byte(buf, byte | 0x80);
+        byte = magnitude & 0x7f;
+        magnitude >>= 7;
+    }
+    patch_builder_byte(buf, byte);
+}
+
+/**
+ * @brief crle中的无符号大小，每字节7位。
+ */
+static void patch_builder_usize(patch_builder_buf_t *buf, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        patch_builder_byte(buf, (value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    patch_builder_byte(buf, value);
+}
+
+/**
+ * @brief 生成未压缩的补丁数据：diff与extra交替，每段之后旧固件不跳转。
+ */
+static void patch_builder_body(patch_builder_buf_t *buf, const uint8_t *from,
+                               uint32_t from_size, const uint8_t *to,
+                               uint32_t to_size)
+{
+    // 不使用dfpatch
+    patch_builder_size(buf, 0);
+
+    for (uint32_t pos = 0; pos < to_size; pos += PATCH_BUILDER_SEGMENT)
+    {
+        const uint32_t len = (to_size - pos < PATCH_BUILDER_SEGMENT)
+                                 ? (to_size - pos)
+                                 : PATCH_BUILDER_SEGMENT;
+        uint32_t diff = (pos < from_size) ? (from_size - pos) : 0;
+        if (diff > len)
+        {
+            diff = len;
+        }
+
+        patch_builder_size(buf, (int32_t)diff);
+        for (uint32_t i = 0; i < diff; ++i)
+        {
+            patch_builder_byte(buf, (uint8_t)(to[pos + i] - from[pos + i]));
+        }
+        patch_builder_size(buf, (int32_t)(len - diff));
+        patch_builder_put(buf, &to[pos + diff], len - diff);
+        patch_builder_size(buf, 0);
+    }
+}
+
+/**
+ * @brief crle编码，较长的重复字节按游程编码，其余原样存放。
+ */
+static void patch_builder_crle(patch_builder_buf_t *buf, const uint8_t *data,
+                               uint32_t size)
+{
+    uint32_t pos = 0;
+    uint32_t literal = 0;
+
+    while (pos < size)
+    {
+        uint32_t run = 1;
+        while ((pos + run < size) && (data[pos + run] == data[pos]))
+        {
+            ++run;
+        }
+
+        if (run < PATCH_BUILDER_MIN_RUN)
+        {
+            pos += run;
+            continue;
+        }
+
+        if (pos > literal)
+        {
+            patch_builder_byte(buf, 0);
+            patch_builder_usize(buf, pos - literal);
+            patch_builder_put(buf, &data[literal], pos - literal);
+        }
+        patch_builder_byte(buf, 1);
+        patch_builder_usize(buf, run);
+        patch_builder_byte(buf, data[pos]);
+        pos += run;
+        literal = pos;
+    }
+
+    if (size > literal)
+    {
+        patch_builder_byte(buf, 0);
+        patch_builder_usize(buf, size - literal);
+        patch_builder_put(buf, &data[literal], size - literal);
+    }
+}
+
+/**
+ * @brief 按高位在前把若干位写入输出，满8位输出一个字节。
+ */
+typedef struct {
+    patch_builder_buf_t *buf;
+    uint8_t byte;
+    uint8_t bits;
+} patch_builder_bits_t;
+
+static void patch_builder_bits(patch_builder_bits_t *bits, uint32_t value,
+                               uint8_t count)
+{
+    while (count-- > 0)
+    {
+        bits->byte = (uint8_t)((bits->byte << 1) | ((value >> count) & 1));
+        if (++bits->bits == 8)
+        {
+            patch_builder_byte(bits->buf, bits->byte);
+            bits->byte = 0;
+            bits->bits = 0;
+        }
+    }
+}
+
+static uint32_t patch_builder_hash(const uint8_t *data)
+{
+    const uint32_t key = data[0] | (data[1] << 8) | (data[2] << 16);
+    return (key * 2654435761u) >> (32 - PATCH_BUILDER_HASH_BITS);
+}
+
+/**
+ * @brief heatshrink编码，首字节为窗口与前瞻位数，之后为位流：
+ * 字面量为标记位1加8位数据，反向引用为标记位0加window_sz2位的距离减1
+ * 与lookahead_sz2位的长度减1，末尾不足一字节的部分补0。
+ * 按哈希链贪心查找最长匹配，只引用已输出的数据。
+ */
+static void patch_builder_heatshrink(patch_builder_buf_t *buf,
+                                     const uint8_t *data, uint32_t size,
+                                     uint8_t window_sz2, uint8_t lookahead_sz2)
+{
+    const uint32_t window = 1u << window_sz2;
+    const uint32_t lookahead = 1u << lookahead_sz2;
+
+    // 反向引用的位数大于字面量时不划算
+    const uint32_t min_match = (1 + window_sz2 + lookahead_sz2) / 9 + 1;
+
+    int32_t *head = malloc(sizeof(int32_t) << PATCH_BUILDER_HASH_BITS);
+    int32_t *prev = malloc(sizeof(int32_t) * (size + 1));
+    memset(head, 0xff, sizeof(int32_t) << PATCH_BUILDER_HASH_BITS);
+
+    patch_builder_byte(buf, ((window_sz2 - 4) << 4) | (lookahead_sz2 - 3));
+    patch_builder_bits_t bits = {.buf = buf};
+
+    uint32_t pos = 0;
+    while (pos < size)
+    {
+        uint32_t best_len = 0;
+        uint32_t best_dist = 0;
+        uint32_t limit = size - pos;
+        if (limit > lookahead)
+        {
+            limit = lookahead;
+        }
+
+        if (limit >= 3)
+        {
+            int32_t cand = head[patch_builder_hash(&data[pos])];
+            for (uint32_t depth = 0; (cand >= 0) &&
+                                     (pos - (uint32_t)cand <= window) &&
+                                     (depth < PATCH_BUILDER_CHAIN_DEPTH);
+                 ++depth, cand = prev[cand])
+            {
+                uint32_t len = 0;
+                while ((len < limit) && (data[cand + len] == data[pos + len]))
+                {
+                    ++len;
+                }
+                if (len > best_len)
+                {
+                    best_len = len;
+                    best_dist = pos - (uint32_t)cand;
+                }
+            }
+        }
+
+        const uint32_t step = (best_len >= min_match) ? best_len : 1;
+        if (step > 1)
+        {
+            patch_builder_bits(&bits, 0, 1);
+            patch_builder_bits(&bits, best_dist - 1, window_sz2);
+            patch_builder_bits(&bits, best_len - 1, lookahead_sz2);
+        }
+        else
+        {
+            patch_builder_bits(&bits, 0x100 | data[pos], 9);
+        }
+
+        for (uint32_t end = pos + step; pos < end; ++pos)
+        {
+            if (pos + 3 <= size)
+            {
+                const uint32_t hash = patch_builder_hash(&data[pos]);
+                prev[pos] = head[hash];
+                head[hash] = (int32_t)pos;
+            }
+        }
+    }
+
+    if (bits.bits != 0)
+    {
+        patch_builder_bits(&bits, 0, 8 - bits.bits);
+    }
+    free(prev);
+    free(head);
+}
+
+static uint32_t patch_builder_build(const uint8_t *from, uint32_t from_size,
+                                    const uint8_t *to, uint32_t to_size,
+                                    patch_builder_compression_t compression,
+                                    uint8_t window_sz2, uint8_t lookahead_sz2,
+                                    uint8_t *patch, uint32_t capacity)
+{
+    // 未压缩的数据最多为新固件大小加上每段的几个大小字段
+    patch_builder_buf_t body = {
+        .capacity = to_size + (to_size / PATCH_BUILDER_SEGMENT + 2) * 16,
+    };
+    body.data = malloc(body.capacity);
+    patch_builder_body(&body, from, from_size, to, to_size);
+
+    patch_builder_buf_t out = {.data = patch, .capacity = capacity};
+    patch_builder_byte(&out, (PATCH_BUILDER_SEQUENTIAL << 4) | compression);
+    patch_builder_header_size(&out, to_size);
+    if (compression == PATCH_BUILDER_HEATSHRINK)
+    {
+        patch_builder_heatshrink(&out, body.data, body.size, window_sz2,
+                                 lookahead_sz2);
+    }
+    else
+    {
+        patch_builder_crle(&out, body.data, body.size);
+    }
+
+    const bool overflow = body.overflow || out.overflow;
+    free(body.data);
+    return overflow ? 0 : out.size;
+}
+
+uint32_t patch_builder_sequential(const uint8_t *from, uint32_t from_size,
+                                  const uint8_t *to, uint32_t to_size,
+                                  patch_builder_compression_t compression,
+                                  uint8_t *patch, uint32_t capacity)
+{
+    return patch_builder_build(from, from_size, to, to_size, compression,
+                               PATCH_BUILDER_WINDOW_SZ2,
+                               PATCH_BUILDER_LOOKAHEAD_SZ2, patch, capacity);
+}
+
+uint32_t patch_builder_sequential_heatshrink(
+    const uint8_t *from, uint32_t from_size, const uint8_t *to,
+    uint32_t to_size, uint8_t window_sz2, uint8_t lookahead_sz2,
+    uint8_t *patch, uint32_t capacity)
+{
+    if ((window_sz2 < 4) || (window_sz2 > 15) || (lookahead_sz2 < 3) ||
+        (lookahead_sz2 >= window_sz2))
+    {
+        return 0;
+    }
+    return patch_builder_build(from, from_size, to, to_size,
+                               PATCH_BUILDER_HEATSHRINK, window_sz2,
+                               lookahead_sz2, patch, capacity);
+}
@@ -0,0 +1,65 @@
+/**
+ * @file patch_builder.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 测试用的detools顺序补丁生成器，即主机上detools create_patch的简化版，
+ * 按固定长度的段逐段生成diff与extra数据，不做块匹配，
+ * 压缩格式按detools的crle或heatshrink编码，不依赖被测代码。
+ */
+
+#ifndef _PATCH_BUILDER_H_
+#define _PATCH_BUILDER_H_
+
+#include <stdint.h>
+
+/**
+ * @brief 补丁的压缩格式，取值与补丁头中的编码一致。
+ */
+typedef enum {
+    PATCH_BUILDER_CRLE = 2,       //!< 重复字节游程编码
+    PATCH_BUILDER_HEATSHRINK = 4, //!< lzss滑动窗口编码
+} patch_builder_compression_t;
+
+/**
+ * @brief heatshrink默认的窗口与前瞻位数，与detools命令行的默认值一致。
+ */
+#define PATCH_BUILDER_WINDOW_SZ2    (8)
+#define PATCH_BUILDER_LOOKAHEAD_SZ2 (4)
+
+/**
+ * @brief 生成从from到to的顺序补丁。
+ * @param from 旧固件。
+ * @param from_size 旧固件字节数。
+ * @param to 新固件。
+ * @param to_size 新固件字节数。
+ * @param compression 压缩格式，heatshrink使用默认的窗口与前瞻位数。
+ * @param patch 补丁输出缓冲区。
+ * @param capacity 输出缓冲区字节数。
+ * @return uint32_t 补丁字节数，缓冲区不足时返回0。
+ */
+extern uint32_t patch_builder_sequential(const uint8_t *from,
+                                         uint32_t from_size, const uint8_t *to,
+                                         uint32_t to_size,
+                                         patch_builder_compression_t compression,
+                                         uint8_t *patch, uint32_t capacity);
+
+/**
+ * @brief 生成从from到to的heatshrink压缩顺序补丁。
+ * @param from 旧固件。
+ * @param from_size 旧固件字节数。
+ * @param to 新固件。
+ * @param to_size 新固件字节数。
+ * @param window_sz2 窗口位数，4到15。
+ * @param lookahead_sz2 前瞻位数，3到window_sz2-1。
+ * @param patch 补丁输出缓冲区。
+ * @param capacity 输出缓冲区字节数。
+ * @return uint32_t 补丁字节数，缓冲区不足或参数无效时返回0。
+ */
+extern uint32_t patch_builder_sequential_heatshrink(
+    const uint8_t *from, uint32_t from_size, const uint8_t *to,
+    uint32_t to_size, uint8_t window_sz2, uint8_t lookahead_sz2,
+    uint8_t *patch, uint32_t capacity);
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ * @file test_detools_add.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief detools_add_bytes的主机测试，不启动rtthread。
+ * 主机上没有__UADD8，编译的是按字并行的SWAR实现，
+ * 与逐字节相加的结果逐位比较：穷举每个通道上的全部字节对，
+ * 再对各种长度与两端的非对齐地址检查结果与缓冲区边界。
+ */
+
+#include <detools.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief 随机测试的最大长度与每侧的保护字节数。
+ */
+#define TEST_MAX_SIZE (300)
+#define TEST_GUARD    (8)
+
+/*
+ * detools.c中heatshrink解码器的内存分配，本测试不会调用。
+ */
+void *detools_port_codec_alloc(size_t size)
+{
+    return malloc(size);
+}
+
+void detools_port_codec_free(void *ptr)
+{
+    free(ptr);
+}
+
+static uint32_t test_rand(uint32_t *seed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return *seed >> 8;
+}
+
+/**
+ * @brief 穷举全部字节对，每个字节对依次放在字的四个通道上，
+ * 其余通道填入会产生进位的值，检查进位不会越过通道。
+ * @return uint32_t 错误数。
+ */
+static uint32_t test_lanes(void)
+{
+    uint32_t errors = 0;
+    uint8_t to[4];
+    uint8_t from[4];
+
+    for (uint32_t a = 0; a < 256; ++a)
+    {
+        for (uint32_t b = 0; b < 256; ++b)
+        {
+            for (uint32_t lane = 0; lane < 4; ++lane)
+            {
+                memset(to, 0xFF, sizeof(to));
+                memset(from, 0x81, sizeof(from));
+                to[lane] = (uint8_t)a;
+                from[lane] = (uint8_t)b;
+                detools_add_bytes(to, from, sizeof(to));
+
+                for (uint32_t i = 0; i < 4; ++i)
+                {
+                    const uint8_t expect =
+                        (i == lane) ? (uint8_t)(a + b) : (uint8_t)0x80;
+                    if (to[i] != expect)
+                    {
+                        ++errors;
+                    }
+                }
+            }
+        }
+    }
+    return errors;
+}
+
+/**
+ * @brief 随机数据，长度0到TEST_MAX_SIZE，to与from各自有0到3字节的偏移，
+ * 与逐字节相加比较，并检查两侧的保护字节不被改写。
+ * @return uint32_t 错误数。
+ */
+static uint32_t test_random(void)
+{
+    static uint8_t to[TEST_MAX_SIZE + 2 * TEST_GUARD];
+    static uint8_t from[TEST_MAX_SIZE + 2 * TEST_GUARD];
+    static uint8_t expect[TEST_MAX_SIZE + 2 * TEST_GUARD];
+    uint32_t seed = 0x2468;
+    uint32_t errors = 0;
+
+    for (uint32_t size = 0; size <= TEST_MAX_SIZE; ++size)
+    {
+        for (uint32_t shift = 0; shift < 16; ++shift)
+        {
+            const uint32_t to_offset = TEST_GUARD - (shift & 3);
+            const uint32_t from_offset = TEST_GUARD - (shift >> 2);
+
+            for (uint32_t i = 0; i < sizeof(to); ++i)
+            {
+                to[i] = (uint8_t)test_rand(&seed);
+                from[i] = (uint8_t)test_rand(&seed);
+            }
+            memcpy(expect, to, sizeof(to));
+            for (uint32_t i = 0; i < size; ++i)
+            {
+                expect[to_offset + i] =
+                    (uint8_t)(expect[to_offset + i] + from[from_offset + i]);
+            }
+
+            detools_add_bytes(&to[to_offset], &from[from_offset], size);
+            if (memcmp(to, expect, sizeof(to)) != 0)
+            {
+                ++errors;
+            }
+        }
+    }
+    return errors;
+}
+
+int main(void)
+{
+    const uint32_t lane_errors = test_lanes();
+    const uint32_t random_errors = test_random();
+
+    printf("%s: %u lane errors, %u random errors\n",
+           (lane_errors || random_errors) ? "FAIL" : "PASS", lane_errors,
+           random_errors);
+    return (lane_errors || random_errors) ? 1 : 0;
+}
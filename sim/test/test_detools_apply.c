@@ -0,0 +1,162 @@
+/**
+ * @file test_detools_apply.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 端到端测试：oem分区的旧固件加上patch分区的补丁，
+ * 补丁按TEST_COMPRESSION压缩，默认crle，heatshrink时检查点记录不了解压器状态，
+ * 还原照常完成，loader启动时还原到user分区，
+ * 已是新固件的扇区不擦不写，只擦除与新固件不同且不为空的扇区，
+ * 之后的扇区保持原样，
+ * 校验通过后软件复位，复位时检查flash内容、启动参数与flash模型的统计。
+ */
+
+#include <algo/digest.h>
+#include <load/load.h>
+#include <mcu.h>
+#include <patch_builder.h>
+#include <rtthread.h>
+#include <sim.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef TEST_COMPRESSION
+#define TEST_COMPRESSION PATCH_BUILDER_CRLE
+#endif
+
+/**
+ * @brief 旧固件与新固件大小，新固件跨越user分区的四个扇区。
+ */
+#define TEST_OLD_SIZE (300 * 1024 + 45)
+#define TEST_NEW_SIZE (3 * MCU_FLASH_SECTOR_SIZE + 70 * 1024 + 7)
+
+static uint8_t test_old[TEST_OLD_SIZE];
+static uint8_t test_new[TEST_NEW_SIZE];
+static uint8_t test_patch[PATCH_SIZE];
+static uint8_t test_junk[MCU_FLASH_WORD_SIZE];
+
+/**
+ * @brief 生成伪随机数据。
+ */
+static void test_random(uint8_t *data, uint32_t size, uint32_t seed)
+{
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        data[i] = (uint8_t)(seed >> 24);
+    }
+}
+
+/**
+ * @brief 复位时检查还原结果。
+ * @return int 进程退出码。
+ */
+static int test_reset(void)
+{
+    const sim_flash_stats_t *stats = sim_flash_stats();
+    load_which_t which = LOAD_APP_INVALID;
+    int failures = 0;
+
+    if (memcmp((const void *)USER_START, test_new, sizeof(test_new)) != 0)
+    {
+        printf("FAIL: user partition differs from the new image\n");
+        ++failures;
+    }
+    if (!load_read_config_which(&which) || (which != LOAD_APP_USER))
+    {
+        printf("FAIL: boot config which %d\n", which);
+        ++failures;
+    }
+
+    // 第一个扇区已是新固件，第四个扇区原本为空，第五个扇区不在新固件范围内
+    if (stats->erases != 2)
+    {
+        printf("FAIL: %u sectors erased\n", stats->erases);
+        ++failures;
+    }
+    if (memcmp((const void *)(USER_START + 4 * MCU_FLASH_SECTOR_SIZE),
+               test_junk, sizeof(test_junk)) != 0)
+    {
+        printf("FAIL: sector beyond the new image was erased\n");
+        ++failures;
+    }
+    if (stats->rewrites != 0)
+    {
+        printf("FAIL: %u flash words programmed without erase\n",
+               stats->rewrites);
+        ++failures;
+    }
+
+    printf("%s: %u byte image from a %u byte patch, %u sectors erased, "
+           "%u words programmed\n",
+           failures ? "FAIL" : "PASS", (unsigned)sizeof(test_new),
+           load_get_patch_size(), stats->erases, stats->words);
+    return failures ? 1 : 0;
+}
+
+/**
+ * @brief 在boot线程启动前准备分区内容与还原请求。
+ * @return int 非0为失败。
+ */
+static int test_init(void)
+{
+    test_random(test_old, sizeof(test_old), 0x1234);
+
+    // 新固件前半部分只有零星修改，后半部分是全新的数据
+    memcpy(test_new, test_old, sizeof(test_old));
+    for (uint32_t i = 0; i < sizeof(test_old); i += 4099)
+    {
+        test_new[i] ^= 0x5A;
+    }
+    test_random(&test_new[sizeof(test_old)],
+                sizeof(test_new) - sizeof(test_old), 0x5678);
+
+    uint32_t size =
+        (TEST_COMPRESSION == PATCH_BUILDER_HEATSHRINK)
+            ? patch_builder_sequential_heatshrink(
+                  test_old, sizeof(test_old), test_new, sizeof(test_new),
+                  PATCH_BUILDER_WINDOW_SZ2, PATCH_BUILDER_LOOKAHEAD_SZ2,
+                  test_patch, sizeof(test_patch))
+            : patch_builder_sequential(test_old, sizeof(test_old), test_new,
+                                       sizeof(test_new), TEST_COMPRESSION,
+                                       test_patch, sizeof(test_patch));
+    algo_image_trailer_t trailer = {
+        .magic = ALGO_IMAGE_TRAILER_MAGIC,
+        .image_size = sizeof(test_new),
+    };
+    trailer.crc32 = algo_crc32_final(
+        algo_crc32_update(algo_crc32_init(), test_new, sizeof(test_new)));
+    algo_sha256_t sha256;
+    algo_sha256_init(&sha256);
+    algo_sha256_update(&sha256, test_new, sizeof(test_new));
+    algo_sha256_final(&sha256, trailer.sha256);
+    if ((size == 0) || (size + sizeof(trailer) > sizeof(test_patch)))
+    {
+        printf("FAIL: patch does not fit into the patch partition\n");
+        sim_exit(1);
+    }
+    memcpy(&test_patch[size], &trailer, sizeof(trailer));
+    size += sizeof(trailer);
+
+    // 第一个扇区已是新固件，第二、三个扇区与第五个扇区残留旧内容，
+    // 第四个扇区为空
+    memset(test_junk, 0x5A, sizeof(test_junk));
+    sim_flash_load(USER_START, test_new, MCU_FLASH_SECTOR_SIZE);
+    for (uint32_t i = 1; i < 5; ++i)
+    {
+        if (i != 3)
+        {
+            sim_flash_load(USER_START + i * MCU_FLASH_SECTOR_SIZE, test_junk,
+                           sizeof(test_junk));
+        }
+    }
+    sim_flash_load(OEM_START, test_old, sizeof(test_old));
+    sim_flash_load(PATCH_START, test_patch, size);
+
+    load_set_patch_size(size);
+    load_set_apply(LOAD_APPLY_USER);
+    sim_reset_hook(test_reset);
+    return 0;
+}
+RUN_PREV_EXPORT(test_init);
@@ -0,0 +1,179 @@
+/**
+ * @file test_heatshrink.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief heatshrink补丁的往返测试，不启动rtthread，
+ * 用测试内的编码器按多组窗口与前瞻位数生成补丁，
+ * 经detools_apply_patch_callbacks在内存中还原并逐字节比较，
+ * 同时检查解码器占用的内存放得进移植层的解压器内存区。
+ */
+
+#include <detools_port.h>
+#include <patch_builder.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief 旧固件与新固件大小，新固件比旧固件多出一段。
+ */
+#define TEST_OLD_SIZE (96 * 1024 + 13)
+#define TEST_NEW_SIZE (128 * 1024 + 77)
+
+/**
+ * @brief 补丁缓冲区大小，最坏情况每字节9位。
+ */
+#define TEST_PATCH_SIZE (TEST_NEW_SIZE * 2)
+
+/**
+ * @brief 窗口与前瞻位数的组合，覆盖最小值、默认值与最大值，
+ * 以及窗口与前瞻超过8位、需要分两次读取的情况。
+ */
+static const uint8_t test_params[][2] = {
+    {4, 3}, {8, 4}, {9, 8}, {11, 5}, {13, 10}, {15, 4}, {15, 14},
+};
+
+static uint8_t test_old[TEST_OLD_SIZE];
+static uint8_t test_new[TEST_NEW_SIZE];
+static uint8_t test_out[TEST_NEW_SIZE];
+static uint8_t test_patch[TEST_PATCH_SIZE];
+
+/**
+ * @brief 内存中的读写位置。
+ */
+typedef struct {
+    uint32_t from;
+    uint32_t patch;
+    uint32_t patch_size;
+    uint32_t to;
+} test_io_t;
+
+static size_t test_alloc_size;
+
+/*
+ * 移植层的解压器内存分配，这里直接使用系统堆并记录大小。
+ */
+void *detools_port_codec_alloc(size_t size)
+{
+    test_alloc_size = size;
+    return malloc(size);
+}
+
+void detools_port_codec_free(void *ptr)
+{
+    free(ptr);
+}
+
+static int test_from_read(void *arg, uint8_t *buf, size_t size)
+{
+    test_io_t *io = arg;
+    if (size > TEST_OLD_SIZE - io->from)
+    {
+        return -1;
+    }
+    memcpy(buf, &test_old[io->from], size);
+    io->from += size;
+    return 0;
+}
+
+static int test_from_seek(void *arg, int offset)
+{
+    test_io_t *io = arg;
+    io->from += offset;
+    return 0;
+}
+
+static int test_patch_read(void *arg, uint8_t *buf, size_t size)
+{
+    test_io_t *io = arg;
+    if (size > io->patch_size - io->patch)
+    {
+        return -1;
+    }
+    memcpy(buf, &test_patch[io->patch], size);
+    io->patch += size;
+    return 0;
+}
+
+static int test_to_write(void *arg, const uint8_t *buf, size_t size)
+{
+    test_io_t *io = arg;
+    if (size > TEST_NEW_SIZE - io->to)
+    {
+        return -1;
+    }
+    memcpy(&test_out[io->to], buf, size);
+    io->to += size;
+    return 0;
+}
+
+/**
+ * @brief 生成伪随机数据。
+ */
+static void test_random(uint8_t *data, uint32_t size, uint32_t seed)
+{
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        data[i] = (uint8_t)(seed >> 24);
+    }
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    // 旧固件一半随机一半重复的短模式，新固件只有零星修改，末尾是新数据
+    test_random(test_old, TEST_OLD_SIZE / 2, 0x1234);
+    for (uint32_t i = TEST_OLD_SIZE / 2; i < TEST_OLD_SIZE; ++i)
+    {
+        test_old[i] = (uint8_t)((i * 7) % 23);
+    }
+    memcpy(test_new, test_old, TEST_OLD_SIZE);
+    for (uint32_t i = 0; i < TEST_OLD_SIZE; i += 997)
+    {
+        test_new[i] ^= 0xA5;
+    }
+    test_random(&test_new[TEST_OLD_SIZE], TEST_NEW_SIZE - TEST_OLD_SIZE,
+                0x5678);
+
+    for (uint32_t i = 0; i < sizeof(test_params) / sizeof(test_params[0]); ++i)
+    {
+        const uint8_t window_sz2 = test_params[i][0];
+        const uint8_t lookahead_sz2 = test_params[i][1];
+        test_io_t io = {0};
+
+        io.patch_size = patch_builder_sequential_heatshrink(
+            test_old, TEST_OLD_SIZE, test_new, TEST_NEW_SIZE, window_sz2,
+            lookahead_sz2, test_patch, sizeof(test_patch));
+        if (io.patch_size == 0)
+        {
+            printf("FAIL: -w %u -l %u patch does not fit\n", window_sz2,
+                   lookahead_sz2);
+            ++failures;
+            continue;
+        }
+
+        memset(test_out, 0, sizeof(test_out));
+        test_alloc_size = 0;
+        const int res = detools_apply_patch_callbacks(
+            test_from_read, test_from_seek, test_patch_read, io.patch_size,
+            test_to_write, &io);
+
+        const bool ok = (res == TEST_NEW_SIZE) && (io.to == TEST_NEW_SIZE) &&
+                        (memcmp(test_out, test_new, TEST_NEW_SIZE) == 0) &&
+                        (test_alloc_size <= DETOOLS_PORT_CODEC_ARENA_SIZE);
+        printf("%s: -w %u -l %u, %u byte patch, %u bytes decoder, "
+               "apply %d (%s)\n",
+               ok ? "PASS" : "FAIL", window_sz2, lookahead_sz2, io.patch_size,
+               (unsigned)test_alloc_size, res,
+               (res < 0) ? detools_error_as_string(res) : "ok");
+        if (!ok)
+        {
+            ++failures;
+        }
+    }
+    return failures ? 1 : 0;
+}
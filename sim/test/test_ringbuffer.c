@@ -0,0 +1,244 @@
+/**
+ * @file test_ringbuffer.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief rt_ringbuffer_*的单生产者单消费者压力测试，不启动rtthread，
+ * 生产者与消费者是两个真正并行的主机线程，
+ * 交替使用put/get与reserve/commit/peek/consume两组接口，
+ * 读写计数从接近32位上限处开始，覆盖计数回绕与缓冲区末尾的拆分。
+ */
+
+#include <pthread.h>
+#include <rthw.h>
+#include <rtthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @brief 缓冲区大小，取得较小使两个线程频繁在满与空之间切换。
+ */
+#define TEST_POOL_SIZE (64)
+
+/**
+ * @brief 传输的总字节数。
+ */
+#define TEST_TOTAL_BYTES (16u * 1024 * 1024)
+
+/**
+ * @brief 读写计数的初始值，传输过程中越过32位上限。
+ */
+#define TEST_INDEX_START (0xFFFFFFFFu - TEST_TOTAL_BYTES / 2)
+
+static struct rt_ringbuffer test_rb;
+static uint8_t test_pool[TEST_POOL_SIZE];
+static volatile uint32_t test_errors;
+
+/*
+ * object.c中其他对象管理接口依赖的内核函数，本测试不会调用。
+ */
+rt_base_t rt_hw_interrupt_disable(void)
+{
+    return 0;
+}
+
+void rt_hw_interrupt_enable(rt_base_t level)
+{
+}
+
+void rt_enter_critical(void)
+{
+}
+
+void rt_exit_critical(void)
+{
+}
+
+uint8_t rt_interrupt_get_nest(void)
+{
+    return 0;
+}
+
+void *rt_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void rt_free(void *ptr)
+{
+    free(ptr);
+}
+
+int rt_kprintf(const char *fmt, ...)
+{
+    return 0;
+}
+
+void rt_assert_handler(const char *ex, const char *func, size_t line)
+{
+    printf("FAIL: assert %s in %s:%u\n", ex, func, (unsigned)line);
+    exit(1);
+}
+
+/**
+ * @brief 第n个字节的内容，周期与缓冲区大小互质，错位会被发现。
+ */
+static uint8_t test_byte(uint32_t n)
+{
+    return (uint8_t)(n % 251);
+}
+
+/**
+ * @brief 简单的线性同余随机数，每个线程各自一个状态。
+ */
+static uint32_t test_rand(uint32_t *seed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return *seed >> 8;
+}
+
+/**
+ * @brief 生产者，随机长度写入，奇数次用put，偶数次直接填写预留的空间。
+ */
+static void *test_producer(void *arg)
+{
+    uint32_t seed = 1;
+    uint32_t sent = 0;
+    uint8_t chunk[TEST_POOL_SIZE];
+
+    for (uint32_t round = 0; sent < TEST_TOTAL_BYTES; ++round)
+    {
+        uint32_t length = test_rand(&seed) % TEST_POOL_SIZE + 1;
+        if (length > TEST_TOTAL_BYTES - sent)
+        {
+            length = TEST_TOTAL_BYTES - sent;
+        }
+
+        size_t done;
+        if (round & 1)
+        {
+            for (uint32_t i = 0; i < length; ++i)
+            {
+                chunk[i] = test_byte(sent + i);
+            }
+            done = rt_ringbuffer_put(&test_rb, chunk, length);
+        }
+        else
+        {
+            struct rt_ringbuffer_span span;
+            done = rt_ringbuffer_reserve(&test_rb, length, &span);
+            if (span.len[0] + span.len[1] != done)
+            {
+                ++test_errors;
+            }
+            for (uint32_t i = 0; i < span.len[0]; ++i)
+            {
+                span.ptr[0][i] = test_byte(sent + i);
+            }
+            for (uint32_t i = 0; i < span.len[1]; ++i)
+            {
+                span.ptr[1][i] = test_byte(sent + span.len[0] + i);
+            }
+            rt_ringbuffer_commit(&test_rb, done);
+        }
+
+        sent += done;
+        if (done == 0)
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 消费者，随机长度读出并逐字节检查，
+ * 奇数次用get，偶数次在原位检查后归还空间。
+ */
+static void *test_consumer(void *arg)
+{
+    uint32_t seed = 2;
+    uint32_t received = 0;
+    uint8_t chunk[TEST_POOL_SIZE];
+
+    for (uint32_t round = 0; received < TEST_TOTAL_BYTES; ++round)
+    {
+        const uint32_t length = test_rand(&seed) % TEST_POOL_SIZE + 1;
+        const size_t available = rt_ringbuffer_data_len(&test_rb);
+        if (available > TEST_POOL_SIZE)
+        {
+            ++test_errors;
+        }
+
+        size_t done;
+        if (round & 1)
+        {
+            done = rt_ringbuffer_get(&test_rb, chunk, length);
+            for (uint32_t i = 0; i < done; ++i)
+            {
+                if (chunk[i] != test_byte(received + i))
+                {
+                    ++test_errors;
+                }
+            }
+        }
+        else
+        {
+            struct rt_ringbuffer_span span;
+            done = rt_ringbuffer_peek(&test_rb, 0, length, &span);
+            for (uint32_t i = 0; i < span.len[0]; ++i)
+            {
+                if (span.ptr[0][i] != test_byte(received + i))
+                {
+                    ++test_errors;
+                }
+            }
+            for (uint32_t i = 0; i < span.len[1]; ++i)
+            {
+                if (span.ptr[1][i] != test_byte(received + span.len[0] + i))
+                {
+                    ++test_errors;
+                }
+            }
+            rt_ringbuffer_consume(&test_rb, done);
+        }
+
+        received += done;
+        if (done == 0)
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    if ((rt_ringbuffer_init(&test_rb, test_pool, 48) != -RT_EINVAL) ||
+        (rt_ringbuffer_init(&test_rb, test_pool, 0) != -RT_EINVAL) ||
+        (rt_ringbuffer_init(&test_rb, test_pool, sizeof(test_pool)) != RT_EOK))
+    {
+        printf("FAIL: rt_ringbuffer_init size check\n");
+        return 1;
+    }
+    test_rb.read_index = TEST_INDEX_START;
+    test_rb.write_index = TEST_INDEX_START;
+
+    pthread_t producer;
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, test_consumer, NULL);
+    pthread_create(&producer, NULL, test_producer, NULL);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+
+    if (rt_ringbuffer_data_len(&test_rb) != 0)
+    {
+        ++test_errors;
+    }
+    printf("%s: %u bytes through a %u byte ring, %u errors\n",
+           test_errors ? "FAIL" : "PASS", TEST_TOTAL_BYTES, TEST_POOL_SIZE,
+           test_errors);
+    return test_errors ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file test_tickless.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 无节拍空闲节拍补偿模型的主机测试，tickless.h只含整数运算，直接编译。
+ * 虚拟时间t按随机的定时器到期、提前唤醒与唤醒延迟推进一百万次，
+ * 每次补偿之后系统节拍都必须等于t / TICKLESS_TICK_US，
+ * 按预算睡满时恰好在定时器到期的节拍边界醒来。
+ */
+
+#define TICKLESS_TICK_US (1000)
+
+#include <stdio.h>
+#include <tickless.h>
+
+/**
+ * @brief 迭代次数。
+ */
+#define TEST_ITERATIONS (1000000)
+
+/**
+ * @brief 没有定时器时传入的节拍数，即RT_TICK_MAX。
+ */
+#define TEST_TICK_MAX (0xFFFFFFFFu)
+
+static uint32_t test_rand(uint32_t *seed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return *seed >> 8;
+}
+
+/**
+ * @brief 随机的距下一个定时器到期的节拍数，偏向不足TICKLESS_MIN_TICKS的短等待
+ * 与超过单次睡眠上限的长等待。
+ */
+static uint32_t test_ticks(uint32_t *seed)
+{
+    switch (test_rand(seed) % 8)
+    {
+    case 0:
+        return test_rand(seed) % (TICKLESS_MIN_TICKS + 2);
+    case 1:
+        return TEST_TICK_MAX;
+    case 2:
+        return test_rand(seed) % 1000000;
+    default:
+        return test_rand(seed) % 200;
+    }
+}
+
+int main(void)
+{
+    uint32_t seed = 0x5EED;
+    uint64_t t = test_rand(&seed);
+    uint64_t tick = t / TICKLESS_TICK_US;
+    uint32_t errors = 0;
+    uint32_t sleeps = 0;
+
+    for (uint32_t i = 0; i < TEST_ITERATIONS; ++i)
+    {
+        const uint32_t remain = TICKLESS_TICK_US - t % TICKLESS_TICK_US;
+        const uint32_t ticks = test_ticks(&seed);
+        const uint32_t budget = tickless_budget(ticks, remain);
+
+        if (budget == 0)
+        {
+            // 不睡眠时systick照常在下一个节拍边界计数
+            if (ticks >= TICKLESS_MIN_TICKS)
+            {
+                ++errors;
+            }
+            t += remain;
+            ++tick;
+            continue;
+        }
+
+        if ((ticks < TICKLESS_MIN_TICKS) || (budget > TICKLESS_MAX_US))
+        {
+            ++errors;
+        }
+
+        // 未到上限时睡满预算恰好到达定时器到期的节拍边界
+        const uint64_t full =
+            (uint64_t)(ticks - 1) * TICKLESS_TICK_US + remain;
+        if ((full <= TICKLESS_MAX_US) &&
+            ((budget != full) ||
+             ((t + budget) / TICKLESS_TICK_US != tick + ticks) ||
+             ((t + budget) % TICKLESS_TICK_US != 0)))
+        {
+            ++errors;
+        }
+
+        // 多数睡满，部分被其他中断提前唤醒，部分有唤醒延迟
+        uint32_t slept;
+        switch (test_rand(&seed) % 10)
+        {
+        case 0:
+        case 1:
+        case 2:
+            slept = test_rand(&seed) % (budget + 1);
+            break;
+        case 3:
+            slept = budget + test_rand(&seed) % 50;
+            break;
+        default:
+            slept = budget;
+            break;
+        }
+
+        uint32_t next;
+        tick += tickless_compensate(remain, slept, &next);
+        t += slept;
+        ++sleeps;
+
+        if ((tick != t / TICKLESS_TICK_US) ||
+            (next != TICKLESS_TICK_US - t % TICKLESS_TICK_US))
+        {
+            ++errors;
+        }
+    }
+
+    printf("%s: %u iterations, %u sleeps, %llu ticks, %u errors\n",
+           errors ? "FAIL" : "PASS", TEST_ITERATIONS, sleeps,
+           (unsigned long long)tick, errors);
+    return errors ? 1 : 0;
+}
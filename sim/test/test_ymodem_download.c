@@ -0,0 +1,121 @@
+/**
+ * @file test_ymodem_download.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 端到端测试：对端经uart4用ymodem发送带摘要尾部的user.bin，
+ * loader按需擦除残留旧固件的扇区并写入user分区，校验通过后软件复位，
+ * 复位时检查flash内容、启动参数与flash模型的统计。
+ */
+
+#include <algo/digest.h>
+#include <load/load.h>
+#include <mcu.h>
+#include <rtthread.h>
+#include <sim.h>
+#include <stdio.h>
+#include <string.h>
+#include <ymodem_sender.h>
+
+/**
+ * @brief 镜像大小，不是数据包与flash word的整数倍，且跨越多个扇区。
+ */
+#define TEST_IMAGE_SIZE (300 * 1024 + 123)
+
+static uint8_t test_file[TEST_IMAGE_SIZE + sizeof(algo_image_trailer_t)];
+static ymodem_sender_file_t test_files[] = {
+    {.name = "user.bin", .data = test_file, .size = sizeof(test_file)},
+};
+
+/**
+ * @brief 生成伪随机镜像并追加摘要尾部。
+ */
+static void test_image_build(void)
+{
+    uint32_t seed = 0x12345678;
+    for (uint32_t i = 0; i < TEST_IMAGE_SIZE; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        test_file[i] = (uint8_t)(seed >> 24);
+    }
+
+    algo_image_trailer_t trailer = {
+        .magic = ALGO_IMAGE_TRAILER_MAGIC,
+        .image_size = TEST_IMAGE_SIZE,
+    };
+    trailer.crc32 = algo_crc32_final(
+        algo_crc32_update(algo_crc32_init(), test_file, TEST_IMAGE_SIZE));
+    algo_sha256_t sha256;
+    algo_sha256_init(&sha256);
+    algo_sha256_update(&sha256, test_file, TEST_IMAGE_SIZE);
+    algo_sha256_final(&sha256, trailer.sha256);
+    memcpy(&test_file[TEST_IMAGE_SIZE], &trailer, sizeof(trailer));
+}
+
+/**
+ * @brief loader完成下载后软件复位，检查结果。
+ * @return int 进程退出码。
+ */
+static int test_reset(void)
+{
+    const sim_flash_stats_t *stats = sim_flash_stats();
+    load_which_t which = LOAD_APP_INVALID;
+    int failures = 0;
+
+    if (ymodem_sender_state() != YMODEM_SENDER_DONE)
+    {
+        printf("FAIL: sender state %d\n", ymodem_sender_state());
+        ++failures;
+    }
+    if (memcmp((const void *)USER_START, test_file, sizeof(test_file)) != 0)
+    {
+        printf("FAIL: user partition differs from user.bin\n");
+        ++failures;
+    }
+    if (!load_read_config_which(&which) || (which != LOAD_APP_USER))
+    {
+        printf("FAIL: boot config which %d\n", which);
+        ++failures;
+    }
+    if (stats->erases != (sizeof(test_file) + MCU_FLASH_SECTOR_SIZE - 1) /
+                             MCU_FLASH_SECTOR_SIZE)
+    {
+        printf("FAIL: %u sectors erased\n", stats->erases);
+        ++failures;
+    }
+    if (stats->rewrites != 0)
+    {
+        printf("FAIL: %u flash words programmed without erase\n",
+               stats->rewrites);
+        ++failures;
+    }
+
+    printf("%s: %u bytes in %llu us at %u baud, %u sectors erased, "
+           "%u words programmed, %u retries\n",
+           failures ? "FAIL" : "PASS", (unsigned)sizeof(test_file),
+           (unsigned long long)ymodem_sender_elapsed_us(), sim_uart_baud(),
+           stats->erases, stats->words, ymodem_sender_retries());
+    return failures ? 1 : 0;
+}
+
+/**
+ * @brief 启动对端，等待loader请求。
+ * @return int 非0为失败。
+ */
+static int test_init(void)
+{
+    test_image_build();
+
+    // user分区残留旧固件，按需擦除必须擦掉写入范围内的每个扇区
+    static const uint8_t old[MCU_FLASH_WORD_SIZE] = {0x5A};
+    for (uint32_t addr = USER_START; addr < USER_START + USER_SIZE;
+         addr += MCU_FLASH_SECTOR_SIZE / 2)
+    {
+        sim_flash_load(addr, old, sizeof(old));
+    }
+    sim_reset_hook(test_reset);
+    ymodem_sender_start(test_files, 1, 1000, 1);
+    return 0;
+}
+RUN_APP_EXPORT(test_init);
@@ -0,0 +1,385 @@
+/**
+ * @file test_ymodem_ring.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief ymodem_ring原位解析数据帧的主机测试，不启动rtthread。
+ * 模拟的dma按随机长度写入循环缓冲区并递减剩余计数，
+ * 接收方按ymodem.c的方式在环中查看包头、分两段计算crc并取得数据，
+ * 数据帧之间夹有杂散字节，部分数据帧损坏，
+ * 检查所有完好的数据帧按顺序被接受、损坏的全部被拒绝，且有数据帧跨越缓冲区末尾。
+ * 最后dma在两次同步之间写入超过一圈，检查溢出被发现且未读数据全部丢弃。
+ */
+
+#include <algo/algo.h>
+#include <rthw.h>
+#include <rtthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ymodem_ring.h>
+
+#define SOH (0x01)
+#define STX (0x02)
+
+/**
+ * @brief 模拟的dma接收缓冲区大小，与YMODEM_RX_BUF_SIZE的默认值相同。
+ */
+#define TEST_RING_SIZE (4096)
+
+/**
+ * @brief 数据帧数量，每16个中损坏一个。
+ */
+#define TEST_FRAMES (4000)
+
+/**
+ * @brief 线路上全部字节的上限。
+ */
+#define TEST_STREAM_SIZE (TEST_FRAMES * (1024 + 5 + 3))
+
+/**
+ * @brief 线路上的一个数据帧。
+ */
+typedef struct {
+    uint32_t offset;    //!< 在线路数据中的位置
+    uint32_t block_len; //!< 数据长度
+    bool corrupt;       //!< 是否损坏
+} test_frame_t;
+
+static uint8_t test_ring_buf[TEST_RING_SIZE];
+static uint8_t test_stream[TEST_STREAM_SIZE];
+static uint32_t test_stream_size;
+static test_frame_t test_frames[TEST_FRAMES];
+static uint8_t test_scratch[1024];
+static ymodem_ring_t test_ring;
+
+/**
+ * @brief 线路数据开始前dma所在的位置，与之后写入的线路数据字节数。
+ */
+static uint32_t test_dma_start;
+static uint32_t test_dma_written;
+
+/*
+ * object.c中其他对象管理接口依赖的内核函数，本测试不会调用。
+ */
+rt_base_t rt_hw_interrupt_disable(void)
+{
+    return 0;
+}
+
+void rt_hw_interrupt_enable(rt_base_t level)
+{
+}
+
+void rt_enter_critical(void)
+{
+}
+
+void rt_exit_critical(void)
+{
+}
+
+uint8_t rt_interrupt_get_nest(void)
+{
+    return 0;
+}
+
+void *rt_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void rt_free(void *ptr)
+{
+    free(ptr);
+}
+
+int rt_kprintf(const char *fmt, ...)
+{
+    return 0;
+}
+
+void rt_assert_handler(const char *ex, const char *func, size_t line)
+{
+    printf("FAIL: assert %s in %s:%u\n", ex, func, (unsigned)line);
+    exit(1);
+}
+
+static uint32_t test_rand(uint32_t *seed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return *seed >> 8;
+}
+
+/**
+ * @brief 模拟的dma剩余传输计数，循环模式下从缓冲区大小递减，到0时重装。
+ */
+static uint32_t test_dma_counter(void)
+{
+    return TEST_RING_SIZE -
+           ((test_dma_start + test_dma_written) % TEST_RING_SIZE);
+}
+
+/**
+ * @brief dma按顺序写入线路数据，越过半满与全满位置时产生中断。
+ * @param len 写入字节数。
+ */
+static void test_dma_write(uint32_t len)
+{
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        const uint32_t pos =
+            (test_dma_start + test_dma_written) % TEST_RING_SIZE;
+        test_ring_buf[pos] = test_stream[test_dma_written % TEST_STREAM_SIZE];
+        ++test_dma_written;
+        if (((pos + 1) % (TEST_RING_SIZE / 2)) == 0)
+        {
+            ymodem_ring_dma_half(&test_ring);
+        }
+    }
+}
+
+/**
+ * @brief dma写入一段随机长度的数据，不覆盖接收方尚未处理的数据。
+ * @param seed 随机数状态。
+ * @param consumed 接收方已处理的总字节数。
+ */
+static void test_dma_transfer(uint32_t *seed, uint32_t consumed)
+{
+    uint32_t len = test_rand(seed) % 300 + 1;
+    const uint32_t room = TEST_RING_SIZE - 1 - (test_dma_written - consumed);
+    if (len > room)
+    {
+        len = room;
+    }
+    if (len > test_stream_size - test_dma_written)
+    {
+        len = test_stream_size - test_dma_written;
+    }
+    test_dma_write(len);
+}
+
+/**
+ * @brief dma在两次同步之间写入len字节，检查是否报告溢出，
+ * 之后清空并确认恢复正常。
+ * @param len 写入字节数。
+ * @param expect 是否应当溢出。
+ * @return uint32_t 错误数。
+ */
+static uint32_t test_overrun(uint32_t len, bool expect)
+{
+    uint32_t errors = 0;
+    test_dma_write(len);
+    const uint32_t available = ymodem_ring_sync(&test_ring);
+    if (ymodem_ring_overrun(&test_ring) != expect)
+    {
+        printf("FAIL: %u bytes between syncs, overrun %d\n", len, !expect);
+        ++errors;
+    }
+    if (available != (expect ? 0 : len))
+    {
+        printf("FAIL: %u bytes between syncs, %u available\n", len,
+               available);
+        ++errors;
+    }
+
+    ymodem_ring_flush(&test_ring);
+    test_dma_write(100);
+    if ((ymodem_ring_sync(&test_ring) != 100) ||
+        ymodem_ring_overrun(&test_ring))
+    {
+        printf("FAIL: ring not usable after %u bytes overrun\n", len);
+        ++errors;
+    }
+    ymodem_ring_flush(&test_ring);
+    return errors;
+}
+
+/**
+ * @brief 生成线路数据：数据帧之间夹0到3个不是包头的杂散字节。
+ */
+static void test_stream_build(void)
+{
+    uint32_t seed = 0xC0FFEE;
+    uint32_t pos = 0;
+
+    for (uint32_t i = 0; i < TEST_FRAMES; ++i)
+    {
+        for (uint32_t junk = test_rand(&seed) % 4; junk > 0; --junk)
+        {
+            test_stream[pos++] = (uint8_t)(0x80 | test_rand(&seed));
+        }
+
+        test_frame_t *frame = &test_frames[i];
+        frame->offset = pos;
+        frame->block_len = (test_rand(&seed) % 8 == 0) ? 128 : 1024;
+        frame->corrupt = (i % 16 == 15);
+
+        uint8_t *pkt = &test_stream[pos];
+        pkt[0] = (frame->block_len == 128) ? SOH : STX;
+        pkt[1] = (uint8_t)(i + 1);
+        pkt[2] = (uint8_t)~pkt[1];
+        for (uint32_t j = 0; j < frame->block_len; ++j)
+        {
+            pkt[3 + j] = (uint8_t)test_rand(&seed);
+        }
+        const uint16_t crc = algo_crc16(&pkt[3], frame->block_len);
+        pkt[3 + frame->block_len] = (uint8_t)(crc >> 8);
+        pkt[4 + frame->block_len] = (uint8_t)crc;
+        if (frame->corrupt)
+        {
+            pkt[3 + test_rand(&seed) % frame->block_len] ^= 0x10;
+        }
+        pos += frame->block_len + 5;
+    }
+    test_stream_size = pos;
+}
+
+/**
+ * @brief 与ymodem.c相同，在环中分两段计算crc。
+ */
+static uint16_t test_ring_crc16(uint32_t offset, uint32_t len, bool *wrapped)
+{
+    ymodem_ring_span_t span;
+    *wrapped = !ymodem_ring_span(&test_ring, offset, len, &span);
+    uint16_t crc = algo_crc16_init();
+    crc = algo_crc16_update(crc, span.ptr[0], span.len[0]);
+    crc = algo_crc16_update(crc, span.ptr[1], span.len[1]);
+    return algo_crc16_final(crc);
+}
+
+/**
+ * @brief 与ymodem.c相同，检查位于读位置的数据帧的序号与crc。
+ */
+static bool test_check_packet(uint32_t block_len, bool *wrapped)
+{
+    const uint8_t seq = ymodem_ring_peek(&test_ring, 1);
+    const uint8_t inv = ymodem_ring_peek(&test_ring, 2);
+    if ((uint8_t)(seq + inv) != 0xFF)
+    {
+        return false;
+    }
+    const uint16_t crc =
+        (uint16_t)(ymodem_ring_peek(&test_ring, 3 + block_len) << 8) |
+        ymodem_ring_peek(&test_ring, 4 + block_len);
+    return test_ring_crc16(3, block_len, wrapped) == crc;
+}
+
+int main(void)
+{
+    uint32_t seed = 0xBEEF;
+    uint32_t consumed = 0;
+    uint32_t next_frame = 0;
+    uint32_t accepted = 0;
+    uint32_t rejected = 0;
+    uint32_t wrapped_frames = 0;
+    uint32_t errors = 0;
+
+    test_stream_build();
+
+    // dma已经运行了一段，读写位置从缓冲区中间开始
+    test_dma_start = test_rand(&seed) % TEST_RING_SIZE;
+    if (!ymodem_ring_init(&test_ring, test_ring_buf, TEST_RING_SIZE,
+                          test_dma_counter))
+    {
+        printf("FAIL: ymodem_ring_init\n");
+        return 1;
+    }
+
+    while (consumed < test_stream_size)
+    {
+        const uint32_t available = ymodem_ring_sync(&test_ring);
+        if (available == 0)
+        {
+            test_dma_transfer(&seed, consumed);
+            continue;
+        }
+
+        const uint8_t head = ymodem_ring_peek(&test_ring, 0);
+        if ((head != SOH) && (head != STX))
+        {
+            ymodem_ring_consume(&test_ring, 1);
+            ++consumed;
+            continue;
+        }
+
+        const uint32_t block_len = (head == SOH) ? 128 : 1024;
+        if (available < block_len + 5)
+        {
+            test_dma_transfer(&seed, consumed);
+            continue;
+        }
+
+        const test_frame_t *frame =
+            (next_frame < TEST_FRAMES) ? &test_frames[next_frame] : NULL;
+        if ((frame == NULL) || (frame->offset != consumed))
+        {
+            printf("FAIL: frame header at %u is not frame %u\n", consumed,
+                   next_frame);
+            return 1;
+        }
+
+        bool wrapped = false;
+        if (test_check_packet(block_len, &wrapped))
+        {
+            // 数据连续时直接使用环中的地址，跨越末尾时拷贝到暂存区
+            ymodem_ring_span_t span;
+            const uint8_t *data;
+            if (ymodem_ring_span(&test_ring, 3, block_len, &span))
+            {
+                data = span.ptr[0];
+            }
+            else
+            {
+                ymodem_ring_copy(&test_ring, 3, test_scratch, block_len);
+                data = test_scratch;
+            }
+            if (frame->corrupt ||
+                (memcmp(data, &test_stream[consumed + 3], block_len) != 0))
+            {
+                ++errors;
+            }
+            ++accepted;
+        }
+        else
+        {
+            if (!frame->corrupt)
+            {
+                ++errors;
+            }
+            ++rejected;
+        }
+        wrapped_frames += wrapped ? 1 : 0;
+
+        ymodem_ring_consume(&test_ring, block_len + 5);
+        consumed += block_len + 5;
+        ++next_frame;
+    }
+
+    // 正常接收期间中断次数与写位置一致，不应报告溢出
+    if (ymodem_ring_overrun(&test_ring))
+    {
+        printf("FAIL: overrun reported while receiving\n");
+        ++errors;
+    }
+
+    // 未满一圈不算溢出，恰好一圈时写位置不变，只能由中断次数发现
+    errors += test_overrun(TEST_RING_SIZE - 1, false);
+    errors += test_overrun(TEST_RING_SIZE, true);
+    errors += test_overrun(TEST_RING_SIZE + 300, true);
+    errors += test_overrun(3 * TEST_RING_SIZE + 7, true);
+
+    const uint32_t expect_rejected = TEST_FRAMES / 16;
+    if ((accepted != TEST_FRAMES - expect_rejected) ||
+        (rejected != expect_rejected) || (wrapped_frames == 0))
+    {
+        ++errors;
+    }
+
+    printf("%s: %u bytes from dma offset %u, %u frames accepted, "
+           "%u rejected, %u across the ring end, %u errors\n",
+           errors ? "FAIL" : "PASS", test_stream_size, test_dma_start,
+           accepted, rejected, wrapped_frames, errors);
+    return errors ? 1 : 0;
+}
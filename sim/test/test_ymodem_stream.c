@@ -0,0 +1,217 @@
+/**
+ * @file test_ymodem_stream.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief ymodem-g端到端测试：loader以YMODEM_STREAM编译并请求'G'，
+ * 对端不等待应答连续发送带摘要尾部的user.bin，user分区残留旧固件，
+ * 每跨入一个扇区on_data都要等待该扇区擦除完成。
+ * TEST_OVERRUN为0时线路在擦除期间写入的数据装得下接收缓冲区，
+ * 检查下载完成且内容与启动参数正确；
+ * 为1时dma在擦除期间转过整圈，检查loader在擦除结束后立即发现溢出并取消传输，
+ * 不再把覆盖后的数据当作后续数据包写入flash。
+ */
+
+#include <algo/digest.h>
+#include <load/load.h>
+#include <main.h>
+#include <mcu.h>
+#include <rtthread.h>
+#include <sim.h>
+#include <stdio.h>
+#include <string.h>
+#include <ymodem.h>
+#include <ymodem_sender.h>
+
+#ifndef TEST_OVERRUN
+#define TEST_OVERRUN (0)
+#endif
+
+/**
+ * @brief 线路速率，擦除一个扇区期间线路写入的字节数与接收缓冲区相比，
+ * 115200下约11.5K，921600下约92K。
+ */
+#if TEST_OVERRUN
+#define TEST_BAUD_RATE (921600)
+#else
+#define TEST_BAUD_RATE (115200)
+#endif
+
+/**
+ * @brief 镜像大小，跨越多个扇区。
+ */
+#define TEST_IMAGE_SIZE (300 * 1024 + 123)
+
+/**
+ * @brief 取消后检查结果前等待的虚拟时间，让loader处理完会话结束。
+ */
+#define TEST_SETTLE_US (100000)
+
+static uint8_t test_file[TEST_IMAGE_SIZE + sizeof(algo_image_trailer_t)];
+static ymodem_sender_file_t test_files[] = {
+    {.name = "user.bin", .data = test_file, .size = sizeof(test_file)},
+};
+static sim_event_t test_poll_event;
+
+/**
+ * @brief 生成伪随机镜像并追加摘要尾部。
+ */
+static void test_image_build(void)
+{
+    uint32_t seed = 0x2468ACE0;
+    for (uint32_t i = 0; i < TEST_IMAGE_SIZE; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        test_file[i] = (uint8_t)(seed >> 24);
+    }
+
+    algo_image_trailer_t trailer = {
+        .magic = ALGO_IMAGE_TRAILER_MAGIC,
+        .image_size = TEST_IMAGE_SIZE,
+    };
+    trailer.crc32 = algo_crc32_final(
+        algo_crc32_update(algo_crc32_init(), test_file, TEST_IMAGE_SIZE));
+    algo_sha256_t sha256;
+    algo_sha256_init(&sha256);
+    algo_sha256_update(&sha256, test_file, TEST_IMAGE_SIZE);
+    algo_sha256_final(&sha256, trailer.sha256);
+    memcpy(&test_file[TEST_IMAGE_SIZE], &trailer, sizeof(trailer));
+}
+
+/**
+ * @brief loader完成下载后软件复位，检查结果。
+ * @return int 进程退出码。
+ */
+static int test_reset(void)
+{
+    load_which_t which = LOAD_APP_INVALID;
+    int failures = 0;
+
+    if (TEST_OVERRUN)
+    {
+        printf("FAIL: download completed despite rx buffer overrun\n");
+        ++failures;
+    }
+    if (ymodem_sender_state() != YMODEM_SENDER_DONE)
+    {
+        printf("FAIL: sender state %d\n", ymodem_sender_state());
+        ++failures;
+    }
+    if (memcmp((const void *)USER_START, test_file, sizeof(test_file)) != 0)
+    {
+        printf("FAIL: user partition differs from user.bin\n");
+        ++failures;
+    }
+    if (!load_read_config_which(&which) || (which != LOAD_APP_USER))
+    {
+        printf("FAIL: boot config which %d\n", which);
+        ++failures;
+    }
+    if (ymodem_sender_retries() != 0)
+    {
+        printf("FAIL: %u retries\n", ymodem_sender_retries());
+        ++failures;
+    }
+
+    printf("%s: %u bytes streamed in %llu us at %u baud, %u sectors erased\n",
+           failures ? "FAIL" : "PASS", (unsigned)sizeof(test_file),
+           (unsigned long long)ymodem_sender_elapsed_us(), sim_uart_baud(),
+           sim_flash_stats()->erases);
+    return failures ? 1 : 0;
+}
+
+/**
+ * @brief 对端被取消后检查loader在溢出后没有再写入数据，结束仿真。
+ */
+static void test_cancelled(void)
+{
+    // 阻塞的那个数据包在原位置被覆盖，之后的数据包都不能再写入
+    const sim_flash_stats_t *stats = sim_flash_stats();
+    const uint32_t words_limit = 1024 / MCU_FLASH_WORD_SIZE;
+    load_which_t which = LOAD_APP_INVALID;
+    int failures = 0;
+
+    if (!TEST_OVERRUN)
+    {
+        printf("FAIL: transfer cancelled without rx buffer overrun\n");
+        ++failures;
+    }
+    if (stats->words > words_limit)
+    {
+        printf("FAIL: %u flash words programmed after overrun\n",
+               stats->words);
+        ++failures;
+    }
+    if (load_read_config_which(&which) && (which != LOAD_APP_INVALID))
+    {
+        printf("FAIL: boot config which %d after cancel\n", which);
+        ++failures;
+    }
+
+    // 溢出应当在擦除结束后立即发现，而不是等到接收超时
+    const uint64_t limit_us = 2 * (uint64_t)1000000;
+    if (sim_time_us() > limit_us + TEST_SETTLE_US)
+    {
+        printf("FAIL: cancelled only after %llu us\n",
+               (unsigned long long)sim_time_us());
+        ++failures;
+    }
+
+    printf("%s: cancelled by %llu us at %u baud, %u words programmed\n",
+           failures ? "FAIL" : "PASS", (unsigned long long)sim_time_us(),
+           sim_uart_baud(), stats->words);
+    sim_exit(failures ? 1 : 0);
+}
+
+/**
+ * @brief 等待对端被取消，取消后留出时间让loader结束会话。
+ * @param event 轮询事件。
+ */
+static void test_poll(sim_event_t *event)
+{
+    static uint64_t cancelled_us = 0;
+    if (ymodem_sender_state() == YMODEM_SENDER_CANCELLED)
+    {
+        if (cancelled_us == 0)
+        {
+            cancelled_us = sim_time_us();
+        }
+        else if (sim_time_us() - cancelled_us >= TEST_SETTLE_US)
+        {
+            test_cancelled();
+        }
+    }
+    sim_event_start(event, sim_time_us() + TEST_SETTLE_US / 10);
+}
+
+/**
+ * @brief 把线路切换到测试的波特率，启动对端。
+ * @return int 非0为失败。
+ */
+static int test_init(void)
+{
+    test_image_build();
+
+    // user分区残留旧固件，每个扇区都需要擦除
+    static const uint8_t old[MCU_FLASH_WORD_SIZE] = {0x5A};
+    for (uint32_t addr = USER_START; addr < USER_START + USER_SIZE;
+         addr += MCU_FLASH_SECTOR_SIZE / 2)
+    {
+        sim_flash_load(addr, old, sizeof(old));
+    }
+
+    // ymodem_init按YMODEM_BAUD_RATE配置串口，这里改为测试的波特率
+    LL_USART_Disable(UART4);
+    LL_USART_SetBaudRate(
+        UART4, LL_RCC_GetUSARTClockFreq(LL_RCC_USART234578_CLKSOURCE),
+        LL_USART_PRESCALER_DIV1, LL_USART_OVERSAMPLING_16, TEST_BAUD_RATE);
+    LL_USART_Enable(UART4);
+
+    sim_reset_hook(test_reset);
+    test_poll_event.handler = test_poll;
+    sim_event_start(&test_poll_event, sim_time_us());
+    ymodem_sender_start(test_files, 1, 1000, 1);
+    return 0;
+}
+RUN_APP_EXPORT(test_init);
@@ -0,0 +1,147 @@
+/**
+ * @file test_ymodem_throughput.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 回环吞吐量测试：对端按TEST_BAUD_RATE经uart4发送user.bin，
+ * TEST_WINDOW大于1时在文件头中提出滑动窗口，
+ * 复位时按有效数据与线路速率之比计算效率，
+ * 使用滑动窗口时效率不得低于TEST_MIN_PERMILLE。
+ */
+
+#include <algo/digest.h>
+#include <load/load.h>
+#include <main.h>
+#include <mcu.h>
+#include <rtthread.h>
+#include <sim.h>
+#include <stdio.h>
+#include <string.h>
+#include <ymodem.h>
+#include <ymodem_sender.h>
+
+#ifndef TEST_BAUD_RATE
+#define TEST_BAUD_RATE (115200)
+#endif
+
+#ifndef TEST_WINDOW
+#define TEST_WINDOW (1)
+#endif
+
+/**
+ * @brief 使用滑动窗口时效率的下限，单位千分之一，
+ * 每个1K数据包有5字节包头与校验，上限约为995。
+ */
+#define TEST_MIN_PERMILLE (900)
+
+/**
+ * @brief 镜像大小，user分区为空，测得的只有传输与编程的耗时。
+ */
+#define TEST_IMAGE_SIZE (160 * 1024 + 77)
+
+static uint8_t test_file[TEST_IMAGE_SIZE + sizeof(algo_image_trailer_t)];
+static ymodem_sender_file_t test_files[] = {
+    {.name = "user.bin", .data = test_file, .size = sizeof(test_file)},
+};
+
+/**
+ * @brief 生成伪随机镜像并追加摘要尾部。
+ */
+static void test_image_build(void)
+{
+    uint32_t seed = 0x9E3779B9;
+    for (uint32_t i = 0; i < TEST_IMAGE_SIZE; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        test_file[i] = (uint8_t)(seed >> 24);
+    }
+
+    algo_image_trailer_t trailer = {
+        .magic = ALGO_IMAGE_TRAILER_MAGIC,
+        .image_size = TEST_IMAGE_SIZE,
+    };
+    trailer.crc32 = algo_crc32_final(
+        algo_crc32_update(algo_crc32_init(), test_file, TEST_IMAGE_SIZE));
+    algo_sha256_t sha256;
+    algo_sha256_init(&sha256);
+    algo_sha256_update(&sha256, test_file, TEST_IMAGE_SIZE);
+    algo_sha256_final(&sha256, trailer.sha256);
+    memcpy(&test_file[TEST_IMAGE_SIZE], &trailer, sizeof(trailer));
+}
+
+/**
+ * @brief loader完成下载后软件复位，检查结果并计算效率。
+ * @return int 进程退出码。
+ */
+static int test_reset(void)
+{
+    const uint32_t expect_window =
+        (TEST_WINDOW < YMODEM_WINDOW) ? TEST_WINDOW : YMODEM_WINDOW;
+    const uint64_t elapsed_us = ymodem_sender_elapsed_us();
+    int failures = 0;
+
+    if (ymodem_sender_state() != YMODEM_SENDER_DONE)
+    {
+        printf("FAIL: sender state %d\n", ymodem_sender_state());
+        ++failures;
+    }
+    if (memcmp((const void *)USER_START, test_file, sizeof(test_file)) != 0)
+    {
+        printf("FAIL: user partition differs from user.bin\n");
+        ++failures;
+    }
+    if (ymodem_sender_window() != ((expect_window > 1) ? expect_window : 1))
+    {
+        printf("FAIL: window %u\n", ymodem_sender_window());
+        ++failures;
+    }
+    if (ymodem_sender_retries() != 0)
+    {
+        printf("FAIL: %u retries\n", ymodem_sender_retries());
+        ++failures;
+    }
+
+    // 有效数据占线路速率的千分比，每字节10位
+    const uint32_t permille =
+        (elapsed_us > 0) ? (uint32_t)((uint64_t)sizeof(test_file) * 10 *
+                                      1000000 * 1000 /
+                                      (elapsed_us * sim_uart_baud()))
+                         : 0;
+    if ((ymodem_sender_window() > 1) && (permille < TEST_MIN_PERMILLE))
+    {
+        printf("FAIL: efficiency below %u.%u%%\n", TEST_MIN_PERMILLE / 10,
+               TEST_MIN_PERMILLE % 10);
+        ++failures;
+    }
+
+    printf("%s: %u bytes in %llu us at %u baud, window %u, "
+           "%u B/s, %u.%u%% of line rate\n",
+           failures ? "FAIL" : "PASS", (unsigned)sizeof(test_file),
+           (unsigned long long)elapsed_us, sim_uart_baud(),
+           ymodem_sender_window(),
+           (unsigned)((uint64_t)sizeof(test_file) * 1000000 / elapsed_us),
+           permille / 10, permille % 10);
+    return failures ? 1 : 0;
+}
+
+/**
+ * @brief 把线路切换到测试的波特率，启动对端。
+ * @return int 非0为失败。
+ */
+static int test_init(void)
+{
+    test_image_build();
+
+    // ymodem_init按YMODEM_BAUD_RATE配置串口，这里改为测试的波特率
+    LL_USART_Disable(UART4);
+    LL_USART_SetBaudRate(
+        UART4, LL_RCC_GetUSARTClockFreq(LL_RCC_USART234578_CLKSOURCE),
+        LL_USART_PRESCALER_DIV1, LL_USART_OVERSAMPLING_16, TEST_BAUD_RATE);
+    LL_USART_Enable(UART4);
+
+    sim_reset_hook(test_reset);
+    ymodem_sender_start(test_files, 1, 1000, TEST_WINDOW);
+    return 0;
+}
+RUN_APP_EXPORT(test_init);
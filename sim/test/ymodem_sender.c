@@ -0,0 +1,376 @@
+/**
+ * @file ymodem_sender.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 测试用的ymodem发送方，crc16独立实现，不依赖被测代码。
+ */
+
+#include <sim.h>
+#include <stdio.h>
+#include <string.h>
+#include <ymodem_sender.h>
+
+#define SOH   (0x01)
+#define STX   (0x02)
+#define EOT   (0x04)
+#define ACK   (0x06)
+#define NAK   (0x15)
+#define CAN   (0x18)
+#define CRC_C (0x43)
+#define CRC_G (0x47)
+#define WND   (0x57)
+
+/**
+ * @brief 数据包的数据长度与总长度。
+ */
+#define SENDER_HEADER_LEN (128)
+#define SENDER_BLOCK_LEN  (1024)
+#define SENDER_PACKET_LEN (SENDER_BLOCK_LEN + 5)
+
+/**
+ * @brief 发送方状态。
+ */
+typedef enum {
+    SENDER_WAIT_REQUEST = 0, //!< 等待文件头请求
+    SENDER_HEADER,           //!< 文件头已发出
+    SENDER_WAIT_DATA,        //!< 文件头已确认，等待数据请求
+    SENDER_WINDOW,           //!< 等待接收方确认的窗口大小
+    SENDER_DATA,             //!< 按窗口发送数据包，窗口为1即停等
+    SENDER_STREAM,           //!< 流式发送数据包
+    SENDER_EOT1,             //!< 第一个EOT已发出
+    SENDER_EOT2,             //!< 第二个EOT已发出
+    SENDER_FINISH,           //!< 空文件头已发出
+    SENDER_END,              //!< 结束
+} sender_phase_t;
+
+static const ymodem_sender_file_t *sender_files;
+static uint32_t sender_count;
+static uint32_t sender_index;
+static uint32_t sender_block;
+static uint32_t sender_next;
+static uint32_t sender_blocks;
+static uint32_t sender_offer;
+static uint32_t sender_window;
+static uint32_t sender_retry_count;
+static sender_phase_t sender_phase = SENDER_END;
+static ymodem_sender_state_t sender_result = YMODEM_SENDER_BUSY;
+static uint64_t sender_begin_us;
+static uint64_t sender_end_us;
+static sim_event_t sender_stream_event;
+static uint8_t sender_packet[SENDER_PACKET_LEN];
+
+/**
+ * @brief crc16/xmodem，多项式0x1021，初始值0。
+ * @param data 数据。
+ * @param len 字节数。
+ * @return uint16_t crc。
+ */
+static uint16_t sender_crc16(const uint8_t *data, uint32_t len)
+{
+    uint16_t crc = 0;
+    while (len-- > 0)
+    {
+        crc ^= (uint16_t)(*data++ << 8);
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021)
+                                 : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief 组装并发出一个数据包。
+ * @param head SOH或STX。
+ * @param seq 序号。
+ * @param data 数据，不足部分按head填充。
+ * @param len 数据长度。
+ */
+static void sender_packet_send(uint8_t head, uint8_t seq, const uint8_t *data,
+                               uint32_t len)
+{
+    const uint32_t block_len =
+        (head == SOH) ? SENDER_HEADER_LEN : SENDER_BLOCK_LEN;
+
+    sender_packet[0] = head;
+    sender_packet[1] = seq;
+    sender_packet[2] = (uint8_t)~seq;
+    memset(&sender_packet[3], (head == SOH) ? 0x00 : 0x1A, block_len);
+    memcpy(&sender_packet[3], data, len);
+    const uint16_t crc = sender_crc16(&sender_packet[3], block_len);
+    sender_packet[3 + block_len] = (uint8_t)(crc >> 8);
+    sender_packet[4 + block_len] = (uint8_t)crc;
+    sim_uart_send(sender_packet, block_len + 5);
+}
+
+/**
+ * @brief 发出当前文件的文件头，没有剩余文件时发出空文件头。
+ */
+static void sender_header_send(void)
+{
+    uint8_t header[SENDER_HEADER_LEN] = {0};
+    if (sender_index < sender_count)
+    {
+        const ymodem_sender_file_t *file = &sender_files[sender_index];
+        const int len = snprintf((char *)header, sizeof(header), "%s",
+                                 file->name);
+        const int info = snprintf((char *)header + len + 1,
+                                  sizeof(header) - len - 1, "%u",
+                                  (unsigned)file->size);
+
+        // 滑动窗口扩展放在文件信息之后，不支持的接收方不会读到
+        if (sender_offer > 1)
+        {
+            snprintf((char *)header + len + info + 2,
+                     sizeof(header) - len - info - 2, "W%u",
+                     (unsigned)sender_offer);
+        }
+    }
+    sender_packet_send(SOH, 0, header, sizeof(header));
+}
+
+/**
+ * @brief 发出当前文件的一个数据包。
+ * @param block 数据包在文件中的序号，从0开始。
+ */
+static void sender_block_send(uint32_t block)
+{
+    const ymodem_sender_file_t *file = &sender_files[sender_index];
+    const uint32_t offset = block * SENDER_BLOCK_LEN;
+    const uint32_t remain = file->size - offset;
+    sender_packet_send(STX, (uint8_t)(block + 1), file->data + offset,
+                       (remain < SENDER_BLOCK_LEN) ? remain : SENDER_BLOCK_LEN);
+}
+
+/**
+ * @brief 在窗口允许的范围内发出尚未发出的数据包，
+ * sender_block为最早未确认的数据包，sender_next为下一个待发出的数据包。
+ */
+static void sender_window_fill(void)
+{
+    while ((sender_next < sender_blocks) &&
+           (sender_next - sender_block < sender_window))
+    {
+        sender_block_send(sender_next);
+        ++sender_next;
+    }
+}
+
+/**
+ * @brief 开始发送当前文件的数据。
+ * @param stream 是否流式发送。
+ */
+static void sender_data_begin(bool stream)
+{
+    const ymodem_sender_file_t *file = &sender_files[sender_index];
+    sender_block = 0;
+    sender_next = 0;
+    sender_blocks = (file->size + SENDER_BLOCK_LEN - 1) / SENDER_BLOCK_LEN;
+    if ((sender_index == 0) && (sender_begin_us == 0))
+    {
+        sender_begin_us = sim_time_us();
+    }
+
+    if (sender_blocks == 0)
+    {
+        sim_uart_send((const uint8_t[]){EOT}, 1);
+        sender_phase = SENDER_EOT1;
+    }
+    else if (stream)
+    {
+        sender_phase = SENDER_STREAM;
+        sim_event_start(&sender_stream_event, sim_time_us());
+    }
+    else
+    {
+        sender_phase = SENDER_DATA;
+        sender_window_fill();
+    }
+}
+
+/**
+ * @brief 流式发送时保持线路上始终有待发数据，不等待应答。
+ * @param event 发送事件。
+ */
+static void sender_stream_handler(sim_event_t *event)
+{
+    if (sender_phase != SENDER_STREAM)
+    {
+        return;
+    }
+
+    while ((sim_uart_pending() < 2 * SENDER_PACKET_LEN) &&
+           (sender_block < sender_blocks))
+    {
+        sender_block_send(sender_block);
+        ++sender_block;
+    }
+
+    if (sender_block < sender_blocks)
+    {
+        // 半个数据包的线路时间后再补充
+        const uint64_t us =
+            (uint64_t)SENDER_PACKET_LEN * 10 * 1000000 / sim_uart_baud() / 2;
+        sim_event_start(event, sim_time_us() + ((us > 0) ? us : 1));
+    }
+    else
+    {
+        sim_uart_send((const uint8_t[]){EOT}, 1);
+        sender_phase = SENDER_EOT1;
+    }
+}
+
+/**
+ * @brief 接收方取消传输。
+ */
+static void sender_cancel(void)
+{
+    sim_event_stop(&sender_stream_event);
+    sim_uart_cancel();
+    sender_phase = SENDER_END;
+    sender_result = YMODEM_SENDER_CANCELLED;
+}
+
+/**
+ * @brief 收到接收方发来的一个字节。
+ * @param ch 字节。
+ */
+static void sender_receive(uint8_t ch)
+{
+    // 窗口大小是数据而不是控制字符
+    if ((ch == CAN) && (sender_phase != SENDER_END) &&
+        (sender_phase != SENDER_WINDOW))
+    {
+        sender_cancel();
+        return;
+    }
+
+    switch (sender_phase)
+    {
+    case SENDER_WAIT_REQUEST:
+        if ((ch == CRC_C) || (ch == CRC_G))
+        {
+            sender_header_send();
+            sender_phase = (sender_index < sender_count) ? SENDER_HEADER
+                                                         : SENDER_FINISH;
+        }
+        break;
+    case SENDER_HEADER:
+        if (ch == ACK)
+        {
+            sender_window = 1;
+            sender_phase = SENDER_WAIT_DATA;
+        }
+        else if (ch == CRC_G)
+        {
+            // 流式传输不应答文件头
+            sender_data_begin(true);
+        }
+        else if (ch == NAK)
+        {
+            ++sender_retry_count;
+            sender_header_send();
+        }
+        break;
+    case SENDER_WAIT_DATA:
+        if ((ch == CRC_C) || (ch == CRC_G))
+        {
+            sender_data_begin(ch == CRC_G);
+        }
+        else if ((ch == WND) && (sender_offer > 1))
+        {
+            sender_phase = SENDER_WINDOW;
+        }
+        break;
+    case SENDER_WINDOW:
+        // 接收方确认的窗口不会超过提出的大小
+        sender_window = ((ch >= 1) && (ch <= sender_offer)) ? ch : 1;
+        sender_phase = SENDER_WAIT_DATA;
+        break;
+    case SENDER_DATA:
+        if (ch == ACK)
+        {
+            if (++sender_block < sender_blocks)
+            {
+                sender_window_fill();
+            }
+            else
+            {
+                sim_uart_send((const uint8_t[]){EOT}, 1);
+                sender_phase = SENDER_EOT1;
+            }
+        }
+        else if (ch == NAK)
+        {
+            // 回退到最早未确认的数据包重新发送
+            ++sender_retry_count;
+            sender_next = sender_block;
+            sender_window_fill();
+        }
+        break;
+    case SENDER_EOT1:
+        if (ch == NAK)
+        {
+            sim_uart_send((const uint8_t[]){EOT}, 1);
+            sender_phase = SENDER_EOT2;
+        }
+        break;
+    case SENDER_EOT2:
+        if (ch == ACK)
+        {
+            sender_end_us = sim_time_us();
+            ++sender_index;
+            sender_phase = SENDER_WAIT_REQUEST;
+        }
+        break;
+    case SENDER_FINISH:
+        if (ch == ACK)
+        {
+            sender_phase = SENDER_END;
+            sender_result = YMODEM_SENDER_DONE;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void ymodem_sender_start(const ymodem_sender_file_t *files, uint32_t count,
+                         uint32_t turnaround_us, uint32_t window)
+{
+    sender_files = files;
+    sender_count = count;
+    sender_offer = window;
+    sender_window = 1;
+    sender_index = 0;
+    sender_retry_count = 0;
+    sender_begin_us = 0;
+    sender_end_us = 0;
+    sender_result = YMODEM_SENDER_BUSY;
+    sender_phase = SENDER_WAIT_REQUEST;
+    sender_stream_event.handler = sender_stream_handler;
+    sim_uart_peer(sender_receive, turnaround_us);
+}
+
+ymodem_sender_state_t ymodem_sender_state(void)
+{
+    return sender_result;
+}
+
+uint64_t ymodem_sender_elapsed_us(void)
+{
+    return sender_end_us - sender_begin_us;
+}
+
+uint32_t ymodem_sender_window(void)
+{
+    return sender_window;
+}
+
+uint32_t ymodem_sender_retries(void)
+{
+    return sender_retry_count;
+}
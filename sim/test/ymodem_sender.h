@@ -0,0 +1,71 @@
+/**
+ * @file ymodem_sender.h
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-27
+ * @copyright Copyright (c) 2026
+ * @brief 测试用的ymodem发送方，即串口另一头的主机程序，
+ * 按接收方请求的'C'或'G'选择停等或流式发送，可在文件头中提出滑动窗口，
+ * 运行在uart模型的中断上下文中。
+ */
+
+#ifndef _YMODEM_SENDER_H_
+#define _YMODEM_SENDER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief 待发送的文件。
+ */
+typedef struct {
+    const char *name;    //!< 文件名
+    const uint8_t *data; //!< 文件内容
+    uint32_t size;       //!< 字节数
+} ymodem_sender_file_t;
+
+/**
+ * @brief 发送结果。
+ */
+typedef enum {
+    YMODEM_SENDER_BUSY = 0,  //!< 尚未结束
+    YMODEM_SENDER_DONE,      //!< 全部文件发送完成并收到结束应答
+    YMODEM_SENDER_CANCELLED, //!< 接收方取消了传输
+} ymodem_sender_state_t;
+
+/**
+ * @brief 开始等待接收方请求并依次发送文件。
+ * @param files 文件列表，发送结束前须保持有效。
+ * @param count 文件数量。
+ * @param turnaround_us 收到应答后到开始发送的延迟。
+ * @param window 在文件头中提出的滑动窗口大小，不大于1时不提出，按停等发送。
+ */
+extern void ymodem_sender_start(const ymodem_sender_file_t *files,
+                                uint32_t count, uint32_t turnaround_us,
+                                uint32_t window);
+
+/**
+ * @brief 返回接收方对最后一个文件确认的滑动窗口大小。
+ * @return uint32_t 窗口大小，1为停等。
+ */
+extern uint32_t ymodem_sender_window(void);
+
+/**
+ * @brief 返回发送结果。
+ * @return ymodem_sender_state_t 发送结果。
+ */
+extern ymodem_sender_state_t ymodem_sender_state(void);
+
+/**
+ * @brief 返回第一个数据包开始发送到最后一个文件数据确认之间的虚拟时间。
+ * @return uint64_t 微秒数。
+ */
+extern uint64_t ymodem_sender_elapsed_us(void);
+
+/**
+ * @brief 返回重传的数据包数量。
+ * @return uint32_t 数量。
+ */
+extern uint32_t ymodem_sender_retries(void);
+
+#endif
@@ -1,5 +1,14 @@
 #include <algo/algo.h>
+#include <crc.h>
+#include <main.h>
 #include <mcu.h>
+#include <rtthread.h>
+#include <stdbool.h>
+
+// 配置调试日志
+#define DBG_TAG __FILE_NAME__
+#define DBG_LVL DBG_DEBUG
+#include <rtdebug.h>
 
 /**
  * @brief crc16查表，多项式: 0x1021，初始值: 0x0000。
@@ -35,9 +44,51 @@ static const uint16_t crc16_table[256] = {
     0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8, 0x6E17, 0x7E36, 0x4E55, 0x5E74,
     0x2E93, 0x3EB2, 0x0ED1, 0x1EF0};
 
-ITCM uint16_t algo_crc16(const uint8_t *data, size_t len)
+#if ALGO_CRC16_SLICE > 1
+
+/**
+ * @brief 分片查表，crc16_slice[k][n]为n后接k个零字节的crc，
+ * 放在ram中避免每次查表都访问flash。
+ */
+static uint16_t crc16_slice[ALGO_CRC16_SLICE][256];
+
+/**
+ * @brief 分片查表是否已经生成。
+ */
+static volatile bool crc16_slice_ready = false;
+
+/**
+ * @brief 由单字节查表推导出分片查表。
+ */
+ITCM static void algo_crc16_slice_setup(void)
+{
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+        crc16_slice[0][n] = crc16_table[n];
+    }
+    for (uint32_t k = 1; k < ALGO_CRC16_SLICE; ++k)
+    {
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            const uint16_t prev = crc16_slice[k - 1][n];
+            crc16_slice[k][n] = (prev << 8) ^ crc16_table[prev >> 8];
+        }
+    }
+    crc16_slice_ready = true;
+}
+
+#endif
+
+/**
+ * @brief 逐字节查表计算crc16。
+ * @param crc 当前crc值。
+ * @param data 指向待校验数据的指针。
+ * @param len 数据长度。
+ * @return uint16_t 更新后的crc值。
+ */
+ITCM static uint16_t algo_crc16_bytewise(uint16_t crc, const uint8_t *data,
+                                         size_t len)
 {
-    uint16_t crc = 0x0000;
     while (len--)
     {
         // 核心逻辑：(CRC左移8位) ^ 表中对应数据
@@ -45,4 +96,109 @@ ITCM uint16_t algo_crc16(const uint8_t *data, size_t len)
         crc = (crc << 8) ^ crc16_table[((crc >> 8) ^ *data++) & 0xFF];
     }
     return crc;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 软件计算crc16，按ALGO_CRC16_SLICE字节一组查表。
+ * @param crc 当前crc值。
+ * @param data 指向待校验数据的指针。
+ * @param len 数据长度。
+ * @return uint16_t 更新后的crc值。
+ */
+ITCM static uint16_t algo_crc16_soft(uint16_t crc, const uint8_t *data,
+                                     size_t len)
+{
+#if ALGO_CRC16_SLICE > 1
+    if (!crc16_slice_ready)
+    {
+        algo_crc16_slice_setup();
+    }
+
+    while (len >= ALGO_CRC16_SLICE)
+    {
+        // 前两个字节与crc合并，其余字节各自查表后异或
+        crc ^= (uint16_t)((data[0] << 8) | data[1]);
+        uint16_t next = crc16_slice[ALGO_CRC16_SLICE - 1][crc >> 8] ^
+                        crc16_slice[ALGO_CRC16_SLICE - 2][crc & 0xFF];
+        for (uint32_t k = 2; k < ALGO_CRC16_SLICE; ++k)
+        {
+            next ^= crc16_slice[ALGO_CRC16_SLICE - 1 - k][data[k]];
+        }
+        crc = next;
+        data += ALGO_CRC16_SLICE;
+        len -= ALGO_CRC16_SLICE;
+    }
+#endif
+
+    return algo_crc16_bytewise(crc, data, len);
+}
+
+ITCM uint16_t algo_crc16_init(void)
+{
+    return 0x0000;
+}
+
+ITCM uint16_t algo_crc16_update(uint16_t crc, const uint8_t *data, size_t len)
+{
+#if ALGO_CRC16_HW
+    if ((len >= ALGO_CRC16_HW_THRESHOLD) && bsp_crc16_update(&crc, data, len))
+    {
+        return crc;
+    }
+#endif
+    return algo_crc16_soft(crc, data, len);
+}
+
+ITCM uint16_t algo_crc16_final(uint16_t crc)
+{
+    return crc;
+}
+
+ITCM uint16_t algo_crc16(const uint8_t *data, size_t len)
+{
+    return algo_crc16_final(algo_crc16_update(algo_crc16_init(), data, len));
+}
+
+#if ALGO_CRC16_BENCHMARK
+
+/**
+ * @brief 以flash内容为输入，比对各实现的结果并输出每字节耗时。
+ * @return int 结果一致返回0，否则返回-1。
+ */
+static int algo_crc16_benchmark(void)
+{
+    const size_t len = 1024;
+    const uint8_t *data = (const uint8_t *)MCU_FLASH_START;
+
+    uint32_t start = DWT->CYCCNT;
+    const uint16_t ref = algo_crc16_bytewise(0x0000, data, len);
+    const uint32_t ref_cycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    const uint16_t soft = algo_crc16_soft(0x0000, data, len);
+    const uint32_t soft_cycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    const uint16_t fast = algo_crc16(data, len);
+    const uint32_t fast_cycles = DWT->CYCCNT - start;
+
+    // 分段计算需要与一次性计算结果一致
+    uint16_t split = algo_crc16_init();
+    split = algo_crc16_update(split, data, 3);
+    split = algo_crc16_update(split, data + 3, len - 3);
+    split = algo_crc16_final(split);
+
+    LOG_I("crc16 cycles/byte x100: table %u, slice %u, engine %u",
+          ref_cycles * 100 / len, soft_cycles * 100 / len,
+          fast_cycles * 100 / len);
+
+    if ((soft != ref) || (fast != ref) || (split != ref))
+    {
+        LOG_E("crc16 mismatch: %04x %04x %04x %04x", ref, soft, fast, split);
+        return -1;
+    }
+    return 0;
+}
+RUN_APP_EXPORT(algo_crc16_benchmark);
+
+#endif
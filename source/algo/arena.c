@@ -0,0 +1,90 @@
+/**
+ * @file arena.c
+ * @author reginald.yang (proyrb@yeah.net)
+ * @version 0.1
+ * @date 2026-04-20
+ * @copyright Copyright (c) 2026
+ * @brief 实现顺序分配的静态内存池。
+ */
+
+#include <algo/arena.h>
+#include <rthw.h>
+#include <rtthread.h>
+
+// 配置调试日志
+#define DBG_TAG __FILE_NAME__
+#define DBG_LVL DBG_DEBUG
+#include <rtdebug.h>
+
+/**
+ * @brief 已使用过的内存池链表，供algo_arena_report遍历。
+ */
+static algo_arena_t *arena_list = NULL;
+
+/**
+ * @brief 把内存池加入链表，只在第一次分配时调用。
+ * @param arena 内存池。
+ */
+static void algo_arena_list(algo_arena_t *arena)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    arena->next = arena_list;
+    arena_list = arena;
+    arena->listed = true;
+    rt_hw_interrupt_enable(level);
+}
+
+ITCM void *algo_arena_alloc(algo_arena_t *arena, size_t size)
+{
+    if (!arena->listed)
+        algo_arena_list(arena);
+
+    const uint32_t start =
+        (arena->used + ALGO_ARENA_ALIGN - 1) & ~(ALGO_ARENA_ALIGN - 1UL);
+    if ((start > arena->size) || (size > arena->size - start))
+    {
+        arena->failed++;
+        LOG_E("arena %s exhausted, %u + %u of %u bytes", arena->name, start,
+              size, arena->size);
+        return NULL;
+    }
+
+    arena->last = start;
+    arena->used = start + size;
+    if (arena->used > arena->peak)
+        arena->peak = arena->used;
+    if (arena->used > arena->peak_all)
+        arena->peak_all = arena->used;
+    return arena->base + start;
+}
+
+ITCM void algo_arena_free(algo_arena_t *arena, void *ptr)
+{
+    if (ptr == arena->base + arena->last)
+        arena->used = arena->last;
+}
+
+ITCM void algo_arena_reset(algo_arena_t *arena)
+{
+    if (arena->peak)
+        LOG_D("arena %s: peak %u of %u bytes", arena->name, arena->peak,
+              arena->size);
+
+    arena->used = 0;
+    arena->last = 0;
+    arena->peak = 0;
+}
+
+uint32_t algo_arena_peak(const algo_arena_t *arena)
+{
+    return arena->peak;
+}
+
+void algo_arena_report(void)
+{
+    for (algo_arena_t *arena = arena_list; arena; arena = arena->next)
+    {
+        LOG_I("arena %s: size %u, used %u, peak %u, failed %u", arena->name,
+              arena->size, arena->used, arena->peak_all, arena->failed);
+    }
+}
@@ -0,0 +1,269 @@
+#include <algo/digest.h>
+#include <mcu.h>
+#include <rtthread.h>
+#include <string.h>
+
+// 配置调试日志
+#define DBG_TAG __FILE_NAME__
+#define DBG_LVL DBG_DEBUG
+#include <rtdebug.h>
+
+/**
+ * @brief crc32查表，反转多项式: 0xEDB88320，首次使用时生成到ram。
+ */
+static uint32_t crc32_table[256];
+
+/**
+ * @brief crc32查表是否已经生成。
+ */
+static volatile bool crc32_table_ready = false;
+
+/**
+ * @brief 生成crc32查表。
+ */
+ITCM static void algo_crc32_setup(void)
+{
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+        uint32_t crc = n;
+        for (uint32_t bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+        }
+        crc32_table[n] = crc;
+    }
+    crc32_table_ready = true;
+}
+
+ITCM uint32_t algo_crc32_init(void)
+{
+    return 0xFFFFFFFF;
+}
+
+ITCM uint32_t algo_crc32_update(uint32_t crc, const uint8_t *data, size_t len)
+{
+    if (!crc32_table_ready)
+    {
+        algo_crc32_setup();
+    }
+
+    while (len--)
+    {
+        crc = (crc >> 8) ^ crc32_table[(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+ITCM uint32_t algo_crc32_final(uint32_t crc)
+{
+    return crc ^ 0xFFFFFFFF;
+}
+
+/**
+ * @brief sha256轮常量。
+ */
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * @brief 处理一个64字节分组。
+ * @param state 中间哈希值。
+ * @param block 分组数据。
+ */
+ITCM static void algo_sha256_transform(uint32_t state[8],
+                                       const uint8_t block[64])
+{
+    uint32_t w[64];
+
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        w[i] = ((uint32_t)block[i * 4] << 24) |
+               ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | ((uint32_t)block[i * 4 + 3]);
+    }
+    for (uint32_t i = 16; i < 64; ++i)
+    {
+        const uint32_t s0 = SHA256_ROTR(w[i - 15], 7) ^
+                            SHA256_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = SHA256_ROTR(w[i - 2], 17) ^
+                            SHA256_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (uint32_t i = 0; i < 64; ++i)
+    {
+        const uint32_t s1 =
+            SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25);
+        const uint32_t ch = (e & f) ^ (~e & g);
+        const uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+        const uint32_t s0 =
+            SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22);
+        const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        const uint32_t t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+ITCM void algo_sha256_init(algo_sha256_t *ctx)
+{
+    ctx->state[0] = 0x6a09e667;
+    ctx->state[1] = 0xbb67ae85;
+    ctx->state[2] = 0x3c6ef372;
+    ctx->state[3] = 0xa54ff53a;
+    ctx->state[4] = 0x510e527f;
+    ctx->state[5] = 0x9b05688c;
+    ctx->state[6] = 0x1f83d9ab;
+    ctx->state[7] = 0x5be0cd19;
+    ctx->length = 0;
+    ctx->block_len = 0;
+}
+
+ITCM void algo_sha256_update(algo_sha256_t *ctx, const uint8_t *data,
+                             size_t len)
+{
+    ctx->length += len;
+
+    // 先补齐上一次剩下的不完整分组
+    if (ctx->block_len > 0)
+    {
+        size_t fill = sizeof(ctx->block) - ctx->block_len;
+        if (fill > len)
+        {
+            fill = len;
+        }
+        memcpy(&ctx->block[ctx->block_len], data, fill);
+        ctx->block_len += fill;
+        data += fill;
+        len -= fill;
+
+        if (ctx->block_len < sizeof(ctx->block))
+        {
+            return;
+        }
+        algo_sha256_transform(ctx->state, ctx->block);
+        ctx->block_len = 0;
+    }
+
+    // 完整分组直接处理，不经过缓存
+    while (len >= sizeof(ctx->block))
+    {
+        algo_sha256_transform(ctx->state, data);
+        data += sizeof(ctx->block);
+        len -= sizeof(ctx->block);
+    }
+
+    memcpy(ctx->block, data, len);
+    ctx->block_len = len;
+}
+
+ITCM void algo_sha256_final(algo_sha256_t *ctx, uint8_t out[32])
+{
+    const uint64_t bits = ctx->length * 8;
+
+    ctx->block[ctx->block_len++] = 0x80;
+    if (ctx->block_len > 56)
+    {
+        memset(&ctx->block[ctx->block_len], 0, 64 - ctx->block_len);
+        algo_sha256_transform(ctx->state, ctx->block);
+        ctx->block_len = 0;
+    }
+    memset(&ctx->block[ctx->block_len], 0, 56 - ctx->block_len);
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        ctx->block[56 + i] = (uint8_t)(bits >> (56 - i * 8));
+    }
+    algo_sha256_transform(ctx->state, ctx->block);
+
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        out[i * 4] = (uint8_t)(ctx->state[i] >> 24);
+        out[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+        out[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+        out[i * 4 + 3] = (uint8_t)(ctx->state[i]);
+    }
+}
+
+ITCM void algo_digest_init(algo_digest_t *digest)
+{
+    digest->size = 0;
+    digest->crc32 = algo_crc32_init();
+#if ALGO_DIGEST_SHA256
+    algo_sha256_init(&digest->sha256);
+#endif
+}
+
+ITCM void algo_digest_update(algo_digest_t *digest, const uint8_t *data,
+                             size_t len)
+{
+    digest->size += len;
+    digest->crc32 = algo_crc32_update(digest->crc32, data, len);
+#if ALGO_DIGEST_SHA256
+    algo_sha256_update(&digest->sha256, data, len);
+#endif
+}
+
+ITCM bool algo_image_trailer_valid(const algo_image_trailer_t *trailer)
+{
+    return trailer->magic == ALGO_IMAGE_TRAILER_MAGIC;
+}
+
+ITCM bool algo_digest_check(algo_digest_t *digest,
+                            const algo_image_trailer_t *trailer)
+{
+    if (digest->size != trailer->image_size)
+    {
+        LOG_E("image size %u, expect %u", digest->size, trailer->image_size);
+        return false;
+    }
+
+    const uint32_t crc32 = algo_crc32_final(digest->crc32);
+    if (crc32 != trailer->crc32)
+    {
+        LOG_E("image crc32 0x%08X, expect 0x%08X", crc32, trailer->crc32);
+        return false;
+    }
+
+#if ALGO_DIGEST_SHA256
+    uint8_t sha256[32];
+    algo_sha256_final(&digest->sha256, sha256);
+    if (memcmp(sha256, trailer->sha256, sizeof(sha256)) != 0)
+    {
+        LOG_E("image sha256 mismatch");
+        return false;
+    }
+#endif
+
+    return true;
+}
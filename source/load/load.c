@@ -181,9 +181,11 @@ void load_app(void)
     case LOAD_APP_USER:
         app_bin_addr = USER_START; //!< 从用户程序启动
         break;
+#if !PARTITION_IN_PLACE
     case LOAD_APP_OEM:
         app_bin_addr = OEM_START; //!< 从厂商程序启动
         break;
+#endif
     default:
         load_set_error(LOAD_ERROR_WHICH);
         return; //!< 无效参数时不加载app程序
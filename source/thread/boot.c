@@ -1,3 +1,4 @@
+#include <algo/digest.h>
 #include <detools_port.h>
 #include <load/load.h>
 #include <main.h>
@@ -11,106 +12,39 @@
 #define DBG_LVL DBG_DEBUG
 #include <rtdebug.h>
 
-ITCM void erase_user(uint32_t patch_size)
-{
-    int result = 0;
-    FLASH_EraseInitTypeDef flash_erase_configuration = {
-        .TypeErase = FLASH_TYPEERASE_SECTORS,
-        .Banks = FLASH_BANK_1,
-        .Sector = (USER_START - MCU_FLASH_START) / MCU_FLASH_SECTOR_SIZE,
-        .NbSectors = (1 + patch_size / MCU_FLASH_SECTOR_SIZE),
-        .VoltageRange = FLASH_VOLTAGE_RANGE_3,
-    };
-
-    LOG_D("flash erase sector index: %u, number: %u",
-          flash_erase_configuration.Sector,
-          flash_erase_configuration.NbSectors);
-
-    // 在擦写前关闭全局中断
-    __disable_irq();
-
-    // 解锁Flash控制寄存器
-    result = HAL_FLASH_Unlock();
-    if (0 != result)
-    {
-        LOG_E("flash unlock fail");
-        return;
-    }
-
-    // 清除ECC标志
-    __HAL_FLASH_CLEAR_FLAG_BANK1(FLASH_FLAG_ALL_ERRORS_BANK1);
-
-    // 执行擦除
-    uint32_t sector_error;
-    result = HAL_FLASHEx_Erase(&flash_erase_configuration, &sector_error);
-    if (0 != result)
-    {
-        LOG_E("flash erase fail with %u", sector_error);
-        return;
-    }
-
-    // 上锁Flash控制寄存器
-    result = HAL_FLASH_Lock();
-    if (0 != result)
-    {
-        LOG_E("flash lock fail");
-    }
-
-    // 使能全局中断
-    __enable_irq();
-
-    LOG_E("flash user success");
-}
+/**
+ * @brief 新固件摘要，还原时边写入边计算。
+ */
+static algo_digest_t apply_digest;
 
-ITCM void erase_oem(uint32_t patch_size)
+/**
+ * @brief 用补丁末尾的摘要尾部校验还原出的新固件。
+ * @param patch_addr 补丁起始地址。
+ * @param patch_size 补丁大小，包含摘要尾部。
+ * @return true 校验通过，或补丁没有摘要尾部且不强制校验。
+ * @return false 新固件损坏。
+ */
+ITCM static bool verify_apply(uint32_t patch_addr, uint32_t patch_size)
 {
-    int result = 0;
-    FLASH_EraseInitTypeDef flash_erase_configuration = {
-        .TypeErase = FLASH_TYPEERASE_SECTORS,
-        .Banks = FLASH_BANK_2,
-        .Sector = (OEM_START - MCU_FLASH_START) / MCU_FLASH_SECTOR_SIZE - 8,
-        .NbSectors = (1 + patch_size / MCU_FLASH_SECTOR_SIZE),
-        .VoltageRange = FLASH_VOLTAGE_RANGE_3,
-    };
-
-    LOG_D("flash erase sector index: %u, number: %u",
-          flash_erase_configuration.Sector,
-          flash_erase_configuration.NbSectors);
-
-    // 在擦写前关闭全局中断
-    __disable_irq();
-
-    // 解锁Flash控制寄存器
-    result = HAL_FLASH_Unlock();
-    if (0 != result)
+    algo_image_trailer_t trailer;
+    if (patch_size >= sizeof(trailer))
     {
-        LOG_E("flash unlock fail");
-        return;
+        memcpy(&trailer,
+               (const void *)(patch_addr + patch_size - sizeof(trailer)),
+               sizeof(trailer));
     }
-
-    // 清除ECC标志
-    __HAL_FLASH_CLEAR_FLAG_BANK2(FLASH_FLAG_ALL_ERRORS_BANK2);
-
-    // 执行擦除
-    uint32_t sector_error;
-    result = HAL_FLASHEx_Erase(&flash_erase_configuration, &sector_error);
-    if (0 != result)
+    else
     {
-        LOG_E("flash erase fail with %u", sector_error);
-        return;
+        trailer.magic = 0;
     }
 
-    // 上锁Flash控制寄存器
-    result = HAL_FLASH_Lock();
-    if (0 != result)
+    if (!algo_image_trailer_valid(&trailer))
     {
-        LOG_E("flash lock fail");
+        LOG_W("patch has no image digest");
+        return !ALGO_DIGEST_REQUIRED;
     }
 
-    // 使能全局中断
-    __enable_irq();
-
-    LOG_I("flash oem success");
+    return algo_digest_check(&apply_digest, &trailer);
 }
 
 ITCM void detect_apply(void)
@@ -120,31 +54,59 @@ ITCM void detect_apply(void)
     uint32_t patch_size;
     uint32_t new_app_addr;
     const load_apply_t apply = load_get_apply();
+
+    // 统计擦除加还原的总耗时，用于比较是否开启bank并行与缓存
+    const rt_tick_t start_tick = rt_tick_get();
     switch (apply)
     {
     case LOAD_APPLY_USER:
         LOG_I("LOAD_APPLY_OEM erase");
+#if DETOOLS_PORT_IN_PLACE
+        // 原地还原，旧固件与新固件都在user分区
+        old_app_addr = USER_START;
+#else
         old_app_addr = OEM_START;
+#endif
         patch_addr = PATCH_START;
         patch_size = load_get_patch_size();
         new_app_addr = USER_START;
-        erase_user(patch_size);
         break;
+#if !DETOOLS_PORT_IN_PLACE
     case LOAD_APPLY_OEM:
         LOG_I("LOAD_APPLY_OEM erase");
         old_app_addr = USER_START;
         patch_addr = PATCH_START;
         patch_size = load_get_patch_size();
         new_app_addr = OEM_START;
-        erase_oem(patch_size);
         break;
+#endif
     default:
         LOG_I("LOAD_APPLY_INVALID");
         return;
     }
 
-    const int result =
-        detools_apply_patch(old_app_addr, patch_addr, patch_size, new_app_addr);
+    // 摘要尾部位于补丁之后，detools还原完成后会忽略多余的数据
+    algo_digest_init(&apply_digest);
+#if DETOOLS_PORT_IN_PLACE
+    UNUSE_VAR(old_app_addr);
+    const int result = detools_apply_patch_in_place(
+        new_app_addr, USER_SIZE, patch_addr, patch_size, &apply_digest);
+#else
+    const int result = detools_apply_patch(old_app_addr, patch_addr,
+                                           patch_size, new_app_addr,
+                                           &apply_digest);
+#endif
+    LOG_I("erase and apply in %u ms, bank overlap %s, dcache %s",
+          (rt_tick_get() - start_tick) * 1000 / RT_TICK_PER_SECOND,
+          DETOOLS_PORT_APPLY_OVERLAP ? "on" : "off",
+          rt_hw_cpu_dcache_status() ? "on" : "off");
+    if ((result == DETOOLS_OK) && !verify_apply(patch_addr, patch_size))
+    {
+        // 新固件损坏，不切换启动分区，也不再重复还原
+        LOG_E("apply verify fail");
+        load_clear_apply();
+        return;
+    }
     if (result == DETOOLS_OK)
     {
         switch (apply)
@@ -190,11 +152,13 @@ ITCM void detect_reset(void)
         app_bin_addr = USER_START;
         LOG_I("detect user app");
         break;
+#if !PARTITION_IN_PLACE
     case LOAD_APP_OEM:
         // 赋值oem程序分区的地址作为app程序地址
         app_bin_addr = OEM_START;
         LOG_I("detect oem app");
         break;
+#endif
     default:
         // 无效参数时不加载app程序
         return;
@@ -1,10 +1,311 @@
+#include <algo/algo.h>
+#include <main.h>
+#include <mcu.h>
+#include <rthw.h>
 #include <rtthread.h>
+#include <stddef.h>
+#include <string.h>
+#include <thread/monitor.h>
+#include <uart.h>
 
 // 配置调试日志
 #define DBG_TAG __FILE_NAME__
 #define DBG_LVL DBG_DEBUG
 #include <rtdebug.h>
 
+#if MONITOR_TRACE_ENABLE
+
+#ifndef RT_HOOK_USING_FUNC_PTR
+#error "MONITOR_TRACE_ENABLE requires RT_HOOK_USING_FUNC_PTR in rtconfig.h"
+#endif
+
+/**
+ * @brief 帧头魔数，小端存储为"MNTR"。
+ */
+#define MONITOR_MAGIC 0x52544E4D
+
+/**
+ * @brief 记录中线程名称的字节数，超出部分截断。
+ */
+#define MONITOR_NAME_LEN 8
+
+/**
+ * @brief 帧头，与采样分析器的帧格式一致，之后是len字节负载与crc16(XMODEM)，
+ * crc覆盖type到负载末尾。
+ */
+typedef struct PACKED {
+    uint32_t magic; //!< MONITOR_MAGIC
+    uint8_t type;   //!< 帧类型，目前只有记录帧0
+    uint8_t seq;    //!< 帧序号，用于发现丢帧
+    uint16_t len;   //!< 负载字节数
+} monitor_frame_head_t;
+
+/**
+ * @brief 延迟统计，计数到上限后不再增加。
+ */
+typedef struct PACKED {
+    uint32_t max;                       //!< 最大延迟周期数
+    uint16_t hist[MONITOR_LAT_BUCKETS]; //!< 按周期数log2划分的直方图
+} monitor_lat_t;
+
+/**
+ * @brief 记录的固定部分，之后是isrs个中断延迟与threads个线程条目。
+ */
+typedef struct PACKED {
+    uint32_t clock;   //!< CYCCNT频率
+    uint32_t elapsed; //!< 本周期经过的周期数
+    uint32_t sleep;   //!< 空闲线程在wfi中经过的lptim计数
+    uint8_t threads;  //!< 线程条目数
+    uint8_t isrs;     //!< 中断延迟条目数
+    uint8_t buckets;  //!< MONITOR_LAT_BUCKETS
+    uint8_t shift;    //!< MONITOR_LAT_SHIFT
+} monitor_record_head_t;
+
+/**
+ * @brief 记录中的线程条目。
+ */
+typedef struct PACKED {
+    char name[MONITOR_NAME_LEN]; //!< 线程名称，不足时以0填充
+    uint8_t priority;            //!< 分配槽位时的优先级
+    uint8_t reserved[3];         //!< 保留
+    uint32_t cycles;             //!< 本周期运行的周期数
+    uint32_t switches;           //!< 本周期切入的次数
+    monitor_lat_t lat;           //!< 从就绪到切入的延迟
+} monitor_record_thread_t;
+
+/**
+ * @brief 单个线程的统计，槽位序号加1保存在线程的user_data中。
+ */
+typedef struct {
+    rt_thread_t thread;          //!< 占用槽位的线程
+    uint32_t ready;              //!< 进入就绪时的CYCCNT
+    bool pending;                //!< 已就绪尚未切入
+    monitor_record_thread_t rec; //!< 本周期的统计
+} monitor_slot_t;
+
+/**
+ * @brief 单个中断来源的统计。
+ */
+typedef struct {
+    uint32_t stamp;    //!< 最早一次未处理的中断入口CYCCNT
+    bool pending;      //!< 有未处理的中断
+    monitor_lat_t lat; //!< 本周期的统计
+} monitor_isr_state_t;
+
+/**
+ * @brief 调度统计状态，除monitor_isr_enter外都在关中断时访问。
+ */
+static struct {
+    uint32_t last;                              //!< 上次切换时的CYCCNT
+    uint32_t start;                             //!< 本周期开始时的CYCCNT
+    bool overflow;                              //!< 最后一个槽位被多个线程共用
+    monitor_slot_t slots[MONITOR_THREAD_SLOTS]; //!< 各线程统计
+    monitor_isr_state_t isr[MONITOR_ISR_COUNT]; //!< 各中断统计
+} monitor;
+
+/**
+ * @brief 记录帧缓冲区，放满全部槽位。
+ */
+static uint8_t monitor_frame[sizeof(monitor_frame_head_t) +
+                             sizeof(monitor_record_head_t) +
+                             sizeof(monitor_lat_t) * MONITOR_ISR_COUNT +
+                             sizeof(monitor_record_thread_t) *
+                                 MONITOR_THREAD_SLOTS +
+                             sizeof(uint16_t)];
+
+/**
+ * @brief 取得线程的槽位，首次出现时分配，需在关中断时调用。
+ * 重新初始化的静态线程user_data被清零，按线程地址找回原槽位。
+ * @param thread 线程。
+ * @return monitor_slot_t* 槽位。
+ */
+ITCM static monitor_slot_t *monitor_slot(rt_thread_t thread)
+{
+    if (thread->user_data != 0)
+        return &monitor.slots[thread->user_data - 1];
+
+    uint32_t i = 0;
+    while ((i < (MONITOR_THREAD_SLOTS - 1)) &&
+           (monitor.slots[i].thread != NULL) &&
+           (monitor.slots[i].thread != thread))
+    {
+        i++;
+    }
+
+    monitor_slot_t *slot = &monitor.slots[i];
+    if ((slot->thread != NULL) && (slot->thread != thread))
+        monitor.overflow = true;
+    slot->thread = thread;
+    memcpy(slot->rec.name, thread->name, sizeof(slot->rec.name));
+    slot->rec.priority = thread->current_priority;
+    thread->user_data = i + 1;
+    return slot;
+}
+
+/**
+ * @brief 累加一次延迟。
+ * @param lat 延迟统计。
+ * @param cycles 延迟周期数。
+ */
+ITCM static void monitor_lat_add(monitor_lat_t *lat, uint32_t cycles)
+{
+    uint32_t bucket = 32 - __CLZ(cycles >> MONITOR_LAT_SHIFT);
+    if (bucket >= MONITOR_LAT_BUCKETS)
+        bucket = MONITOR_LAT_BUCKETS - 1;
+    if (lat->hist[bucket] != UINT16_MAX)
+        lat->hist[bucket]++;
+    if (cycles > lat->max)
+        lat->max = cycles;
+}
+
+/**
+ * @brief 调度钩子，在关中断时由调度器调用，把距上次切换的周期计入切出线程。
+ * 中断中发起的调度在退出中断后才真正切换，这段时间计入切入线程。
+ * @param from 切出线程。
+ * @param to 切入线程。
+ */
+ITCM static void monitor_scheduler_hook(rt_thread_t from, rt_thread_t to)
+{
+    const uint32_t now = DWT->CYCCNT;
+    monitor_slot(from)->rec.cycles += now - monitor.last;
+    monitor.last = now;
+
+    monitor_slot_t *slot = monitor_slot(to);
+    slot->rec.switches++;
+    if (slot->pending)
+    {
+        slot->pending = false;
+        monitor_lat_add(&slot->rec.lat, now - slot->ready);
+    }
+}
+
+/**
+ * @brief 记录线程进入就绪的时间，被抢占的线程重新运行不计入延迟。
+ * @param thread 线程。
+ */
+ITCM static void monitor_ready(rt_thread_t thread)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+    monitor_slot_t *slot = monitor_slot(thread);
+    if (!slot->pending)
+    {
+        slot->ready = DWT->CYCCNT;
+        slot->pending = true;
+    }
+    rt_hw_interrupt_enable(level);
+}
+
+/**
+ * @brief 线程恢复钩子，在开中断后调用，期间线程可能已经切入运行。
+ * @param thread 被恢复的线程。
+ */
+ITCM static void monitor_resume_hook(rt_thread_t thread)
+{
+    if ((thread->stat & RT_THREAD_STAT_MASK) == RT_THREAD_READY)
+        monitor_ready(thread);
+}
+
+/**
+ * @brief 定时器进入钩子，超时唤醒不经过rt_thread_resume，
+ * 在线程自带定时器到期时记录就绪时间。
+ * @param timer 到期的定时器。
+ */
+ITCM static void monitor_timer_hook(rt_timer_t timer)
+{
+    rt_thread_t thread = timer->parameter;
+    if ((thread != NULL) && (&thread->thread_timer == timer))
+        monitor_ready(thread);
+}
+
+ITCM void monitor_isr_enter(monitor_isr_t src)
+{
+    monitor_isr_state_t *isr = &monitor.isr[src];
+    if (!isr->pending)
+    {
+        isr->stamp = DWT->CYCCNT;
+        isr->pending = true;
+    }
+}
+
+ITCM void monitor_isr_served(monitor_isr_t src)
+{
+    monitor_isr_state_t *isr = &monitor.isr[src];
+    rt_base_t level = rt_hw_interrupt_disable();
+    if (isr->pending)
+    {
+        isr->pending = false;
+        monitor_lat_add(&isr->lat, DWT->CYCCNT - isr->stamp);
+    }
+    rt_hw_interrupt_enable(level);
+}
+
+/**
+ * @brief 取出本周期的统计并清零，组成一帧经usart1发出。
+ * @param seq 帧序号。
+ * @param sleep 空闲线程在wfi中经过的lptim计数。
+ */
+static void monitor_report(uint8_t seq, uint32_t sleep)
+{
+    monitor_record_head_t head = {
+        .clock = SystemCoreClock,
+        .sleep = sleep,
+        .isrs = MONITOR_ISR_COUNT,
+        .buckets = MONITOR_LAT_BUCKETS,
+        .shift = MONITOR_LAT_SHIFT,
+    };
+    uint8_t *const payload = &monitor_frame[sizeof(monitor_frame_head_t)];
+    uint8_t *p = payload + sizeof(head);
+
+    // 关中断拷贝，各项统计属于同一时间段
+    rt_base_t level = rt_hw_interrupt_disable();
+    const uint32_t now = DWT->CYCCNT;
+    monitor_slot(rt_thread_self())->rec.cycles += now - monitor.last;
+    monitor.last = now;
+    head.elapsed = now - monitor.start;
+    monitor.start = now;
+
+    for (uint32_t i = 0; i < MONITOR_ISR_COUNT; ++i)
+    {
+        memcpy(p, &monitor.isr[i].lat, sizeof(monitor_lat_t));
+        memset(&monitor.isr[i].lat, 0, sizeof(monitor_lat_t));
+        p += sizeof(monitor_lat_t);
+    }
+
+    for (uint32_t i = 0; i < MONITOR_THREAD_SLOTS; ++i)
+    {
+        monitor_record_thread_t *rec = &monitor.slots[i].rec;
+        if ((rec->cycles == 0) && (rec->switches == 0))
+            continue;
+
+        memcpy(p, rec, sizeof(*rec));
+        if ((i == (MONITOR_THREAD_SLOTS - 1)) && monitor.overflow)
+            memcpy(p, "(other)", sizeof("(other)"));
+        rec->cycles = 0;
+        rec->switches = 0;
+        memset(&rec->lat, 0, sizeof(rec->lat));
+        p += sizeof(*rec);
+        head.threads++;
+    }
+    rt_hw_interrupt_enable(level);
+
+    memcpy(payload, &head, sizeof(head));
+    const uint16_t len = p - payload;
+    const monitor_frame_head_t frame_head = {
+        .magic = MONITOR_MAGIC, .type = 0, .seq = seq, .len = len};
+    memcpy(monitor_frame, &frame_head, sizeof(frame_head));
+    const uint16_t crc = algo_crc16(
+        &monitor_frame[offsetof(monitor_frame_head_t, type)],
+        sizeof(frame_head) - offsetof(monitor_frame_head_t, type) + len);
+    memcpy(p, &crc, sizeof(crc));
+
+    // 等待发送缓冲区清空，使整帧一次放入缓冲区，不与其他线程的日志交错
+    bsp_uart_flush(BSP_UART_USART1);
+    bsp_uart_write(BSP_UART_USART1, monitor_frame,
+                   sizeof(frame_head) + len + sizeof(crc));
+}
+
+#endif
+
 /**
  * @brief 监视器线程。
  * @param parameter 线程名称字符串。
@@ -12,11 +313,15 @@
 ITCM static void monitor_thread_entry(void *parameter)
 {
     // 将毫秒转换为系统的Tick数
-    const rt_tick_t period_tick = rt_tick_from_millisecond(1000);
+    const rt_tick_t period_tick = rt_tick_from_millisecond(MONITOR_PERIOD_MS);
 
     // 获取进入循环前的当前Tick时间作为基准
     rt_tick_t last_wakeup_tick = rt_tick_get();
 
+#if MONITOR_TRACE_ENABLE
+    uint8_t seq = 0;
+#endif
+
     while (1)
     {
         /* 取出数据并清零 */
@@ -25,20 +330,20 @@ ITCM static void monitor_thread_entry(void *parameter)
         rt_idle_total_sleep_clear();
         rt_exit_critical();
 
-        /* 理论上1秒钟LPTIM应该走1000000个Tick */
-        if (sleep_cnt > 1000000)
+#if MONITOR_TRACE_ENABLE
+        monitor_report(seq++, (uint32_t)sleep_cnt);
+#else
+        /* 理论上每个周期LPTIM应该走MONITOR_PERIOD_MS * 1000个Tick */
+        const uint64_t period_cnt = (uint64_t)MONITOR_PERIOD_MS * 1000;
+        if (sleep_cnt > period_cnt)
         {
-            sleep_cnt = 1000000; // 修正误差，防止出现负数
+            sleep_cnt = period_cnt; // 修正误差，防止出现负数
         }
 
-        static uint8_t cnt = 0;
-        if (++cnt % 1 == 0)
-        {
-            /* 占用率 = 100 - (睡眠占比) */
-            LOG_D("cpu usage per s: %.2f%%",
-                  100.0f - ((float)sleep_cnt / 1000000) * 100.0f);
-            cnt = 0;
-        }
+        /* 占用率 = 100 - (睡眠占比) */
+        LOG_D("cpu usage per s: %.2f%%",
+              100.0f - ((float)sleep_cnt / period_cnt) * 100.0f);
+#endif
 
         /*
          * 阻塞延时至下一个绝对时间点
@@ -50,11 +355,21 @@ ITCM static void monitor_thread_entry(void *parameter)
 }
 
 /**
- * @brief 启动监视器线程。
+ * @brief 安装调度统计钩子并启动监视器线程。
  * @return int 非0为失败。
  */
 static int monitor_thread_init(void)
 {
+#if MONITOR_TRACE_ENABLE
+    monitor.last = DWT->CYCCNT;
+    monitor.start = monitor.last;
+    rt_timer_enter_sethook(monitor_timer_hook);
+    rt_thread_resume_sethook(monitor_resume_hook);
+    rt_scheduler_sethook(monitor_scheduler_hook);
+    LOG_I("monitor trace %u ms, %u slots", MONITOR_PERIOD_MS,
+          MONITOR_THREAD_SLOTS);
+#endif
+
     const char *const name = "monitor";
     rt_err_t result = RT_EOK;
     rt_thread_t tid = rt_thread_create(name, monitor_thread_entry, (void *)name,
@@ -79,4 +394,4 @@ static int monitor_thread_init(void)
     }
     return result;
 }
-RUN_APP_EXPORT(monitor_thread_init);
\ No newline at end of file
+RUN_APP_EXPORT(monitor_thread_init);
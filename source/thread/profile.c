@@ -0,0 +1,394 @@
+#include <algo/algo.h>
+#include <main.h>
+#include <mcu.h>
+#include <rthw.h>
+#include <rtthread.h>
+#include <stddef.h>
+#include <string.h>
+#include <thread/profile.h>
+#include <uart.h>
+
+// 配置调试日志
+#define DBG_TAG __FILE_NAME__
+#define DBG_LVL DBG_DEBUG
+#include <rtdebug.h>
+
+#if PROFILE_ENABLE
+
+/**
+ * @brief 帧头魔数，小端存储为"PCPF"。
+ */
+#define PROFILE_MAGIC 0x46504350
+
+/**
+ * @brief 直方图区间数量。
+ */
+#define PROFILE_BUCKETS (PROFILE_HIST_SIZE / sizeof(uint32_t))
+
+/**
+ * @brief 帧类型。
+ */
+typedef enum {
+    PROFILE_FRAME_START = 0, //!< 采样参数与统计
+    PROFILE_FRAME_DATA,      //!< 非零区间
+    PROFILE_FRAME_END,       //!< 输出结束
+} profile_frame_type_t;
+
+/**
+ * @brief 帧头，之后是len字节负载与crc16(XMODEM)，crc覆盖type到负载末尾。
+ */
+typedef struct PACKED {
+    uint32_t magic; //!< PROFILE_MAGIC
+    uint8_t type;   //!< profile_frame_type_t
+    uint8_t seq;    //!< 帧序号，用于发现丢帧
+    uint16_t len;   //!< 负载字节数
+} profile_frame_head_t;
+
+/**
+ * @brief PROFILE_FRAME_START的负载。
+ */
+typedef struct PACKED {
+    uint32_t rate;       //!< 每秒采样次数
+    uint32_t shift;      //!< 区间宽度为1 << shift字节
+    uint32_t itcm_start; //!< itcm代码起始地址
+    uint32_t itcm_len;   //!< itcm代码字节数
+    uint32_t code_start; //!< flash代码起始地址
+    uint32_t code_len;   //!< flash代码字节数
+    uint32_t samples;    //!< 落在直方图中的采样数
+    uint32_t other;      //!< 落在代码区以外的采样数
+    uint64_t cycles;     //!< 采样中断消耗的周期数
+    uint64_t elapsed;    //!< 经过的周期数
+} profile_frame_start_t;
+
+/**
+ * @brief PROFILE_FRAME_DATA的负载单元。
+ */
+typedef struct PACKED {
+    uint32_t addr;  //!< 区间起始地址
+    uint32_t count; //!< 采样数
+} profile_frame_entry_t;
+
+/**
+ * @brief 按地址累加的采样数，前段对应itcm，后段对应flash代码。
+ */
+AXI_UNINIT ALIGN(4) static uint32_t profile_hist[PROFILE_BUCKETS];
+
+/**
+ * @brief 采样器状态，地址范围在初始化后不再改变。
+ */
+static struct {
+    uint32_t itcm_start;   //!< itcm代码起始地址
+    uint32_t itcm_len;     //!< itcm代码字节数
+    uint32_t code_start;   //!< flash代码起始地址
+    uint32_t code_len;     //!< flash代码字节数
+    uint32_t itcm_buckets; //!< itcm占用的区间数
+    uint32_t shift;        //!< 区间宽度的位数
+    uint32_t last;         //!< 上次采样时的CYCCNT
+    profile_stat_t stat;   //!< 采样统计
+} profile;
+
+/**
+ * @brief 记录一次采样。
+ * @param frame 被打断处的异常栈帧，frame[6]为pc。
+ */
+ITCM USED static void profile_sample(const uint32_t *frame)
+{
+    const uint32_t start = DWT->CYCCNT;
+    TIM7->SR = ~TIM_SR_UIF;
+
+    const uint32_t pc = frame[6];
+    if ((pc - profile.itcm_start) < profile.itcm_len)
+    {
+        profile_hist[(pc - profile.itcm_start) >> profile.shift]++;
+        profile.stat.samples++;
+    }
+    else if ((pc - profile.code_start) < profile.code_len)
+    {
+        profile_hist[profile.itcm_buckets +
+                     ((pc - profile.code_start) >> profile.shift)]++;
+        profile.stat.samples++;
+    }
+    else
+    {
+        profile.stat.other++;
+    }
+
+    const uint32_t end = DWT->CYCCNT;
+    profile.stat.elapsed += end - profile.last;
+    profile.stat.cycles += end - start;
+    profile.last = end;
+}
+
+/**
+ * @brief tim7中断，按异常返回值选择被打断处使用的栈，取出栈帧交给采样函数。
+ */
+NAKED ITCM void TIM7_IRQHandler(void)
+{
+    __asm volatile("tst lr, #4       \n"
+                   "ite eq           \n"
+                   "mrseq r0, msp    \n"
+                   "mrsne r0, psp    \n"
+                   "b profile_sample \n");
+}
+
+void profile_enable(bool on)
+{
+    if (on)
+    {
+        profile.last = DWT->CYCCNT;
+        NVIC_EnableIRQ(TIM7_IRQn);
+    }
+    else
+    {
+        NVIC_DisableIRQ(TIM7_IRQn);
+    }
+}
+
+void profile_clear(void)
+{
+    const bool on = NVIC_GetEnableIRQ(TIM7_IRQn);
+    NVIC_DisableIRQ(TIM7_IRQn);
+    memset(profile_hist, 0, sizeof(profile_hist));
+    memset(&profile.stat, 0, sizeof(profile.stat));
+    profile_enable(on);
+}
+
+void profile_get_stat(profile_stat_t *stat)
+{
+    const bool on = NVIC_GetEnableIRQ(TIM7_IRQn);
+    NVIC_DisableIRQ(TIM7_IRQn);
+    *stat = profile.stat;
+    if (on)
+        NVIC_EnableIRQ(TIM7_IRQn);
+}
+
+/**
+ * @brief 发出一帧，先等待发送缓冲区清空，使整帧一次放入缓冲区，
+ * 不与其他线程的日志交错。
+ * 帧缓冲区为静态变量，不占用分析器线程1K的栈，只能在该线程中调用。
+ * @param type 帧类型。
+ * @param seq 帧序号。
+ * @param payload 负载。
+ * @param len 负载字节数。
+ */
+static void profile_send_frame(uint8_t type, uint8_t seq, const void *payload,
+                               uint16_t len)
+{
+    const profile_frame_head_t head = {
+        .magic = PROFILE_MAGIC, .type = type, .seq = seq, .len = len};
+    static uint8_t frame[sizeof(head) + sizeof(profile_frame_entry_t) *
+                                            PROFILE_FRAME_ENTRIES +
+                         sizeof(uint16_t)];
+
+    memcpy(frame, &head, sizeof(head));
+    memcpy(&frame[sizeof(head)], payload, len);
+    const uint16_t crc =
+        algo_crc16(&frame[offsetof(profile_frame_head_t, type)],
+                   sizeof(head) - offsetof(profile_frame_head_t, type) + len);
+    memcpy(&frame[sizeof(head) + len], &crc, sizeof(crc));
+
+    bsp_uart_flush(BSP_UART_USART1);
+    bsp_uart_write(BSP_UART_USART1, frame, sizeof(head) + len + sizeof(crc));
+}
+
+void profile_dump(void)
+{
+    uint8_t seq = 0;
+
+    profile_frame_start_t start = {
+        .rate = PROFILE_RATE_HZ,
+        .shift = profile.shift,
+        .itcm_start = profile.itcm_start,
+        .itcm_len = profile.itcm_len,
+        .code_start = profile.code_start,
+        .code_len = profile.code_len,
+    };
+    profile_stat_t stat;
+    profile_get_stat(&stat);
+    start.samples = stat.samples;
+    start.other = stat.other;
+    start.cycles = stat.cycles;
+    start.elapsed = stat.elapsed;
+    profile_send_frame(PROFILE_FRAME_START, seq++, &start, sizeof(start));
+
+    // 采样继续进行，各区间的计数是逐个读取的近似快照，
+    // 与帧缓冲区一样放在栈外，留出日志格式化浮点数所需的栈
+    static profile_frame_entry_t entries[PROFILE_FRAME_ENTRIES];
+    uint32_t count = 0;
+    uint32_t total = 0;
+    const uint32_t used = profile.itcm_buckets +
+                          ((profile.code_len + (1u << profile.shift) - 1) >>
+                           profile.shift);
+    for (uint32_t i = 0; i < used; ++i)
+    {
+        if (profile_hist[i] == 0)
+            continue;
+
+        entries[count].addr =
+            (i < profile.itcm_buckets)
+                ? profile.itcm_start + (i << profile.shift)
+                : profile.code_start +
+                      ((i - profile.itcm_buckets) << profile.shift);
+        entries[count].count = profile_hist[i];
+        if (++count == PROFILE_FRAME_ENTRIES)
+        {
+            profile_send_frame(PROFILE_FRAME_DATA, seq++, entries,
+                               count * sizeof(entries[0]));
+            total += count;
+            count = 0;
+        }
+    }
+    if (count > 0)
+    {
+        profile_send_frame(PROFILE_FRAME_DATA, seq++, entries,
+                           count * sizeof(entries[0]));
+        total += count;
+    }
+    profile_send_frame(PROFILE_FRAME_END, seq, &total, sizeof(total));
+
+    LOG_I("profile dump: %u samples, %u outside code, %u buckets, "
+          "overhead %.3f%%",
+          stat.samples, stat.other, total,
+          stat.elapsed ? 100.0 * stat.cycles / stat.elapsed : 0.0);
+}
+
+/**
+ * @brief 配置tim7按PROFILE_RATE_HZ产生更新中断。
+ */
+static void profile_timer_init(void)
+{
+    LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_TIM7);
+
+    // apb1分频不为1时定时器时钟为pclk1的2倍
+    uint32_t clock = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->D2CFGR & RCC_D2CFGR_D2PPRE1) != RCC_D2CFGR_D2PPRE1_DIV1)
+        clock *= 2;
+
+    const uint32_t period = clock / PROFILE_RATE_HZ;
+    const uint32_t prescaler = period / 0x10000;
+    TIM7->CR1 = 0;
+    TIM7->PSC = prescaler;
+    TIM7->ARR = period / (prescaler + 1) - 1;
+    TIM7->EGR = TIM_EGR_UG;
+    TIM7->SR = 0;
+    TIM7->DIER = TIM_DIER_UIE;
+    TIM7->CR1 = TIM_CR1_CEN;
+
+    // 最高优先级，中断服务程序中的热点同样可以采到
+    NVIC_SetPriority(TIM7_IRQn,
+                     NVIC_EncodePriority(NVIC_GetPriorityGrouping(), 0, 0));
+}
+
+/**
+ * @brief 处理usart1收到的命令，没有命令时返回。
+ */
+static void profile_poll_command(void)
+{
+    if (LL_USART_IsActiveFlag_ORE(USART1))
+        LL_USART_ClearFlag_ORE(USART1);
+    if (!LL_USART_IsActiveFlag_RXNE_RXFNE(USART1))
+        return;
+
+    switch (LL_USART_ReceiveData8(USART1))
+    {
+    case PROFILE_CMD_DUMP:
+        profile_dump();
+        break;
+    case PROFILE_CMD_CLEAR:
+        profile_clear();
+        LOG_I("profile clear");
+        break;
+    case PROFILE_CMD_PAUSE:
+    {
+        const bool on = !NVIC_GetEnableIRQ(TIM7_IRQn);
+        profile_enable(on);
+        LOG_I("profile %s", on ? "resume" : "pause");
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief 采样分析器线程，轮询usart1上的命令并按周期输出直方图。
+ * @param parameter 线程名称字符串。
+ */
+static void profile_thread_entry(void *parameter)
+{
+    rt_tick_t last_dump = rt_tick_get();
+
+    while (1)
+    {
+        profile_poll_command();
+
+#if PROFILE_DUMP_PERIOD_MS
+        if ((rt_tick_get() - last_dump) >=
+            rt_tick_from_millisecond(PROFILE_DUMP_PERIOD_MS))
+        {
+            profile_dump();
+            last_dump = rt_tick_get();
+        }
+#else
+        UNUSE_VAR(last_dump);
+#endif
+
+        rt_thread_mdelay(100);
+    }
+}
+
+/**
+ * @brief 划分直方图并启动采样与分析器线程。
+ * @return int 非0为失败。
+ */
+static int profile_thread_init(void)
+{
+    profile.itcm_start = (uint32_t)_itcm_ram_start;
+    profile.itcm_len = (uint32_t)_itcm_ram_end - (uint32_t)_itcm_ram_start;
+    profile.code_start = (uint32_t)_code_start;
+    profile.code_len = (uint32_t)_code_end - (uint32_t)_code_start;
+
+    // 取能容纳全部代码的最小区间宽度，至少为一条thumb指令
+    profile.shift = 1;
+    while ((((profile.itcm_len + (1u << profile.shift) - 1) >> profile.shift) +
+            ((profile.code_len + (1u << profile.shift) - 1) >>
+             profile.shift)) > PROFILE_BUCKETS)
+    {
+        profile.shift++;
+    }
+    profile.itcm_buckets =
+        (profile.itcm_len + (1u << profile.shift) - 1) >> profile.shift;
+    LOG_I("profile %u Hz, %u byte buckets", PROFILE_RATE_HZ,
+          1u << profile.shift);
+
+    profile_timer_init();
+    profile_clear();
+    profile_enable(true);
+
+    const char *const name = "profile";
+    rt_err_t result = RT_EOK;
+    rt_thread_t tid = rt_thread_create(name, profile_thread_entry, (void *)name,
+                                       1024, RT_THREAD_PRIORITY_MAX - 2, 0);
+    if (tid != NULL)
+    {
+        LOG_I("<thread:%s> create success", name);
+        result = rt_thread_startup(tid);
+        if (result == RT_EOK)
+        {
+            LOG_I("<thread:%s> startup success", name);
+        }
+        else
+        {
+            LOG_E("<thread:%s> startup fail with %d", name, result);
+        }
+    }
+    else
+    {
+        result = RT_ENOMEM;
+        LOG_E("<thread:%s> create fail", name);
+    }
+    return result;
+}
+RUN_APP_EXPORT(profile_thread_init);
+
+#endif
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""比较 detools 各压缩算法的补丁大小、传输时间与目标板解码开销。
+
+对每一对新旧固件分别用各压缩算法生成补丁，按 YModem 1K 帧格式估算
+串口传输时间。目标板还原时 detools_port 会输出如下日志：
+
+    scan pass: codec heatshrink, 41.27 cycles/byte, arena peak 1336 bytes
+
+用 --log 传入这些日志后，表格中补充每字节解码周期数与解压器内存峰值。
+目标板只编译了 crle 与 heatshrink，lzma 仅用于比较补丁大小。
+
+用法：
+    codec_matrix.py old_user.bin:new_user.bin old_oem.bin:new_oem.bin \\
+        --baud 921600 --log boot_crle.log --log boot_heatshrink.log
+"""
+
+import argparse
+import io
+import re
+
+import detools
+
+CODECS = ("crle", "heatshrink", "lzma", "none")
+
+LOG_PATTERN = re.compile(r"codec (\w+), ([\d.]+) cycles/byte, "
+                         r"arena peak (\d+) bytes")
+
+YMODEM_BLOCK = 1024
+YMODEM_FRAME = 3 + YMODEM_BLOCK + 2
+YMODEM_HEADER = 3 + 128 + 2
+
+
+def create_patch(old, new, codec, window_sz2, lookahead_sz2):
+    fpatch = io.BytesIO()
+    detools.create_patch(io.BytesIO(old), io.BytesIO(new), fpatch,
+                         compression=codec,
+                         heatshrink_window_sz2=window_sz2,
+                         heatshrink_lookahead_sz2=lookahead_sz2)
+    return fpatch.getvalue()
+
+
+def transfer_seconds(size, baud):
+    # 文件头帧、数据帧与结束时的空文件头帧，每字节10位
+    frames = (size + YMODEM_BLOCK - 1) // YMODEM_BLOCK
+    wire = 2 * YMODEM_HEADER + frames * YMODEM_FRAME
+    return wire * 10 / baud
+
+
+def parse_logs(paths):
+    target = {}
+    for path in paths:
+        with open(path, encoding="utf-8", errors="replace") as f:
+            for line in f:
+                match = LOG_PATTERN.search(line)
+                if match:
+                    target[match.group(1)] = (float(match.group(2)),
+                                              int(match.group(3)))
+    return target
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("pairs", nargs="+", metavar="OLD:NEW",
+                        help="旧固件与新固件，冒号分隔")
+    parser.add_argument("--baud", type=int, default=115200,
+                        help="YModem 串口波特率")
+    parser.add_argument("--window-sz2", type=int, default=8,
+                        help="heatshrink 窗口位数")
+    parser.add_argument("--lookahead-sz2", type=int, default=4,
+                        help="heatshrink 前瞻位数")
+    parser.add_argument("--log", action="append", default=[],
+                        help="目标板还原日志，可重复")
+    args = parser.parse_args()
+
+    target = parse_logs(args.log)
+
+    print("| pair | codec | patch bytes | ratio | transfer s "
+          "| cycles/byte | arena peak |")
+    print("|---|---|---:|---:|---:|---:|---:|")
+    for pair in args.pairs:
+        old_path, new_path = pair.split(":", 1)
+        with open(old_path, "rb") as f:
+            old = f.read()
+        with open(new_path, "rb") as f:
+            new = f.read()
+
+        for codec in CODECS:
+            patch = create_patch(old, new, codec, args.window_sz2,
+                                 args.lookahead_sz2)
+            cycles, peak = target.get(codec, (None, None))
+            print("| {} | {} | {} | {:.1f}% | {:.2f} | {} | {} |".format(
+                pair, codec, len(patch), 100 * len(patch) / len(new),
+                transfer_seconds(len(patch), args.baud),
+                "-" if cycles is None else "{:.2f}".format(cycles),
+                "-" if peak is None else peak))
+
+
+if __name__ == "__main__":
+    main()
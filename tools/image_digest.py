@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""为固件或补丁文件追加镜像摘要尾部。
+
+尾部描述最终写入 app 分区的镜像，与 include/algo/digest.h 中的
+algo_image_trailer_t 一致：
+
+    uint32_t magic;      "DBTL"
+    uint32_t image_size; 镜像字节数
+    uint32_t crc32;      CRC-32/ISO-HDLC
+    uint8_t  sha256[32];
+
+用法：
+    固件:  image_digest.py user.bin
+    补丁:  image_digest.py user.patch --image new_user.bin
+"""
+
+import argparse
+import hashlib
+import struct
+import zlib
+
+TRAILER_MAGIC = 0x4C544244
+TRAILER_FORMAT = "<III32s"
+
+
+def build_trailer(image):
+    return struct.pack(TRAILER_FORMAT, TRAILER_MAGIC, len(image),
+                       zlib.crc32(image) & 0xFFFFFFFF,
+                       hashlib.sha256(image).digest())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("file", help="待发送的固件或补丁文件，原地追加尾部")
+    parser.add_argument("--image",
+                        help="补丁还原后的新固件，缺省时对 file 本身计算摘要")
+    args = parser.parse_args()
+
+    with open(args.file, "rb") as f:
+        data = f.read()
+
+    if len(data) >= struct.calcsize(TRAILER_FORMAT):
+        magic, = struct.unpack_from(
+            "<I", data, len(data) - struct.calcsize(TRAILER_FORMAT))
+        if magic == TRAILER_MAGIC:
+            parser.error("{} already has a digest trailer".format(args.file))
+
+    if args.image:
+        with open(args.image, "rb") as f:
+            image = f.read()
+    else:
+        image = data
+
+    trailer = build_trailer(image)
+    with open(args.file, "ab") as f:
+        f.write(trailer)
+
+    print("{}: image {} bytes, crc32 0x{:08X}".format(
+        args.file, len(image), zlib.crc32(image) & 0xFFFFFFFF))
+
+
+if __name__ == "__main__":
+    main()
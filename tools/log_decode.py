@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+"""把延迟格式化日志的原始记录还原为文本。
+
+rt_kprintf 只记录格式字符串地址、系统 tick 与原始参数，格式字符串通过
+固件 elf 查找。支持两种输入：
+
+    --stream 串口抓包，ASYNC_LOG_BINARY 为 1 时 log 线程输出的原始记录；
+    --dump   内存转储，例如 gdb 中 dump binary memory dtcm.bin 0x20000000
+             0x20020000，解码 log_rb 中尚未输出的记录，--history 时
+             尽量恢复整个缓冲区中残留的旧记录。
+
+用法：
+    log_decode.py build/diffboot.elf --stream uart1.bin
+    log_decode.py build/diffboot.elf --dump dtcm.bin --base 0x20000000
+"""
+
+import argparse
+import struct
+import sys
+
+SYNC = 0xA5
+HEADER = struct.Struct("<BBHII")
+
+
+class Elf:
+    """只解析 32 位小端 elf 中需要的部分：分配段与符号表。"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1:
+            raise ValueError("not a 32-bit elf")
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+
+        self.sections = []
+        for i in range(shnum):
+            (name, stype, flags, addr, offset, size, link, info, align,
+             entsize) = struct.unpack_from("<10I", self.data,
+                                           shoff + i * shentsize)
+            self.sections.append((stype, flags, addr, offset, size, link))
+
+        self.symbols = {}
+        for stype, _, _, offset, size, link in self.sections:
+            if stype != 2:  # SHT_SYMTAB
+                continue
+            strtab = self.sections[link][3]
+            for pos in range(offset, offset + size, 16):
+                name, value, _, _, _, _ = struct.unpack_from(
+                    "<IIIBBH", self.data, pos)
+                end = self.data.index(b"\0", strtab + name)
+                self.symbols.setdefault(
+                    self.data[strtab + name:end].decode(), value)
+
+    def read(self, addr, size):
+        for stype, flags, start, offset, length, _ in self.sections:
+            # 只在有内容的分配段中查找 (SHT_PROGBITS, SHF_ALLOC)
+            if stype == 1 and flags & 2 and start <= addr < start + length:
+                return self.data[offset + addr - start:
+                                 offset + min(addr + size, start + length)
+                                 - start]
+        return None
+
+    def string(self, addr):
+        data = self.read(addr, 512)
+        if data is None or b"\0" not in data:
+            return None
+        return data[:data.index(b"\0")].decode("utf-8", "replace")
+
+
+def parse_spec(fmt, i):
+    """与 kservice.c 中 rt_log_parse_spec 一致，i 指向 '%' 之后。"""
+    start = i
+    while i < len(fmt) and fmt[i] in "-+ #0":
+        i += 1
+    stars = 0
+    if i < len(fmt) and fmt[i] == "*":
+        stars += 1
+        i += 1
+    while i < len(fmt) and fmt[i].isdigit():
+        i += 1
+    if i < len(fmt) and fmt[i] == ".":
+        i += 1
+        if i < len(fmt) and fmt[i] == "*":
+            stars += 1
+            i += 1
+        while i < len(fmt) and fmt[i].isdigit():
+            i += 1
+    body_end = i
+    wide = False
+    if fmt.startswith("ll", i):
+        wide = True
+        i += 2
+    elif i < len(fmt) and fmt[i] in "lhz":
+        i += 2 if fmt.startswith("hh", i) else 1
+    if i >= len(fmt):
+        return i, fmt[start:body_end], stars, "", wide
+    return i + 1, fmt[start:body_end], stars, fmt[i], wide
+
+
+def render(fmt, payload):
+    out = []
+    pos = 0
+    i = 0
+
+    def take(size):
+        nonlocal pos
+        if pos + size > len(payload):
+            return None
+        value = payload[pos:pos + size]
+        pos += size
+        return value
+
+    while i < len(fmt):
+        if fmt[i] != "%":
+            out.append(fmt[i])
+            i += 1
+            continue
+        i, body, stars, conv, wide = parse_spec(fmt, i + 1)
+        for _ in range(stars):
+            star = take(4)
+            star = struct.unpack("<i", star)[0] if star else 0
+            body = body.replace("*", str(star), 1)
+
+        if conv in "diuoxXcp" and conv:
+            raw = take(8 if wide and conv not in "cp" else 4)
+            if raw is None:
+                out.append("?")
+                continue
+            signed = conv in "di"
+            value = int.from_bytes(raw, "little", signed=signed)
+            if conv == "c":
+                out.append(("%" + body + "c") % chr(value & 0xFF))
+            elif conv == "p":
+                out.append(("%" + body + "#x") % value)
+            else:
+                out.append(("%" + body + ("d" if conv == "u" else conv))
+                           % value)
+        elif conv in "fF" and conv:
+            raw = take(8)
+            if raw is None:
+                out.append("?")
+                continue
+            out.append(("%" + body + "f") % struct.unpack("<d", raw)[0])
+        elif conv == "s":
+            raw = take(4)
+            if raw is None:
+                out.append("?")
+                continue
+            size, = struct.unpack("<I", raw)
+            text = take((size + 3) & ~3) or b""
+            out.append(("%" + body + "s")
+                       % text[:size].decode("utf-8", "replace"))
+        elif conv == "%":
+            out.append("%")
+        else:
+            out.append(conv)
+    return "".join(out)
+
+
+def records(elf, data, resync):
+    """逐条解析记录，resync 时跳过无法解析的字节继续查找。"""
+    pos = 0
+    while pos + HEADER.size <= len(data):
+        sync, words, seq, tick, fmt_addr = HEADER.unpack_from(data, pos)
+        fmt = elf.string(fmt_addr) if sync == SYNC and words >= 3 else None
+        if fmt is None or pos + words * 4 > len(data):
+            if not resync:
+                break
+            pos += 1 if resync == "byte" else 4
+            continue
+        yield seq, tick, render(fmt, data[pos + HEADER.size:pos + words * 4])
+        pos += words * 4
+
+
+def from_dump(elf, dump, base, history):
+    def load(addr, size):
+        return dump[addr - base:addr - base + size]
+
+    rb = elf.symbols.get("log_rb")
+    if rb is None:
+        sys.exit("log_rb not found in elf symbols")
+    buf, mask, write, read = struct.unpack("<4I", load(rb, 16))
+    pool = load(buf, mask + 1)
+    if history:
+        # 写位置之后是最旧的数据，可能从一条记录中间开始
+        start = write - (mask + 1) if write > mask else 0
+        resync = "word"
+    else:
+        start = read
+        resync = None
+    data = bytes(pool[(start + i) & mask] for i in range(write - start))
+    return records(elf, data, resync)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="固件 elf 文件")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--stream", help="串口抓包的原始记录")
+    source.add_argument("--dump", help="包含 log_rb 与 log_pool 的内存转储")
+    parser.add_argument("--base", type=lambda x: int(x, 0), default=0x20000000,
+                        help="内存转储的起始地址")
+    parser.add_argument("--history", action="store_true",
+                        help="恢复缓冲区中已输出的旧记录")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+    if args.stream:
+        with open(args.stream, "rb") as f:
+            entries = records(elf, f.read(), "byte")
+    else:
+        with open(args.dump, "rb") as f:
+            entries = from_dump(elf, f.read(), args.base, args.history)
+
+    last = None
+    for seq, tick, text in entries:
+        if last is not None and (seq - last - 1) & 0xFFFF:
+            print("<{} records lost>".format((seq - last - 1) & 0xFFFF))
+        last = seq
+        sys.stdout.write("[{:>10}] {}".format(tick, text))
+        if not text.endswith("\n"):
+            sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
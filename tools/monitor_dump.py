@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""解码监视器线程的调度统计记录。
+
+目标板每个周期在 usart1 上输出一帧记录，帧格式与采样分析器相同，
+见 include/thread/monitor.h 与 source/thread/monitor.c：
+
+    magic "MNTR" | type u8 | seq u8 | len u16 | 负载 | crc16(XMODEM)
+
+负载为记录头、各中断的延迟统计与各线程条目。延迟按周期数的 log2 分区，
+区间 0 为小于 1 << shift 个周期，区间 i 的上界为 1 << (shift + i)。
+
+用法：
+    monitor_dump.py --capture uart1.bin
+    monitor_dump.py --port COM5 --baud 921600 --follow
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+from profile_dump import frames
+
+MAGIC = b"MNTR"
+RECORD = struct.Struct("<III4B")
+LAT_MAX = struct.Struct("<I")
+THREAD = struct.Struct("<8sB3xII")
+ISR_NAMES = ["uart4"]
+
+
+def parse_lat(payload, pos, buckets):
+    """返回 (最大延迟, 直方图) 与之后的位置。"""
+    peak, = LAT_MAX.unpack_from(payload, pos)
+    pos += LAT_MAX.size
+    hist = struct.unpack_from("<{}H".format(buckets), payload, pos)
+    return (peak, hist), pos + 2 * buckets
+
+
+def parse_record(payload):
+    clock, elapsed, sleep, threads, isrs, buckets, shift = \
+        RECORD.unpack_from(payload)
+    pos = RECORD.size
+    record = {"clock": clock, "elapsed": elapsed, "sleep": sleep,
+              "shift": shift, "isrs": [], "threads": []}
+    for _ in range(isrs):
+        lat, pos = parse_lat(payload, pos, buckets)
+        record["isrs"].append(lat)
+    for _ in range(threads):
+        name, prio, cycles, switches = THREAD.unpack_from(payload, pos)
+        lat, pos = parse_lat(payload, pos + THREAD.size, buckets)
+        record["threads"].append({
+            "name": name.split(b"\0")[0].decode("ascii", "replace"),
+            "prio": prio, "cycles": cycles, "switches": switches,
+            "lat": lat})
+    return record
+
+
+def records(data):
+    """返回 (序号, 记录) 列表，丢弃校验失败的帧。"""
+    return [(seq, parse_record(payload))
+            for _, seq, payload in frames(data, MAGIC)]
+
+
+def percentile(hist, ratio):
+    """返回覆盖 ratio 比例样本的区间序号。"""
+    total = sum(hist)
+    acc = 0
+    for i, count in enumerate(hist):
+        acc += count
+        if acc >= total * ratio:
+            return i
+    return len(hist) - 1
+
+
+def us(cycles, clock):
+    return 1e6 * cycles / clock if clock else 0.0
+
+
+def bound(index, lat, shift, clock):
+    """区间上界的微秒数，不超过最大延迟。"""
+    peak, hist = lat
+    if index < len(hist) - 1:
+        peak = min(peak, 1 << (shift + index))
+    return "{:.1f}".format(us(peak, clock))
+
+
+def describe_lat(lat, shift, clock):
+    peak, hist = lat
+    count = sum(hist)
+    if count == 0:
+        return "{:>6} {:>9} {:>9} {:>9}".format(0, "-", "-", "-")
+    return "{:>6} {:>9} {:>9} {:>9.1f}".format(
+        count, bound(percentile(hist, 0.5), lat, shift, clock),
+        bound(percentile(hist, 0.99), lat, shift, clock),
+        us(peak, clock))
+
+
+def show(seq, record):
+    clock, shift = record["clock"], record["shift"]
+    elapsed = record["elapsed"] or 1
+    print("#{:<3} {:.1f} ms, idle sleep {} lptim ticks".format(
+        seq, us(record["elapsed"], clock) / 1000, record["sleep"]))
+    print("  {:<10}{:>4} {:>7} {:>7} {:>6} {:>9} {:>9} {:>9}".format(
+        "thread", "pri", "cpu%", "switch", "wake", "p50 us", "p99 us",
+        "max us"))
+    for t in sorted(record["threads"], key=lambda t: -t["cycles"]):
+        print("  {:<10}{:>4} {:>7.2f} {:>7} {}".format(
+            t["name"], t["prio"], 100.0 * t["cycles"] / elapsed,
+            t["switches"], describe_lat(t["lat"], shift, clock)))
+    for i, lat in enumerate(record["isrs"]):
+        name = ISR_NAMES[i] if i < len(ISR_NAMES) else "isr{}".format(i)
+        print("  {:<10}{:>4} {:>7} {:>7} {}".format(
+            "isr:" + name, "", "", "", describe_lat(lat, shift, clock)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--capture", help="串口抓包文件")
+    source.add_argument("--port", help="串口名称")
+    parser.add_argument("--baud", type=int, default=115200, help="串口波特率")
+    parser.add_argument("--follow", action="store_true",
+                        help="持续读取串口并逐条输出")
+    parser.add_argument("--last", type=int, default=0,
+                        help="只显示最后几条记录，0为全部")
+    args = parser.parse_args()
+
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            found = records(f.read())
+        if not found:
+            sys.exit("no monitor record found")
+        for seq, record in found[-args.last:] if args.last else found:
+            show(seq, record)
+        return
+
+    import serial
+
+    data = bytearray()
+    with serial.Serial(args.port, args.baud, timeout=0.1) as link:
+        while True:
+            data += link.read(4096)
+            # 最后一个魔数之前的数据已经可以完整解析
+            cut = data.rfind(MAGIC)
+            if cut > 0:
+                for seq, record in records(bytes(data[:cut])):
+                    show(seq, record)
+                del data[:cut]
+            if not args.follow and cut > 0:
+                break
+            time.sleep(0.05)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,361 @@
+#!/usr/bin/env python3
+"""根据 pc 采样结果生成 itcm/dtcm 放置片段，并报告 tcm 利用率。
+
+链接脚本按输入段在脚本中首次匹配的位置分配，placement.ld 中的
+PLACEMENT_ITCM 与 PLACEMENT_DTCM 在普通代码段与常量数据段之前匹配，
+被列出的 .text.<函数> 放入 itcm，.rodata.<常量> 放入 dtcm。
+编译选项需保持每个函数、每个数据一个段。
+
+采样文件每行为 "<采样数> <符号>"，# 开头为注释，
+可由 tools/profile_dump.py 生成，也可以手工整理 dwt 计时结果。
+
+    generate 按每字节采样数从高到低贪心选择函数，直到 itcm 余量用完；
+             热点函数字面量池中引用的只读对象按引用函数的采样数排序，
+             在 --dtcm-budget 内放入 dtcm。
+    report   构建后输出 itcm/dtcm 利用率与 placement.ld 放置的符号。
+
+用法：
+    placement.py generate build/diffboot.elf profile.txt \\
+        -o bsp/include/stm32h743iit6/placement.ld
+    placement.py report build/diffboot.elf \\
+        --fragment bsp/include/stm32h743iit6/placement.ld
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+STT_OBJECT = 1
+STT_FUNC = 2
+
+# 在复制 itcm 之前运行的函数，不能放入 itcm
+RESET_FUNCTIONS = ("reset_handler", "reset_copy_ram_init",
+                   "reset_clear_ram_uninit", "fpu_init", "rcc_init",
+                   "ram_init")
+
+PATTERN = re.compile(r"\*\(\.(text|rodata)\.([^\s)]+)\)")
+
+
+class Elf:
+    """只解析 32 位小端 elf 中需要的部分：段表与符号表。"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1:
+            raise ValueError("not a 32-bit elf")
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data,
+                                                        0x2E)
+
+        headers = [struct.unpack_from("<10I", self.data, shoff + i * shentsize)
+                   for i in range(shnum)]
+        names = headers[shstrndx][4]
+        self.sections = []
+        for name, stype, flags, addr, offset, size, link, _, _, _ in headers:
+            self.sections.append({
+                "name": self.cstring(names + name),
+                "type": stype,
+                "flags": flags,
+                "addr": addr,
+                "offset": offset,
+                "size": size,
+                "link": link,
+            })
+
+        self.symbols = []
+        self.values = {}
+        for section in self.sections:
+            if section["type"] != 2:  # SHT_SYMTAB
+                continue
+            strtab = self.sections[section["link"]]["offset"]
+            for pos in range(section["offset"],
+                             section["offset"] + section["size"], 16):
+                name, value, size, info, _, shndx = struct.unpack_from(
+                    "<IIIBBH", self.data, pos)
+                name = self.cstring(strtab + name)
+                self.values.setdefault(name, value)
+                if (info & 0xF) not in (STT_FUNC, STT_OBJECT) or size == 0:
+                    continue
+                if shndx >= len(self.sections):
+                    continue
+                self.symbols.append({
+                    "name": name,
+                    "addr": value & ~1,
+                    "size": size,
+                    "type": info & 0xF,
+                    "section": self.sections[shndx]["name"],
+                })
+
+    def cstring(self, pos):
+        return self.data[pos:self.data.index(b"\0", pos)].decode()
+
+    def section(self, name):
+        for section in self.sections:
+            if section["name"] == name:
+                return section
+        return None
+
+    def section_size(self, name):
+        section = self.section(name)
+        return section["size"] if section else 0
+
+    def read(self, addr, size):
+        for section in self.sections:
+            # 只在有内容的分配段中查找 (SHT_PROGBITS, SHF_ALLOC)
+            start = section["addr"]
+            if (section["type"] == 1 and section["flags"] & 2
+                    and start <= addr < start + section["size"]):
+                offset = section["offset"] + addr - start
+                return self.data[offset:offset + size]
+        return b""
+
+
+def read_profile(path):
+    samples = {}
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            line = line.split("#", 1)[0].split()
+            if len(line) >= 2:
+                samples[line[1]] = samples.get(line[1], 0) + int(line[0])
+    return samples
+
+
+def read_fragment(path):
+    """返回片段中已放置的函数与常量名。"""
+    placed = {"text": [], "rodata": []}
+    if path and os.path.exists(path):
+        with open(path, encoding="utf-8") as f:
+            for kind, name in PATTERN.findall(f.read()):
+                placed[kind].append(name)
+    return placed
+
+
+def group(symbols, kind):
+    """按名称合并同名的静态符号，它们会被同一条规则一起放置。"""
+    result = {}
+    for symbol in symbols:
+        if symbol["type"] != kind:
+            continue
+        entry = result.setdefault(symbol["name"], {
+            "name": symbol["name"], "size": 0, "sections": set(),
+            "ranges": []})
+        entry["size"] += (symbol["size"] + 3) & ~3
+        entry["sections"].add(symbol["section"])
+        entry["ranges"].append((symbol["addr"], symbol["size"]))
+    return result
+
+
+def itcm_capacity(elf):
+    itcm = elf.section(".itcm")
+    end = elf.values.get("_itcm_region_end")
+    if itcm is None or end is None:
+        sys.exit("elf has no .itcm section or _itcm_region_end symbol")
+    return end - itcm["addr"]
+
+
+def dtcm_capacity(elf):
+    start = elf.values.get("_dtcm_const_start")
+    end = elf.values.get("_stack_start")
+    if start is None or end is None:
+        sys.exit("elf has no _dtcm_const_start or _stack_start symbol")
+    return end - start
+
+
+def percent(part, whole):
+    return 100.0 * part / whole if whole else 0.0
+
+
+def select_text(elf, samples, placed, reserve, exclude):
+    functions = group(elf.symbols, STT_FUNC)
+    capacity = itcm_capacity(elf)
+
+    # 当前片段放置的函数会被重新选择，余量只扣除手工标记的部分
+    fixed = elf.section_size(".itcm") - sum(
+        functions[name]["size"] for name in placed["text"]
+        if name in functions and ".itcm" in functions[name]["sections"])
+    budget = capacity - fixed - reserve
+
+    candidates = []
+    for name, count in samples.items():
+        entry = functions.get(name)
+        if entry is None or count <= 0 or name in exclude:
+            continue
+        # 手工标记ITCM的函数位于.itcm段且不在片段中
+        if ".itcm" in entry["sections"] and name not in placed["text"]:
+            continue
+        candidates.append((count / entry["size"], count, entry))
+    candidates.sort(key=lambda item: (-item[0], item[2]["name"]))
+
+    chosen = []
+    for _, count, entry in candidates:
+        if entry["size"] <= budget:
+            budget -= entry["size"]
+            chosen.append((entry, count))
+    return chosen, capacity, fixed
+
+
+def select_rodata(elf, samples, budget, exclude):
+    functions = group(elf.symbols, STT_FUNC)
+    objects = group(elf.symbols, STT_OBJECT)
+    movable = {".const", ".dtcm_const"}
+
+    spans = []
+    for entry in objects.values():
+        if entry["name"] in exclude or not entry["sections"] <= movable:
+            continue
+        for addr, size in entry["ranges"]:
+            spans.append((addr, addr + size, entry))
+
+    # 字面量池按4字节对齐，扫描热点函数中落在只读对象内的字
+    weight = {}
+    for name, count in samples.items():
+        entry = functions.get(name)
+        if entry is None or count <= 0:
+            continue
+        for addr, size in entry["ranges"]:
+            code = elf.read(addr, size)
+            for pos in range((-addr) & 3, len(code) - 3, 4):
+                word, = struct.unpack_from("<I", code, pos)
+                for start, end, obj in spans:
+                    if start <= word < end:
+                        weight[obj["name"]] = weight.get(obj["name"],
+                                                         0) + count
+                        break
+
+    candidates = sorted(((count / objects[name]["size"], count, objects[name])
+                         for name, count in weight.items()),
+                        key=lambda item: (-item[0], item[2]["name"]))
+    chosen = []
+    for _, count, entry in candidates:
+        if entry["size"] <= budget:
+            budget -= entry["size"]
+            chosen.append((entry, count))
+    return chosen
+
+
+def write_fragment(path, profile, text, rodata, total):
+    def rules(macro, prefix, chosen):
+        if not chosen:
+            return "#define {}\n".format(macro)
+        lines = ["#define {} \\".format(macro)]
+        for i, (entry, _) in enumerate(chosen):
+            tail = " \\" if i + 1 < len(chosen) else ""
+            lines.append("    *(.{}.{}){}".format(prefix, entry["name"], tail))
+        return "\n".join(lines) + "\n"
+
+    def summary(chosen):
+        size = sum(entry["size"] for entry, _ in chosen)
+        count = sum(count for _, count in chosen)
+        return "{} symbols, {} bytes, {:.1f}% of samples".format(
+            len(chosen), size, percent(count, total))
+
+    with open(path, "w", encoding="utf-8", newline="\n") as f:
+        f.write("/**\n"
+                " * @file placement.ld\n"
+                " * @brief 由tools/placement.py根据pc采样生成，不要手工修改。\n"
+                " * profile: {}\n"
+                " */\n\n".format(os.path.basename(profile)))
+        f.write("#ifndef _PLACEMENT_LD_\n#define _PLACEMENT_LD_\n\n")
+        f.write("/* itcm: {} */\n".format(summary(text)))
+        f.write(rules("PLACEMENT_ITCM", "text", text))
+        f.write("\n/* dtcm: {} */\n".format(summary(rodata)))
+        f.write(rules("PLACEMENT_DTCM", "rodata", rodata))
+        f.write("\n#endif\n")
+
+
+def report(elf, placed, samples=None):
+    total = sum(samples.values()) if samples else 0
+    functions = group(elf.symbols, STT_FUNC)
+    objects = group(elf.symbols, STT_OBJECT)
+
+    itcm_size = itcm_capacity(elf)
+    itcm_used = elf.section_size(".itcm")
+    profiled = sum(functions[name]["size"] for name in placed["text"]
+                   if name in functions
+                   and ".itcm" in functions[name]["sections"])
+    print("itcm: {} / {} bytes ({:.1f}%), tagged {}, profile {}".format(
+        itcm_used, itcm_size, percent(itcm_used, itcm_size),
+        itcm_used - profiled, profiled))
+
+    dtcm_size = dtcm_capacity(elf)
+    parts = [(name, elf.section_size(section)) for name, section in (
+        ("const", ".dtcm_const"), ("data", ".dtcm_init"),
+        ("bss", ".dtcm_uninit"), ("stack", ".stack"))]
+    dtcm_used = sum(size for _, size in parts)
+    print("dtcm: {} / {} bytes ({:.1f}%), {}, heap {}".format(
+        dtcm_used, dtcm_size, percent(dtcm_used, dtcm_size),
+        ", ".join("{} {}".format(name, size) for name, size in parts),
+        dtcm_size - dtcm_used))
+
+    for region, kind, table, home in (("itcm", "text", functions, ".itcm"),
+                                      ("dtcm", "rodata", objects,
+                                       ".dtcm_const")):
+        for name in placed[kind]:
+            entry = table.get(name)
+            if entry is None:
+                # 函数被改名、内联或被链接器丢弃
+                print("{}  {:<40} missing".format(region, name))
+                continue
+            where = "" if home in entry["sections"] else "  not placed"
+            share = ""
+            if samples:
+                share = "  {:>6} samples ({:.1f}%)".format(
+                    samples.get(name, 0), percent(samples.get(name, 0), total))
+            print("{}  {:<40} {:>6} bytes{}{}".format(region, name,
+                                                      entry["size"], share,
+                                                      where))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    generate = commands.add_parser("generate", help="根据采样生成放置片段")
+    generate.add_argument("elf", help="当前放置下构建的固件 elf 文件")
+    generate.add_argument("profile", help="采样文件")
+    generate.add_argument("-o", "--output", required=True,
+                          help="生成的 placement.ld")
+    generate.add_argument("--itcm-reserve", type=int, default=1024,
+                          help="itcm 预留给长跳转跳板与对齐的字节数")
+    generate.add_argument("--dtcm-budget", type=int, default=4096,
+                          help="放入 dtcm 的常量上限，占用的是堆空间")
+    generate.add_argument("--exclude", action="append", default=[],
+                          help="不参与放置的符号，可重复")
+
+    build = commands.add_parser("report", help="输出 tcm 利用率")
+    build.add_argument("elf", help="固件 elf 文件")
+    build.add_argument("--fragment", help="构建时使用的 placement.ld")
+    build.add_argument("--profile", help="采样文件，用于显示放置符号的占比")
+
+    args = parser.parse_args()
+    elf = Elf(args.elf)
+
+    if args.command == "generate":
+        samples = read_profile(args.profile)
+        placed = read_fragment(args.output)
+        exclude = set(args.exclude) | set(RESET_FUNCTIONS)
+        text, capacity, fixed = select_text(elf, samples, placed,
+                                            args.itcm_reserve, exclude)
+        rodata = select_rodata(elf, samples, args.dtcm_budget,
+                               exclude)
+        total = sum(samples.values())
+        write_fragment(args.output, args.profile, text, rodata, total)
+        print("itcm budget: {} bytes free of {} after {} tagged and {} "
+              "reserved".format(capacity - fixed - args.itcm_reserve,
+                                capacity, fixed, args.itcm_reserve))
+        for region, chosen in (("itcm", text), ("dtcm", rodata)):
+            for entry, count in chosen:
+                print("{}  {:<40} {:>6} bytes  {:>6} samples ({:.1f}%)".format(
+                    region, entry["name"], entry["size"], count,
+                    percent(count, total)))
+        print("relink to apply {}".format(args.output))
+    else:
+        samples = read_profile(args.profile) if args.profile else None
+        report(elf, read_fragment(args.fragment), samples)
+
+
+if __name__ == "__main__":
+    main()
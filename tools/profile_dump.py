@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""把 pc 采样直方图还原为函数热度。
+
+目标板在 usart1 上收到 'p' 后输出直方图帧，帧格式见
+include/thread/profile.h 与 source/thread/profile.c：
+
+    magic "PCPF" | type u8 | seq u8 | len u16 | 负载 | crc16(XMODEM)
+
+帧之间可能夹杂日志文本，按魔数查找并校验 crc。支持两种输入：
+
+    --capture 串口抓包文件；
+    --port    直接打开串口发送命令并等待结束帧，需要 pyserial。
+
+-o 输出 "<采样数> <符号>"，作为 tools/placement.py generate 的输入。
+
+用法：
+    profile_dump.py build/diffboot.elf --capture uart1.bin -o profile.txt
+    profile_dump.py build/diffboot.elf --port COM5 --baud 921600
+"""
+
+import argparse
+import bisect
+import binascii
+import struct
+import sys
+import time
+
+from placement import STT_FUNC, Elf
+
+MAGIC = b"PCPF"
+HEAD = struct.Struct("<4sBBH")
+START = struct.Struct("<8I2Q")
+ENTRY = struct.Struct("<II")
+FRAME_START, FRAME_DATA, FRAME_END = range(3)
+
+
+def frames(data, magic=MAGIC):
+    """逐帧解析，跳过日志文本与校验失败的帧。"""
+    pos = data.find(magic)
+    while pos >= 0 and pos + HEAD.size <= len(data):
+        _, ftype, seq, size = HEAD.unpack_from(data, pos)
+        end = pos + HEAD.size + size + 2
+        if end <= len(data):
+            crc, = struct.unpack_from("<H", data, end - 2)
+            if binascii.crc_hqx(data[pos + 4:end - 2], 0) == crc:
+                yield ftype, seq, data[pos + HEAD.size:end - 2]
+                pos = data.find(magic, end)
+                continue
+        pos = data.find(magic, pos + 1)
+
+
+def parse(data):
+    """返回最后一次完整输出的参数与直方图。"""
+    result = None
+    start, buckets, expect, lost = None, {}, 0, 0
+    for ftype, seq, payload in frames(data):
+        if ftype == FRAME_START:
+            start, buckets, expect, lost = START.unpack(payload), {}, 1, 0
+            continue
+        if start is None:
+            continue
+        if seq != expect:
+            lost += (seq - expect) & 0xFF
+        expect = (seq + 1) & 0xFF
+        if ftype == FRAME_DATA:
+            for i in range(0, len(payload), ENTRY.size):
+                addr, count = ENTRY.unpack_from(payload, i)
+                buckets[addr] = count
+        elif ftype == FRAME_END:
+            total, = struct.unpack("<I", payload)
+            result = (start, buckets, lost, total)
+            start = None
+    return result
+
+
+def read_port(port, baud, timeout):
+    import serial
+
+    data = bytearray()
+    with serial.Serial(port, baud, timeout=0.1) as link:
+        link.reset_input_buffer()
+        link.write(b"p")
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            data += link.read(4096)
+            if parse(bytes(data)) is not None:
+                break
+    return bytes(data)
+
+
+def symbolize(elf, buckets):
+    functions = sorted((s["addr"], s["addr"] + s["size"], s["name"])
+                       for s in elf.symbols if s["type"] == STT_FUNC)
+    starts = [f[0] for f in functions]
+    hits = {}
+    for addr, count in buckets.items():
+        i = bisect.bisect_right(starts, addr) - 1
+        if i >= 0 and addr < functions[i][1]:
+            name = functions[i][2]
+        else:
+            # 区间起点落在函数间的填充或字面量池中
+            name = "0x{:08x}".format(addr)
+        hits[name] = hits.get(name, 0) + count
+    return sorted(hits.items(), key=lambda item: -item[1])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="固件 elf 文件")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--capture", help="串口抓包文件")
+    source.add_argument("--port", help="串口名称")
+    parser.add_argument("--baud", type=int, default=115200, help="串口波特率")
+    parser.add_argument("--timeout", type=float, default=10.0,
+                        help="等待结束帧的秒数")
+    parser.add_argument("--top", type=int, default=30, help="显示的函数数量")
+    parser.add_argument("-o", "--output", help="输出采样文件")
+    args = parser.parse_args()
+
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        data = read_port(args.port, args.baud, args.timeout)
+
+    parsed = parse(data)
+    if parsed is None:
+        sys.exit("no complete profile dump found")
+    start, buckets, lost, total = parsed
+    (rate, shift, _, _, _, _, samples, other, cycles, elapsed) = start
+
+    print("rate {} Hz, bucket {} bytes, {} samples, {} outside code, "
+          "overhead {:.3f}%".format(rate, 1 << shift, samples, other,
+                                    100.0 * cycles / elapsed if elapsed
+                                    else 0.0))
+    if lost or len(buckets) != total:
+        print("warning: {} frames lost, {} of {} buckets received".format(
+            lost, len(buckets), total))
+
+    hits = symbolize(Elf(args.elf), buckets)
+    counted = sum(count for _, count in hits)
+    for name, count in hits[:args.top]:
+        print("{:>8} {:>6.2f}%  {}".format(count, 100.0 * count / counted,
+                                           name))
+
+    if args.output:
+        with open(args.output, "w", encoding="utf-8") as f:
+            f.write("# rate {} Hz, {} samples\n".format(rate, samples))
+            for name, count in hits:
+                f.write("{} {}\n".format(count, name))
+
+
+if __name__ == "__main__":
+    main()